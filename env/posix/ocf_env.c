@@ -6,6 +6,8 @@
 #include "ocf_env.h"
 #include <sched.h>
 #include <execinfo.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
 
 /* ALLOCATOR */
 struct _env_allocator {
@@ -110,6 +112,178 @@ void env_allocator_destroy(env_allocator *allocator)
 	}
 }
 
+/* LARGE MEMORY ALLOCATIONS */
+#define ENV_HUGEPAGE_SIZE	(2UL << 20)
+
+/*
+ * Mapped blocks are kept in a list rather than in a header in front of
+ * the block, so that blocks start at the (hugepage aligned) beginning of
+ * their mapping. There are only a few of them, one per large structure.
+ */
+struct env_large_block {
+	void *addr;
+	size_t map_size;
+	struct env_large_block *next;
+};
+
+static struct {
+	pthread_mutex_t lock;
+	struct env_mem_config config;
+	struct env_large_block *blocks;
+} env_mem = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.config = {
+		.hugepages = false,
+		.numa_policy = env_numa_default,
+	},
+};
+
+void env_mem_set_config(const struct env_mem_config *config)
+{
+	ENV_BUG_ON(pthread_mutex_lock(&env_mem.lock));
+	env_mem.config = *config;
+	pthread_mutex_unlock(&env_mem.lock);
+}
+
+void env_mem_get_config(struct env_mem_config *config)
+{
+	ENV_BUG_ON(pthread_mutex_lock(&env_mem.lock));
+	*config = env_mem.config;
+	pthread_mutex_unlock(&env_mem.lock);
+}
+
+static void env_mem_set_policy(void *addr, size_t size,
+		const struct env_mem_config *config)
+{
+	unsigned long nodemask = 0;
+	int mode;
+
+	switch (config->numa_policy) {
+	case env_numa_preferred:
+		mode = MPOL_PREFERRED;
+		break;
+	case env_numa_bind:
+		mode = MPOL_BIND;
+		break;
+	case env_numa_interleave:
+		mode = MPOL_INTERLEAVE;
+		break;
+	default:
+		return;
+	}
+
+	if (config->numa_policy == env_numa_interleave) {
+		/* Kernel restricts mask to nodes with memory */
+		nodemask = ~0UL;
+	} else if (config->numa_node >= 0 &&
+			config->numa_node < sizeof(nodemask) * 8) {
+		nodemask = 1UL << config->numa_node;
+	} else {
+		return;
+	}
+
+	/* Pages are not touched yet, so policy applies to all of them */
+	syscall(SYS_mbind, addr, size, mode, &nodemask,
+			sizeof(nodemask) * 8, 0);
+}
+
+static void *env_mem_map(size_t size, bool hugepages)
+{
+	int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+	size_t head, tail;
+	char *addr;
+
+	if (hugepages) {
+		/* Succeeds only if hugepages are reserved */
+		addr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+				flags | MAP_HUGETLB, -1, 0);
+		if (addr != MAP_FAILED)
+			return addr;
+
+		/* Transparent hugepages need aligned mapping */
+		addr = mmap(NULL, size + ENV_HUGEPAGE_SIZE,
+				PROT_READ | PROT_WRITE, flags, -1, 0);
+		if (addr == MAP_FAILED)
+			return NULL;
+
+		head = ENV_HUGEPAGE_SIZE - ((uintptr_t)addr %
+				ENV_HUGEPAGE_SIZE);
+		if (head == ENV_HUGEPAGE_SIZE)
+			head = 0;
+		tail = ENV_HUGEPAGE_SIZE - head;
+
+		if (head)
+			munmap(addr, head);
+		if (tail)
+			munmap(addr + head + size, tail);
+		addr += head;
+
+		madvise(addr, size, MADV_HUGEPAGE);
+		return addr;
+	}
+
+	addr = mmap(NULL, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+
+	return addr == MAP_FAILED ? NULL : addr;
+}
+
+void *env_large_alloc(size_t size)
+{
+	struct env_mem_config config;
+	struct env_large_block *block;
+	size_t map_size;
+
+	block = malloc(sizeof(*block));
+	if (!block)
+		return NULL;
+
+	env_mem_get_config(&config);
+
+	map_size = DIV_ROUND_UP(size, ENV_HUGEPAGE_SIZE) * ENV_HUGEPAGE_SIZE;
+	block->addr = env_mem_map(map_size, config.hugepages);
+	if (!block->addr) {
+		free(block);
+		return NULL;
+	}
+
+	env_mem_set_policy(block->addr, map_size, &config);
+	block->map_size = map_size;
+
+	ENV_BUG_ON(pthread_mutex_lock(&env_mem.lock));
+	block->next = env_mem.blocks;
+	env_mem.blocks = block;
+	pthread_mutex_unlock(&env_mem.lock);
+
+	return block->addr;
+}
+
+bool env_large_free(const void *ptr)
+{
+	struct env_large_block **curr, *block = NULL;
+
+	/* Mappings are page aligned, most malloc'ed blocks are not */
+	if ((uintptr_t)ptr % PAGE_SIZE)
+		return false;
+
+	ENV_BUG_ON(pthread_mutex_lock(&env_mem.lock));
+	for (curr = &env_mem.blocks; *curr; curr = &(*curr)->next) {
+		if ((*curr)->addr == ptr) {
+			block = *curr;
+			*curr = block->next;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&env_mem.lock);
+
+	if (!block)
+		return false;
+
+	munmap(block->addr, block->map_size);
+	free(block);
+
+	return true;
+}
+
 /* DEBUGING */
 #define ENV_TRACE_DEPTH	16
 
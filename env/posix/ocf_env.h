@@ -124,29 +124,94 @@ static inline void env_free(const void *ptr)
 	free((void *)ptr);
 }
 
+/* LARGE MEMORY ALLOCATIONS */
+/*
+ * Allocations of at least ENV_LARGE_ALLOC_MIN bytes (metadata segments,
+ * collision table, cache line locks) are mapped separately. If enabled
+ * in config (off by default), they are backed by explicit hugepages if any
+ * are reserved, or transparent hugepages otherwise. They are placed on NUMA
+ * nodes according to configured policy. Placement is best effort, memory
+ * is still allocated if it can not be applied. Mapped memory is always
+ * zeroed and starts at the beginning of its mapping, so it is aligned to
+ * hugepage size if backed by hugepages and to page size otherwise.
+ */
+#define ENV_LARGE_ALLOC_MIN	(2UL << 20)
+
+enum env_numa_policy {
+	/* First touch placement */
+	env_numa_default,
+	/* Prefer node, fall back to others */
+	env_numa_preferred,
+	/* Allocate strictly from node */
+	env_numa_bind,
+	/* Interleave pages across all nodes */
+	env_numa_interleave,
+};
+
+struct env_mem_config {
+	/* Back large allocations with hugepages */
+	bool hugepages;
+
+	/* NUMA placement of large allocations */
+	enum env_numa_policy numa_policy;
+
+	/* Node for preferred and bind policies */
+	int numa_node;
+};
+
+/* Applies to allocations made after the call */
+void env_mem_set_config(const struct env_mem_config *config);
+void env_mem_get_config(struct env_mem_config *config);
+
+/* Returns NULL if memory could not be mapped */
+void *env_large_alloc(size_t size);
+
+/*
+ * Unmaps block returned by env_large_alloc(). Returns false if ptr is not
+ * such block, e.g. it was allocated by malloc() when mapping failed.
+ */
+bool env_large_free(const void *ptr);
+
+static inline void *env_valloc(size_t size, bool zero)
+{
+	void *ptr;
+
+	if (size >= ENV_LARGE_ALLOC_MIN) {
+		ptr = env_large_alloc(size);
+		if (ptr)
+			return ptr;
+	}
+
+	return zero ? calloc(1, size) : malloc(size);
+}
+
 static inline void *env_vmalloc_flags(size_t size, int flags)
 {
-	return malloc(size);
+	return env_valloc(size, false);
 }
 
 static inline void *env_vzalloc_flags(size_t size, int flags)
 {
-	return env_zalloc(size, 0);
+	return env_valloc(size, true);
 }
 
 static inline void *env_vmalloc(size_t size)
 {
-	return malloc(size);
+	return env_vmalloc_flags(size, 0);
 }
 
 static inline void *env_vzalloc(size_t size)
 {
-	return env_zalloc(size, 0);
+	return env_vzalloc_flags(size, 0);
 }
 
 static inline void env_vfree(const void *ptr)
 {
-	free((void *)ptr);
+	if (!ptr)
+		return;
+
+	if (!env_large_free(ptr))
+		free((void *)ptr);
 }
 
 /* SECURE MEMORY MANAGEMENT */
@@ -166,11 +231,11 @@ static inline void env_vfree(const void *ptr)
 
 static inline void *env_secure_alloc(size_t size)
 {
-	void *ptr = malloc(size);
+	void *ptr = env_vmalloc(size);
 
 #if SECURE_MEMORY_HANDLING
 	if (ptr && mlock(ptr, size)) {
-		free(ptr);
+		env_vfree(ptr);
 		ptr = NULL;
 	}
 #endif
@@ -186,7 +251,7 @@ static inline void env_secure_free(const void *ptr, size_t size)
 		/* TODO: flush CPU caches ? */
 		ENV_BUG_ON(munlock(ptr));
 #endif
-		free((void*)ptr);
+		env_vfree(ptr);
 	}
 }
 
@@ -463,6 +528,11 @@ static inline void env_atomic64_sub(long i, env_atomic64 *a)
 	__sync_sub_and_fetch(&a->counter, i);
 }
 
+static inline long env_atomic64_sub_return(long i, env_atomic64 *a)
+{
+	return __sync_sub_and_fetch(&a->counter, i);
+}
+
 static inline void env_atomic64_inc(env_atomic64 *a)
 {
 	env_atomic64_add(1, a);
@@ -64,6 +64,23 @@ LogPageBlock::~LogPageBlock()
 	delete [] aPages;
 }
 
+/* the list link is not saved, owners relink their blocks on load */
+void LogPageBlock::save_state(Checkpoint &checkpoint) const
+{
+	checkpoint.put_bytes(pages, BLOCK_SIZE * sizeof(int));
+	checkpoint.put_bytes(aPages, BLOCK_SIZE * sizeof(long));
+	checkpoint.put_address(address);
+	checkpoint.put(numPages);
+}
+
+void LogPageBlock::load_state(Checkpoint &checkpoint)
+{
+	checkpoint.get_bytes(pages, BLOCK_SIZE * sizeof(int));
+	checkpoint.get_bytes(aPages, BLOCK_SIZE * sizeof(long));
+	checkpoint.get_address(address);
+	checkpoint.get(numPages);
+}
+
 /* Comparison class for use by FTL to sort the LogPageBlock compared to the number of pages written. */
 bool LogPageBlock::operator() (const LogPageBlock& lhs, const LogPageBlock& rhs) const
 {
@@ -163,8 +180,10 @@ enum status FtlImpl_Bast::write(Event &event)
 		controller.get_free_page(logBlockAddress);
 		event.set_address(logBlockAddress);
 	} else {
+		controller.gc_begin(event);
 		if (!is_sequential(logBlock, lba, event))
 			random_merge(logBlock, lba, event);
+		controller.gc_end(event);
 
 		allocate_new_logblock(logBlock, lba, event);
 		logBlock = log_map[lba];
@@ -216,7 +235,7 @@ enum status FtlImpl_Bast::trim(Event &event)
 		if (lBlock->get_state() == INACTIVE) // All pages invalid, force an erase. PTRIM style.
 		{
 			dispose_logblock(logBlock, lookupBlock);
-			Block_manager::instance()->erase_and_invalidate(event, returnAddress, LOG);
+			block_manager.erase_and_invalidate(event, returnAddress, LOG);
 		}
 
 	}
@@ -230,7 +249,7 @@ enum status FtlImpl_Bast::trim(Event &event)
 		if (dBlock->get_state() == INACTIVE) // All pages invalid, force an erase. PTRIM style.
 		{
 			data_list[lookupBlock] = -1;
-			Block_manager::instance()->erase_and_invalidate(event, dataAddress, DATA);
+			block_manager.erase_and_invalidate(event, dataAddress, DATA);
 		}
 
 	}
@@ -258,14 +277,16 @@ void FtlImpl_Bast::allocate_new_logblock(LogPageBlock *logBlock, long lba, Event
 		long exLogicalBlock = (*it).first;
 		LogPageBlock *exLogBlock = (*it).second;
 
+		controller.gc_begin(event);
 		if (!is_sequential(exLogBlock, exLogicalBlock, event))
 			random_merge(exLogBlock, exLogicalBlock, event);
+		controller.gc_end(event);
 
 		controller.stats.numPageBlockToPageConversion++;
 	}
 
 	logBlock = new LogPageBlock();
-	logBlock->address = Block_manager::instance()->get_free_block(LOG, event);
+	logBlock->address = block_manager.get_free_block(LOG, event);
 
 	//printf("Using new log block with address: %lu Block: %u\n", logBlock->address.get_linear_address(), logBlock->address.block);
 	log_map[lba] = logBlock;
@@ -294,13 +315,13 @@ bool FtlImpl_Bast::is_sequential(LogPageBlock* logBlock, long lba, Event &event)
 
 	if (isSequential)
 	{
-		Block_manager::instance()->promote_block(DATA);
+		block_manager.promote_block(DATA);
 
 		// Add to empty list i.e. switch without erasing the datablock.
 		if (data_list[lba] != -1)
 		{
 			Address a = Address(data_list[lba], PAGE);
-			Block_manager::instance()->erase_and_invalidate(event, a, DATA);
+			block_manager.erase_and_invalidate(event, a, DATA);
 		}
 
 		data_list[lba] = logBlock->address.get_linear_address();
@@ -326,7 +347,7 @@ bool FtlImpl_Bast::random_merge(LogPageBlock *logBlock, long lba, Event &event)
 	 */
 
 	Address eventAddress = Address(event.get_logical_address(), PAGE);
-	Address newDataBlock = Block_manager::instance()->get_free_block(DATA, event);
+	Address newDataBlock = block_manager.get_free_block(DATA, event);
 
 	int t=0;
 	for (uint i=0;i<BLOCK_SIZE;i++)
@@ -352,7 +373,7 @@ bool FtlImpl_Bast::random_merge(LogPageBlock *logBlock, long lba, Event &event)
 
 		Event writeEvent = Event(WRITE, event.get_logical_address(), 1, event.get_start_time()+readEvent.get_time_taken());
 		writeEvent.set_address(Address(newDataBlock.get_linear_address() + i, PAGE));
-		writeEvent.set_payload((char*)page_data + readAddress.get_linear_address() * PAGE_SIZE);
+		writeEvent.set_copy_address(readAddress);
 		writeEvent.set_replace_address(readAddress);
 		controller.issue(writeEvent);
 
@@ -370,12 +391,12 @@ bool FtlImpl_Bast::random_merge(LogPageBlock *logBlock, long lba, Event &event)
 
 	// Invalidate inactive pages (LOG and DATA
 
-	Block_manager::instance()->erase_and_invalidate(event, logBlock->address, LOG);
+	block_manager.erase_and_invalidate(event, logBlock->address, LOG);
 
 	if (data_list[lba] != -1)
 	{
 		Address a = Address(data_list[lba], PAGE);
-		Block_manager::instance()->erase_and_invalidate(event, a, DATA);
+		block_manager.erase_and_invalidate(event, a, DATA);
 	}
 
 	// Update mapping
@@ -405,6 +426,39 @@ void FtlImpl_Bast::update_map_block(Event &event)
 
 void FtlImpl_Bast::print_ftl_statistics()
 {
-	Block_manager::instance()->print_statistics();
+	block_manager.print_statistics();
 }
 
+
+void FtlImpl_Bast::save_state(Checkpoint &checkpoint) const
+{
+	ulong entries = log_map.size();
+
+	checkpoint.put_bytes(data_list, NUMBER_OF_ADDRESSABLE_BLOCKS * sizeof(long));
+	checkpoint.put(entries);
+	for (std::map<long, LogPageBlock*>::const_iterator it = log_map.begin(); it != log_map.end(); ++it)
+	{
+		checkpoint.put(it->first);
+		it->second->save_state(checkpoint);
+	}
+}
+
+void FtlImpl_Bast::load_state(Checkpoint &checkpoint)
+{
+	ulong entries;
+
+	for (std::map<long, LogPageBlock*>::iterator it = log_map.begin(); it != log_map.end(); ++it)
+		delete it->second;
+	log_map.clear();
+
+	checkpoint.get_bytes(data_list, NUMBER_OF_ADDRESSABLE_BLOCKS * sizeof(long));
+	checkpoint.get(entries);
+	for (ulong i = 0; checkpoint.ok() && i < entries; i++)
+	{
+		long lba;
+		checkpoint.get(lba);
+		LogPageBlock *logBlock = new LogPageBlock();
+		logBlock->load_state(checkpoint);
+		log_map[lba] = logBlock;
+	}
+}
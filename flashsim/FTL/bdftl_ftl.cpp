@@ -121,7 +121,7 @@ enum status FtlImpl_BDftl::write(Event &event)
 
 		// Get new block if necessary
 		if (block_map[dlbn].pbn == -1u && dlpn % BLOCK_SIZE == 0)
-			block_map[dlbn].pbn = Block_manager::instance()->get_free_block(DATA, event).get_linear_address();
+			block_map[dlbn].pbn = block_manager.get_free_block(DATA, event).get_linear_address();
 
 		if (block_map[dlbn].pbn != -1u)
 		{
@@ -287,7 +287,7 @@ enum status FtlImpl_BDftl::trim(Event &event)
 		{
 			block_map[dlbn].pbn = -1;
 			block_map[dlbn].nextPage = 0;
-			Block_manager::instance()->erase_and_invalidate(event, address, DATA);
+			block_manager.erase_and_invalidate(event, address, DATA);
 		}
 	} else { // DFTL lookup
 
@@ -370,7 +370,7 @@ void FtlImpl_BDftl::cleanup_block(Event &event, Block *block)
 			writeEvent.set_replace_address(Address(block->get_physical_address()+i, PAGE));
 
 			// Setup the write event to read from the right place.
-			writeEvent.set_payload((char*)page_data + (block->get_physical_address()+i) * PAGE_SIZE);
+			writeEvent.set_copy_address(Address(block->get_physical_address()+i, PAGE));
 
 			if (controller.issue(writeEvent) == FAILURE)
 				printf("Data block copy failed.");
@@ -450,6 +450,43 @@ void FtlImpl_BDftl::print_ftl_statistics()
 	}
 
 	printf(" Blocks optimal: %i\n", numOptimal);
-	Block_manager::instance()->print_statistics();
+	block_manager.print_statistics();
 }
 
+
+void FtlImpl_BDftl::save_state(Checkpoint &checkpoint) const
+{
+	std::queue<Block*> queue(blockQueue);
+	ulong entries = queue.size();
+
+	FtlImpl_DftlParent::save_state(checkpoint);
+	checkpoint.put_bytes(block_map, NUMBER_OF_ADDRESSABLE_BLOCKS * sizeof(BPage));
+	checkpoint.put_bytes(trim_map, NUMBER_OF_ADDRESSABLE_BLOCKS * BLOCK_SIZE * sizeof(bool));
+
+	/* blocks are saved by physical address, -1 for none */
+	checkpoint.put(inuseBlock == NULL ? -1L : inuseBlock->get_physical_address());
+	checkpoint.put(entries);
+	for (; !queue.empty(); queue.pop())
+		checkpoint.put(queue.front()->get_physical_address());
+}
+
+void FtlImpl_BDftl::load_state(Checkpoint &checkpoint)
+{
+	long physical_address;
+	ulong entries;
+
+	FtlImpl_DftlParent::load_state(checkpoint);
+	checkpoint.get_bytes(block_map, NUMBER_OF_ADDRESSABLE_BLOCKS * sizeof(BPage));
+	checkpoint.get_bytes(trim_map, NUMBER_OF_ADDRESSABLE_BLOCKS * BLOCK_SIZE * sizeof(bool));
+
+	checkpoint.get(physical_address);
+	inuseBlock = (physical_address < 0) ? NULL : get_block_pointer(Address(physical_address, PAGE));
+
+	blockQueue = std::queue<Block*>();
+	checkpoint.get(entries);
+	for (ulong i = 0; checkpoint.ok() && i < entries; i++)
+	{
+		checkpoint.get(physical_address);
+		blockQueue.push(get_block_pointer(Address(physical_address, PAGE)));
+	}
+}
@@ -158,7 +158,7 @@ void FtlImpl_Dftl::cleanup_block(Event &event, Block *block)
 			writeEvent.set_replace_address(Address(block->get_physical_address()+i, PAGE));
 
 			// Setup the write event to read from the right place.
-			writeEvent.set_payload((char*)page_data + (block->get_physical_address()+i) * PAGE_SIZE);
+			writeEvent.set_copy_address(Address(block->get_physical_address()+i, PAGE));
 
 			if (controller.issue(writeEvent) == FAILURE)
 				printf("Data block copy failed.");
@@ -217,5 +217,5 @@ void FtlImpl_Dftl::cleanup_block(Event &event, Block *block)
 
 void FtlImpl_Dftl::print_ftl_statistics()
 {
-	Block_manager::instance()->print_statistics();
+	block_manager.print_statistics();
 }
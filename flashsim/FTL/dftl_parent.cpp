@@ -37,6 +37,8 @@
 #include <queue>
 #include <iostream>
 #include <limits>
+#include <algorithm>
+#include <boost/ref.hpp>
 #include "ssd.h"
 
 using namespace ssd;
@@ -127,10 +129,10 @@ long FtlImpl_DftlParent::get_free_data_page(Event &event)
 long FtlImpl_DftlParent::get_free_data_page(Event &event, bool insert_events)
 {
 	if (currentDataPage == -1 || (currentDataPage % BLOCK_SIZE == BLOCK_SIZE -1 && insert_events))
-		Block_manager::instance()->insert_events(event);
+		block_manager.insert_events(event);
 
 	if (currentDataPage == -1 || currentDataPage % BLOCK_SIZE == BLOCK_SIZE -1)
-		currentDataPage = Block_manager::instance()->get_free_block(DATA, event).get_linear_address();
+		currentDataPage = block_manager.get_free_block(DATA, event).get_linear_address();
 	else
 		currentDataPage++;
 
@@ -286,3 +288,54 @@ void FtlImpl_DftlParent::update_translation_map(FtlImpl_DftlParent::MPage &mpage
 	mpage.ppn = ppn;
 	reverse_trans_map[ppn] = mpage.vpn;
 }
+
+/* the translation pages are saved in LRU order, which also fixes the order
+ * of entries with equal visit times, so evictions replay identically */
+void FtlImpl_DftlParent::save_state(Checkpoint &checkpoint) const
+{
+	uint ssdSize = NUMBER_OF_ADDRESSABLE_BLOCKS * BLOCK_SIZE;
+
+	checkpoint.put(cmt);
+	checkpoint.put(currentDataPage);
+	checkpoint.put(currentTranslationPage);
+	checkpoint.put_bytes(reverse_trans_map, ssdSize * sizeof(long));
+
+	const MpageByLastVisited &lru = trans_map.get<1>();
+	for (MpageByLastVisited::const_iterator it = lru.begin(); it != lru.end(); ++it)
+		checkpoint.put(*it);
+}
+
+void FtlImpl_DftlParent::load_state(Checkpoint &checkpoint)
+{
+	uint ssdSize = NUMBER_OF_ADDRESSABLE_BLOCKS * BLOCK_SIZE;
+	uint i;
+
+	checkpoint.get(cmt);
+	checkpoint.get(currentDataPage);
+	checkpoint.get(currentTranslationPage);
+	checkpoint.get_bytes(reverse_trans_map, ssdSize * sizeof(long));
+
+	std::vector<MPage> pages;
+	pages.reserve(ssdSize);
+	for (i = 0; checkpoint.ok() && i < ssdSize; i++)
+	{
+		MPage mpage(0);
+		checkpoint.get(mpage);
+		pages.push_back(mpage);
+	}
+	if (!checkpoint.ok())
+		return;
+
+	/* insert in LRU order, then put the sequenced index back in vpn order
+	 * since the FTL indexes it by vpn */
+	trans_map.clear();
+	for (i = 0; i < ssdSize; i++)
+		trans_map.push_back(pages[i]);
+
+	std::vector<boost::reference_wrapper<const MPage> > by_vpn;
+	by_vpn.reserve(ssdSize);
+	for (MpageByID::iterator it = trans_map.begin(); it != trans_map.end(); ++it)
+		by_vpn.push_back(boost::cref(*it));
+	std::sort(by_vpn.begin(), by_vpn.end(), [](const MPage &lhs, const MPage &rhs) { return lhs.vpn < rhs.vpn; });
+	trans_map.rearrange(by_vpn.begin());
+}
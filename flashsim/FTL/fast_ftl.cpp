@@ -71,13 +71,13 @@ void FtlImpl_Fast::initialize_log_pages()
 	Event event = Event(WRITE, 1, 1, 0);
 	// RW
 	log_pages = new LogPageBlock;
-	log_pages->address = Block_manager::instance()->get_free_block(LOG, event);
+	log_pages->address = block_manager.get_free_block(LOG, event);
 
 	LogPageBlock *next = log_pages;
 	for (uint i=0;i<FAST_LOG_BLOCK_LIMIT-1;i++)
 	{
 		LogPageBlock *newLPB = new LogPageBlock();
-		newLPB->address = Block_manager::instance()->get_free_block(LOG, event);
+		newLPB->address = block_manager.get_free_block(LOG, event);
 		next->next = newLPB;
 		next = newLPB;
 	}
@@ -152,7 +152,7 @@ enum status FtlImpl_Fast::write(Event &event)
 	// if a collision occurs at offset of the data block of pbn.
 	if (data_list[logicalBlockAddress] == -1)
 	{
-		Address newBlock = Block_manager::instance()->get_free_block(DATA, event);
+		Address newBlock = block_manager.get_free_block(DATA, event);
 
 		// Register the mapping
 		data_list[logicalBlockAddress] = newBlock.get_linear_address();
@@ -173,7 +173,7 @@ enum status FtlImpl_Fast::write(Event &event)
 	}
 
 	// Insert go sarbage collection
-	Block_manager::instance()->insert_events(event);
+	block_manager.insert_events(event);
 
 	// Statistics
 	controller.stats.numFTLWrite++;
@@ -210,7 +210,7 @@ enum status FtlImpl_Fast::trim(Event &event)
 
 				if (block->get_state() == INACTIVE) // All pages invalid, force an erase. PTRIM style.
 				{
-					Block_manager::instance()->erase_and_invalidate(event, currentBlock->address, LOG);
+					block_manager.erase_and_invalidate(event, currentBlock->address, LOG);
 					data_list[lookupBlock] = -1;
 				}
 
@@ -233,7 +233,7 @@ enum status FtlImpl_Fast::trim(Event &event)
 
 			if (block->get_state() == INACTIVE) // All pages invalid, force an erase. PTRIM style.
 			{
-				Block_manager::instance()->erase_and_invalidate(event, address, LOG);
+				block_manager.erase_and_invalidate(event, address, LOG);
 				sequential_logicalblock_address = -1;
 			}
 
@@ -247,7 +247,7 @@ enum status FtlImpl_Fast::trim(Event &event)
 
 			if (block->get_state() == INACTIVE) // All pages invalid, force an erase. PTRIM style.
 			{
-				Block_manager::instance()->erase_and_invalidate(event, address, LOG);
+				block_manager.erase_and_invalidate(event, address, LOG);
 				data_list[lookupBlock] = -1;
 			}
 		}
@@ -257,7 +257,7 @@ enum status FtlImpl_Fast::trim(Event &event)
 	event.set_address(Address(0, PAGE));
 
 	// Insert garbage collection
-	Block_manager::instance()->insert_events(event);
+	block_manager.insert_events(event);
 
 	// Statistics
 	controller.stats.numFTLTrim++;
@@ -270,7 +270,7 @@ void FtlImpl_Fast::switch_sequential(Event &event)
 	// Add to empty list i.e. switch without erasing the datablock.
 
 	if (data_list[sequential_logicalblock_address] != -1)
-		Block_manager::instance()->invalidate(Address(data_list[sequential_logicalblock_address], BLOCK), DATA);
+		block_manager.invalidate(Address(data_list[sequential_logicalblock_address], BLOCK), DATA);
 
 	data_list[sequential_logicalblock_address] = sequential_address.get_linear_address();
 
@@ -287,11 +287,11 @@ void FtlImpl_Fast::merge_sequential(Event &event)
 	// Do merge (n reads, n writes and 2 erases (gc'ed))
 	Address eventAddress = Address(event.get_logical_address(), PAGE);
 
-	Address newDataBlock = Block_manager::instance()->get_free_block(DATA, event);
+	Address newDataBlock = block_manager.get_free_block(DATA, event);
 	//printf("Using new data block with address: %lu Block: %u\n", newDataBlock.get_linear_address(), newDataBlock.block);
 
-	if (Block_manager::instance()->get_num_free_blocks() < 5)
-		Block_manager::instance()->insert_events(event);
+	if (block_manager.get_num_free_blocks() < 5)
+		block_manager.insert_events(event);
 
 	for (uint i=0;i<BLOCK_SIZE;i++)
 	{
@@ -311,7 +311,7 @@ void FtlImpl_Fast::merge_sequential(Event &event)
 		if (controller.issue(readEvent) == FAILURE) { printf("Read failed\n"); return; }
 
 		Event writeEvent = Event(WRITE, event.get_logical_address(), 1, event.get_start_time()+readEvent.get_time_taken());
-		writeEvent.set_payload((char*)page_data + readAddress.get_linear_address() * PAGE_SIZE);
+		writeEvent.set_copy_address(readAddress);
 		writeEvent.set_address(Address(newDataBlock.get_linear_address() + i, PAGE));
 		if (controller.issue(writeEvent) == FAILURE) {  printf("Write failed\n"); return; }
 
@@ -325,9 +325,9 @@ void FtlImpl_Fast::merge_sequential(Event &event)
 	}
 
 	// Invalidate inactive pages
-	Block_manager::instance()->invalidate(&sequential_address, DATA);
+	block_manager.invalidate(&sequential_address, DATA);
 	if (data_list[sequential_logicalblock_address] != -1)
-		Block_manager::instance()->invalidate(Address(data_list[sequential_logicalblock_address], BLOCK), DATA);
+		block_manager.invalidate(Address(data_list[sequential_logicalblock_address], BLOCK), DATA);
 
 	// Update mapping
 	data_list[sequential_logicalblock_address] = newDataBlock.get_linear_address();
@@ -361,10 +361,10 @@ bool FtlImpl_Fast::random_merge(LogPageBlock *logBlock, Event &event)
 		for (uint i=0;i<BLOCK_SIZE;++i)
 			pinned[i] = false;
 
-		if (Block_manager::instance()->get_num_free_blocks() < 5)
-			Block_manager::instance()->insert_events(event);
+		if (block_manager.get_num_free_blocks() < 5)
+			block_manager.insert_events(event);
 
-		Address mergeAddress = Block_manager::instance()->get_free_block(DATA, event);
+		Address mergeAddress = block_manager.get_free_block(DATA, event);
 
 		long victimLBA = m->first;
 		if (victimLBA == -1)
@@ -404,7 +404,7 @@ bool FtlImpl_Fast::random_merge(LogPageBlock *logBlock, Event &event)
 						//event.consolidate_metaevent(readEvent);
 
 						Event writeEvent = Event(WRITE, event.get_logical_address(), 1, event.get_start_time()+readEvent.get_time_taken());
-						writeEvent.set_payload((char*)page_data + readAddress.get_linear_address() * PAGE_SIZE);
+						writeEvent.set_copy_address(readAddress);
 						writeEvent.set_address(writeAddress);
 
 						if (controller.issue(writeEvent) == FAILURE) { printf("failed\n"); return false; }
@@ -441,7 +441,7 @@ bool FtlImpl_Fast::random_merge(LogPageBlock *logBlock, Event &event)
 
 					// Write the page to merge address
 					Event writeEvent = Event(WRITE, event.get_logical_address(), 1, event.get_start_time()+readEvent.get_time_taken());
-					writeEvent.set_payload((char*)page_data + readAddress.get_linear_address() * PAGE_SIZE);
+					writeEvent.set_copy_address(readAddress);
 					writeEvent.set_address(writeAddress);
 					if (controller.issue(writeEvent) == FAILURE) { printf("failed\n"); return false;	}
 					//event.consolidate_metaevent(writeEvent);
@@ -460,7 +460,7 @@ bool FtlImpl_Fast::random_merge(LogPageBlock *logBlock, Event &event)
 		}
 
 		// Invalidate inactive pages
-		Block_manager::instance()->invalidate(Address(data_list[victimLBA], BLOCK), DATA);
+		block_manager.invalidate(Address(data_list[victimLBA], BLOCK), DATA);
 
 		data_list[victimLBA] = mergeAddress.get_linear_address();
 
@@ -490,7 +490,9 @@ bool FtlImpl_Fast::write_to_log_block(Event &event, long logicalBlockAddress)
 			 * merge the SW log block with its corresponding data block
 			 * after merge, the two blocks are erased and returned to the free-block list
 			 */
+			controller.gc_begin(event);
 			merge_sequential(event);
+			controller.gc_end(event);
 		}
 
 		/* Get a block from the free-block list and use it as a SW log block
@@ -499,7 +501,7 @@ bool FtlImpl_Fast::write_to_log_block(Event &event, long logicalBlockAddress)
 		 */
 
 		sequential_offset = 1;
-		sequential_address = Block_manager::instance()->get_free_block(DATA, event);
+		sequential_address = block_manager.get_free_block(DATA, event);
 		sequential_logicalblock_address = logicalBlockAddress;
 
 		event.set_address(sequential_address);
@@ -520,10 +522,12 @@ bool FtlImpl_Fast::write_to_log_block(Event &event, long logicalBlockAddress)
 			} else {
 				// Merge the SW log block with its corresponding data block
 				// Get a block from the free-block list and use it as a SW log block
+				controller.gc_begin(event);
 				merge_sequential(event);
+				controller.gc_end(event);
 
 				sequential_offset = 1;
-				sequential_address = Block_manager::instance()->get_free_block(DATA, event);
+				sequential_address = block_manager.get_free_block(DATA, event);
 				sequential_logicalblock_address = logicalBlockAddress;
 
 				// Append data to the SW log block
@@ -542,16 +546,18 @@ bool FtlImpl_Fast::write_to_log_block(Event &event, long logicalBlockAddress)
 
 				LogPageBlock *victim = log_pages;
 
+				controller.gc_begin(event);
 				random_merge(victim, event);
+				controller.gc_end(event);
 
 				// Maintain the log page list
 				log_pages = log_pages->next;
-				Block_manager::instance()->invalidate(&victim->address, LOG);
+				block_manager.invalidate(&victim->address, LOG);
 				delete victim;
 
 				// Create new LogPageBlock and append it to the log_pages list.
 				LogPageBlock *newLPB = new LogPageBlock();
-				newLPB->address = Block_manager::instance()->get_free_block(LOG, event);
+				newLPB->address = block_manager.get_free_block(LOG, event);
 
 				LogPageBlock *next = log_pages;
 				while (next->next != NULL) next = next->next;
@@ -598,6 +604,58 @@ void FtlImpl_Fast::update_map_block(Event &event)
 
 void FtlImpl_Fast::print_ftl_statistics()
 {
-	Block_manager::instance()->print_statistics();
+	block_manager.print_statistics();
 }
 
+
+void FtlImpl_Fast::save_state(Checkpoint &checkpoint) const
+{
+	ulong entries = 0;
+	LogPageBlock *lpb;
+
+	checkpoint.put_bytes(data_list, NUMBER_OF_ADDRESSABLE_BLOCKS * sizeof(long));
+	checkpoint.put_bytes(pin_list, NUMBER_OF_ADDRESSABLE_BLOCKS * BLOCK_SIZE * sizeof(bool));
+	checkpoint.put(sequential_logicalblock_address);
+	checkpoint.put_address(sequential_address);
+	checkpoint.put(sequential_offset);
+	checkpoint.put(log_page_next);
+
+	/* log blocks in list order, none if they are not initialised yet */
+	for (lpb = log_pages; lpb != NULL; lpb = lpb->next)
+		entries++;
+	checkpoint.put(entries);
+	for (lpb = log_pages; lpb != NULL; lpb = lpb->next)
+		lpb->save_state(checkpoint);
+}
+
+void FtlImpl_Fast::load_state(Checkpoint &checkpoint)
+{
+	ulong entries;
+	LogPageBlock *last = NULL;
+
+	while (log_pages != NULL)
+	{
+		LogPageBlock *next = log_pages->next;
+		delete log_pages;
+		log_pages = next;
+	}
+
+	checkpoint.get_bytes(data_list, NUMBER_OF_ADDRESSABLE_BLOCKS * sizeof(long));
+	checkpoint.get_bytes(pin_list, NUMBER_OF_ADDRESSABLE_BLOCKS * BLOCK_SIZE * sizeof(bool));
+	checkpoint.get(sequential_logicalblock_address);
+	checkpoint.get_address(sequential_address);
+	checkpoint.get(sequential_offset);
+	checkpoint.get(log_page_next);
+
+	checkpoint.get(entries);
+	for (ulong i = 0; checkpoint.ok() && i < entries; i++)
+	{
+		LogPageBlock *lpb = new LogPageBlock();
+		lpb->load_state(checkpoint);
+		if (last == NULL)
+			log_pages = lpb;
+		else
+			last->next = lpb;
+		last = lpb;
+	}
+}
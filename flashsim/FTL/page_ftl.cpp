@@ -17,7 +17,18 @@
 
 /****************************************************************************/
 
-/* Implements a very simple page-level FTL without merge */
+/* Implements a page-level FTL
+ *
+ * Every logical page is mapped to any physical page.  Writes go out of place
+ * to the current write block and invalidate the previous copy.  When the
+ * erased blocks run low, garbage collection picks victim blocks (greedy or
+ * cost-benefit, see GC_POLICY), relocates their valid pages to a separate GC
+ * write block and erases them.  The over-provisioned blocks (see
+ * OVERPROVISIONING) are the spare area that keeps this possible.  With
+ * BACKGROUND_GC, blocks are also cleaned ahead of time in idle periods.
+ * With NVME_QUEUES, host writes are striped over one write block per die (per
+ * plane with DIE_MULTI_PLANE) and each goes to the die that is free first.
+ */
 
 #include <new>
 #include <assert.h>
@@ -27,26 +38,60 @@
 
 using namespace ssd;
 
+// Erased blocks kept back so that GC always has a block to relocate into.
+static const ulong GC_RESERVE_BLOCKS = 2;
+
 FtlImpl_Page::FtlImpl_Page(Controller &controller):
 	FtlParent(controller)
 {
-	trim_map = new bool[NUMBER_OF_ADDRESSABLE_BLOCKS * BLOCK_SIZE];
+	logical_pages = (ulong) NUMBER_OF_ADDRESSABLE_BLOCKS * BLOCK_SIZE;
+	physical_pages = (ulong) SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE * BLOCK_SIZE / VIRTUAL_PAGE_SIZE;
+
+	currentPage = -1;
+	currentGCPage = -1;
+
+	if (NVME_QUEUES > 0)
+		diePages.assign(SSD_SIZE * PACKAGE_SIZE * (DIE_MULTI_PLANE ? DIE_SIZE : 1), -1);
+
+	map = new long[logical_pages];
+	for (ulong i = 0; i < logical_pages; i++)
+		map[i] = -1;
 
-	numPagesActive = 0;
+	reverse_map = new long[physical_pages];
+	for (ulong i = 0; i < physical_pages; i++)
+		reverse_map[i] = -1;
+
+	printf("Using page FTL: %lu logical pages on %lu physical pages (%u%% over-provisioning), %s GC.\n", logical_pages, physical_pages, OVERPROVISIONING, GC_POLICY == GC_COST_BENEFIT ? "cost-benefit" : "greedy");
 
 	return;
 }
 
 FtlImpl_Page::~FtlImpl_Page(void)
 {
+	delete[] map;
+	delete[] reverse_map;
 
 	return;
 }
 
 enum status FtlImpl_Page::read(Event &event)
 {
-	event.set_address(Address(0, PAGE));
-	event.set_noop(true);
+	ulong lpn = event.get_logical_address();
+
+	if (lpn >= logical_pages)
+	{
+		fprintf(stderr, "Page FTL error: %s: logical page %lu beyond the %lu addressable pages\n", __func__, lpn, logical_pages);
+		return FAILURE;
+	}
+
+	if (map[lpn] == -1)
+	{
+		// Never written, nothing to read from flash.
+		event.set_address(Address(0, PAGE));
+		event.set_noop(true);
+	}
+	else
+		event.set_address(Address(map[lpn], PAGE));
 
 	controller.stats.numFTLRead++;
 
@@ -55,65 +100,187 @@ enum status FtlImpl_Page::read(Event &event)
 
 enum status FtlImpl_Page::write(Event &event)
 {
-	event.set_address(Address(1, PAGE));
-	event.set_noop(true);
+	ulong lpn = event.get_logical_address();
 
-	controller.stats.numFTLWrite++;
+	if (lpn >= logical_pages)
+	{
+		fprintf(stderr, "Page FTL error: %s: logical page %lu beyond the %lu addressable pages\n", __func__, lpn, logical_pages);
+		return FAILURE;
+	}
 
-	if (numPagesActive == NUMBER_OF_ADDRESSABLE_BLOCKS * BLOCK_SIZE)
+	long ppn;
+	if (diePages.empty())
+		ppn = get_free_page(event, currentPage, true);
+	else
 	{
-		numPagesActive -= BLOCK_SIZE;
+		uint die = controller.get_idle_die();
+		ppn = get_free_page(event, diePages[die], true, die);
+	}
+	if (ppn == -1)
+		return FAILURE;
 
-		Event eraseEvent = Event(ERASE, event.get_logical_address(), 1, event.get_start_time());
-		eraseEvent.set_address(Address(0, PAGE));
+	if (map[lpn] != -1)
+	{
+		event.set_replace_address(Address(map[lpn], PAGE));
+		reverse_map[map[lpn]] = -1;
+	}
 
-		if (controller.issue(eraseEvent) == FAILURE) printf("Erase failed");
+	map[lpn] = ppn;
+	reverse_map[ppn] = lpn;
+	event.set_address(Address(ppn, PAGE));
+
+	controller.stats.numFTLWrite++;
 
-		event.incr_time_taken(eraseEvent.get_time_taken());
+	return controller.issue(event);
+}
 
-		controller.stats.numFTLErase++;
+enum status FtlImpl_Page::trim(Event &event)
+{
+	ulong lpn = event.get_logical_address();
+
+	if (lpn >= logical_pages)
+	{
+		fprintf(stderr, "Page FTL error: %s: logical page %lu beyond the %lu addressable pages\n", __func__, lpn, logical_pages);
+		return FAILURE;
 	}
 
-	numPagesActive++;
+	event.set_address(Address(0, PAGE));
 
+	if (map[lpn] != -1)
+	{
+		Address address = Address(map[lpn], PAGE);
+		controller.get_block_pointer(address)->invalidate_page(address.page);
+
+		reverse_map[map[lpn]] = -1;
+		map[lpn] = -1;
+	}
+
+	controller.stats.numFTLTrim++;
 
 	return controller.issue(event);
 }
 
-enum status FtlImpl_Page::trim(Event &event)
+/*
+ * Returns the next page of a write block, opening a new block (on the given
+ * die if not -1) when the current one is full.  Host writes clean first if
+ * erased blocks run low.  Returns -1 when no space could be reclaimed.
+ */
+long FtlImpl_Page::get_free_page(Event &event, long &frontier, bool collect, long die)
 {
-	controller.stats.numFTLTrim++;
+	if (frontier == -1 || frontier % BLOCK_SIZE == 0)
+	{
+		if (collect && block_manager.get_num_clean_blocks() < GC_RESERVE_BLOCKS)
+		{
+			controller.gc_begin(event);
+			enum status status = garbage_collect(event);
+			controller.gc_end(event);
 
-	uint dlpn = event.get_logical_address();
+			if (status == FAILURE)
+				return -1;
+		}
 
-	if (!trim_map[event.get_logical_address()])
-		trim_map[event.get_logical_address()] = true;
+		frontier = block_manager.get_free_block(DATA, event, die).get_linear_address();
+	}
+
+	return frontier++;
+}
 
-	// Update trim map and update block map if all pages are trimmed. i.e. the state are reseted to optimal.
-	long addressStart = dlpn - dlpn % BLOCK_SIZE;
-	bool allTrimmed = true;
-	for (uint i=addressStart;i<addressStart+BLOCK_SIZE;i++)
+/*
+ * Reclaims blocks until the reserve of erased blocks is restored.
+ */
+enum status FtlImpl_Page::garbage_collect(Event &event)
+{
+	while (block_manager.get_num_clean_blocks() < GC_RESERVE_BLOCKS)
 	{
-		if (!trim_map[i])
-			allTrimmed = false;
+		Block *victim = block_manager.get_gc_victim((enum gc_policy) GC_POLICY, event.get_start_time());
+
+		if (victim == NULL)
+		{
+			fprintf(stderr, "Page FTL error: %s: no block left to reclaim, increase OVERPROVISIONING\n", __func__);
+			return FAILURE;
+		}
+
+		cleanup_block(event, victim);
+
+		Address address = Address(victim->get_physical_address(), BLOCK);
+		block_manager.erase_and_invalidate(event, address, DATA);
+		controller.stats.numGCErase++;
 	}
 
-	if (allTrimmed)
+	return SUCCESS;
+}
+
+/*
+ * Copies the valid pages of the victim to the GC write block, so it can be
+ * erased.  Also used by background cleaning (see BACKGROUND_GC).
+ */
+void FtlImpl_Page::cleanup_block(Event &event, Block *victim)
+{
+	long victim_address = victim->get_physical_address();
+
+	for (uint i = 0; i < BLOCK_SIZE; i++)
 	{
-		Event eraseEvent = Event(ERASE, event.get_logical_address(), 1, event.get_start_time());
-		eraseEvent.set_address(Address(0, PAGE));
+		if (victim->get_state(i) != VALID)
+			continue;
+
+		long old_ppn = victim_address + i;
+		long lpn = reverse_map[old_ppn];
+		assert(lpn != -1);
+
+		// Copies go one after the other, each starting when the last is done.
+		double copy_time = event.get_start_time() + event.get_time_taken();
+
+		Event read_event = Event(READ, lpn, 1, copy_time);
+		read_event.set_address(Address(old_ppn, PAGE));
 
-		if (controller.issue(eraseEvent) == FAILURE) printf("Erase failed");
+		if (controller.issue(read_event) == FAILURE)
+			fprintf(stderr, "Page FTL error: %s: relocation read of page %li failed\n", __func__, old_ppn);
 
-		event.incr_time_taken(eraseEvent.get_time_taken());
+		long new_ppn = get_free_page(event, currentGCPage, false);
 
-		for (uint i=addressStart;i<addressStart+BLOCK_SIZE;i++)
-			trim_map[i] = false;
+		Event write_event = Event(WRITE, lpn, 1, copy_time + read_event.get_time_taken());
+		write_event.set_address(Address(new_ppn, PAGE));
+		write_event.set_replace_address(Address(old_ppn, PAGE));
+		write_event.set_copy_address(Address(old_ppn, PAGE));
 
-		controller.stats.numFTLErase++;
+		if (controller.issue(write_event) == FAILURE)
+			fprintf(stderr, "Page FTL error: %s: relocation write of page %li failed\n", __func__, old_ppn);
 
-		numPagesActive -= BLOCK_SIZE;
+		event.incr_time_taken(read_event.get_time_taken() + write_event.get_time_taken());
+
+		map[lpn] = new_ppn;
+		reverse_map[new_ppn] = lpn;
+		reverse_map[old_ppn] = -1;
+
+		controller.stats.numGCRead++;
+		controller.stats.numGCWrite++;
 	}
+}
 
-	return SUCCESS;
+void FtlImpl_Page::print_ftl_statistics()
+{
+	printf("Page FTL:\n");
+	printf("-----------\n");
+	printf("Host Writes: %li\t GC Writes: %li\t GC Erases: %li\t Background GC Erases: %li\n", controller.stats.numFTLWrite, controller.stats.numGCWrite, controller.stats.numGCErase, controller.stats.numBackgroundGCErase);
+	printf("Write Amplification: %f\n", controller.stats.write_amplification());
+	printf("-----------\n");
+	block_manager.print_statistics();
+}
+
+void FtlImpl_Page::save_state(Checkpoint &checkpoint) const
+{
+	checkpoint.put(currentPage);
+	checkpoint.put(currentGCPage);
+	checkpoint.put_bytes(diePages.data(), diePages.size() * sizeof(long));
+	checkpoint.put_bytes(map, logical_pages * sizeof(long));
+	checkpoint.put_bytes(reverse_map, physical_pages * sizeof(long));
+}
+
+void FtlImpl_Page::load_state(Checkpoint &checkpoint)
+{
+	checkpoint.get(currentPage);
+	checkpoint.get(currentGCPage);
+	checkpoint.get_bytes(diePages.data(), diePages.size() * sizeof(long));
+	checkpoint.get_bytes(map, logical_pages * sizeof(long));
+	checkpoint.get_bytes(reverse_map, physical_pages * sizeof(long));
 }
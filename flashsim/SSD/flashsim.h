@@ -0,0 +1,106 @@
+/* flashsim.h is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* flashsim.h
+ * C interface to the simulator, for programs that link libflashsim.a
+ * instead of talking to a standalone server over its socket.
+ *
+ * Devices are addressed in bytes.  Requests that do not cover whole pages are
+ * widened to the pages they touch; the untouched part of a partially written
+ * page is read from the device first.  Times are simulated milliseconds.
+ *
+ * Asynchronous requests arrive at the current simulated time and complete
+ * from the event loop, a thread shared by all devices so that they run on one
+ * timeline.  With FLASHSIM_CLOCK_VIRTUAL the loop completes requests as fast
+ * as it can, in order of their completion times, and the simulated time
+ * jumps to each completion.  With FLASHSIM_CLOCK_REAL the simulated time
+ * follows the real time since the first device was opened, multiplied by the time
+ * scale, and every request completes when its completion time is reached.
+ *
+ * All functions may be called from any thread, including from completion
+ * callbacks; the simulation itself runs under one lock. */
+
+#ifndef _FLASHSIM_H
+#define _FLASHSIM_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct flashsim_dev;
+
+enum flashsim_dir {
+	FLASHSIM_READ = 0,
+	FLASHSIM_WRITE = 1,
+	FLASHSIM_TRIM = 2,
+	/* writes back the controller's write buffer, addr and bytes are
+	 * ignored */
+	FLASHSIM_FLUSH = 3
+};
+
+enum flashsim_clock {
+	FLASHSIM_CLOCK_VIRTUAL = 0,
+	FLASHSIM_CLOCK_REAL = 1
+};
+
+/* completion of an asynchronous request: 0 or a negative errno, and the
+ * simulated time the request completed at */
+typedef void (*flashsim_end_t)(void *priv, int error, double completion_time);
+
+/* selects the clock of the event loop, scale is simulated milliseconds per
+ * real millisecond (FLASHSIM_CLOCK_REAL); the simulated time starts at 0 when
+ * the first device is opened
+ * only allowed while no device is open, returns 0 or -EBUSY / -EINVAL */
+int flashsim_set_clock(enum flashsim_clock clock, double scale);
+
+/* the current simulated time */
+double flashsim_now(void);
+
+/* a device configured by config_file (ssd.conf format), NULL if the file
+ * cannot be read */
+struct flashsim_dev *flashsim_open(const char *config_file);
+
+/* waits for the outstanding requests of the device, then destroys it */
+void flashsim_close(struct flashsim_dev *dev);
+
+uint32_t flashsim_get_page_size(const struct flashsim_dev *dev);
+
+/* host visible capacity in bytes */
+uint64_t flashsim_get_capacity(const struct flashsim_dev *dev);
+
+/* simulates a request arriving at start_time, without the event loop, and
+ * returns its service time, or a negative errno
+ * reads fill buf when data pages are enabled and zero it otherwise */
+double flashsim_io(struct flashsim_dev *dev, enum flashsim_dir dir,
+		uint64_t addr, uint32_t bytes, double start_time, void *buf);
+
+/* submits a request arriving now; end is called from the event loop when it
+ * completes, buf must stay valid until then
+ * returns 0, or a negative errno without calling end */
+int flashsim_submit(struct flashsim_dev *dev, enum flashsim_dir dir,
+		uint64_t addr, uint32_t bytes, void *buf, flashsim_end_t end,
+		void *priv);
+
+void flashsim_print_statistics(struct flashsim_dev *dev);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -29,7 +29,9 @@
 #include <stdio.h>
 #include <vector>
 #include <queue>
+#include <deque>
 #include <map>
+#include <unordered_map>
 #include <boost/multi_index_container.hpp>
 #include <boost/multi_index/identity.hpp>
 #include <boost/multi_index/ordered_index.hpp>
@@ -55,116 +57,216 @@ typedef unsigned int uint;
 typedef unsigned long ulong;
 
 
-/* Simulator configuration from ssd_config.cpp */
+/* Simulator configuration from ssd_config.cpp
+ * Every Ssd holds its own copy of the configuration, so devices that differ in
+ * geometry, timing or FTL can be simulated side by side in one process.  The
+ * parameters are read through the macros below, which refer to the current
+ * configuration: an Ssd makes its own configuration current for the duration
+ * of every call into it (see Config_scope).  Outside of those calls, the
+ * current configuration is the default one that load_config() reads. */
+class Config
+{
+public:
+	Config(void);
+	void load(const char * const config_name);
+	void load_entry(const char *name, double value, uint line_number);
+	void check(void);
+	void print(FILE *stream) const;
+
+	/* Ram class:
+	 * 	delay to read from and write to the RAM for 1 page of data */
+	double ram_read_delay;
+	double ram_write_delay;
+
+	/* Bus class:
+	 * 	delay to communicate over bus
+	 * 	max number of connected devices allowed
+	 * 	number of time entries bus has to keep track of future schedule usage
+	 * 	flag value to detect free table entry (keep this negative)
+	 * 	number of simultaneous communication channels - defined by SSD_SIZE */
+	double bus_ctrl_delay;
+	double bus_data_delay;
+	uint bus_max_connect;
+	uint bus_table_size;
+	double bus_channel_free_flag;
+
+	/* Ssd class:
+	 * 	number of Packages per Ssd (size) */
+	uint ssd_size;
+
+	/* Package class:
+	 * 	number of Dies per Package (size) */
+	uint package_size;
+
+	/* Die class:
+	 * 	number of Planes per Die (size) */
+	uint die_size;
+
+	/* Plane class:
+	 * 	number of Blocks per Plane (size)
+	 * 	delay for reading from plane register
+	 * 	delay for writing to plane register
+	 * 	delay for merging is based on read, write, reg_read, reg_write
+	 * 		and does not need to be explicitly defined */
+	uint plane_size;
+	double plane_reg_read_delay;
+	double plane_reg_write_delay;
+
+	/* Block class:
+	 * 	number of Pages per Block (size)
+	 * 	number of erases in lifetime of block
+	 * 	delay for erasing block */
+	uint block_size;
+	uint block_erases;
+	double block_erase_delay;
+
+	/* Page class:
+	 * 	delay for Page reads
+	 * 	delay for Page writes
+	 * 	page size and whether the page data is stored */
+	double page_read_delay;
+	double page_write_delay;
+	uint page_size;
+	bool page_enable_data;
+
+	/* Mapping directory */
+	uint map_directory_size;
+
+	/* FTL Implementation */
+	uint ftl_implementation;
+
+	/* Over-provisioned spare area in percent and GC victim selection (page
+	 * FTL). */
+	uint overprovisioning;
+	uint gc_policy;
+
+	/* Background garbage collection in idle periods (0 -> disabled), the idle
+	 * time before it starts, the percentage of erased blocks it aims for and
+	 * the most victims it cleans per idle period (0 -> no limit). */
+	uint background_gc;
+	double background_gc_idle_time;
+	uint background_gc_watermark;
+	uint background_gc_blocks;
+
+	/* Host interface: submission queues, their depth and the die scheduler
+	 * (0 queues -> requests start when they arrive, no die model). */
+	uint nvme_queues;
+	uint nvme_queue_depth;
+	uint nvme_scheduler;
+
+	/* Die model pipelining (with NVME_QUEUES): the planes of a die run
+	 * operations of the same kind in parallel (multi-plane), and cache read /
+	 * program overlap the page transfers with the array operations. */
+	bool die_multi_plane;
+	bool die_cache_mode;
+
+	/* Controller DRAM write buffer: capacity in pages (0 -> disabled, writes
+	 * go straight to the FTL), flush policy (0 -> write back every page as it
+	 * arrives, 1 -> once the dirty pages reach the high watermark, down to the
+	 * low watermark) and the watermarks in percent of the capacity. */
+	uint write_buffer_pages;
+	uint write_buffer_flush;
+	uint write_buffer_high;
+	uint write_buffer_low;
+
+	/* Statistics time series window length (0 -> disabled) */
+	double stats_window;
+
+	/* LOG page limit for BAST and FAST. */
+	uint bast_log_block_limit;
+	uint fast_log_block_limit;
+
+	/* Number of blocks allowed to be in DFTL Cached Mapping Table. */
+	uint cache_dftl_limit;
+
+	/* Parallelism mode */
+	uint parallelism_mode;
+
+	/* Virtual block and page size (as a multiple of the physical size) */
+	uint virtual_block_size;
+	uint virtual_page_size;
+
+	/* Derived from the geometry by check() */
+	uint number_of_addressable_blocks;
+
+	/* RAISSDs: Number of physical SSDs, RAID-0 stripe unit in pages */
+	uint raid_number_of_physical_ssds;
+	uint raid_stripe_unit;
+};
+
+/* Makes a configuration current from construction or enter() until
+ * destruction or leave(), then restores the one that was current before, so
+ * scopes nest (a RaidSsd and its members).  The current configuration is not
+ * per thread: one thread at a time drives the simulated devices. */
+class Config_scope
+{
+public:
+	Config_scope(const Config &config);
+	~Config_scope(void);
+	void enter(void);
+	void leave(void);
+private:
+	const Config &config;
+	const Config *previous;
+	bool entered;
+};
 
-/* Configuration file parsing for extern config variables defined below */
+extern const Config *current_config;
+
+/* Configuration file parsing into the default configuration */
 void load_entry(char *name, double value, uint line_number);
 void load_config(const char * const config_name);
 void load_config(void); 	/** Default wrapper to read config from "ssd.conf". */
-void print_config(FILE *stream);
-
-/* Ram class:
- * 	delay to read from and write to the RAM for 1 page of data */
-extern const double RAM_READ_DELAY;
-extern const double RAM_WRITE_DELAY;
-
-/* Bus class:
- * 	delay to communicate over bus
- * 	max number of connected devices allowed
- * 	flag value to detect free table entry (keep this negative)
- * 	number of time entries bus has to keep track of future schedule usage
- * 	number of simultaneous communication channels - defined by SSD_SIZE */
-extern const double BUS_CTRL_DELAY;
-extern const double BUS_DATA_DELAY;
-extern const uint BUS_MAX_CONNECT;
-extern const double BUS_CHANNEL_FREE_FLAG;
-extern const uint BUS_TABLE_SIZE;
-/* extern const uint BUS_CHANNELS = 4; same as # of Packages, defined by SSD_SIZE */
-
-/* Ssd class:
- * 	number of Packages per Ssd (size) */
-extern const uint SSD_SIZE;
-
-/* Package class:
- * 	number of Dies per Package (size) */
-extern const uint PACKAGE_SIZE;
-
-/* Die class:
- * 	number of Planes per Die (size) */
-extern const uint DIE_SIZE;
-
-/* Plane class:
- * 	number of Blocks per Plane (size)
- * 	delay for reading from plane register
- * 	delay for writing to plane register
- * 	delay for merging is based on read, write, reg_read, reg_write 
- * 		and does not need to be explicitly defined */
-extern const uint PLANE_SIZE;
-extern const double PLANE_REG_READ_DELAY;
-extern const double PLANE_REG_WRITE_DELAY;
-
-/* Block class:
- * 	number of Pages per Block (size)
- * 	number of erases in lifetime of block
- * 	delay for erasing block */
-extern const uint BLOCK_SIZE;
-extern const uint BLOCK_ERASES;
-extern const double BLOCK_ERASE_DELAY;
-
-/* Page class:
- * 	delay for Page reads
- * 	delay for Page writes */
-extern const double PAGE_READ_DELAY;
-extern const double PAGE_WRITE_DELAY;
-extern const uint PAGE_SIZE;
-extern const bool PAGE_ENABLE_DATA;
-
-/*
- * Mapping directory
- */
-extern const uint MAP_DIRECTORY_SIZE;
-
-/*
- * FTL Implementation
- */
-extern const uint FTL_IMPLEMENTATION;
-
-/*
- * LOG page limit for BAST.
- */
-extern const uint BAST_LOG_BLOCK_LIMIT;
-
-/*
- * LOG page limit for FAST.
- */
-extern const uint FAST_LOG_BLOCK_LIMIT;
-
-/*
- * Number of blocks allowed to be in DFTL Cached Mapping Table.
- */
-extern const uint CACHE_DFTL_LIMIT;
-
-/*
- * Parallelism mode
- */
-extern const uint PARALLELISM_MODE;
-
-/* Virtual block size (as a multiple of the physical block size) */
-extern const uint VIRTUAL_BLOCK_SIZE;
-
-/* Virtual page size (as a multiple of the physical page size) */
-extern const uint VIRTUAL_PAGE_SIZE;
-
-extern const uint NUMBER_OF_ADDRESSABLE_BLOCKS;
-
-/* RAISSDs: Number of physical SSDs */
-extern const uint RAID_NUMBER_OF_PHYSICAL_SSDS;
-
-/*
- * Memory area to support pages with data.
- */
-extern void *page_data;
-extern void *global_buffer;
+void print_config(FILE *stream);	/** Prints the current configuration. */
+
+/* Parameters of the current configuration, described in the Config class */
+#define RAM_READ_DELAY (ssd::current_config->ram_read_delay)
+#define RAM_WRITE_DELAY (ssd::current_config->ram_write_delay)
+#define BUS_CTRL_DELAY (ssd::current_config->bus_ctrl_delay)
+#define BUS_DATA_DELAY (ssd::current_config->bus_data_delay)
+#define BUS_MAX_CONNECT (ssd::current_config->bus_max_connect)
+#define BUS_CHANNEL_FREE_FLAG (ssd::current_config->bus_channel_free_flag)
+#define BUS_TABLE_SIZE (ssd::current_config->bus_table_size)
+#define SSD_SIZE (ssd::current_config->ssd_size)
+#define PACKAGE_SIZE (ssd::current_config->package_size)
+#define DIE_SIZE (ssd::current_config->die_size)
+#define PLANE_SIZE (ssd::current_config->plane_size)
+#define PLANE_REG_READ_DELAY (ssd::current_config->plane_reg_read_delay)
+#define PLANE_REG_WRITE_DELAY (ssd::current_config->plane_reg_write_delay)
+#define BLOCK_SIZE (ssd::current_config->block_size)
+#define BLOCK_ERASES (ssd::current_config->block_erases)
+#define BLOCK_ERASE_DELAY (ssd::current_config->block_erase_delay)
+#define PAGE_READ_DELAY (ssd::current_config->page_read_delay)
+#define PAGE_WRITE_DELAY (ssd::current_config->page_write_delay)
+#define PAGE_SIZE (ssd::current_config->page_size)
+#define PAGE_ENABLE_DATA (ssd::current_config->page_enable_data)
+#define MAP_DIRECTORY_SIZE (ssd::current_config->map_directory_size)
+#define FTL_IMPLEMENTATION (ssd::current_config->ftl_implementation)
+#define OVERPROVISIONING (ssd::current_config->overprovisioning)
+#define GC_POLICY (ssd::current_config->gc_policy)
+#define BACKGROUND_GC (ssd::current_config->background_gc)
+#define BACKGROUND_GC_IDLE_TIME (ssd::current_config->background_gc_idle_time)
+#define BACKGROUND_GC_WATERMARK (ssd::current_config->background_gc_watermark)
+#define BACKGROUND_GC_BLOCKS (ssd::current_config->background_gc_blocks)
+#define NVME_QUEUES (ssd::current_config->nvme_queues)
+#define NVME_QUEUE_DEPTH (ssd::current_config->nvme_queue_depth)
+#define NVME_SCHEDULER (ssd::current_config->nvme_scheduler)
+#define DIE_MULTI_PLANE (ssd::current_config->die_multi_plane)
+#define DIE_CACHE_MODE (ssd::current_config->die_cache_mode)
+#define WRITE_BUFFER_PAGES (ssd::current_config->write_buffer_pages)
+#define WRITE_BUFFER_FLUSH (ssd::current_config->write_buffer_flush)
+#define WRITE_BUFFER_HIGH (ssd::current_config->write_buffer_high)
+#define WRITE_BUFFER_LOW (ssd::current_config->write_buffer_low)
+#define STATS_WINDOW (ssd::current_config->stats_window)
+#define BAST_LOG_BLOCK_LIMIT (ssd::current_config->bast_log_block_limit)
+#define FAST_LOG_BLOCK_LIMIT (ssd::current_config->fast_log_block_limit)
+#define CACHE_DFTL_LIMIT (ssd::current_config->cache_dftl_limit)
+#define PARALLELISM_MODE (ssd::current_config->parallelism_mode)
+#define VIRTUAL_BLOCK_SIZE (ssd::current_config->virtual_block_size)
+#define VIRTUAL_PAGE_SIZE (ssd::current_config->virtual_page_size)
+#define NUMBER_OF_ADDRESSABLE_BLOCKS (ssd::current_config->number_of_addressable_blocks)
+#define RAID_NUMBER_OF_PHYSICAL_SSDS (ssd::current_config->raid_number_of_physical_ssds)
+#define RAID_STRIPE_UNIT (ssd::current_config->raid_stripe_unit)
 
 /* Enumerations to clarify status integers in simulation
  * Do not use typedefs on enums for reader clarity */
@@ -215,6 +317,16 @@ enum block_type {LOG, DATA, LOG_SEQ};
  */
 enum ftl_implementation {IMPL_PAGE, IMPL_BAST, IMPL_FAST, IMPL_DFTL, IMPL_BIMODAL};
 
+/*
+ * Garbage collection victim selection policies.
+ */
+enum gc_policy {GC_GREEDY, GC_COST_BENEFIT};
+
+/*
+ * Dispatch of page operations to the dies with NVME_QUEUES.
+ */
+enum nvme_scheduler {SCHED_IN_ORDER, SCHED_OUT_OF_ORDER};
+
 
 #define BOOST_MULTI_INDEX_ENABLE_SAFE_MODE 1
 
@@ -227,7 +339,10 @@ enum ftl_implementation {IMPL_PAGE, IMPL_BAST, IMPL_FAST, IMPL_DFTL, IMPL_BIMODA
  * constructors that accept args
  * (e.g. a Ssd contains a Controller, Ram, Bus, and Packages). */
 class Address;
+class Checkpoint;
 class Stats;
+class Latency_histogram;
+class Stats_series;
 class Event;
 class Channel;
 class Bus;
@@ -248,6 +363,9 @@ class FtlImpl_Dftl;
 class FtlImpl_BDftl;
 
 class Ram;
+class Page_store;
+class Command_queues;
+class Write_buffer;
 class Controller;
 class Ssd;
 
@@ -287,6 +405,30 @@ public:
 	ulong get_linear_address() const;
 };
 
+/* Binary stream used to save and restore the simulator state.  Values are
+ * stored in host byte order, so a checkpoint is only meant to be loaded by the
+ * same build with the same device configuration.  Errors are sticky: callers
+ * check ok() once after a whole save or load. */
+class Checkpoint
+{
+public:
+	Checkpoint(FILE *stream);
+	~Checkpoint(void);
+	template <class T> void put(const T &value) { put_bytes(&value, sizeof(T)); }
+	template <class T> void get(T &value) { get_bytes(&value, sizeof(T)); }
+	void put_bytes(const void *data, size_t size);
+	void get_bytes(void *data, size_t size);
+	void put_address(const Address &address);
+	void get_address(Address &address);
+	void put_section(uint tag);
+	void get_section(uint tag);
+	void fail(void);
+	bool ok(void) const;
+private:
+	FILE *stream;
+	bool failed;
+};
+
 class Stats
 {
 public:
@@ -306,6 +448,10 @@ public:
 	long numWLWrite;
 	long numWLErase;
 
+	// Write amplification (page writes from the host / programmed on flash)
+	long numHostWrite;
+	long numFlashWrite;
+
 	// Log based FTL's
 	long numLogMergeSwitch;
 	long numLogMergePartial;
@@ -318,6 +464,14 @@ public:
 	long numCacheHits;
 	long numCacheFaults;
 
+	// Background garbage collection (cleaning in idle periods)
+	long numBackgroundGCErase;
+	long numBackgroundGCPeriods;
+
+	// Garbage collection time: blocking requests / spent in idle periods
+	double timeForegroundGC;
+	double timeBackgroundGC;
+
 	// Memory consumptions (Bytes)
 	long numMemoryTranslation;
 	long numMemoryCache;
@@ -325,10 +479,20 @@ public:
 	long numMemoryRead;
 	long numMemoryWrite;
 
+	// Controller write buffer: reads served from it, writes to a page
+	// already dirty in it, pages written back and host writes that waited
+	// for a free slot, and how long they waited
+	long numBufferReadHit;
+	long numBufferCoalesce;
+	long numBufferFlush;
+	long numBufferStall;
+	double timeBufferStall;
+
 	// Advance statictics
 	double translation_overhead() const;
 	double variance_of_io() const;
 	double cache_hit_ratio() const;
+	double write_amplification() const;
 
 	// Constructors, maintainance, output, etc.
 	Stats(void);
@@ -341,6 +505,75 @@ private:
 	void reset();
 };
 
+/* Log-linear histogram of request latencies, kept in microseconds: exact
+ * below 16us, then 16 sub-buckets per power of two, i.e. within 1/16 of the
+ * true value.  Latencies are given in the time unit of the configuration,
+ * which must be milliseconds.  Buckets are only allocated up to the longest
+ * latency seen. */
+class Latency_histogram
+{
+public:
+	Latency_histogram(void);
+	void add(double latency);
+	ulong get_count(void) const;
+	double get_mean(void) const;
+	double get_max(void) const;
+	double percentile(double p) const;
+	uint get_num_buckets(void) const;
+	ulong get_bucket(uint bucket) const;
+	static double get_bucket_limit(uint bucket);
+private:
+	static uint bucket_of(ulong us);
+
+	std::vector<ulong> buckets;
+	ulong count;
+	double sum;
+	double max;
+};
+
+enum stats_format {STATS_CSV, STATS_JSON};
+
+/* Time series of the device statistics: requests are counted, with their
+ * latency histograms, in the window of virtual time (see STATS_WINDOW) they
+ * complete in, together with the GC work done and the erased blocks left by
+ * the end of the window.  Windows are counted from the first arrival. */
+class Stats_series
+{
+public:
+	Stats_series(double window);
+	~Stats_series(void);
+	void add(enum event_type type, uint pages, double start_time, double completion_time, const Stats &stats, ulong free_blocks);
+	void write(FILE *stream, enum stats_format format, const Stats &stats, ulong free_blocks);
+	void reset(void);
+private:
+	struct window
+	{
+		ulong reads;
+		ulong writes;
+		ulong read_pages;
+		ulong write_pages;
+		Latency_histogram read_latency;
+		Latency_histogram write_latency;
+		long gc_erases;
+		long gc_writes;
+		double gc_time;
+		ulong free_blocks;
+	};
+
+	void close(const Stats &stats, ulong free_blocks);
+	void write_csv(FILE *stream) const;
+	void write_json(FILE *stream) const;
+
+	double length;
+	double first_arrival;
+	std::vector<window> windows;
+
+	// Cumulative GC counters when the last window was opened.
+	long base_gc_erases;
+	long base_gc_writes;
+	double base_gc_time;
+};
+
 /* Class to emulate a log block with page-level mapping. */
 class LogPageBlock
 {
@@ -355,6 +588,9 @@ public:
 
 	LogPageBlock *next;
 
+	void save_state(Checkpoint &checkpoint) const;
+	void load_state(Checkpoint &checkpoint);
+
 	bool operator() (const ssd::LogPageBlock& lhs, const ssd::LogPageBlock& rhs) const;
 	bool operator() (const ssd::LogPageBlock*& lhs, const ssd::LogPageBlock*& rhs) const;
 };
@@ -374,6 +610,7 @@ public:
 	const Address &get_merge_address(void) const;
 	const Address &get_log_address(void) const;
 	const Address &get_replace_address(void) const;
+	const Address &get_copy_address(void) const;
 	uint get_size(void) const;
 	enum event_type get_event_type(void) const;
 	double get_start_time(void) const;
@@ -385,6 +622,7 @@ public:
 	void set_merge_address(const Address &address);
 	void set_log_address(const Address &address);
 	void set_replace_address(const Address &address);
+	void set_copy_address(const Address &address);
 	void set_next(Event &next);
 	void set_payload(void *payload);
 	void set_event_type(const enum event_type &type);
@@ -404,6 +642,7 @@ private:
 	Address merge_address;
 	Address log_address;
 	Address replace_address;
+	Address copy_address;
 	uint size;
 	void *payload;
 	Event *next;
@@ -428,6 +667,8 @@ public:
 	enum status connect(void);
 	enum status disconnect(void);
 	double ready_time(void);
+	void save_state(Checkpoint &checkpoint) const;
+	void load_state(Checkpoint &checkpoint);
 private:
 	void unlock(double current_time);
 
@@ -468,6 +709,8 @@ public:
 	enum status disconnect(uint channel);
 	Channel &get_channel(uint channel);
 	double ready_time(uint channel);
+	void save_state(Checkpoint &checkpoint) const;
+	void load_state(Checkpoint &checkpoint);
 private:
 	uint num_channels;
 	Channel * const channels;
@@ -521,8 +764,12 @@ public:
 	void invalidate_page(uint page);
 	long get_physical_address(void) const;
 	Block *get_pointer(void);
+	Page_store *get_page_store(void) const;
+	Block_manager &get_block_manager(void) const;
 	block_type get_block_type(void) const;
 	void set_block_type(block_type value);
+	void save_state(Checkpoint &checkpoint) const;
+	void load_state(Checkpoint &checkpoint);
 
 private:
 	uint size;
@@ -563,6 +810,8 @@ public:
 	ssd::uint get_num_valid(const Address &address) const;
 	ssd::uint get_num_invalid(const Address &address) const;
 	Block *get_block_pointer(const Address & address);
+	void save_state(Checkpoint &checkpoint) const;
+	void load_state(Checkpoint &checkpoint);
 private:
 	void update_wear_stats(void);
 	enum status get_next_page(void);
@@ -602,6 +851,8 @@ public:
 	ssd::uint get_num_valid(const Address &address) const;
 	ssd::uint get_num_invalid(const Address &address) const;
 	Block *get_block_pointer(const Address & address);
+	void save_state(Checkpoint &checkpoint) const;
+	void load_state(Checkpoint &checkpoint);
 private:
 	void update_wear_stats(const Address &address);
 	uint size;
@@ -638,6 +889,8 @@ public:
 	ssd::uint get_num_valid(const Address &address) const;
 	ssd::uint get_num_invalid(const Address &address) const;
 	Block *get_block_pointer(const Address & address);
+	void save_state(Checkpoint &checkpoint) const;
+	void load_state(Checkpoint &checkpoint);
 private:
 	void update_wear_stats (const Address &address);
 	uint size;
@@ -675,7 +928,7 @@ public:
 
 	// Usual suspects
 	Address get_free_block(Event &event);
-	Address get_free_block(block_type btype, Event &event);
+	Address get_free_block(block_type btype, Event &event, long die = -1);
 	void invalidate(Address address, block_type btype);
 	void print_statistics();
 	void insert_events(Event &event);
@@ -683,23 +936,23 @@ public:
 	bool is_log_full();
 	void erase_and_invalidate(Event &event, Address &address, block_type btype);
 	int get_num_free_blocks();
+	ulong get_num_clean_blocks();
+	Block *get_gc_victim(enum gc_policy policy, double time);
+	void background_clean(double start_time, double deadline);
 
 	// Used to update GC on used pages in blocks.
 	void update_block(Block * b);
 
-	// Singleton
-	static Block_manager *instance();
-	static void instance_initialize(FtlParent *ftl);
-	static Block_manager *inst;
-
 	void cost_insert(Block *b);
 
 	void print_cost_status();
 
+	void save_state(Checkpoint &checkpoint) const;
+	void load_state(Checkpoint &checkpoint);
 
 
 private:
-	void get_page_block(Address &address, Event &event);
+	void get_page_block(Address &address, Event &event, long die = -1);
 	static bool block_comparitor_simple (Block const *x,Block const *y);
 
 	FtlParent *ftl;
@@ -763,6 +1016,9 @@ public:
 
 	virtual void print_ftl_statistics();
 
+	virtual void save_state(Checkpoint &checkpoint) const;
+	virtual void load_state(Checkpoint &checkpoint);
+
 	friend class Block_manager;
 
 	ulong get_erases_remaining(const Address &address) const;
@@ -770,10 +1026,12 @@ public:
 	enum page_state get_state(const Address &address) const;
 	enum block_state get_block_state(const Address &address) const;
 	Block *get_block_pointer(const Address & address);
+	Block_manager &get_block_manager(void);
 
 	Address resolve_logical_address(unsigned int logicalAddress);
 protected:
 	Controller &controller;
+	Block_manager block_manager;
 };
 
 class FtlImpl_Page : public FtlParent
@@ -784,11 +1042,27 @@ public:
 	enum status read(Event &event);
 	enum status write(Event &event);
 	enum status trim(Event &event);
+	void cleanup_block(Event &event, Block *block);
+	void save_state(Checkpoint &checkpoint) const;
+	void load_state(Checkpoint &checkpoint);
+	void print_ftl_statistics();
 private:
-	ulong currentPage;
-	ulong numPagesActive;
-	bool *trim_map;
+	long get_free_page(Event &event, long &frontier, bool collect, long die = -1);
+	enum status garbage_collect(Event &event);
+
+	ulong logical_pages;
+	ulong physical_pages;
+
+	// Next page to write of the host and the GC write blocks.
+	long currentPage;
+	long currentGCPage;
+
+	// With NVME_QUEUES, the next page of the host write block of each die.
+	std::vector<long> diePages;
+
+	// Logical to physical page map and its reverse.
 	long *map;
+	long *reverse_map;
 };
 
 class FtlImpl_Bast : public FtlParent
@@ -799,6 +1073,8 @@ public:
 	enum status read(Event &event);
 	enum status write(Event &event);
 	enum status trim(Event &event);
+	void save_state(Checkpoint &checkpoint) const;
+	void load_state(Checkpoint &checkpoint);
 private:
 	std::map<long, LogPageBlock*> log_map;
 
@@ -826,6 +1102,8 @@ public:
 	enum status read(Event &event);
 	enum status write(Event &event);
 	enum status trim(Event &event);
+	void save_state(Checkpoint &checkpoint) const;
+	void load_state(Checkpoint &checkpoint);
 private:
 	void initialize_log_pages();
 
@@ -865,6 +1143,8 @@ public:
 	virtual enum status read(Event &event) = 0;
 	virtual enum status write(Event &event) = 0;
 	virtual enum status trim(Event &event) = 0;
+	void save_state(Checkpoint &checkpoint) const;
+	void load_state(Checkpoint &checkpoint);
 protected:
 	struct MPage {
 		long vpn;
@@ -943,6 +1223,8 @@ public:
 	enum status write(Event &event);
 	enum status trim(Event &event);
 	void cleanup_block(Event &event, Block *block);
+	void save_state(Checkpoint &checkpoint) const;
+	void load_state(Checkpoint &checkpoint);
 private:
 	struct BPage {
 		uint pbn;
@@ -979,6 +1261,134 @@ private:
 	double write_delay;
 };
 
+/* Stores the data of the simulated pages when PAGE_ENABLE_DATA is set.
+ * Pages hold references to reference counted, deduplicated contents so only
+ * distinct non-zero data is kept in host memory and relocations are cheap. */
+class Page_store
+{
+public:
+	Page_store(ulong num_pages, uint page_size = PAGE_SIZE);
+	~Page_store(void);
+	void write(ulong page, const void *data);
+	void copy(ulong from, ulong to);
+	const void *read(ulong page) const;
+	void erase(ulong page, uint count);
+	ulong get_num_contents(void) const;
+	ulong get_resident_bytes(void) const;
+	void print_statistics(FILE *stream = NULL);
+	void save_state(Checkpoint &checkpoint) const;
+	void load_state(Checkpoint &checkpoint);
+private:
+	struct content
+	{
+		char *data;
+		ulong hash;
+		uint refs;
+		uint next;
+	};
+	ulong hash(const void *data, bool &is_zero) const;
+	uint get_ref(ulong page) const;
+	void set_ref(ulong page, uint id);
+	void release(uint id);
+	uint intern(const void *data);
+	void reset(void);
+
+	ulong num_pages;
+	uint page_size;
+	std::vector<uint *> chunks;
+	std::vector<content> contents;
+	std::vector<uint> free_ids;
+	std::unordered_map<ulong, uint> index;
+	char *zero_page;
+	ulong num_written;
+	ulong num_deduplicated;
+	ulong num_relocated;
+};
+
+/* NVMe-style submission queues in front of the controller (NVME_QUEUES).
+ * Each queue holds up to NVME_QUEUE_DEPTH outstanding commands; a command
+ * arriving at a full queue is started when the earliest outstanding command
+ * of that queue completes.  Commands of a queue must be admitted in arrival
+ * order, and the completion of every admitted command reported back. */
+class Command_queues
+{
+public:
+	Command_queues(uint num_queues, uint depth);
+	~Command_queues(void);
+	double admit(uint queue, double arrival_time);
+	void complete(uint queue, double completion_time);
+	uint get_num_queues(void) const;
+	bool is_full(uint queue, uint pending) const;
+	void print_statistics(FILE *stream = NULL);
+	void reset_statistics(void);
+	void save_state(Checkpoint &checkpoint) const;
+	void load_state(Checkpoint &checkpoint);
+private:
+	struct submission_queue
+	{
+		// Completion times of the outstanding commands, a min-heap.
+		std::vector<double> outstanding;
+		ulong commands;
+		ulong waited;
+		double wait_time;
+		double max_wait;
+	};
+
+	uint depth;
+	std::vector<submission_queue> queues;
+};
+
+/* DRAM write buffer of the controller (WRITE_BUFFER_PAGES).  Host page
+ * writes complete once they are copied into a free slot; the buffer writes
+ * them back through the FTL by its flush policy, and a slot stays taken until
+ * the page is programmed.  While the flash keeps up, writes see only the RAM
+ * delay; once every slot is dirty or being written back, a write waits for
+ * the earliest slot to free.  Reads of buffered pages are served from it. */
+class Write_buffer
+{
+public:
+	Write_buffer(Controller &controller, uint capacity);
+	~Write_buffer(void);
+	enum status write(Event &event);
+	bool read(Event &event);
+	void trim(const Event &event);
+	enum status drain(double time, double &done);
+	void save_state(Checkpoint &checkpoint) const;
+	void load_state(Checkpoint &checkpoint);
+private:
+	struct buffered_page
+	{
+		// Identifies this copy of the page in dirty_order and in_flight.
+		ulong sequence;
+		bool dirty;
+		// Page contents with PAGE_ENABLE_DATA, empty without data.
+		std::vector<char> data;
+	};
+
+	// A page being written back holds its slot until done.
+	struct write_back
+	{
+		double done;
+		ulong logical_address;
+		ulong sequence;
+		bool operator>(const write_back &rhs) const { return done > rhs.done; }
+	};
+
+	void release(double time);
+	enum status flush_oldest(double time);
+	void store(buffered_page &page, const void *data);
+
+	Controller &controller;
+	uint capacity;
+	ulong next_sequence;
+	uint dirty;
+	std::unordered_map<ulong, buffered_page> pages;
+	// Dirty pages in the order they were buffered, (address, sequence).
+	std::deque<std::pair<ulong, ulong> > dirty_order;
+	// Write-backs in progress, a min-heap on done.
+	std::vector<write_back> in_flight;
+};
+
 /* The controller accepts read/write requests through its event_arrive method
  * and consults the FTL regarding what to do by calling the FTL's read/write
  * methods.  The FTL returns an event list for the controller through its issue
@@ -1001,11 +1411,24 @@ public:
 	friend class FtlImpl_Dftl;
 	friend class FtlImpl_BDftl;
 	friend class Block_manager;
+	friend class Write_buffer;
 
 	Stats stats;
 	void print_ftl_statistics();
 	const FtlParent &get_ftl(void) const;
+	Block_manager &get_block_manager(void) const;
+	double drain_write_buffer(double start_time);
+	void save_state(Checkpoint &checkpoint) const;
+	void load_state(Checkpoint &checkpoint);
 private:
+	void background_gc(double arrival_time);
+	void gc_begin(const Event &event);
+	void gc_end(const Event &event);
+	void update_busy(const Event &event);
+	uint get_die(const Address &address) const;
+	double dispatch(Event &event);
+	enum status cache_register(Event &event);
+	uint get_idle_die(void) const;
 	enum status issue(Event &event_list);
 	void translate_address(Address &address);
 	ssd::ulong get_erases_remaining(const Address &address) const;
@@ -1020,6 +1443,39 @@ private:
 	Block *get_block_pointer(const Address & address);
 	Ssd &ssd;
 	FtlParent *ftl;
+	Write_buffer *write_buffer;
+
+	// Idle detection: latest arrival and when each package is done.
+	double last_arrival;
+	std::vector<double> busy_until;
+
+	// Die model with NVME_QUEUES, per die or per plane with DIE_MULTI_PLANE:
+	// when its array is done, when its cache register is free, the kind of
+	// its last operation and, for in-order dispatch, the last dispatch on
+	// each channel.
+	std::vector<double> die_free;
+	std::vector<double> cache_free;
+	std::vector<enum event_type> die_op;
+	std::vector<double> channel_dispatch;
+
+	// Garbage collection time accounting, see gc_begin().
+	uint gc_depth;
+	double gc_start;
+	bool gc_background;
+};
+
+/* One request of a batch submitted with Ssd::event_arrive_batch(), with the
+ * same meaning as the event_arrive() arguments.  For reads with data pages
+ * enabled, the data read is copied to buffer when it is not NULL.  queue is
+ * the submission queue with NVME_QUEUES (modulo the number of queues). */
+struct Batch_request
+{
+	enum event_type type;
+	ulong logical_address;
+	uint size;
+	double start_time;
+	void *buffer;
+	uint queue;
 };
 
 /* The SSD is the single main object that will be created to simulate a real
@@ -1029,20 +1485,35 @@ class Ssd
 {
 public:
 	Ssd (uint ssd_size = SSD_SIZE);
+	explicit Ssd(const Config &config);
 	~Ssd(void);
 	double event_arrive(enum event_type type, ulong logical_address, uint size, double start_time);
 	double event_arrive(enum event_type type, ulong logical_address, uint size, double start_time, void *buffer);
+	enum status event_arrive_batch(const Batch_request *requests, uint count, double *completion_times);
 	void *get_result_buffer();
+	double drain_write_buffer(double start_time);
 	friend class Controller;
 	void print_statistics();
 	void reset_statistics();
 	void write_statistics(FILE *stream);
 	void write_header(FILE *stream);
+	void write_time_series(FILE *stream, enum stats_format format = STATS_CSV);
 	const Controller &get_controller(void) const;
+	const Config &get_config(void) const;
+	Page_store *get_page_store(void) const;
+	Block_manager &get_block_manager(void) const;
 
 	void print_ftl_statistics();
+	void print_wear_statistics();
 	double ready_at(void);
+	enum status save_checkpoint(const char *file_name, bool save_page_data = true);
+	enum status load_checkpoint(const char *file_name);
 private:
+	Ssd(const Config &config, uint ssd_size);
+	double event_arrive_command(enum event_type type, ulong logical_address, uint size, double start_time, void *buffer);
+	double event_arrive_pages(enum event_type type, ulong logical_address, uint size, double start_time, void *buffer);
+	void complete_batch(const Batch_request *requests, uint from, uint to, ulong first, double *completion_times, std::vector<uint> &pending);
+	void record(enum event_type type, uint size, double start_time, double completion_time);
 	enum status read(Event &event);
 	enum status write(Event &event);
 	enum status erase(Event &event);
@@ -1062,6 +1533,11 @@ private:
 	ssd::uint get_num_invalid(const Address &address) const;
 	Block *get_block_pointer(const Address & address);
 
+	/* the configuration of this device, current while it is being built,
+	 * destroyed or called (keep these first, the other members use it) */
+	Config config;
+	Config_scope config_scope;
+
 	uint size;
 	Controller controller;
 	Ram ram;
@@ -1070,15 +1546,35 @@ private:
 	ulong erases_remaining;
 	ulong least_worn;
 	double last_erase_time;
+
+	/* page data, NULL without PAGE_ENABLE_DATA */
+	Page_store *page_store;
+
+	/* result of the last read (pages in request order) */
+	std::vector<char> read_buffer;
+	bool read_buffer_valid;
+
+	/* page events and start times of the batch in flight, reused between
+	 * batches */
+	std::vector<Event> batch_events;
+	std::vector<double> batch_starts;
+
+	/* host submission queues, NULL without NVME_QUEUES */
+	Command_queues *queues;
+
+	/* statistics time series, NULL without STATS_WINDOW */
+	Stats_series *series;
 };
 
 class RaidSsd
 {
 public:
 	RaidSsd (uint ssd_size = SSD_SIZE);
+	explicit RaidSsd(const std::vector<Config> &members);
 	~RaidSsd(void);
 	double event_arrive(enum event_type type, ulong logical_address, uint size, double start_time);
 	double event_arrive(enum event_type type, ulong logical_address, uint size, double start_time, void *buffer);
+	enum status event_arrive_batch(const Batch_request *requests, uint count, double *completion_times);
 	void *get_result_buffer();
 	friend class Controller;
 	void print_statistics();
@@ -1086,13 +1582,46 @@ public:
 	void write_statistics(FILE *stream);
 	void write_header(FILE *stream);
 	const Controller &get_controller(void) const;
+	const Config &get_config(void) const;
 
 	void print_ftl_statistics();
+	void print_wear_statistics();
 private:
+	struct member_usage
+	{
+		ulong requests;
+		ulong pages;
+		double busy_time;
+		double busy_until;
+	};
+
+	void split_request(const Batch_request &request, std::vector<Batch_request> &members) const;
+	void copy_stripes(const Batch_request &request, uint member, ulong member_address, char *member_data, bool to_member) const;
+	void account(uint member, uint pages, double start_time, double completion_time);
+	void check_members(void) const;
+
+	/* array configuration (PARALLELISM_MODE, RAID_STRIPE_UNIT), the members
+	 * have their own */
+	Config config;
+	Config_scope config_scope;
+
 	uint size;
 
-	Ssd *Ssds;
+	std::vector<Ssd *> Ssds;
+
+	// RAID-0 (PARALLELISM_MODE 3) service of each member and of the array.
+	std::vector<member_usage> usage;
+	double first_arrival;
+	double last_completion;
+
+	// Stripes of the current request gathered per member, and read results.
+	std::vector<Batch_request> sub_requests;
+	std::vector<std::vector<char> > member_data;
+	std::vector<char> read_buffer;
+	bool read_buffer_valid;
 
+	// Member whose read result get_result_buffer() returns, -1 for none.
+	int result_member;
 };
 } /* end namespace ssd */
 
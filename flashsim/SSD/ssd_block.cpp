@@ -80,7 +80,7 @@ Block::Block(const Plane &parent, uint block_size, ulong erases_remaining, doubl
 
 	// Creates the active cost structure in the block manager.
 	// It assumes that it is created lineary.
-	Block_manager::instance()->cost_insert(this);
+	get_block_manager().cost_insert(this);
 
 	return;
 }
@@ -114,7 +114,7 @@ enum status Block::write(Event &event)
 		state = ACTIVE;
 		modification_time = event.get_start_time();
 
-		Block_manager::instance()->update_block(this);
+		get_block_manager().update_block(this);
 	}
 	return ret;
 }
@@ -148,6 +148,8 @@ enum status Block::_erase(Event &event)
 			data[i].set_state(EMPTY);
 		}
 
+		if (PAGE_ENABLE_DATA)
+			get_page_store()->erase(physical_address, size);
 
 		event.incr_time_taken(erase_delay);
 		last_erase_time = event.get_start_time() + event.get_time_taken();
@@ -156,7 +158,7 @@ enum status Block::_erase(Event &event)
 		pages_invalid = 0;
 		state = FREE;
 
-		Block_manager::instance()->update_block(this);
+		get_block_manager().update_block(this);
 	}
 
 	return SUCCESS;
@@ -223,7 +225,7 @@ void Block::invalidate_page(uint page)
 
 	pages_invalid++;
 
-	Block_manager::instance()->update_block(this);
+	get_block_manager().update_block(this);
 
 	/* update block state */
 	if(pages_invalid >= size)
@@ -268,6 +270,17 @@ Block *Block::get_pointer(void)
 	return this;
 }
 
+/* the page data and block manager of the Ssd this block belongs to */
+Page_store *Block::get_page_store(void) const
+{
+	return parent.get_parent().get_parent().get_parent().get_page_store();
+}
+
+Block_manager &Block::get_block_manager(void) const
+{
+	return parent.get_parent().get_parent().get_parent().get_block_manager();
+}
+
 block_type Block::get_block_type(void) const
 {
 	return this->btype;
@@ -277,3 +290,35 @@ void Block::set_block_type(block_type value)
 {
 	this->btype = value;
 }
+
+/* the Block_manager restores its own view of the block (see
+ * Block_manager::load_state), so it is not notified here */
+void Block::save_state(Checkpoint &checkpoint) const
+{
+	checkpoint.put(pages_invalid);
+	checkpoint.put(pages_valid);
+	checkpoint.put(state);
+	checkpoint.put(erases_remaining);
+	checkpoint.put(last_erase_time);
+	checkpoint.put(modification_time);
+	checkpoint.put(btype);
+	for (uint i = 0; i < size; i++)
+		checkpoint.put(data[i].get_state());
+}
+
+void Block::load_state(Checkpoint &checkpoint)
+{
+	checkpoint.get(pages_invalid);
+	checkpoint.get(pages_valid);
+	checkpoint.get(state);
+	checkpoint.get(erases_remaining);
+	checkpoint.get(last_erase_time);
+	checkpoint.get(modification_time);
+	checkpoint.get(btype);
+	for (uint i = 0; i < size; i++)
+	{
+		enum page_state page_state;
+		checkpoint.get(page_state);
+		data[i].set_state(page_state);
+	}
+}
@@ -13,6 +13,7 @@
 #include <stdexcept>
 #include <algorithm>
 #include <queue>
+#include <boost/ref.hpp>
 #include "ssd.h"
 
 using namespace ssd;
@@ -32,6 +33,10 @@ Block_manager::Block_manager(FtlParent *ftl) : ftl(ftl)
 	if (FTL_IMPLEMENTATION == IMPL_FAST)
 		max_log_blocks = FAST_LOG_BLOCK_LIMIT;
 
+	// The page FTL also writes to its over-provisioned blocks.
+	if (FTL_IMPLEMENTATION == IMPL_PAGE)
+		max_blocks = (SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE) / VIRTUAL_PAGE_SIZE;
+
 	// Block-based map lookup simulation
 	max_map_pages = MAP_DIRECTORY_SIZE * BLOCK_SIZE;
 
@@ -60,25 +65,20 @@ void Block_manager::cost_insert(Block *b)
 	active_cost.push_back(b);
 }
 
-void Block_manager::instance_initialize(FtlParent *ftl)
-{
-	Block_manager::inst = new Block_manager(ftl);
-}
-
-Block_manager *Block_manager::instance()
-{
-	return Block_manager::inst;
-}
-
 /*
  * Retrieves a page using either simple approach (when not all
  * pages have been written or the complex that retrieves
  * it from a free page list.
  */
-void Block_manager::get_page_block(Address &address, Event &event)
+void Block_manager::get_page_block(Address &address, Event &event, long die)
 {
 	// We need separate queues for each plane? communication channel? communication channel is at the per die level at the moment. i.e. each LUN is a die.
 
+	// Picking blocks by die needs all erased blocks on the free list.
+	if (die >= 0)
+		for (; simpleCurrentFree < max_blocks*BLOCK_SIZE; simpleCurrentFree += BLOCK_SIZE)
+			free_list.push_back(ftl->get_block_pointer(Address(simpleCurrentFree, BLOCK)));
+
 	if (simpleCurrentFree < max_blocks*BLOCK_SIZE)
 	{
 		address.set_linear_address(simpleCurrentFree, BLOCK);
@@ -94,9 +94,20 @@ void Block_manager::get_page_block(Address &address, Event &event)
 		}
 
 		assert(free_list.size() != 0);
-		address.set_linear_address(free_list.front()->get_physical_address(), BLOCK);
-		current_writing_block = free_list.front()->get_physical_address();
-		free_list.erase(free_list.begin());
+		std::vector<Block*>::iterator it = free_list.begin();
+		if (die >= 0)
+		{
+			// The first erased block of the die, or any if it has none left.
+			// With DIE_MULTI_PLANE, the dies of the die model are planes.
+			const ulong die_pages = (ulong) (DIE_MULTI_PLANE ? 1 : DIE_SIZE) * PLANE_SIZE * BLOCK_SIZE;
+			while (it != free_list.end() && (*it)->get_physical_address() / die_pages != (ulong) die)
+				++it;
+			if (it == free_list.end())
+				it = free_list.begin();
+		}
+		address.set_linear_address((*it)->get_physical_address(), BLOCK);
+		current_writing_block = (*it)->get_physical_address();
+		free_list.erase(it);
 		out_of_blocks = false;
 	}
 }
@@ -181,6 +192,8 @@ void Block_manager::insert_events(Event &event)
 
 	uint num_to_erase = 5; // More Magic!
 
+	ftl->controller.gc_begin(event);
+
 	//printf("%i %i %i\n", invalid_list.size(), log_active, data_active);
 
 	// First step and least expensive is to go though invalid list. (Only used by FAST)
@@ -240,12 +253,16 @@ void Block_manager::insert_events(Event &event)
 			num_to_erase--;
 		}
 	}
+
+	ftl->controller.gc_end(event);
 }
 
-Address Block_manager::get_free_block(block_type type, Event &event)
+/* die, if not -1, asks for a block on that die of the die model (see
+ * Controller::get_die()) when it has an erased one */
+Address Block_manager::get_free_block(block_type type, Event &event, long die)
 {
 	Address address;
-	get_page_block(address, event);
+	get_page_block(address, event, die);
 	switch (type)
 	{
 	case DATA:
@@ -322,8 +339,189 @@ int Block_manager::get_num_free_blocks()
 		return free_list.size();
 }
 
+/*
+ * Returns the number of erased blocks that can be handed out
+ * without cleaning first.
+ */
+ulong Block_manager::get_num_clean_blocks()
+{
+	return (max_blocks - simpleCurrentFree / BLOCK_SIZE) + free_list.size();
+}
+
+/*
+ * Picks a fully written block with invalid pages to reclaim, or NULL if
+ * there is none.  Walks the cost index from the most invalidated block, so
+ * greedy takes the first candidate, while cost-benefit weighs the space
+ * reclaimed against the age of the data (the LFS cleaner's
+ * age * (1 - u) / 2u, u being the live fraction of the block).
+ */
+Block *Block_manager::get_gc_victim(enum gc_policy policy, double time)
+{
+	Block *victim = NULL;
+	double best = -1;
+
+	ActiveByCost &by_cost = active_cost.get<1>();
+	for (ActiveByCost::reverse_iterator it = by_cost.rbegin(); it != by_cost.rend() && (*it)->get_pages_invalid() > 0; ++it)
+	{
+		Block *block = *it;
+
+		// Blocks still being written are not candidates.
+		if (block->get_pages_valid() != BLOCK_SIZE)
+			continue;
+
+		if (policy == GC_GREEDY || block->get_pages_invalid() == BLOCK_SIZE)
+			return block;
+
+		double u = (double)(BLOCK_SIZE - block->get_pages_invalid()) / BLOCK_SIZE;
+		double age = time - block->get_modification_time();
+		double benefit = (age > 0 ? age : 0) * (1 - u) / (2 * u);
+
+		if (benefit > best)
+		{
+			best = benefit;
+			victim = block;
+		}
+	}
+
+	return victim;
+}
+
+/*
+ * Cleans blocks in an idle period that starts at start_time and ends when the
+ * next request arrives at deadline, until BACKGROUND_GC_WATERMARK percent of
+ * the blocks are erased.  A victim is only started if the estimated time to
+ * relocate its valid pages and erase it fits in what is left of the idle
+ * period, so cleaning rarely holds up the arriving request.  Only the FTLs
+ * that relocate pages through cleanup_block() support this.
+ */
+void Block_manager::background_clean(double start_time, double deadline)
+{
+	if (FTL_IMPLEMENTATION != IMPL_PAGE && FTL_IMPLEMENTATION != IMPL_DFTL && FTL_IMPLEMENTATION != IMPL_BIMODAL)
+		return;
+
+	ulong watermark = (max_blocks * BACKGROUND_GC_WATERMARK + 99) / 100;
+	double page_copy = PAGE_READ_DELAY + PAGE_WRITE_DELAY + 3 * BUS_CTRL_DELAY + 2 * BUS_DATA_DELAY + 2 * (RAM_READ_DELAY + RAM_WRITE_DELAY);
+	double time = start_time;
+	uint cleaned = 0;
+
+	while (get_num_clean_blocks() < watermark && (BACKGROUND_GC_BLOCKS == 0 || cleaned < BACKGROUND_GC_BLOCKS))
+	{
+		Block *victim = get_gc_victim((enum gc_policy) GC_POLICY, time);
+		if (victim == NULL)
+			break;
+
+		double estimate = (BLOCK_SIZE - victim->get_pages_invalid()) * page_copy + BUS_CTRL_DELAY + BLOCK_ERASE_DELAY;
+		if (time + estimate > deadline)
+			break;
+
+		Event event = Event(ERASE, 0, 1, time);
+		Address address = Address(victim->get_physical_address(), BLOCK);
+
+		ftl->controller.gc_begin(event);
+		ftl->cleanup_block(event, victim);
+		erase_and_invalidate(event, address, DATA);
+		ftl->controller.gc_end(event);
+
+		ftl->controller.stats.numBackgroundGCErase++;
+		time += event.get_time_taken();
+		cleaned++;
+	}
+
+	if (cleaned > 0)
+		ftl->controller.stats.numBackgroundGCPeriods++;
+}
+
 void Block_manager::update_block(Block * b)
 {
 	std::size_t pos = (b->physical_address / BLOCK_SIZE);
 	active_cost.replace(active_cost.begin()+pos, b);
 }
+
+/* block lists are saved as the blocks' physical addresses */
+static void save_block_list(Checkpoint &checkpoint, const std::vector<Block*> &list)
+{
+	ulong entries = list.size();
+
+	checkpoint.put(entries);
+	for (ulong i = 0; i < entries; i++)
+		checkpoint.put(list[i]->get_physical_address());
+}
+
+static void load_block_list(Checkpoint &checkpoint, std::vector<Block*> &list, FtlParent *ftl)
+{
+	ulong entries;
+
+	checkpoint.get(entries);
+	list.clear();
+	for (ulong i = 0; checkpoint.ok() && i < entries; i++)
+	{
+		long physical_address;
+		checkpoint.get(physical_address);
+		list.push_back(ftl->get_block_pointer(Address(physical_address, PAGE)));
+	}
+}
+
+static bool block_address_sorter(Block * const &lhs, Block * const &rhs)
+{
+	return lhs->get_physical_address() < rhs->get_physical_address();
+}
+
+void Block_manager::save_state(Checkpoint &checkpoint) const
+{
+	checkpoint.put(data_active);
+	checkpoint.put(log_active);
+	checkpoint.put(logseq_active);
+	checkpoint.put(directoryCurrentPage);
+	checkpoint.put(directoryCachedPage);
+	checkpoint.put(simpleCurrentFree);
+	checkpoint.put(num_insert_events);
+	checkpoint.put(current_writing_block);
+	checkpoint.put(inited);
+	checkpoint.put(out_of_blocks);
+
+	save_block_list(checkpoint, active_list);
+	save_block_list(checkpoint, free_list);
+	save_block_list(checkpoint, invalid_list);
+
+	/* GC victims are taken from the end of the cost index, so its order
+	 * among blocks with equal cost matters as well */
+	std::vector<Block*> by_cost(active_cost.get<1>().begin(), active_cost.get<1>().end());
+	save_block_list(checkpoint, by_cost);
+}
+
+/* expects the blocks' own state to be restored already */
+void Block_manager::load_state(Checkpoint &checkpoint)
+{
+	checkpoint.get(data_active);
+	checkpoint.get(log_active);
+	checkpoint.get(logseq_active);
+	checkpoint.get(directoryCurrentPage);
+	checkpoint.get(directoryCachedPage);
+	checkpoint.get(simpleCurrentFree);
+	checkpoint.get(num_insert_events);
+	checkpoint.get(current_writing_block);
+	checkpoint.get(inited);
+	checkpoint.get(out_of_blocks);
+
+	load_block_list(checkpoint, active_list, ftl);
+	load_block_list(checkpoint, free_list, ftl);
+	load_block_list(checkpoint, invalid_list, ftl);
+
+	std::vector<Block*> by_cost;
+	load_block_list(checkpoint, by_cost, ftl);
+	if (!checkpoint.ok() || by_cost.size() != active_cost.size())
+		return;
+
+	/* inserting in cost order recreates the order of equal cost blocks, then
+	 * the sequenced index is put back in physical order for update_block() */
+	active_cost.clear();
+	for (uint i = 0; i < by_cost.size(); i++)
+		active_cost.push_back(by_cost[i]);
+
+	std::vector<boost::reference_wrapper<Block * const> > by_address;
+	by_address.reserve(active_cost.size());
+	for (ActiveBySeq::iterator it = active_cost.begin(); it != active_cost.end(); ++it)
+		by_address.push_back(boost::cref(*it));
+	std::sort(by_address.begin(), by_address.end(), block_address_sorter);
+	active_cost.rearrange(by_address.begin());
+}
@@ -132,3 +132,17 @@ double Bus::ready_time(uint channel)
 	assert(channels != NULL && channel < num_channels);
 	return channels[channel].ready_time();
 }
+
+void Bus::save_state(Checkpoint &checkpoint) const
+{
+	assert(channels != NULL);
+	for (uint i = 0; i < num_channels; i++)
+		channels[i].save_state(checkpoint);
+}
+
+void Bus::load_state(Checkpoint &checkpoint)
+{
+	assert(channels != NULL);
+	for (uint i = 0; i < num_channels; i++)
+		channels[i].load_state(checkpoint);
+}
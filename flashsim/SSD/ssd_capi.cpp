@@ -0,0 +1,342 @@
+/* ssd_capi.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* C interface (flashsim.h)
+ *
+ * Each device is an Ssd with a configuration of its own.  Requests are
+ * simulated when they are submitted, at the current simulated time, and
+ * their completions wait in a heap ordered by completion time until the
+ * event loop thread delivers them.  The loop advances the virtual clock to
+ * each completion it delivers, or sleeps until the scaled real clock reaches
+ * it.  One lock covers the simulation and the heap, because the current
+ * configuration of the simulator is process wide; completion callbacks are
+ * called without it, so they can submit further requests. */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+#include "ssd.h"
+#include "flashsim.h"
+
+using namespace ssd;
+
+struct flashsim_dev
+{
+	Config config;
+	Ssd *ssd;
+	uint32_t page_size;
+	uint64_t capacity;
+
+	/* submitted requests whose completion has not been delivered yet */
+	ulong outstanding;
+
+	/* edge pages of partial writes */
+	std::vector<char> scratch;
+};
+
+/* a completion waiting for the event loop, submission order breaks ties */
+struct flashsim_completion
+{
+	double time;
+	ulong sequence;
+	struct flashsim_dev *dev;
+	flashsim_end_t end;
+	void *priv;
+};
+
+struct flashsim_later
+{
+	bool operator()(const flashsim_completion &lhs, const flashsim_completion &rhs) const
+	{
+		return lhs.time > rhs.time || (lhs.time == rhs.time && lhs.sequence > rhs.sequence);
+	}
+};
+
+typedef std::chrono::steady_clock real_clock;
+
+static std::mutex lock;
+static std::condition_variable loop_cv;
+static std::condition_variable idle_cv;
+static std::priority_queue<flashsim_completion, std::vector<flashsim_completion>, flashsim_later> pending;
+static std::thread loop_thread;
+static bool loop_running = false;
+static uint num_devices = 0;
+static ulong sequence = 0;
+
+static enum flashsim_clock clock_mode = FLASHSIM_CLOCK_VIRTUAL;
+static double time_scale = 1.0;
+static double virtual_time = 0.0;
+static real_clock::time_point epoch;
+
+/* the simulated time, called with the lock held */
+static double current_time(void)
+{
+	if (clock_mode == FLASHSIM_CLOCK_VIRTUAL)
+		return virtual_time;
+	return std::chrono::duration<double, std::milli>(real_clock::now() - epoch).count() * time_scale;
+}
+
+/* delivers the completions in order of their completion time */
+static void event_loop(void)
+{
+	std::unique_lock<std::mutex> guard(lock);
+
+	while (loop_running || !pending.empty())
+	{
+		if (pending.empty())
+		{
+			loop_cv.wait(guard);
+			continue;
+		}
+
+		flashsim_completion next = pending.top();
+		if (clock_mode == FLASHSIM_CLOCK_REAL && next.time > current_time())
+		{
+			/* woken early when a request completing sooner is submitted */
+			loop_cv.wait_until(guard, epoch + std::chrono::duration_cast<real_clock::duration>(std::chrono::duration<double, std::milli>(next.time / time_scale)));
+			continue;
+		}
+		pending.pop();
+		if (next.time > virtual_time)
+			virtual_time = next.time;
+
+		guard.unlock();
+		next.end(next.priv, 0, next.time);
+		guard.lock();
+
+		if (--next.dev->outstanding == 0)
+			idle_cv.notify_all();
+	}
+}
+
+/* reads count pages from page into the start of data, zeroes without page
+ * data, returns the time taken */
+static double read_pages(struct flashsim_dev *dev, ulong page, uint count, double start_time, char *data)
+{
+	double time_taken = dev->ssd->event_arrive(READ, page, count, start_time, NULL);
+	const void *result = dev->ssd->get_result_buffer();
+
+	if (result != NULL)
+		memcpy(data, result, (size_t) count * dev->page_size);
+	else
+		memset(data, 0, (size_t) count * dev->page_size);
+	return time_taken;
+}
+
+/* simulates a request on the pages it touches, called with the lock held
+ * a partially written page is read first, as the device would have to */
+static double simulate(struct flashsim_dev *dev, enum flashsim_dir dir, uint64_t addr, uint32_t bytes, double start_time, void *buf)
+{
+	const uint32_t page_size = dev->page_size;
+	ulong first = addr / page_size;
+	ulong last = (addr + bytes - 1) / page_size;
+	uint pages = last - first + 1;
+	uint32_t head = addr % page_size;
+	uint32_t tail = (addr + bytes) % page_size;
+	double time_taken = 0.0;
+
+	/* completes once the acknowledged writes are on flash */
+	if (dir == FLASHSIM_FLUSH)
+		return dev->ssd->drain_write_buffer(start_time);
+
+	if (bytes == 0)
+		return 0.0;
+
+	if (dir == FLASHSIM_READ)
+	{
+		if (head == 0 && tail == 0)
+			return read_pages(dev, first, pages, start_time, (char *) buf);
+
+		dev->scratch.resize((size_t) pages * page_size);
+		time_taken = read_pages(dev, first, pages, start_time, &dev->scratch[0]);
+		memcpy(buf, &dev->scratch[head], bytes);
+		return time_taken;
+	}
+
+	if (dir == FLASHSIM_TRIM)
+	{
+		/* only the pages covered completely are unmapped */
+		ulong from = (addr + page_size - 1) / page_size;
+		ulong to = (addr + bytes) / page_size;
+
+		if (to <= from)
+			return 0.0;
+		return dev->ssd->event_arrive(TRIM, from, to - from, start_time, NULL);
+	}
+
+	if (head == 0 && tail == 0)
+		return dev->ssd->event_arrive(WRITE, first, pages, start_time, buf);
+
+	dev->scratch.resize((size_t) pages * page_size);
+	if (head != 0)
+		time_taken = read_pages(dev, first, 1, start_time, &dev->scratch[0]);
+	if (tail != 0 && (last != first || head == 0))
+	{
+		double tail_time = read_pages(dev, last, 1, start_time, &dev->scratch[(size_t) (pages - 1) * page_size]);
+		if (tail_time > time_taken)
+			time_taken = tail_time;
+	}
+	memcpy(&dev->scratch[head], buf, bytes);
+	return time_taken + dev->ssd->event_arrive(WRITE, first, pages, start_time + time_taken, &dev->scratch[0]);
+}
+
+static bool valid_request(const struct flashsim_dev *dev, enum flashsim_dir dir, uint64_t addr, uint32_t bytes, const void *buf)
+{
+	if (dev == NULL || addr > dev->capacity || bytes > dev->capacity - addr)
+		return false;
+	if (dir != FLASHSIM_READ && dir != FLASHSIM_WRITE && dir != FLASHSIM_TRIM && dir != FLASHSIM_FLUSH)
+		return false;
+	return dir == FLASHSIM_TRIM || dir == FLASHSIM_FLUSH || bytes == 0 || buf != NULL;
+}
+
+int flashsim_set_clock(enum flashsim_clock clock, double scale)
+{
+	std::lock_guard<std::mutex> guard(lock);
+
+	if (num_devices > 0)
+		return -EBUSY;
+	if ((clock != FLASHSIM_CLOCK_VIRTUAL && clock != FLASHSIM_CLOCK_REAL) || !(scale > 0.0))
+		return -EINVAL;
+	clock_mode = clock;
+	time_scale = scale;
+	return 0;
+}
+
+double flashsim_now(void)
+{
+	std::lock_guard<std::mutex> guard(lock);
+
+	return current_time();
+}
+
+struct flashsim_dev *flashsim_open(const char *config_file)
+{
+	FILE *stream = fopen(config_file, "r");
+
+	if (stream == NULL)
+	{
+		fprintf(stderr, "FlashSim error: %s: unable to open config file %s\n", __func__, config_file);
+		return NULL;
+	}
+	fclose(stream);
+
+	struct flashsim_dev *dev = new struct flashsim_dev;
+	dev->config.load(config_file);
+	dev->outstanding = 0;
+
+	std::lock_guard<std::mutex> guard(lock);
+
+	/* the device derives the addressable size when checking its config */
+	dev->ssd = new Ssd(dev->config);
+	const Config &config = dev->ssd->get_config();
+	dev->page_size = config.page_size;
+	dev->capacity = (uint64_t) config.number_of_addressable_blocks * config.block_size * config.page_size;
+
+	/* the simulated time starts with the first device */
+	if (num_devices++ == 0)
+	{
+		virtual_time = 0.0;
+		epoch = real_clock::now();
+		if (!loop_thread.joinable())
+		{
+			loop_running = true;
+			loop_thread = std::thread(event_loop);
+		}
+	}
+	return dev;
+}
+
+void flashsim_close(struct flashsim_dev *dev)
+{
+	std::thread stopped;
+
+	if (dev == NULL)
+		return;
+
+	{
+		std::unique_lock<std::mutex> guard(lock);
+
+		while (dev->outstanding > 0)
+			idle_cv.wait(guard);
+		delete dev->ssd;
+
+		/* the loop ends with the last device */
+		if (--num_devices == 0)
+		{
+			loop_running = false;
+			loop_cv.notify_all();
+			stopped.swap(loop_thread);
+		}
+	}
+
+	if (stopped.joinable())
+	{
+		if (stopped.get_id() == std::this_thread::get_id())
+			stopped.detach();
+		else
+			stopped.join();
+	}
+	delete dev;
+}
+
+uint32_t flashsim_get_page_size(const struct flashsim_dev *dev)
+{
+	return dev->page_size;
+}
+
+uint64_t flashsim_get_capacity(const struct flashsim_dev *dev)
+{
+	return dev->capacity;
+}
+
+double flashsim_io(struct flashsim_dev *dev, enum flashsim_dir dir, uint64_t addr, uint32_t bytes, double start_time, void *buf)
+{
+	if (!valid_request(dev, dir, addr, bytes, buf) || start_time < 0.0)
+		return -EINVAL;
+
+	std::lock_guard<std::mutex> guard(lock);
+
+	return simulate(dev, dir, addr, bytes, start_time, buf);
+}
+
+int flashsim_submit(struct flashsim_dev *dev, enum flashsim_dir dir, uint64_t addr, uint32_t bytes, void *buf, flashsim_end_t end, void *priv)
+{
+	if (!valid_request(dev, dir, addr, bytes, buf) || end == NULL)
+		return -EINVAL;
+
+	std::lock_guard<std::mutex> guard(lock);
+	double start_time = current_time();
+	flashsim_completion completion = {start_time + simulate(dev, dir, addr, bytes, start_time, buf), sequence++, dev, end, priv};
+
+	dev->outstanding++;
+	pending.push(completion);
+	loop_cv.notify_one();
+	return 0;
+}
+
+void flashsim_print_statistics(struct flashsim_dev *dev)
+{
+	std::lock_guard<std::mutex> guard(lock);
+
+	dev->ssd->print_statistics();
+}
@@ -128,49 +128,23 @@ enum status Channel::lock(double start_time, double duration, Event &event)
 	assert(start_time >= 0.0);
 	assert(duration >= 0.0);
 
-	/* free up any table slots and sort existing ones */
-	unlock(start_time);
-
-	double sched_time = BUS_CHANNEL_FREE_FLAG;
-
-	/* just schedule if table is empty */
-	if(timings.size() == 0)
-		sched_time = start_time;
-
-	/* check if can schedule before or in between before just scheduling
-	 * after all other events */
-	else
+	/* free up any table slots and sort existing ones
+	 * page operations do not lock the channel in time order (a read locks
+	 * its transfer before the next page of its request locks its command),
+	 * so only the slots that ended before the event started are free */
+	unlock(event.get_start_time());
+
+	/* the first gap in the schedule from start_time on that is long enough
+	 * the table is sorted by lock time, so the event either fits before
+	 * the next entry or has to move past it */
+	double sched_time = start_time;
+	for (std::vector<lock_times>::iterator it = timings.begin(); it < timings.end(); it++)
 	{
-		/* skip over empty table entries
-		 * empty table entries will be first from sorting (in unlock method)
-		 * because the flag is a negative value */
-		std::vector<lock_times>::iterator it = timings.begin();
-
-		/* schedule before first event in table */
-		if((*it).lock_time > start_time && (*it).lock_time - start_time >= duration)
-			sched_time = start_time;
-
-		/* schedule in between other events in table */
-		if(sched_time == BUS_CHANNEL_FREE_FLAG)
-		{
-			for(; it < timings.end(); it++)
-			{
-				if (it + 1 != timings.end())
-				{
-					/* enough time to schedule in between next two events */
-					if((*it).unlock_time >= start_time  && (*(it+1)).lock_time - (*it).unlock_time >= duration)
-					{
-						sched_time = (*it).unlock_time;
-						break;
-					}
-				}
-
-			}
-		}
-
-		/* schedule after all events in table */
-		if(sched_time == BUS_CHANNEL_FREE_FLAG)
-			sched_time = timings.back().unlock_time;
+		if ((*it).unlock_time <= sched_time)
+			continue;
+		if ((*it).lock_time >= sched_time + duration)
+			break;
+		sched_time = (*it).unlock_time;
 	}
 
 	/* write scheduling info in free table slot */
@@ -217,3 +191,30 @@ double Channel::ready_time(void)
 	return ready_at;
 }
 
+
+/* the schedule of outstanding locks, so a restored device resumes with the
+ * same bus contention; connections are structural and not saved */
+void Channel::save_state(Checkpoint &checkpoint) const
+{
+	ulong entries = timings.size();
+
+	checkpoint.put(entries);
+	if (entries > 0)
+		checkpoint.put_bytes(&timings[0], entries * sizeof(lock_times));
+	checkpoint.put(table_entries);
+	checkpoint.put(selected_entry);
+	checkpoint.put(ready_at);
+}
+
+void Channel::load_state(Checkpoint &checkpoint)
+{
+	ulong entries;
+
+	checkpoint.get(entries);
+	timings.resize(checkpoint.ok() ? entries : 0);
+	if (!timings.empty())
+		checkpoint.get_bytes(&timings[0], timings.size() * sizeof(lock_times));
+	checkpoint.get(table_entries);
+	checkpoint.get(selected_entry);
+	checkpoint.get(ready_at);
+}
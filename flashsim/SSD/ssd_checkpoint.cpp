@@ -0,0 +1,312 @@
+/* ssd_checkpoint.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Checkpoint class and Ssd checkpoint files
+ *
+ * Saving and restoring the complete simulator state, so a preconditioned
+ * (filled and overwritten until GC runs) device can be reloaded at startup
+ * instead of being preconditioned again before every experiment.
+ *
+ * A checkpoint holds a header with the device geometry and FTL settings it
+ * was taken with, followed by one tagged section per component: the flash
+ * hierarchy (page / block states, wear counters), the bus channel schedules,
+ * the controller statistics, the FTL maps, the Block_manager lists, the
+ * submission queues and, optionally, the page data.  Every component saves
+ * and loads its own state through save_state() / load_state(). */
+
+#include <new>
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include "ssd.h"
+
+using namespace ssd;
+
+/* "FSCP" */
+static const uint CHECKPOINT_MAGIC = 0x50435346;
+static const uint CHECKPOINT_VERSION = 6;
+
+static const uint SECTION_FLASH = 1;
+static const uint SECTION_BUS = 2;
+static const uint SECTION_CONTROLLER = 3;
+static const uint SECTION_PAGE_DATA = 4;
+static const uint SECTION_QUEUES = 5;
+static const uint SECTION_END = 0xffffffff;
+
+Checkpoint::Checkpoint(FILE *stream):
+	stream(stream),
+	failed(stream == NULL)
+{
+	return;
+}
+
+Checkpoint::~Checkpoint(void)
+{
+	return;
+}
+
+void Checkpoint::put_bytes(const void *data, size_t size)
+{
+	if (!failed && size > 0 && fwrite(data, size, 1, stream) != 1)
+		failed = true;
+}
+
+/* on failure the destination is zeroed so callers never see garbage */
+void Checkpoint::get_bytes(void *data, size_t size)
+{
+	if (!failed && size > 0 && fread(data, size, 1, stream) != 1)
+		failed = true;
+	if (failed)
+		memset(data, 0, size);
+}
+
+/* addresses are stored field by field, including a possibly stale linear
+ * address, so they come back exactly as they were */
+void Checkpoint::put_address(const Address &address)
+{
+	put(address.package);
+	put(address.die);
+	put(address.plane);
+	put(address.block);
+	put(address.page);
+	put(address.real_address);
+	put(address.valid);
+}
+
+void Checkpoint::get_address(Address &address)
+{
+	get(address.package);
+	get(address.die);
+	get(address.plane);
+	get(address.block);
+	get(address.page);
+	get(address.real_address);
+	get(address.valid);
+}
+
+/* section tags catch a checkpoint that does not match the loader early
+ * instead of restoring garbage */
+void Checkpoint::put_section(uint tag)
+{
+	put(tag);
+}
+
+void Checkpoint::get_section(uint tag)
+{
+	uint found;
+
+	get(found);
+	if (!failed && found != tag)
+	{
+		fprintf(stderr, "Checkpoint error: %s: expected section %u, found %u\n", __func__, tag, found);
+		failed = true;
+	}
+}
+
+/* for loaders that find the saved state unusable */
+void Checkpoint::fail(void)
+{
+	failed = true;
+}
+
+bool Checkpoint::ok(void) const
+{
+	return !failed;
+}
+
+/* the configuration a checkpoint depends on */
+static void put_config(Checkpoint &checkpoint)
+{
+	checkpoint.put(SSD_SIZE);
+	checkpoint.put(PACKAGE_SIZE);
+	checkpoint.put(DIE_SIZE);
+	checkpoint.put(PLANE_SIZE);
+	checkpoint.put(BLOCK_SIZE);
+	checkpoint.put(PAGE_SIZE);
+	checkpoint.put(FTL_IMPLEMENTATION);
+	checkpoint.put(OVERPROVISIONING);
+	checkpoint.put(MAP_DIRECTORY_SIZE);
+	checkpoint.put(BAST_LOG_BLOCK_LIMIT);
+	checkpoint.put(FAST_LOG_BLOCK_LIMIT);
+	checkpoint.put(CACHE_DFTL_LIMIT);
+	checkpoint.put(BUS_TABLE_SIZE);
+	checkpoint.put(NVME_QUEUES);
+	checkpoint.put(NVME_QUEUE_DEPTH);
+	checkpoint.put((uint) DIE_MULTI_PLANE);
+	checkpoint.put(WRITE_BUFFER_PAGES);
+}
+
+static enum status check_config(Checkpoint &checkpoint)
+{
+	const uint expected[] = {SSD_SIZE, PACKAGE_SIZE, DIE_SIZE, PLANE_SIZE, BLOCK_SIZE, PAGE_SIZE, FTL_IMPLEMENTATION, OVERPROVISIONING, MAP_DIRECTORY_SIZE, BAST_LOG_BLOCK_LIMIT, FAST_LOG_BLOCK_LIMIT, CACHE_DFTL_LIMIT, BUS_TABLE_SIZE, NVME_QUEUES, NVME_QUEUE_DEPTH, DIE_MULTI_PLANE, WRITE_BUFFER_PAGES};
+	const char *names[] = {"SSD_SIZE", "PACKAGE_SIZE", "DIE_SIZE", "PLANE_SIZE", "BLOCK_SIZE", "PAGE_SIZE", "FTL_IMPLEMENTATION", "OVERPROVISIONING", "MAP_DIRECTORY_SIZE", "BAST_LOG_BLOCK_LIMIT", "FAST_LOG_BLOCK_LIMIT", "CACHE_DFTL_LIMIT", "BUS_TABLE_SIZE", "NVME_QUEUES", "NVME_QUEUE_DEPTH", "DIE_MULTI_PLANE", "WRITE_BUFFER_PAGES"};
+	enum status status = SUCCESS;
+
+	for (uint i = 0; i < sizeof(expected) / sizeof(expected[0]); i++)
+	{
+		uint value;
+		checkpoint.get(value);
+		if (checkpoint.ok() && value != expected[i])
+		{
+			fprintf(stderr, "Ssd error: %s: checkpoint has %s %u, configuration has %u\n", __func__, names[i], value, expected[i]);
+			status = FAILURE;
+		}
+	}
+	return checkpoint.ok() ? status : FAILURE;
+}
+
+/* save the complete simulator state to file_name
+ * the page data is only included when data pages are enabled and
+ * save_page_data is set */
+enum status Ssd::save_checkpoint(const char *file_name, bool save_page_data)
+{
+	Config_scope scope(config);
+	uint i;
+
+	FILE *stream = fopen(file_name, "wb");
+	if (stream == NULL)
+	{
+		fprintf(stderr, "Ssd error: %s: unable to open checkpoint file %s\n", __func__, file_name);
+		return FAILURE;
+	}
+
+	Checkpoint checkpoint(stream);
+	bool page_data = PAGE_ENABLE_DATA && save_page_data;
+
+	checkpoint.put(CHECKPOINT_MAGIC);
+	checkpoint.put(CHECKPOINT_VERSION);
+	put_config(checkpoint);
+	checkpoint.put(page_data);
+
+	checkpoint.put_section(SECTION_FLASH);
+	checkpoint.put(erases_remaining);
+	checkpoint.put(least_worn);
+	checkpoint.put(last_erase_time);
+	for (i = 0; i < size; i++)
+		data[i].save_state(checkpoint);
+
+	checkpoint.put_section(SECTION_BUS);
+	bus.save_state(checkpoint);
+
+	checkpoint.put_section(SECTION_CONTROLLER);
+	controller.save_state(checkpoint);
+
+	if (queues != NULL)
+	{
+		checkpoint.put_section(SECTION_QUEUES);
+		queues->save_state(checkpoint);
+	}
+
+	if (page_data)
+	{
+		checkpoint.put_section(SECTION_PAGE_DATA);
+		page_store->save_state(checkpoint);
+	}
+	checkpoint.put_section(SECTION_END);
+
+	bool written = checkpoint.ok();
+	if (fclose(stream) != 0)
+		written = false;
+
+	if (!written)
+	{
+		fprintf(stderr, "Ssd error: %s: unable to write checkpoint file %s\n", __func__, file_name);
+		return FAILURE;
+	}
+	return SUCCESS;
+}
+
+/* restore the simulator state saved by save_checkpoint()
+ * meant to be called on a freshly created Ssd with the same configuration
+ * the checkpoint was taken with; a failed load leaves the Ssd unusable */
+enum status Ssd::load_checkpoint(const char *file_name)
+{
+	Config_scope scope(config);
+	uint i;
+	uint magic;
+	uint version;
+	bool page_data;
+
+	FILE *stream = fopen(file_name, "rb");
+	if (stream == NULL)
+	{
+		fprintf(stderr, "Ssd error: %s: unable to open checkpoint file %s\n", __func__, file_name);
+		return FAILURE;
+	}
+
+	Checkpoint checkpoint(stream);
+
+	checkpoint.get(magic);
+	checkpoint.get(version);
+	if (!checkpoint.ok() || magic != CHECKPOINT_MAGIC || version != CHECKPOINT_VERSION)
+	{
+		fprintf(stderr, "Ssd error: %s: %s is not a FlashSim checkpoint (version %u)\n", __func__, file_name, CHECKPOINT_VERSION);
+		fclose(stream);
+		return FAILURE;
+	}
+	if (check_config(checkpoint) == FAILURE)
+	{
+		fclose(stream);
+		return FAILURE;
+	}
+	checkpoint.get(page_data);
+
+	checkpoint.get_section(SECTION_FLASH);
+	checkpoint.get(erases_remaining);
+	checkpoint.get(least_worn);
+	checkpoint.get(last_erase_time);
+	for (i = 0; i < size; i++)
+		data[i].load_state(checkpoint);
+
+	checkpoint.get_section(SECTION_BUS);
+	bus.load_state(checkpoint);
+
+	checkpoint.get_section(SECTION_CONTROLLER);
+	controller.load_state(checkpoint);
+
+	if (queues != NULL)
+	{
+		checkpoint.get_section(SECTION_QUEUES);
+		queues->load_state(checkpoint);
+	}
+
+	if (page_data)
+	{
+		checkpoint.get_section(SECTION_PAGE_DATA);
+		if (PAGE_ENABLE_DATA)
+			page_store->load_state(checkpoint);
+		else
+		{
+			/* read past the data the configuration has no use for */
+			Page_store discard((ulong) SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE * BLOCK_SIZE);
+			discard.load_state(checkpoint);
+		}
+	}
+	else if (PAGE_ENABLE_DATA)
+		fprintf(stderr, "Ssd warning: %s: checkpoint %s holds no page data, all pages read as zeroes\n", __func__, file_name);
+	checkpoint.get_section(SECTION_END);
+
+	fclose(stream);
+
+	if (!checkpoint.ok())
+	{
+		fprintf(stderr, "Ssd error: %s: checkpoint file %s is truncated or corrupt\n", __func__, file_name);
+		return FAILURE;
+	}
+	read_buffer_valid = false;
+	return SUCCESS;
+}
@@ -25,219 +25,182 @@
  * support includes skipping blank lines, comment lines (begin with a #).
  * Parsed lines consist of the variable name, a space, then the value
  * (e.g. SSD_SIZE 4 ).  Default config values (if config file is missing
- * an entry to set the value) are defined in the variable declarations below.
+ * an entry to set the value) are set by the Config constructor below.
  *
- * A function is also provided for printing the current configuration. */
+ * Each Ssd keeps its own Config.  load_config() and print_config() work on
+ * the default configuration, which new devices copy unless they are given
+ * one of their own. */
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include "ssd.h"
 
-/* using namespace ssd; */
-namespace ssd {
-
-/* Define typedefs and error macros from ssd.h here instead of including
- * header file because we want to declare the global configuration variables
- * and set them in this file.  ssd.h declares the global configuration
- * variables as extern const, which would conflict this file's definitions.
- * This is not the best solution, but it is easy and it works. */
-
-/* some obvious typedefs for laziness */
-typedef unsigned int uint;
-typedef unsigned long ulong;
-
-/* define exit codes for errors */
-#define MEM_ERR -1
-#define FILE_ERR -2
-
-/* Simulator configuration
- * All configuration variables are set by reading ssd.conf and referenced with
- * 	as "extern const" in ssd.h
- * Configuration variables are described below and are assigned default values
- * 	in case of config file error.  The values defined below are overwritten
- * 	when defined in the config file.
- * We do not want a class here because we want to use the configuration
- * 	variables in the same was as macros. */
-
-/* Ram class:
- * 	delay to read from and write to the RAM for 1 page of data */
-double RAM_READ_DELAY = 0.00000001;
-double RAM_WRITE_DELAY = 0.00000001;
-
-/* Bus class:
- * 	delay to communicate over bus
- * 	max number of connected devices allowed
- * 	number of time entries bus has to keep track of future schedule usage
- * 	value used as a flag to indicate channel is free
- * 		(use a value not used as a delay value - e.g. -1.0)
- * 	number of simultaneous communication channels - defined by SSD_SIZE */
-double BUS_CTRL_DELAY = 0.000000005;
-double BUS_DATA_DELAY = 0.00000001;
-uint BUS_MAX_CONNECT = 8;
-uint BUS_TABLE_SIZE = 64;
-double BUS_CHANNEL_FREE_FLAG = -1.0;
-/* uint BUS_CHANNELS = 4; same as # of Packages, defined by SSD_SIZE */
-
-/* Ssd class:
- * 	number of Packages per Ssd (size) */
-uint SSD_SIZE = 4;
-
-/* Package class:
- * 	number of Dies per Package (size) */
-uint PACKAGE_SIZE = 8;
-
-/* Die class:
- * 	number of Planes per Die (size) */
-uint DIE_SIZE = 2;
-
-/* Plane class:
- * 	number of Blocks per Plane (size)
- * 	delay for reading from plane register
- * 	delay for writing to plane register
- * 	delay for merging is based on read, write, reg_read, reg_write 
- * 		and does not need to be explicitly defined */
-uint PLANE_SIZE = 64;
-double PLANE_REG_READ_DELAY = 0.0000000001;
-double PLANE_REG_WRITE_DELAY = 0.0000000001;
-
-/* Block class:
- * 	number of Pages per Block (size)
- * 	number of erases in lifetime of block
- * 	delay for erasing block */
-uint BLOCK_SIZE = 16;
-uint BLOCK_ERASES = 1048675;
-double BLOCK_ERASE_DELAY = 0.001;
-
-/* Page class:
- * 	delay for Page reads
- * 	delay for Page writes */
-double PAGE_READ_DELAY = 0.000001;
-double PAGE_WRITE_DELAY = 0.00001;
-
-/* Page data memory allocation
- *
- */
-uint PAGE_SIZE = 4096;
-bool PAGE_ENABLE_DATA = true;
-
-/*
- * Memory area to support pages with data.
- */
-void *page_data;
-
-/*
- * Number of blocks to reserve for mappings. e.g. map directory in BAST.
- */
-uint MAP_DIRECTORY_SIZE = 0;
-
-/*
- * Implementation to use (0 -> Page, 1 -> BAST, 2 -> FAST, 3 -> DFTL, 4 -> BiModal
- */
-uint FTL_IMPLEMENTATION = 0;
-
-/*
- * Limit of LOG pages (for use in BAST)
- */
-uint BAST_LOG_BLOCK_LIMIT = 100;
-
-
-/*
- * Limit of LOG pages (for use in FAST)
- */
-uint FAST_LOG_BLOCK_LIMIT = 4;
-
-/*
- * Number of pages allowed to be in DFTL Cached Mapping Table.
- * (Size equals CACHE_BLOCK_LIMIT * block size * page size)
- *
- */
-uint CACHE_DFTL_LIMIT = 8;
-
-/*
- * Parallelism mode.
- * 0 -> Normal
- * 1 -> Striping
- * 2 -> Logical Address Space Parallelism (LASP)
- */
-uint PARALLELISM_MODE = 0;
-
-/* Virtual block size (as a multiple of the physical block size) */
-uint VIRTUAL_BLOCK_SIZE = 1;
+using namespace ssd;
 
-/* Virtual page size (as a multiple of the physical page size) */
-uint VIRTUAL_PAGE_SIZE = 1;
+/* the configuration read by load_config(), current outside device calls */
+static Config default_config;
 
-uint NUMBER_OF_ADDRESSABLE_BLOCKS = 0;
+namespace ssd {
+	const Config *current_config = &default_config;
+}
 
-/* RAISSDs: Number of physical SSDs */
-uint RAID_NUMBER_OF_PHYSICAL_SSDS = 0;
+/* Default values, used when the config file does not set a variable.
+ * Variables are described in ssd.h. */
+Config::Config(void):
+	ram_read_delay(0.00000001),
+	ram_write_delay(0.00000001),
+	bus_ctrl_delay(0.000000005),
+	bus_data_delay(0.00000001),
+	bus_max_connect(8),
+	bus_table_size(64),
+	bus_channel_free_flag(-1.0),
+	ssd_size(4),
+	package_size(8),
+	die_size(2),
+	plane_size(64),
+	plane_reg_read_delay(0.0000000001),
+	plane_reg_write_delay(0.0000000001),
+	block_size(16),
+	block_erases(1048675),
+	block_erase_delay(0.001),
+	page_read_delay(0.000001),
+	page_write_delay(0.00001),
+	page_size(4096),
+	page_enable_data(true),
+	map_directory_size(0),
+	ftl_implementation(0),
+	overprovisioning(7),
+	gc_policy(0),
+	background_gc(0),
+	background_gc_idle_time(10.0),
+	background_gc_watermark(10),
+	background_gc_blocks(0),
+	nvme_queues(0),
+	nvme_queue_depth(32),
+	nvme_scheduler(1),
+	die_multi_plane(false),
+	die_cache_mode(false),
+	write_buffer_pages(0),
+	write_buffer_flush(0),
+	write_buffer_high(75),
+	write_buffer_low(25),
+	stats_window(0.0),
+	bast_log_block_limit(100),
+	fast_log_block_limit(4),
+	cache_dftl_limit(8),
+	parallelism_mode(0),
+	virtual_block_size(1),
+	virtual_page_size(1),
+	number_of_addressable_blocks(0),
+	raid_number_of_physical_ssds(0),
+	raid_stripe_unit(16)
+{
+	return;
+}
 
-void load_entry(char *name, double value, uint line_number) {
+void Config::load_entry(const char *name, double value, uint line_number)
+{
 	/* cheap implementation - go through all possibilities and match entry */
 	if (!strcmp(name, "RAM_READ_DELAY"))
-		RAM_READ_DELAY = value;
+		ram_read_delay = value;
 	else if (!strcmp(name, "RAM_WRITE_DELAY"))
-		RAM_WRITE_DELAY = value;
+		ram_write_delay = value;
 	else if (!strcmp(name, "BUS_CTRL_DELAY"))
-		BUS_CTRL_DELAY = value;
+		bus_ctrl_delay = value;
 	else if (!strcmp(name, "BUS_DATA_DELAY"))
-		BUS_DATA_DELAY = value;
+		bus_data_delay = value;
 	else if (!strcmp(name, "BUS_MAX_CONNECT"))
-		BUS_MAX_CONNECT = (uint) value;
+		bus_max_connect = (uint) value;
 	else if (!strcmp(name, "BUS_TABLE_SIZE"))
-		BUS_TABLE_SIZE = (uint) value;
+		bus_table_size = (uint) value;
 	else if (!strcmp(name, "SSD_SIZE"))
-		SSD_SIZE = (uint) value;
+		ssd_size = (uint) value;
 	else if (!strcmp(name, "PACKAGE_SIZE"))
-		PACKAGE_SIZE = (uint) value;
+		package_size = (uint) value;
 	else if (!strcmp(name, "DIE_SIZE"))
-		DIE_SIZE = (uint) value;
+		die_size = (uint) value;
 	else if (!strcmp(name, "PLANE_SIZE"))
-		PLANE_SIZE = (uint) value;
+		plane_size = (uint) value;
 	else if (!strcmp(name, "PLANE_REG_READ_DELAY"))
-		PLANE_REG_READ_DELAY = value;
+		plane_reg_read_delay = value;
 	else if (!strcmp(name, "PLANE_REG_WRITE_DELAY"))
-		PLANE_REG_WRITE_DELAY = value;
+		plane_reg_write_delay = value;
 	else if (!strcmp(name, "BLOCK_SIZE"))
-		BLOCK_SIZE = (uint) value;
+		block_size = (uint) value;
 	else if (!strcmp(name, "BLOCK_ERASES"))
-		BLOCK_ERASES = (uint) value;
+		block_erases = (uint) value;
 	else if (!strcmp(name, "BLOCK_ERASE_DELAY"))
-		BLOCK_ERASE_DELAY = value;
+		block_erase_delay = value;
 	else if (!strcmp(name, "PAGE_READ_DELAY"))
-		PAGE_READ_DELAY = value;
+		page_read_delay = value;
 	else if (!strcmp(name, "PAGE_WRITE_DELAY"))
-		PAGE_WRITE_DELAY = value;
+		page_write_delay = value;
 	else if (!strcmp(name, "PAGE_SIZE"))
-		PAGE_SIZE = value;
+		page_size = value;
 	else if (!strcmp(name, "FTL_IMPLEMENTATION"))
-		FTL_IMPLEMENTATION = value;
+		ftl_implementation = value;
 	else if (!strcmp(name, "PAGE_ENABLE_DATA"))
-		PAGE_ENABLE_DATA = (value == 1);
+		page_enable_data = (value == 1);
 	else if (!strcmp(name, "MAP_DIRECTORY_SIZE"))
-		MAP_DIRECTORY_SIZE = value;
+		map_directory_size = value;
 	else if (!strcmp(name, "FTL_IMPLEMENTATION"))
-		FTL_IMPLEMENTATION = value;
+		ftl_implementation = value;
+	else if (!strcmp(name, "OVERPROVISIONING"))
+		overprovisioning = value;
+	else if (!strcmp(name, "GC_POLICY"))
+		gc_policy = value;
+	else if (!strcmp(name, "BACKGROUND_GC"))
+		background_gc = value;
+	else if (!strcmp(name, "BACKGROUND_GC_IDLE_TIME"))
+		background_gc_idle_time = value;
+	else if (!strcmp(name, "BACKGROUND_GC_WATERMARK"))
+		background_gc_watermark = value;
+	else if (!strcmp(name, "BACKGROUND_GC_BLOCKS"))
+		background_gc_blocks = value;
+	else if (!strcmp(name, "NVME_QUEUES"))
+		nvme_queues = value;
+	else if (!strcmp(name, "NVME_QUEUE_DEPTH"))
+		nvme_queue_depth = value;
+	else if (!strcmp(name, "NVME_SCHEDULER"))
+		nvme_scheduler = value;
+	else if (!strcmp(name, "DIE_MULTI_PLANE"))
+		die_multi_plane = value;
+	else if (!strcmp(name, "DIE_CACHE_MODE"))
+		die_cache_mode = value;
+	else if (!strcmp(name, "WRITE_BUFFER_PAGES"))
+		write_buffer_pages = value;
+	else if (!strcmp(name, "WRITE_BUFFER_FLUSH"))
+		write_buffer_flush = value;
+	else if (!strcmp(name, "WRITE_BUFFER_HIGH"))
+		write_buffer_high = value;
+	else if (!strcmp(name, "WRITE_BUFFER_LOW"))
+		write_buffer_low = value;
+	else if (!strcmp(name, "STATS_WINDOW"))
+		stats_window = value;
 	else if (!strcmp(name, "BAST_LOG_BLOCK_LIMIT"))
-		BAST_LOG_BLOCK_LIMIT = value;
+		bast_log_block_limit = value;
 	else if (!strcmp(name, "FAST_LOG_BLOCK_LIMIT"))
-		FAST_LOG_BLOCK_LIMIT = value;
+		fast_log_block_limit = value;
 	else if (!strcmp(name, "CACHE_DFTL_LIMIT"))
-		CACHE_DFTL_LIMIT = value;
+		cache_dftl_limit = value;
 	else if (!strcmp(name, "PARALLELISM_MODE"))
-		PARALLELISM_MODE = value;
+		parallelism_mode = value;
 	else if (!strcmp(name, "VIRTUAL_BLOCK_SIZE"))
-		VIRTUAL_BLOCK_SIZE = value;
+		virtual_block_size = value;
 	else if (!strcmp(name, "VIRTUAL_PAGE_SIZE"))
-		VIRTUAL_PAGE_SIZE = value;
+		virtual_page_size = value;
 	else if (!strcmp(name, "RAID_NUMBER_OF_PHYSICAL_SSDS"))
-		RAID_NUMBER_OF_PHYSICAL_SSDS = value;
+		raid_number_of_physical_ssds = value;
+	else if (!strcmp(name, "RAID_STRIPE_UNIT"))
+		raid_stripe_unit = value;
 	else
 		fprintf(stderr, "Config file parsing error on line %u\n", line_number);
 	return;
 }
 
-void load_config(const char * const config_name) {
+void Config::load(const char * const config_name)
+{
 	FILE *config_file = NULL;
 
 	/* update sscanf line below with max name length (%s) if changing sizes */
@@ -270,44 +233,144 @@ void load_config(const char * const config_name) {
 	}
 	fclose(config_file);
 
-	NUMBER_OF_ADDRESSABLE_BLOCKS = (SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE) / VIRTUAL_PAGE_SIZE;
-
+	check();
 	return;
 }
 
-/** Default wrapper. */
-void load_config(void) {
-	load_config("ssd.conf");
+/* derives the number of addressable blocks from the geometry and checks the
+ * values, exits on an invalid configuration like load() does
+ * call again after changing the geometry of a loaded configuration */
+void Config::check(void)
+{
+	number_of_addressable_blocks = (ssd_size * package_size * die_size * plane_size) / virtual_page_size;
+
+	if (nvme_queues > 0 && nvme_queue_depth == 0)
+	{
+		fprintf(stderr, "Config file error: NVME_QUEUE_DEPTH must be at least 1\n");
+		exit(FILE_ERR);
+	}
+
+	if (write_buffer_pages > 0 && (write_buffer_high > 100 || write_buffer_low >= write_buffer_high))
+	{
+		fprintf(stderr, "Config file error: WRITE_BUFFER_LOW must be below WRITE_BUFFER_HIGH, which must be at most 100\n");
+		exit(FILE_ERR);
+	}
+
+	if (parallelism_mode == 3 && raid_stripe_unit == 0)
+	{
+		fprintf(stderr, "Config file error: RAID_STRIPE_UNIT must be at least 1\n");
+		exit(FILE_ERR);
+	}
+
+	/* the page FTL (0) keeps the over-provisioned blocks to itself */
+	if (ftl_implementation == 0)
+	{
+		if (overprovisioning >= 100)
+		{
+			fprintf(stderr, "Config file error: OVERPROVISIONING must be below 100\n");
+			exit(FILE_ERR);
+		}
+		number_of_addressable_blocks -= (number_of_addressable_blocks * overprovisioning + 99) / 100;
+	}
+
+	return;
 }
 
-void print_config(FILE *stream) {
+void Config::print(FILE *stream) const
+{
 	if (stream == NULL)
 		stream = stdout;
-	fprintf(stream, "RAM_READ_DELAY: %.16lf\n", RAM_READ_DELAY);
-	fprintf(stream, "RAM_WRITE_DELAY: %.16lf\n", RAM_WRITE_DELAY);
-	fprintf(stream, "BUS_CTRL_DELAY: %.16lf\n", BUS_CTRL_DELAY);
-	fprintf(stream, "BUS_DATA_DELAY: %.16lf\n", BUS_DATA_DELAY);
-	fprintf(stream, "BUS_MAX_CONNECT: %u\n", BUS_MAX_CONNECT);
-	fprintf(stream, "BUS_TABLE_SIZE: %u\n", BUS_TABLE_SIZE);
-	fprintf(stream, "SSD_SIZE: %u\n", SSD_SIZE);
-	fprintf(stream, "PACKAGE_SIZE: %u\n", PACKAGE_SIZE);
-	fprintf(stream, "DIE_SIZE: %u\n", DIE_SIZE);
-	fprintf(stream, "PLANE_SIZE: %u\n", PLANE_SIZE);
-	fprintf(stream, "PLANE_REG_READ_DELAY: %.16lf\n", PLANE_REG_READ_DELAY);
-	fprintf(stream, "PLANE_REG_WRITE_DELAY: %.16lf\n", PLANE_REG_WRITE_DELAY);
-	fprintf(stream, "BLOCK_SIZE: %u\n", BLOCK_SIZE);
-	fprintf(stream, "BLOCK_ERASES: %u\n", BLOCK_ERASES);
-	fprintf(stream, "BLOCK_ERASE_DELAY: %.16lf\n", BLOCK_ERASE_DELAY);
-	fprintf(stream, "PAGE_READ_DELAY: %.16lf\n", PAGE_READ_DELAY);
-	fprintf(stream, "PAGE_WRITE_DELAY: %.16lf\n", PAGE_WRITE_DELAY);
-	fprintf(stream, "PAGE_SIZE: %u\n", PAGE_SIZE);
-	fprintf(stream, "PAGE_ENABLE_DATA: %i\n", PAGE_ENABLE_DATA);
-	fprintf(stream, "MAP_DIRECTORY_SIZE: %i\n", MAP_DIRECTORY_SIZE);
-	fprintf(stream, "FTL_IMPLEMENTATION: %i\n", FTL_IMPLEMENTATION);
-	fprintf(stream, "PARALLELISM_MODE: %i\n", PARALLELISM_MODE);
-	fprintf(stream, "RAID_NUMBER_OF_PHYSICAL_SSDS: %i\n", RAID_NUMBER_OF_PHYSICAL_SSDS);
+	fprintf(stream, "RAM_READ_DELAY: %.16lf\n", ram_read_delay);
+	fprintf(stream, "RAM_WRITE_DELAY: %.16lf\n", ram_write_delay);
+	fprintf(stream, "BUS_CTRL_DELAY: %.16lf\n", bus_ctrl_delay);
+	fprintf(stream, "BUS_DATA_DELAY: %.16lf\n", bus_data_delay);
+	fprintf(stream, "BUS_MAX_CONNECT: %u\n", bus_max_connect);
+	fprintf(stream, "BUS_TABLE_SIZE: %u\n", bus_table_size);
+	fprintf(stream, "SSD_SIZE: %u\n", ssd_size);
+	fprintf(stream, "PACKAGE_SIZE: %u\n", package_size);
+	fprintf(stream, "DIE_SIZE: %u\n", die_size);
+	fprintf(stream, "PLANE_SIZE: %u\n", plane_size);
+	fprintf(stream, "PLANE_REG_READ_DELAY: %.16lf\n", plane_reg_read_delay);
+	fprintf(stream, "PLANE_REG_WRITE_DELAY: %.16lf\n", plane_reg_write_delay);
+	fprintf(stream, "BLOCK_SIZE: %u\n", block_size);
+	fprintf(stream, "BLOCK_ERASES: %u\n", block_erases);
+	fprintf(stream, "BLOCK_ERASE_DELAY: %.16lf\n", block_erase_delay);
+	fprintf(stream, "PAGE_READ_DELAY: %.16lf\n", page_read_delay);
+	fprintf(stream, "PAGE_WRITE_DELAY: %.16lf\n", page_write_delay);
+	fprintf(stream, "PAGE_SIZE: %u\n", page_size);
+	fprintf(stream, "PAGE_ENABLE_DATA: %i\n", page_enable_data);
+	fprintf(stream, "MAP_DIRECTORY_SIZE: %i\n", map_directory_size);
+	fprintf(stream, "FTL_IMPLEMENTATION: %i\n", ftl_implementation);
+	fprintf(stream, "OVERPROVISIONING: %u\n", overprovisioning);
+	fprintf(stream, "GC_POLICY: %u\n", gc_policy);
+	fprintf(stream, "BACKGROUND_GC: %u\n", background_gc);
+	fprintf(stream, "BACKGROUND_GC_IDLE_TIME: %.16lf\n", background_gc_idle_time);
+	fprintf(stream, "BACKGROUND_GC_WATERMARK: %u\n", background_gc_watermark);
+	fprintf(stream, "BACKGROUND_GC_BLOCKS: %u\n", background_gc_blocks);
+	fprintf(stream, "NVME_QUEUES: %u\n", nvme_queues);
+	fprintf(stream, "NVME_QUEUE_DEPTH: %u\n", nvme_queue_depth);
+	fprintf(stream, "NVME_SCHEDULER: %u\n", nvme_scheduler);
+	fprintf(stream, "DIE_MULTI_PLANE: %i\n", die_multi_plane);
+	fprintf(stream, "DIE_CACHE_MODE: %i\n", die_cache_mode);
+	fprintf(stream, "WRITE_BUFFER_PAGES: %u\n", write_buffer_pages);
+	fprintf(stream, "WRITE_BUFFER_FLUSH: %u\n", write_buffer_flush);
+	fprintf(stream, "WRITE_BUFFER_HIGH: %u\n", write_buffer_high);
+	fprintf(stream, "WRITE_BUFFER_LOW: %u\n", write_buffer_low);
+	fprintf(stream, "STATS_WINDOW: %.16lf\n", stats_window);
+	fprintf(stream, "PARALLELISM_MODE: %i\n", parallelism_mode);
+	fprintf(stream, "RAID_NUMBER_OF_PHYSICAL_SSDS: %i\n", raid_number_of_physical_ssds);
+	fprintf(stream, "RAID_STRIPE_UNIT: %u\n", raid_stripe_unit);
 
 	return;
 }
 
+Config_scope::Config_scope(const Config &config):
+	config(config),
+	previous(NULL),
+	entered(false)
+{
+	enter();
+}
+
+Config_scope::~Config_scope(void)
+{
+	leave();
+}
+
+void Config_scope::enter(void)
+{
+	if (entered)
+		return;
+	previous = current_config;
+	current_config = &config;
+	entered = true;
+}
+
+void Config_scope::leave(void)
+{
+	if (!entered)
+		return;
+	current_config = previous;
+	entered = false;
+}
+
+void ssd::load_entry(char *name, double value, uint line_number)
+{
+	default_config.load_entry(name, value, line_number);
+}
+
+void ssd::load_config(const char * const config_name)
+{
+	default_config.load(config_name);
+}
+
+/** Default wrapper. */
+void ssd::load_config(void)
+{
+	load_config("ssd.conf");
+}
+
+void ssd::print_config(FILE *stream)
+{
+	current_config->print(stream);
 }
@@ -39,7 +39,13 @@
 using namespace ssd;
 
 Controller::Controller(Ssd &parent):
-	ssd(parent)
+	ssd(parent),
+	write_buffer(NULL),
+	last_arrival(0.0),
+	busy_until(parent.size, 0.0),
+	gc_depth(0),
+	gc_start(0.0),
+	gc_background(false)
 {
 	switch (FTL_IMPLEMENTATION)
 	{
@@ -59,26 +65,258 @@ Controller::Controller(Ssd &parent):
 		ftl = new FtlImpl_BDftl(*this);
 		break;
 	}
+
+	if (NVME_QUEUES > 0)
+	{
+		uint dies = ssd.size * PACKAGE_SIZE * (DIE_MULTI_PLANE ? DIE_SIZE : 1);
+
+		die_free.assign(dies, 0.0);
+		cache_free.assign(dies, 0.0);
+		die_op.assign(dies, READ);
+		channel_dispatch.assign(ssd.size, 0.0);
+	}
+	else if (DIE_MULTI_PLANE || DIE_CACHE_MODE)
+		fprintf(stderr, "Controller warning: %s: DIE_MULTI_PLANE and DIE_CACHE_MODE need the die model of NVME_QUEUES, ignoring them\n", __func__);
+
+	if (WRITE_BUFFER_PAGES > 0)
+		write_buffer = new Write_buffer(*this, WRITE_BUFFER_PAGES);
+
+	if (BACKGROUND_GC && (FTL_IMPLEMENTATION == IMPL_BAST || FTL_IMPLEMENTATION == IMPL_FAST))
+		fprintf(stderr, "Controller warning: %s: background garbage collection is not supported by BAST and FAST, their merges stay in the foreground\n", __func__);
 	return;
 }
 
 Controller::~Controller(void)
 {
+	delete write_buffer;
 	delete ftl;
 	return;
 }
 
 enum status Controller::event_arrive(Event &event)
 {
+	enum status status = FAILURE;
+
+	/* the device cannot have been idle for longer than the time since the
+	 * last arrival, so that is checked before anything is flushed */
+	if (BACKGROUND_GC && event.get_start_time() - last_arrival > BACKGROUND_GC_IDLE_TIME)
+		background_gc(event.get_start_time());
+	if (event.get_start_time() > last_arrival)
+		last_arrival = event.get_start_time();
+
+	/* with a write buffer, host writes complete in it and reach the FTL
+	 * when they are written back */
 	if(event.get_event_type() == READ)
-		return ftl->read(event);
+	{
+		if (write_buffer != NULL && write_buffer->read(event))
+			status = SUCCESS;
+		else
+			status = ftl->read(event);
+	}
 	else if(event.get_event_type() == WRITE)
-		return ftl->write(event);
+	{
+		stats.numHostWrite++;
+		if (write_buffer != NULL)
+			status = write_buffer->write(event);
+		else
+			status = ftl->write(event);
+	}
 	else if(event.get_event_type() == TRIM)
-		return ftl->trim(event);
+	{
+		if (write_buffer != NULL)
+			write_buffer->trim(event);
+		status = ftl->trim(event);
+	}
 	else
 		fprintf(stderr, "Controller: %s: Invalid event type\n", __func__);
-	return FAILURE;
+
+	return status;
+}
+
+/* a host flush starting at start_time, returns the time until every page
+ * acknowledged from the write buffer is programmed, or -1 on failure */
+double Controller::drain_write_buffer(double start_time)
+{
+	double done;
+
+	if (write_buffer == NULL)
+		return 0.0;
+	if (write_buffer->drain(start_time, done) == FAILURE)
+		return -1.0;
+	return done - start_time;
+}
+
+/* clean blocks in the idle period ending at arrival_time, if the device has
+ * been idle for at least BACKGROUND_GC_IDLE_TIME */
+void Controller::background_gc(double arrival_time)
+{
+	double idle_time = last_arrival;
+
+	for (uint i = 0; i < busy_until.size(); i++)
+		if (busy_until[i] > idle_time)
+			idle_time = busy_until[i];
+
+	if (arrival_time - idle_time <= BACKGROUND_GC_IDLE_TIME)
+		return;
+
+	gc_background = true;
+	ftl->get_block_manager().background_clean(idle_time + BACKGROUND_GC_IDLE_TIME, arrival_time);
+	gc_background = false;
+}
+
+/* garbage collection time accounting
+ * the time an event spends between gc_begin() and gc_end() is counted as
+ * foreground GC time, or background GC time when it is spent cleaning in an
+ * idle period; GC nested in other GC (a merge that cleans blocks, cleaning
+ * that has to open a new block) is only counted once */
+void Controller::gc_begin(const Event &event)
+{
+	if (gc_depth++ == 0)
+		gc_start = event.get_time_taken();
+}
+
+void Controller::gc_end(const Event &event)
+{
+	assert(gc_depth > 0);
+	if (--gc_depth > 0)
+		return;
+
+	if (gc_background)
+		stats.timeBackgroundGC += event.get_time_taken() - gc_start;
+	else
+		stats.timeForegroundGC += event.get_time_taken() - gc_start;
+}
+
+/* the package of an issued event is busy until the event completes, and so
+ * is its die with NVME_QUEUES, except that a cache read frees the array when
+ * the page reaches the cache register (see cache_register()) and only keeps
+ * the register until the page is sent */
+void Controller::update_busy(const Event &event)
+{
+	double done = event.get_start_time() + event.get_time_taken();
+	uint package = event.get_address().package;
+
+	if (done > busy_until[package])
+		busy_until[package] = done;
+
+	if (!die_free.empty() && !event.get_noop())
+	{
+		uint die = get_die(event.get_address());
+
+		if (DIE_CACHE_MODE && event.get_event_type() == READ)
+			cache_free[die] = done;
+		else
+			die_free[die] = done;
+		die_op[die] = event.get_event_type();
+	}
+}
+
+/* the die model entry of an address: its die (package * PACKAGE_SIZE + die),
+ * or its plane of that die with DIE_MULTI_PLANE */
+uint Controller::get_die(const Address &address) const
+{
+	uint die = address.package * PACKAGE_SIZE + address.die;
+
+	if (DIE_MULTI_PLANE)
+		return die * DIE_SIZE + address.plane;
+	return die;
+}
+
+/* returns the time a page operation starts on the device
+ * with NVME_QUEUES, the operation is dispatched once its die is done with the
+ * previous one and, for in-order dispatch, not before the operations ahead of
+ * it on its channel, and the wait is added to the event; without, it starts
+ * at its start time as it always has
+ * with DIE_CACHE_MODE, a page to program is sent as soon as the cache
+ * register is free and a read right behind the previous one; with
+ * DIE_MULTI_PLANE, the planes of a die overlap operations of the same kind
+ * only */
+double Controller::dispatch(Event &event)
+{
+	if (die_free.empty() || event.get_noop())
+		return event.get_start_time();
+
+	const Address &address = event.get_address();
+	uint die = get_die(address);
+	double ready = event.get_start_time() + event.get_time_taken();
+	double time = die_free[die];
+
+	if (DIE_CACHE_MODE && event.get_event_type() == WRITE)
+		time = cache_free[die];
+	/* the next cache read is sent while the array finishes the previous one */
+	else if (DIE_CACHE_MODE && event.get_event_type() == READ && die_op[die] == READ)
+		time -= BUS_CTRL_DELAY;
+
+	if (time < ready)
+		time = ready;
+
+	if (DIE_MULTI_PLANE)
+	{
+		uint first = die - address.plane;
+
+		for (uint plane = first; plane < first + DIE_SIZE; plane++)
+			if (plane != die && die_op[plane] != event.get_event_type() && die_free[plane] > time)
+				time = die_free[plane];
+	}
+
+	if (NVME_SCHEDULER == SCHED_IN_ORDER)
+	{
+		if (time < channel_dispatch[address.package])
+			time = channel_dispatch[address.package];
+		channel_dispatch[address.package] = time;
+	}
+
+	event.incr_time_taken(time - ready);
+	return time;
+}
+
+/* with DIE_CACHE_MODE, the hand-over between the array and the bus through
+ * the cache register: a read page moves to the register once the previous
+ * page has left it, freeing the array for the next read, and a page to
+ * program moves on from the register once the array is done with the
+ * previous program, freeing the register for the next page
+ * called between the array read and the transfer of a read, and between the
+ * transfer and the program of a write; the wait is added to the event */
+enum status Controller::cache_register(Event &event)
+{
+	if (die_free.empty() || event.get_noop() || !DIE_CACHE_MODE)
+		return SUCCESS;
+
+	uint die = get_die(event.get_address());
+	double time = event.get_start_time() + event.get_time_taken();
+	double free = event.get_event_type() == READ ? cache_free[die] : die_free[die];
+
+	if (free > time)
+	{
+		event.incr_time_taken(free - time);
+		time = free;
+	}
+
+	if (event.get_event_type() == READ)
+		die_free[die] = time;
+	else
+		cache_free[die] = time;
+	return SUCCESS;
+}
+
+/* the die (see get_die()) that can take a write first, where the page FTL
+ * places its next host write with NVME_QUEUES
+ * with DIE_MULTI_PLANE, ties go to the same plane of other dies first, so
+ * the pages of a request spread over the channels before the planes */
+uint Controller::get_idle_die(void) const
+{
+	const std::vector<double> &free = DIE_CACHE_MODE ? cache_free : die_free;
+	uint planes = DIE_MULTI_PLANE ? DIE_SIZE : 1;
+	uint dies = free.size() / planes;
+	uint idle = 0;
+
+	for (uint i = 1; i < free.size(); i++)
+	{
+		uint die = i % dies * planes + i / dies;
+		if (free[die] < free[idle])
+			idle = die;
+	}
+	return idle;
 }
 
 enum status Controller::issue(Event &event_list)
@@ -96,38 +334,45 @@ enum status Controller::issue(Event &event_list)
 		else if(cur -> get_event_type() == READ)
 		{
 			assert(cur -> get_address().valid > NONE);
-			if(ssd.bus.lock(cur -> get_address().package, cur -> get_start_time(), BUS_CTRL_DELAY, *cur) == FAILURE
+			if(ssd.bus.lock(cur -> get_address().package, dispatch(*cur), BUS_CTRL_DELAY, *cur) == FAILURE
 				|| ssd.read(*cur) == FAILURE
+				|| cache_register(*cur) == FAILURE
 				|| ssd.bus.lock(cur -> get_address().package, cur -> get_start_time()+cur -> get_time_taken(), BUS_CTRL_DELAY + BUS_DATA_DELAY, *cur) == FAILURE
 				|| ssd.ram.write(*cur) == FAILURE
 				|| ssd.ram.read(*cur) == FAILURE
 				|| ssd.replace(*cur) == FAILURE)
 				return FAILURE;
+			update_busy(*cur);
 		}
 		else if(cur -> get_event_type() == WRITE)
 		{
 			assert(cur -> get_address().valid > NONE);
-			if(ssd.bus.lock(cur -> get_address().package, cur -> get_start_time(), BUS_CTRL_DELAY + BUS_DATA_DELAY, *cur) == FAILURE
+			stats.numFlashWrite++;
+			if(ssd.bus.lock(cur -> get_address().package, dispatch(*cur), BUS_CTRL_DELAY + BUS_DATA_DELAY, *cur) == FAILURE
 				|| ssd.ram.write(*cur) == FAILURE
 				|| ssd.ram.read(*cur) == FAILURE
+				|| cache_register(*cur) == FAILURE
 				|| ssd.write(*cur) == FAILURE
 				|| ssd.replace(*cur) == FAILURE)
 				return FAILURE;
+			update_busy(*cur);
 		}
 		else if(cur -> get_event_type() == ERASE)
 		{
 			assert(cur -> get_address().valid > NONE);
-			if(ssd.bus.lock(cur -> get_address().package, cur -> get_start_time(), BUS_CTRL_DELAY, *cur) == FAILURE
+			if(ssd.bus.lock(cur -> get_address().package, dispatch(*cur), BUS_CTRL_DELAY, *cur) == FAILURE
 				|| ssd.erase(*cur) == FAILURE)
 				return FAILURE;
+			update_busy(*cur);
 		}
 		else if(cur -> get_event_type() == MERGE)
 		{
 			assert(cur -> get_address().valid > NONE);
 			assert(cur -> get_merge_address().valid > NONE);
-			if(ssd.bus.lock(cur -> get_address().package, cur -> get_start_time(), BUS_CTRL_DELAY, *cur) == FAILURE
+			if(ssd.bus.lock(cur -> get_address().package, dispatch(*cur), BUS_CTRL_DELAY, *cur) == FAILURE
 				|| ssd.merge(*cur) == FAILURE)
 				return FAILURE;
+			update_busy(*cur);
 		}
 		else if(cur -> get_event_type() == TRIM)
 		{
@@ -213,7 +458,43 @@ const FtlParent &Controller::get_ftl(void) const
 	return (*ftl);
 }
 
+Block_manager &Controller::get_block_manager(void) const
+{
+	return ftl->get_block_manager();
+}
+
 void Controller::print_ftl_statistics()
 {
 	ftl->print_ftl_statistics();
 }
+
+/* statistics, the write buffer, FTL maps and the Block_manager lists */
+void Controller::save_state(Checkpoint &checkpoint) const
+{
+	checkpoint.put(stats);
+	checkpoint.put(last_arrival);
+	checkpoint.put_bytes(&busy_until[0], busy_until.size() * sizeof(double));
+	checkpoint.put_bytes(die_free.data(), die_free.size() * sizeof(double));
+	checkpoint.put_bytes(cache_free.data(), cache_free.size() * sizeof(double));
+	checkpoint.put_bytes(die_op.data(), die_op.size() * sizeof(enum event_type));
+	checkpoint.put_bytes(channel_dispatch.data(), channel_dispatch.size() * sizeof(double));
+	if (write_buffer != NULL)
+		write_buffer->save_state(checkpoint);
+	ftl->save_state(checkpoint);
+	ftl->get_block_manager().save_state(checkpoint);
+}
+
+void Controller::load_state(Checkpoint &checkpoint)
+{
+	checkpoint.get(stats);
+	checkpoint.get(last_arrival);
+	checkpoint.get_bytes(&busy_until[0], busy_until.size() * sizeof(double));
+	checkpoint.get_bytes(die_free.data(), die_free.size() * sizeof(double));
+	checkpoint.get_bytes(cache_free.data(), cache_free.size() * sizeof(double));
+	checkpoint.get_bytes(die_op.data(), die_op.size() * sizeof(enum event_type));
+	checkpoint.get_bytes(channel_dispatch.data(), channel_dispatch.size() * sizeof(double));
+	if (write_buffer != NULL)
+		write_buffer->load_state(checkpoint);
+	ftl->load_state(checkpoint);
+	ftl->get_block_manager().load_state(checkpoint);
+}
@@ -108,6 +108,13 @@ const Address &Event::get_replace_address(void) const
 	return replace_address;
 }
 
+/* physical page whose data a relocating write copies (GC, merges)
+ * only valid when the write has no payload of its own */
+const Address &Event::get_copy_address(void) const
+{
+	return copy_address;
+}
+
 void Event::set_log_address(const Address &address)
 {
 	log_address = address;
@@ -184,6 +191,11 @@ void Event::set_replace_address(const Address &address)
 	replace_address = address;
 }
 
+void Event::set_copy_address(const Address &address)
+{
+	copy_address = address;
+}
+
 void Event::set_noop(bool value)
 {
 	noop = value;
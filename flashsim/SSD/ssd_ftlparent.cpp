@@ -25,13 +25,10 @@
 
 using namespace ssd;
 
-// Initialization of the block layer.
-Block_manager *Block_manager::inst = NULL;
-
-FtlParent::FtlParent(Controller &controller) : controller(controller)
+FtlParent::FtlParent(Controller &controller) :
+	controller(controller),
+	block_manager(this)
 {
-	Block_manager::instance_initialize(this);
-
 	printf("Number of addressable blocks: %u\n", NUMBER_OF_ADDRESSABLE_BLOCKS);
 
 }
@@ -63,6 +60,12 @@ Block *FtlParent::get_block_pointer(const Address &address)
 	return controller.get_block_pointer(address);
 }
 
+/* every FTL has a block manager of its own, for the blocks of its device */
+Block_manager &FtlParent::get_block_manager(void)
+{
+	return block_manager;
+}
+
 void FtlParent::cleanup_block(Event &event, Block *block)
 {
 	assert(false);
@@ -73,3 +76,14 @@ void FtlParent::print_ftl_statistics()
 {
 	return;
 }
+
+/* FTLs with mapping state override these for checkpoints */
+void FtlParent::save_state(Checkpoint &checkpoint) const
+{
+	return;
+}
+
+void FtlParent::load_state(Checkpoint &checkpoint)
+{
+	return;
+}
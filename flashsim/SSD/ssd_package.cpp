@@ -209,3 +209,21 @@ Block *Package::get_block_pointer(const Address & address)
 	assert(address.valid >= DIE);
 	return data[address.die].get_block_pointer(address);
 }
+
+void Package::save_state(Checkpoint &checkpoint) const
+{
+	checkpoint.put(least_worn);
+	checkpoint.put(erases_remaining);
+	checkpoint.put(last_erase_time);
+	for (uint i = 0; i < size; i++)
+		data[i].save_state(checkpoint);
+}
+
+void Package::load_state(Checkpoint &checkpoint)
+{
+	checkpoint.get(least_worn);
+	checkpoint.get(erases_remaining);
+	checkpoint.get(last_erase_time);
+	for (uint i = 0; i < size; i++)
+		data[i].load_state(checkpoint);
+}
@@ -30,14 +30,6 @@
 
 #include "ssd.h"
 
-namespace ssd {
-	/*
-	 * Buffer used for accessing data pages.
-	 */
-	void *global_buffer;
-
-}
-
 using namespace ssd;
 
 Page::Page(const Block &parent, double read_delay, double write_delay):
@@ -69,8 +61,9 @@ enum status Page::_read(Event &event)
 
 	event.incr_time_taken(read_delay);
 
-	if (!event.get_noop() && PAGE_ENABLE_DATA)
-		global_buffer = (char*)page_data + event.get_address().get_linear_address() * PAGE_SIZE;
+	/* the data goes to the event's payload, the requester's buffer */
+	if (!event.get_noop() && PAGE_ENABLE_DATA && event.get_payload() != NULL)
+		memcpy(event.get_payload(), parent.get_page_store()->read(event.get_address().get_linear_address()), PAGE_SIZE);
 
 	return SUCCESS;
 }
@@ -81,10 +74,15 @@ enum status Page::_write(Event &event)
 
 	event.incr_time_taken(write_delay);
 
-	if (PAGE_ENABLE_DATA && event.get_payload() != NULL && event.get_noop() == false)
+	if (PAGE_ENABLE_DATA && event.get_noop() == false)
 	{
-		void *data = (char*)page_data + event.get_address().get_linear_address() * PAGE_SIZE;
-		memcpy (data, event.get_payload(), PAGE_SIZE);
+		Page_store *page_store = parent.get_page_store();
+
+		/* relocations share the source page's contents instead of copying */
+		if (event.get_copy_address().valid == PAGE)
+			page_store->copy(event.get_copy_address().get_linear_address(), event.get_address().get_linear_address());
+		else if (event.get_payload() != NULL)
+			page_store->write(event.get_address().get_linear_address(), event.get_payload());
 	}
 
 	if (event.get_noop() == false)
@@ -0,0 +1,360 @@
+/* ssd_pagestore.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Page_store class
+ *
+ * Sparse, content-addressed storage for page data (PAGE_ENABLE_DATA).
+ *
+ * Physical pages do not own their bytes.  Each physical page holds a
+ * reference to a content entry; identical contents are stored once (looked
+ * up by hash, confirmed by memcmp) and reference counted, and the all-zero
+ * content is a static page that costs nothing.  Relocations done by GC and
+ * merges copy the reference instead of the bytes, and erasing a block drops
+ * the references of its pages.
+ *
+ * The page -> content table is split into chunks that are only allocated
+ * once a non-zero page in their range is written, so an untouched region of
+ * the simulated device takes no host memory at all. */
+
+#include <new>
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include "ssd.h"
+
+using namespace ssd;
+
+/* pages per chunk of the page -> content table */
+static const ulong CHUNK_PAGES = 4096;
+
+Page_store::Page_store(ulong num_pages, uint page_size):
+	num_pages(num_pages),
+	page_size(page_size),
+	chunks((num_pages + CHUNK_PAGES - 1) / CHUNK_PAGES, (uint *) NULL),
+	zero_page(new char[page_size]()),
+	num_written(0),
+	num_deduplicated(0),
+	num_relocated(0)
+{
+	/* content id 0 is the zero page and never freed */
+	contents.push_back(content());
+	contents[0].data = zero_page;
+	contents[0].hash = 0;
+	contents[0].refs = 0;
+	contents[0].next = 0;
+	return;
+}
+
+Page_store::~Page_store(void)
+{
+	reset();
+	delete[] zero_page;
+	return;
+}
+
+/* drop all page data */
+void Page_store::reset(void)
+{
+	uint i;
+
+	for (i = 0; i < chunks.size(); i++)
+	{
+		delete[] chunks[i];
+		chunks[i] = NULL;
+	}
+	for (i = 1; i < contents.size(); i++)
+		delete[] contents[i].data;
+	contents.resize(1);
+	free_ids.clear();
+	index.clear();
+}
+
+/* 64-bit multiply-xorshift hash over the page words
+ * also reports whether the page is all zero */
+ulong Page_store::hash(const void *data, bool &is_zero) const
+{
+	const unsigned char *bytes = (const unsigned char *) data;
+	unsigned long long h = 0x9e3779b97f4a7c15ULL ^ page_size;
+	unsigned long long any = 0;
+	uint i;
+
+	for (i = 0; i + 8 <= page_size; i += 8)
+	{
+		unsigned long long word;
+		memcpy(&word, bytes + i, 8);
+		any |= word;
+		h ^= word;
+		h *= 0xff51afd7ed558ccdULL;
+		h ^= h >> 32;
+	}
+	for (; i < page_size; i++)
+	{
+		any |= bytes[i];
+		h = (h ^ bytes[i]) * 0x100000001b3ULL;
+	}
+
+	is_zero = (any == 0);
+	return (ulong) h;
+}
+
+uint Page_store::get_ref(ulong page) const
+{
+	assert(page < num_pages);
+	const uint *chunk = chunks[page / CHUNK_PAGES];
+	return chunk == NULL ? 0 : chunk[page % CHUNK_PAGES];
+}
+
+void Page_store::set_ref(ulong page, uint id)
+{
+	assert(page < num_pages);
+	uint *&chunk = chunks[page / CHUNK_PAGES];
+
+	if (chunk == NULL)
+	{
+		/* zero pages do not need a chunk */
+		if (id == 0)
+			return;
+		chunk = new uint[CHUNK_PAGES]();
+	}
+
+	uint old = chunk[page % CHUNK_PAGES];
+	chunk[page % CHUNK_PAGES] = id;
+
+	if (id != 0)
+		contents[id].refs++;
+	if (old != 0)
+		release(old);
+}
+
+/* drop a reference, freeing the content with its last reference */
+void Page_store::release(uint id)
+{
+	assert(id != 0 && contents[id].refs > 0);
+	content &c = contents[id];
+
+	if (--c.refs > 0)
+		return;
+
+	/* unlink from its hash chain */
+	std::unordered_map<ulong, uint>::iterator it = index.find(c.hash);
+	assert(it != index.end());
+	if (it -> second == id)
+	{
+		if (c.next == 0)
+			index.erase(it);
+		else
+			it -> second = c.next;
+	}
+	else
+	{
+		uint prev = it -> second;
+		while (contents[prev].next != id)
+			prev = contents[prev].next;
+		contents[prev].next = c.next;
+	}
+
+	delete[] c.data;
+	c.data = NULL;
+	c.next = 0;
+	free_ids.push_back(id);
+}
+
+/* find the content equal to data, or store a new one */
+uint Page_store::intern(const void *data)
+{
+	bool is_zero;
+	ulong h = hash(data, is_zero);
+	uint id;
+
+	if (is_zero)
+		return 0;
+
+	std::unordered_map<ulong, uint>::iterator it = index.find(h);
+	if (it != index.end())
+	{
+		for (id = it -> second; id != 0; id = contents[id].next)
+			if (memcmp(contents[id].data, data, page_size) == 0)
+			{
+				num_deduplicated++;
+				return id;
+			}
+	}
+
+	if (!free_ids.empty())
+	{
+		id = free_ids.back();
+		free_ids.pop_back();
+	}
+	else
+	{
+		id = contents.size();
+		contents.push_back(content());
+	}
+
+	content &c = contents[id];
+	c.data = new char[page_size];
+	memcpy(c.data, data, page_size);
+	c.hash = h;
+	c.refs = 0;
+	c.next = (it != index.end()) ? it -> second : 0;
+	index[h] = id;
+	return id;
+}
+
+/* store page contents written by the host */
+void Page_store::write(ulong page, const void *data)
+{
+	assert(data != NULL);
+	set_ref(page, intern(data));
+	num_written++;
+}
+
+/* relocate page contents (GC, merges) by reference */
+void Page_store::copy(ulong from, ulong to)
+{
+	set_ref(to, get_ref(from));
+	num_relocated++;
+}
+
+/* contents of a page; an unwritten or erased page reads as zeroes
+ * the pointer stays valid until the page is next written or erased */
+const void *Page_store::read(ulong page) const
+{
+	return contents[get_ref(page)].data;
+}
+
+/* drop the contents of count pages starting at page (block erase) */
+void Page_store::erase(ulong page, uint count)
+{
+	for (ulong i = page; i < page + count; i++)
+		if (get_ref(i) != 0)
+			set_ref(i, 0);
+}
+
+/* number of distinct non-zero contents held in host memory */
+ulong Page_store::get_num_contents(void) const
+{
+	return contents.size() - 1 - free_ids.size();
+}
+
+/* host memory used for page data and the page table */
+ulong Page_store::get_resident_bytes(void) const
+{
+	ulong bytes = get_num_contents() * (ulong) page_size;
+
+	for (uint i = 0; i < chunks.size(); i++)
+		if (chunks[i] != NULL)
+			bytes += CHUNK_PAGES * sizeof(uint);
+	return bytes + contents.size() * sizeof(content);
+}
+
+void Page_store::print_statistics(FILE *stream)
+{
+	if (stream == NULL)
+		stream = stdout;
+	fprintf(stream, "Page store:\n");
+	fprintf(stream, "-----------\n");
+	fprintf(stream, "Writes: %lu Deduplicated: %lu Relocated: %lu\n", num_written, num_deduplicated, num_relocated);
+	fprintf(stream, "Distinct contents: %lu Resident: %lu KB (device: %lu KB)\n", get_num_contents(), get_resident_bytes() / 1024, num_pages * page_size / 1024);
+	fprintf(stream, "-----------\n");
+}
+
+/* distinct contents are saved once, followed by the page table chunks that
+ * are in use with the content ids renumbered densely */
+void Page_store::save_state(Checkpoint &checkpoint) const
+{
+	std::vector<uint> saved_id(contents.size(), 0);
+	ulong num_contents = 0;
+	ulong num_chunks = 0;
+	uint i;
+
+	for (i = 1; i < contents.size(); i++)
+		if (contents[i].data != NULL)
+			saved_id[i] = ++num_contents;
+
+	checkpoint.put(num_pages);
+	checkpoint.put(num_written);
+	checkpoint.put(num_deduplicated);
+	checkpoint.put(num_relocated);
+	checkpoint.put(num_contents);
+	for (i = 1; i < contents.size(); i++)
+		if (contents[i].data != NULL)
+			checkpoint.put_bytes(contents[i].data, page_size);
+
+	for (i = 0; i < chunks.size(); i++)
+		if (chunks[i] != NULL)
+			num_chunks++;
+	checkpoint.put(num_chunks);
+
+	std::vector<uint> refs(CHUNK_PAGES);
+	for (i = 0; i < chunks.size(); i++)
+	{
+		if (chunks[i] == NULL)
+			continue;
+		for (ulong j = 0; j < CHUNK_PAGES; j++)
+			refs[j] = saved_id[chunks[i][j]];
+		checkpoint.put(i);
+		checkpoint.put_bytes(&refs[0], CHUNK_PAGES * sizeof(uint));
+	}
+}
+
+void Page_store::load_state(Checkpoint &checkpoint)
+{
+	ulong saved_pages;
+	ulong num_contents;
+	ulong num_chunks;
+	ulong i;
+
+	reset();
+
+	checkpoint.get(saved_pages);
+	if (checkpoint.ok() && saved_pages != num_pages)
+	{
+		fprintf(stderr, "Page_store error: %s: checkpoint holds %lu pages, store has %lu\n", __func__, saved_pages, num_pages);
+		checkpoint.fail();
+		return;
+	}
+
+	checkpoint.get(num_written);
+	checkpoint.get(num_deduplicated);
+	checkpoint.get(num_relocated);
+
+	/* saved contents are distinct, so interning them maps saved id i + 1 to
+	 * a fresh content id */
+	std::vector<uint> id(1, 0);
+	std::vector<char> data(page_size);
+	checkpoint.get(num_contents);
+	for (i = 0; checkpoint.ok() && i < num_contents; i++)
+	{
+		checkpoint.get_bytes(&data[0], page_size);
+		id.push_back(intern(&data[0]));
+	}
+
+	std::vector<uint> refs(CHUNK_PAGES);
+	checkpoint.get(num_chunks);
+	for (i = 0; checkpoint.ok() && i < num_chunks; i++)
+	{
+		uint chunk;
+		checkpoint.get(chunk);
+		checkpoint.get_bytes(&refs[0], CHUNK_PAGES * sizeof(uint));
+		if (!checkpoint.ok() || chunk >= chunks.size())
+			break;
+		for (ulong j = 0; j < CHUNK_PAGES; j++)
+			if (refs[j] != 0 && refs[j] < id.size())
+				set_ref(chunk * CHUNK_PAGES + j, id[refs[j]]);
+	}
+}
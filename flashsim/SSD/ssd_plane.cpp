@@ -241,7 +241,11 @@ enum status Plane::_merge(Event &event)
 				/* find next page to write to */
 				if(data[write.block].get_state(write.page) == EMPTY)
 				{
-					/* write to page (page::_write() sets status to valid) */
+					/* write to page (page::_write() sets status to valid)
+					 * the page data moves with it; read / write only hold the
+					 * fields, so give the page store the linear addresses */
+					write_event.set_address(Address(data[write.block].get_physical_address() + write.page, PAGE));
+					write_event.set_copy_address(Address(data[read.block].get_physical_address() + read.page, PAGE));
 					if(data[merge_address.block].write(write_event) == 0)
 					{
 						fprintf(stderr, "Plane error: %s: Write for merge block %d into %d failed\n", __func__, address.block, merge_address.block);
@@ -403,3 +407,25 @@ Block *Plane::get_block_pointer(const Address & address)
 	assert(address.valid >= PLANE);
 	return data[address.block].get_pointer();
 }
+
+void Plane::save_state(Checkpoint &checkpoint) const
+{
+	checkpoint.put(least_worn);
+	checkpoint.put(erases_remaining);
+	checkpoint.put(last_erase_time);
+	checkpoint.put_address(next_page);
+	checkpoint.put(free_blocks);
+	for (uint i = 0; i < size; i++)
+		data[i].save_state(checkpoint);
+}
+
+void Plane::load_state(Checkpoint &checkpoint)
+{
+	checkpoint.get(least_worn);
+	checkpoint.get(erases_remaining);
+	checkpoint.get(last_erase_time);
+	checkpoint.get_address(next_page);
+	checkpoint.get(free_blocks);
+	for (uint i = 0; i < size; i++)
+		data[i].load_state(checkpoint);
+}
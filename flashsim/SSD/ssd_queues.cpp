@@ -0,0 +1,174 @@
+/* ssd_queues.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Command_queues class
+ *
+ * The host side of an NVMe-style controller (NVME_QUEUES).  Requests are
+ * submitted to one of several submission queues, each with a fixed number of
+ * command slots.  A command holds its slot from the time it is started until
+ * it completes, so a host keeping more commands outstanding than a queue is
+ * deep sees them wait in the queue before the device starts them.
+ *
+ * Once started, the page operations of a command are dispatched to the dies
+ * by the controller (see Controller::dispatch()), which is where the
+ * queue depth turns into die level parallelism. */
+
+#include <new>
+#include <assert.h>
+#include <stdio.h>
+#include <algorithm>
+#include <functional>
+#include "ssd.h"
+
+using namespace ssd;
+
+Command_queues::Command_queues(uint num_queues, uint depth):
+	depth(depth),
+	queues(num_queues)
+{
+	assert(num_queues > 0 && depth > 0);
+
+	for (uint i = 0; i < num_queues; i++)
+		queues[i].outstanding.reserve(depth);
+	reset_statistics();
+	return;
+}
+
+Command_queues::~Command_queues(void)
+{
+	return;
+}
+
+/* returns the time the command arriving at arrival_time is started: at once
+ * if its queue has a free slot, or else when the earliest outstanding
+ * command of the queue completes and frees its slot */
+double Command_queues::admit(uint queue, double arrival_time)
+{
+	submission_queue &sq = queues[queue % queues.size()];
+	std::vector<double> &heap = sq.outstanding;
+	double start_time = arrival_time;
+
+	/* commands that completed before this one arrived have left the queue */
+	while (!heap.empty() && heap.front() <= arrival_time)
+	{
+		std::pop_heap(heap.begin(), heap.end(), std::greater<double>());
+		heap.pop_back();
+	}
+
+	if (heap.size() >= depth)
+	{
+		start_time = heap.front();
+		std::pop_heap(heap.begin(), heap.end(), std::greater<double>());
+		heap.pop_back();
+
+		sq.waited++;
+		sq.wait_time += start_time - arrival_time;
+		if (start_time - arrival_time > sq.max_wait)
+			sq.max_wait = start_time - arrival_time;
+	}
+
+	sq.commands++;
+	return start_time;
+}
+
+/* an admitted command holds its slot until completion_time */
+void Command_queues::complete(uint queue, double completion_time)
+{
+	std::vector<double> &heap = queues[queue % queues.size()].outstanding;
+
+	heap.push_back(completion_time);
+	std::push_heap(heap.begin(), heap.end(), std::greater<double>());
+}
+
+uint Command_queues::get_num_queues(void) const
+{
+	return queues.size();
+}
+
+/* true if a queue with pending admitted commands, whose completions have not
+ * been reported yet, might have no free slot for the next command */
+bool Command_queues::is_full(uint queue, uint pending) const
+{
+	return queues[queue % queues.size()].outstanding.size() + pending >= depth;
+}
+
+void Command_queues::print_statistics(FILE *stream)
+{
+	if (stream == NULL)
+		stream = stdout;
+	fprintf(stream, "Submission queues: %lu of depth %u\n", (ulong) queues.size(), depth);
+	fprintf(stream, "-----------\n");
+	for (uint i = 0; i < queues.size(); i++)
+	{
+		const submission_queue &sq = queues[i];
+
+		if (sq.commands == 0)
+			continue;
+		fprintf(stream, "Queue %u: Commands: %lu Waited: %lu Mean wait: %f Max wait: %f\n", i, sq.commands, sq.waited, sq.wait_time / sq.commands, sq.max_wait);
+	}
+	fprintf(stream, "-----------\n");
+}
+
+/* the outstanding commands stay, they are device state and not statistics */
+void Command_queues::reset_statistics(void)
+{
+	for (uint i = 0; i < queues.size(); i++)
+	{
+		queues[i].commands = 0;
+		queues[i].waited = 0;
+		queues[i].wait_time = 0.0;
+		queues[i].max_wait = 0.0;
+	}
+}
+
+void Command_queues::save_state(Checkpoint &checkpoint) const
+{
+	for (uint i = 0; i < queues.size(); i++)
+	{
+		const submission_queue &sq = queues[i];
+		ulong entries = sq.outstanding.size();
+
+		checkpoint.put(entries);
+		checkpoint.put_bytes(sq.outstanding.data(), entries * sizeof(double));
+		checkpoint.put(sq.commands);
+		checkpoint.put(sq.waited);
+		checkpoint.put(sq.wait_time);
+		checkpoint.put(sq.max_wait);
+	}
+}
+
+void Command_queues::load_state(Checkpoint &checkpoint)
+{
+	for (uint i = 0; i < queues.size(); i++)
+	{
+		submission_queue &sq = queues[i];
+		ulong entries;
+
+		checkpoint.get(entries);
+		if (!checkpoint.ok() || entries > depth)
+		{
+			checkpoint.fail();
+			return;
+		}
+		sq.outstanding.resize(entries);
+		checkpoint.get_bytes(sq.outstanding.data(), entries * sizeof(double));
+		checkpoint.get(sq.commands);
+		checkpoint.get(sq.waited);
+		checkpoint.get(sq.wait_time);
+		checkpoint.get(sq.max_wait);
+	}
+}
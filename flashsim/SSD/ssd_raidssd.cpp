@@ -19,12 +19,19 @@
  * Matias Bjørling 2012-01-09
  *
  * The Raid SSD is responsible for raiding multiple SSDs together using different mapping techniques.
+ *
+ * In RAID-0 mode (PARALLELISM_MODE 3) the logical pages are striped over the
+ * members in units of RAID_STRIPE_UNIT pages.  A request is split into one
+ * sub-request per member it touches, the members serve them side by side
+ * from the arrival time, and the request completes with the slowest member.
  */
 
 #include <cmath>
 #include <new>
 #include <assert.h>
 #include <stdio.h>
+#include <string.h>
+#include <vector>
 #include "ssd.h"
 #include <sys/mman.h>
 #include <stdlib.h>
@@ -38,7 +45,13 @@ using namespace ssd;
  * occurs in the order of declaration in the class definition and not in the
  * order listed here */
 RaidSsd::RaidSsd(uint ssd_size):
-	size(ssd_size)
+	config(*current_config),
+	config_scope(config),
+	size(ssd_size),
+	first_arrival(-1.0),
+	last_completion(0.0),
+	read_buffer_valid(false),
+	result_member(-1)
 {
 /*
  * Idea
@@ -51,16 +64,155 @@ RaidSsd::RaidSsd(uint ssd_size):
  * 2. Address splitting.
  * 3. Complete control
  */
-	Ssds = new Ssd[RAID_NUMBER_OF_PHYSICAL_SSDS];
+	for (uint i = 0; i < RAID_NUMBER_OF_PHYSICAL_SSDS; i++)
+		Ssds.push_back(new Ssd(config));
+
+	usage.resize(RAID_NUMBER_OF_PHYSICAL_SSDS);
+	sub_requests.resize(RAID_NUMBER_OF_PHYSICAL_SSDS);
+	member_data.resize(RAID_NUMBER_OF_PHYSICAL_SSDS);
+	reset_statistics();
 
+	config_scope.leave();
+	return;
+}
+
+/* an array of differently configured members (e.g. a fast and a large
+ * drive), one per configuration; the array itself takes the current
+ * configuration for PARALLELISM_MODE and RAID_STRIPE_UNIT */
+RaidSsd::RaidSsd(const std::vector<Config> &members):
+	config(*current_config),
+	config_scope(config),
+	size(0),
+	first_arrival(-1.0),
+	last_completion(0.0),
+	read_buffer_valid(false),
+	result_member(-1)
+{
+	config.raid_number_of_physical_ssds = members.size();
+	if (!members.empty())
+	{
+		config.page_size = members[0].page_size;
+		config.page_enable_data = members[0].page_enable_data;
+		size = members[0].ssd_size;
+	}
+
+	for (uint i = 0; i < members.size(); i++)
+		Ssds.push_back(new Ssd(members[i]));
+	check_members();
+
+	usage.resize(RAID_NUMBER_OF_PHYSICAL_SSDS);
+	sub_requests.resize(RAID_NUMBER_OF_PHYSICAL_SSDS);
+	member_data.resize(RAID_NUMBER_OF_PHYSICAL_SSDS);
+	reset_statistics();
+
+	config_scope.leave();
 	return;
 }
 
 RaidSsd::~RaidSsd(void)
 {
+	for (uint i = 0; i < Ssds.size(); i++)
+		delete Ssds[i];
 	return;
 }
 
+/* requests are split and their data moved in pages, which must be the same
+ * on every member */
+void RaidSsd::check_members(void) const
+{
+	for (uint i = 0; i < Ssds.size(); i++)
+	{
+		const Config &member = Ssds[i]->get_config();
+
+		if (member.page_size != PAGE_SIZE || member.page_enable_data != PAGE_ENABLE_DATA)
+		{
+			fprintf(stderr, "RaidSsd error: %s: member %u differs in PAGE_SIZE or PAGE_ENABLE_DATA\n", __func__, i);
+			exit(FILE_ERR);
+		}
+	}
+}
+
+/* RAID-0: sets members[i] to the part of the request that goes to member i,
+ * size 0 if none.  The stripe units of a request that land on one member
+ * are consecutive there, so each member gets a single sub-request. */
+void RaidSsd::split_request(const Batch_request &request, std::vector<Batch_request> &members) const
+{
+	ulong end = request.logical_address + request.size;
+	ulong page = request.logical_address;
+
+	for (uint i = 0; i < RAID_NUMBER_OF_PHYSICAL_SSDS; i++)
+	{
+		members[i] = request;
+		members[i].size = 0;
+		members[i].buffer = NULL;
+	}
+
+	while (page < end)
+	{
+		ulong stripe = page / RAID_STRIPE_UNIT;
+		ulong pages = RAID_STRIPE_UNIT - page % RAID_STRIPE_UNIT;
+		Batch_request &member = members[stripe % RAID_NUMBER_OF_PHYSICAL_SSDS];
+
+		if (pages > end - page)
+			pages = end - page;
+		if (member.size == 0)
+			member.logical_address = stripe / RAID_NUMBER_OF_PHYSICAL_SSDS * RAID_STRIPE_UNIT + page % RAID_STRIPE_UNIT;
+		member.size += pages;
+		page += pages;
+	}
+}
+
+/* RAID-0: copies the stripe units of a request on one member between the
+ * request buffer and member_data, the contiguous data of the member's
+ * sub-request starting at member_address.  No member data reads as zeroes. */
+void RaidSsd::copy_stripes(const Batch_request &request, uint member, ulong member_address, char *member_data, bool to_member) const
+{
+	ulong end = request.logical_address + request.size;
+	ulong page = request.logical_address;
+
+	while (page < end)
+	{
+		ulong stripe = page / RAID_STRIPE_UNIT;
+		ulong pages = RAID_STRIPE_UNIT - page % RAID_STRIPE_UNIT;
+
+		if (pages > end - page)
+			pages = end - page;
+		if (stripe % RAID_NUMBER_OF_PHYSICAL_SSDS == member)
+		{
+			char *data = (char *) request.buffer + (page - request.logical_address) * PAGE_SIZE;
+			ulong offset = (stripe / RAID_NUMBER_OF_PHYSICAL_SSDS * RAID_STRIPE_UNIT + page % RAID_STRIPE_UNIT - member_address) * PAGE_SIZE;
+
+			if (to_member)
+				memcpy(member_data + offset, data, pages * PAGE_SIZE);
+			else if (member_data != NULL)
+				memcpy(data, member_data + offset, pages * PAGE_SIZE);
+			else
+				memset(data, 0, pages * PAGE_SIZE);
+		}
+		page += pages;
+	}
+}
+
+/* a member is busy from the start of a sub-request until it completes;
+ * overlapping sub-requests are only counted once */
+void RaidSsd::account(uint member, uint pages, double start_time, double completion_time)
+{
+	member_usage &member_use = usage[member];
+	double from = start_time > member_use.busy_until ? start_time : member_use.busy_until;
+
+	if (completion_time > from)
+		member_use.busy_time += completion_time - from;
+	if (completion_time > member_use.busy_until)
+		member_use.busy_until = completion_time;
+	member_use.requests++;
+	member_use.pages += pages;
+
+	if (first_arrival < 0.0 || start_time < first_arrival)
+		first_arrival = start_time;
+	if (completion_time > last_completion)
+		last_completion = completion_time;
+}
+
 double RaidSsd::event_arrive(enum event_type type, ulong logical_address, uint size, double start_time)
 {
 	return event_arrive(type, logical_address, size, start_time, NULL);
@@ -74,49 +226,302 @@ double RaidSsd::event_arrive(enum event_type type, ulong logical_address, uint s
  * 	request.  Remember to use the same time units as in the config file. */
 double RaidSsd::event_arrive(enum event_type type, ulong logical_address, uint size, double start_time, void *buffer)
 {
-	if (type == WRITE)
-		printf("Writing to logical address: %lu\n", logical_address);
-	else if (type == READ)
-		printf("Read from logical address: %lu\n", logical_address);
+	Config_scope scope(config);
+
+	read_buffer_valid = false;
+	result_member = -1;
 
 	if (PARALLELISM_MODE == 1) // Striping
 	{
-		double timings[RAID_NUMBER_OF_PHYSICAL_SSDS];
+		/* members that are configured alike take the same time, otherwise
+		 * the request waits for the slowest */
+		double time_taken = 0.0;
+		result_member = 0;
 		for (uint i = 0; i < RAID_NUMBER_OF_PHYSICAL_SSDS; i++)
 		{
-			if (buffer == NULL)
-			{
-				printf("Executing stage: %i\n", i);
-				timings[i] = Ssds[i].event_arrive(type, logical_address, size, start_time, NULL);
-			}
+			double timing;
 
+			/* data is exchanged with the first member only */
+			if (buffer == NULL || i > 0)
+				timing = Ssds[i]->event_arrive(type, logical_address, size, start_time, NULL);
 			else
-				timings[i] = Ssds[i].event_arrive(type, logical_address, size, start_time, (char*)buffer +(i*PAGE_SIZE));
+				timing = Ssds[i]->event_arrive(type, logical_address, size, start_time, buffer);
 
+			if (timing > time_taken)
+				time_taken = timing;
 		}
 
-		for (uint i = 0; i < RAID_NUMBER_OF_PHYSICAL_SSDS-1; i++)
+		return time_taken;
+	}
+	else if (PARALLELISM_MODE == 2) // Splitted address space
+	{
+		result_member = logical_address % RAID_NUMBER_OF_PHYSICAL_SSDS;
+		return Ssds[logical_address%RAID_NUMBER_OF_PHYSICAL_SSDS]->event_arrive(type, logical_address, size, start_time, (char*)buffer);
+	}
+	else if (PARALLELISM_MODE == 3) // RAID-0
+	{
+		Batch_request request = {type, logical_address, size, start_time, buffer, 0};
+		double completion_time = start_time;
+
+		split_request(request, sub_requests);
+
+		/* read results are gathered in request order, like Ssd does */
+		bool gather = (type == READ && PAGE_ENABLE_DATA);
+		if (gather && read_buffer.size() < (size_t) size * PAGE_SIZE)
+			read_buffer.resize((size_t) size * PAGE_SIZE);
+		request.buffer = gather ? &read_buffer[0] : buffer;
+
+		for (uint i = 0; i < RAID_NUMBER_OF_PHYSICAL_SSDS; i++)
 		{
-			if (timings[i] != timings[i+1])
-				fprintf(stderr, "ERROR: Timings are not the same. %lf %lf\n", timings[i], timings[i+1]);
+			const Batch_request &sub = sub_requests[i];
+			char *data = NULL;
+
+			if (sub.size == 0)
+				continue;
+
+			if (buffer != NULL && type != READ)
+			{
+				member_data[i].resize((size_t) sub.size * PAGE_SIZE);
+				data = &member_data[i][0];
+				copy_stripes(request, i, sub.logical_address, data, true);
+			}
+
+			double time_taken = Ssds[i]->event_arrive(type, sub.logical_address, sub.size, start_time, data);
+
+			account(i, sub.size, start_time, start_time + time_taken);
+			if (start_time + time_taken > completion_time)
+				completion_time = start_time + time_taken;
+
+			if (gather)
+				copy_stripes(request, i, sub.logical_address, (char *) Ssds[i]->get_result_buffer(), false);
 		}
 
-		return timings[0];
+		read_buffer_valid = gather;
+		return completion_time - start_time;
+	}
+
+	return 0;
+}
+
+/* Batches are fanned out as one sub-batch per member drive, following the
+ * same placement as event_arrive().  When striping, every member serves the
+ * whole batch and a request completes when its slowest member does. */
+enum status RaidSsd::event_arrive_batch(const Batch_request *requests, uint count, double *completion_times)
+{
+	Config_scope scope(config);
+	enum status status = SUCCESS;
+	uint i, j;
+
+	read_buffer_valid = false;
+	result_member = -1;
+
+	if (PARALLELISM_MODE == 1) // Striping
+	{
+		std::vector<Batch_request> member(requests, requests + count);
+		std::vector<double> times(count);
+
+		for (j = 0; j < count; j++)
+			completion_times[j] = 0.0;
+
+		for (i = 0; i < RAID_NUMBER_OF_PHYSICAL_SSDS; i++)
+		{
+			/* every member holds the whole request, data is exchanged
+			 * with the first one only, the others just add timing */
+			if (i == 1)
+				for (j = 0; j < count; j++)
+					member[j].buffer = NULL;
+
+			if (Ssds[i]->event_arrive_batch(&member[0], count, &times[0]) == FAILURE)
+				status = FAILURE;
+
+			for (j = 0; j < count; j++)
+				if (times[j] > completion_times[j])
+					completion_times[j] = times[j];
+		}
 	}
 	else if (PARALLELISM_MODE == 2) // Splitted address space
 	{
-		return Ssds[logical_address%RAID_NUMBER_OF_PHYSICAL_SSDS].event_arrive(type, logical_address, size, start_time, (char*)buffer);
+		std::vector<std::vector<Batch_request> > member(RAID_NUMBER_OF_PHYSICAL_SSDS);
+		std::vector<std::vector<uint> > index(RAID_NUMBER_OF_PHYSICAL_SSDS);
+		std::vector<double> times;
+
+		/* sub-batches keep the batch order, so they stay sorted */
+		for (j = 0; j < count; j++)
+		{
+			uint target = requests[j].logical_address % RAID_NUMBER_OF_PHYSICAL_SSDS;
+			member[target].push_back(requests[j]);
+			index[target].push_back(j);
+		}
+
+		for (i = 0; i < RAID_NUMBER_OF_PHYSICAL_SSDS; i++)
+		{
+			if (member[i].empty())
+				continue;
+
+			times.resize(member[i].size());
+			if (Ssds[i]->event_arrive_batch(&member[i][0], member[i].size(), &times[0]) == FAILURE)
+				status = FAILURE;
+
+			for (j = 0; j < member[i].size(); j++)
+				completion_times[index[i][j]] = times[j];
+		}
 	}
+	else if (PARALLELISM_MODE == 3) // RAID-0
+	{
+		std::vector<std::vector<Batch_request> > member(RAID_NUMBER_OF_PHYSICAL_SSDS);
+		std::vector<std::vector<uint> > index(RAID_NUMBER_OF_PHYSICAL_SSDS);
+		std::vector<double> times;
 
-	return 0;
+		/* at most one sub-request per member and request, in batch order */
+		for (j = 0; j < count; j++)
+		{
+			completion_times[j] = requests[j].start_time;
+			split_request(requests[j], sub_requests);
+
+			for (i = 0; i < RAID_NUMBER_OF_PHYSICAL_SSDS; i++)
+			{
+				if (sub_requests[i].size == 0)
+					continue;
+				member[i].push_back(sub_requests[i]);
+				index[i].push_back(j);
+			}
+		}
+
+		for (i = 0; i < RAID_NUMBER_OF_PHYSICAL_SSDS; i++)
+		{
+			ulong pages = 0;
+
+			if (member[i].empty())
+				continue;
+
+			/* the stripes of a member are gathered into one buffer */
+			for (j = 0; j < member[i].size(); j++)
+				if (requests[index[i][j]].buffer != NULL)
+					pages += member[i][j].size;
+			member_data[i].resize(pages * PAGE_SIZE);
+
+			pages = 0;
+			for (j = 0; j < member[i].size(); j++)
+			{
+				Batch_request &sub = member[i][j];
+				const Batch_request &request = requests[index[i][j]];
+
+				if (request.buffer == NULL)
+					continue;
+				sub.buffer = &member_data[i][pages * PAGE_SIZE];
+				if (request.type != READ)
+					copy_stripes(request, i, sub.logical_address, (char *) sub.buffer, true);
+				pages += sub.size;
+			}
+
+			times.resize(member[i].size());
+			if (Ssds[i]->event_arrive_batch(&member[i][0], member[i].size(), &times[0]) == FAILURE)
+				status = FAILURE;
+
+			for (j = 0; j < member[i].size(); j++)
+			{
+				const Batch_request &sub = member[i][j];
+				const Batch_request &request = requests[index[i][j]];
+
+				account(i, sub.size, sub.start_time, times[j]);
+				if (times[j] > completion_times[index[i][j]])
+					completion_times[index[i][j]] = times[j];
+				if (request.type == READ && request.buffer != NULL && PAGE_ENABLE_DATA)
+					copy_stripes(request, i, sub.logical_address, (char *) sub.buffer, false);
+			}
+		}
+	}
+	else
+	{
+		for (j = 0; j < count; j++)
+			completion_times[j] = requests[j].start_time;
+	}
+
+	return status;
+}
+
+/* statistics are kept per member drive and printed one drive at a time,
+ * after the utilisation of the members in RAID-0 mode */
+void RaidSsd::print_statistics()
+{
+	Config_scope scope(config);
+
+	if (PARALLELISM_MODE == 3)
+	{
+		double elapsed = last_completion - first_arrival;
+
+		printf("RAID-0: %u members, stripe unit %u pages\n", RAID_NUMBER_OF_PHYSICAL_SSDS, RAID_STRIPE_UNIT);
+		printf("-----------\n");
+		for (uint i = 0; i < RAID_NUMBER_OF_PHYSICAL_SSDS; i++)
+			printf("Member SSD %u: Requests: %lu Pages: %lu Busy: %f Utilisation: %.2f%%\n", i, usage[i].requests, usage[i].pages, usage[i].busy_time, first_arrival < 0.0 || elapsed <= 0.0 ? 0.0 : 100.0 * usage[i].busy_time / elapsed);
+		printf("-----------\n");
+	}
+
+	for (uint i = 0; i < RAID_NUMBER_OF_PHYSICAL_SSDS; i++)
+	{
+		printf("Member SSD %u\n", i);
+		Ssds[i]->print_statistics();
+	}
+}
+
+/* the members keep their busy state, only the counters start over */
+void RaidSsd::reset_statistics()
+{
+	Config_scope scope(config);
+
+	for (uint i = 0; i < usage.size(); i++)
+	{
+		usage[i].requests = 0;
+		usage[i].pages = 0;
+		usage[i].busy_time = 0.0;
+	}
+	first_arrival = -1.0;
+	last_completion = 0.0;
+
+	for (uint i = 0; i < RAID_NUMBER_OF_PHYSICAL_SSDS; i++)
+		Ssds[i]->reset_statistics();
+}
+
+void RaidSsd::print_ftl_statistics()
+{
+	Config_scope scope(config);
+
+	for (uint i = 0; i < RAID_NUMBER_OF_PHYSICAL_SSDS; i++)
+	{
+		printf("Member SSD %u\n", i);
+		Ssds[i]->print_ftl_statistics();
+	}
+}
+
+void RaidSsd::print_wear_statistics()
+{
+	Config_scope scope(config);
+
+	for (uint i = 0; i < RAID_NUMBER_OF_PHYSICAL_SSDS; i++)
+	{
+		printf("Member SSD %u\n", i);
+		Ssds[i]->print_wear_statistics();
+	}
 }
 
 /*
- * Returns a pointer to the global buffer of the Ssd.
+ * Returns a pointer to the data of the last read, NULL if there is none.
+ * In RAID-0 mode the data is gathered from the members in request order,
+ * otherwise it is that of the member that served the read (the first one
+ * when striping).
  * It is up to the user to not read out of bound and only
- * read the intended size. i.e. the page size.
+ * read the intended size. i.e. the request size.
  */
 void *RaidSsd::get_result_buffer()
 {
-	return global_buffer;
+	if (read_buffer_valid)
+		return &read_buffer[0];
+	if (result_member >= 0)
+		return Ssds[result_member]->get_result_buffer();
+	return NULL;
+}
+
+const Config &RaidSsd::get_config(void) const
+{
+	return config;
 }
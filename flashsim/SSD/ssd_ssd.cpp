@@ -28,6 +28,7 @@
 #include <new>
 #include <assert.h>
 #include <stdio.h>
+#include <string.h>
 #include "ssd.h"
 #include <sys/mman.h>
 #include <stdlib.h>
@@ -38,10 +39,26 @@
 
 using namespace ssd;
 
+/* a device with a copy of the current configuration */
+Ssd::Ssd(uint ssd_size):
+	Ssd(*current_config, ssd_size)
+{
+	return;
+}
+
+/* a device with a configuration of its own */
+Ssd::Ssd(const Config &config):
+	Ssd(config, config.ssd_size)
+{
+	return;
+}
+
 /* use caution when editing the initialization list - initialization actually
  * occurs in the order of declaration in the class definition and not in the
  * order listed here */
-Ssd::Ssd(uint ssd_size): 
+Ssd::Ssd(const Config &config, uint ssd_size):
+	config(config),
+	config_scope(this->config),
 	size(ssd_size), 
 	controller(*this), 
 	ram(RAM_READ_DELAY, RAM_WRITE_DELAY), 
@@ -60,10 +77,17 @@ Ssd::Ssd(uint ssd_size):
 	least_worn(0), 
 
 	/* assume hardware created at time 0 and had an implied free erasure */
-	last_erase_time(0.0)
+	last_erase_time(0.0),
+
+	page_store(NULL),
+	read_buffer_valid(false),
+	queues(NULL),
+	series(NULL)
 {
 	uint i;
 
+	this->config.check();
+
 	/* new cannot initialize an array with constructor args so
 	 *		malloc the array
 	 *		then use placement new to call the constructor for each element
@@ -87,37 +111,29 @@ Ssd::Ssd(uint ssd_size):
 		exit(MEM_ERR);
 	}
 
+	/* page data lives in a sparse, deduplicating store, so only the
+	 * distinct contents that have actually been written use host memory */
 	if (PAGE_ENABLE_DATA)
-	{
-		/* Allocate memory for data pages */
-		ulong pageSize = ((ulong)(SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE * BLOCK_SIZE)) * (ulong)PAGE_SIZE;
-#ifdef __APPLE__
-		page_data = mmap(NULL, pageSize, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
-#else
-		page_data = mmap64(NULL, pageSize, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1 ,0);
-#endif
-
-		if (page_data == MAP_FAILED)
-		{
-			fprintf(stderr, "Ssd error: %s: constructor unable to allocate page data.\n", __func__);
-			switch (errno)
-			{
-			case EACCES:
-				break;
-			}
-			printf("%i\n",errno);
-			exit(MEM_ERR);
-		}
-	}
+		page_store = new Page_store((ulong) SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE * BLOCK_SIZE);
+
+	if (NVME_QUEUES > 0)
+		queues = new Command_queues(NVME_QUEUES, NVME_QUEUE_DEPTH);
+
+	if (STATS_WINDOW > 0)
+		series = new Stats_series(STATS_WINDOW);
 
 	assert(VIRTUAL_BLOCK_SIZE > 0);
 	assert(VIRTUAL_PAGE_SIZE > 0);
 
+	config_scope.leave();
 	return;
 }
 
+/* the members are destroyed with the configuration still current */
 Ssd::~Ssd(void)
 {
+	config_scope.enter();
+
 	/* explicitly call destructors and use free
 	 * since we used malloc and placement new */
 	for (uint i = 0; i < size; i++)
@@ -125,8 +141,9 @@ Ssd::~Ssd(void)
 		data[i].~Package();
 	}
 	free(data);
-	ulong pageSize = ((ulong)(SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE * BLOCK_SIZE)) * (ulong)PAGE_SIZE;
-	munmap(page_data, pageSize);
+	delete queues;
+	delete series;
+	delete page_store;
 
 	return;
 }
@@ -141,9 +158,13 @@ double Ssd::event_arrive(enum event_type type, ulong logical_address, uint size,
  * 	logical_address (page number), size of request in pages, and the start
  * 	time (arrive time) of the request
  * The SSD will process the request and return the time taken to process the
- * 	request.  Remember to use the same time units as in the config file. */
+ * 	request.  Remember to use the same time units as in the config file.
+ * With NVME_QUEUES, requests are submitted to the first queue and the time
+ * taken includes the time spent waiting in it. */
 double Ssd::event_arrive(enum event_type type, ulong logical_address, uint size, double start_time, void *buffer)
 {
+	Config_scope scope(config);
+
 	assert(start_time >= 0.0);
 
 	if (VIRTUAL_PAGE_SIZE == 1)
@@ -151,6 +172,29 @@ double Ssd::event_arrive(enum event_type type, ulong logical_address, uint size,
 	else
 		assert((long long int) logical_address*VIRTUAL_PAGE_SIZE <= (long long int) SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE * BLOCK_SIZE);
 
+	if (queues != NULL)
+	{
+		double admit_time = queues->admit(0, start_time);
+		double time_taken = event_arrive_command(type, logical_address, size, admit_time, buffer);
+
+		queues->complete(0, admit_time + time_taken);
+		record(type, size, start_time, admit_time + time_taken);
+		return admit_time - start_time + time_taken;
+	}
+
+	double time_taken = event_arrive_command(type, logical_address, size, start_time, buffer);
+	record(type, size, start_time, start_time + time_taken);
+	return time_taken;
+}
+
+/* a request started at start_time, returns its service time */
+double Ssd::event_arrive_command(enum event_type type, ulong logical_address, uint size, double start_time, void *buffer)
+{
+	/* requests larger than a page are split into page events that go through
+	 * the FTL one by one, in address order */
+	if (size > 1)
+		return event_arrive_pages(type, logical_address, size, start_time, buffer);
+
 	/* allocate the event and address dynamically so that the allocator can
 	 * handle efficiency issues for us */
 	Event *event = NULL;
@@ -161,7 +205,17 @@ double Ssd::event_arrive(enum event_type type, ulong logical_address, uint size,
 		exit(MEM_ERR);
 	}
 
-	event->set_payload(buffer);
+	/* read data goes to read_buffer, unwritten pages read as zeroes */
+	read_buffer_valid = (type == READ && PAGE_ENABLE_DATA);
+	if (read_buffer_valid)
+	{
+		if (read_buffer.size() < PAGE_SIZE)
+			read_buffer.resize(PAGE_SIZE);
+		memset(&read_buffer[0], 0, PAGE_SIZE);
+		event->set_payload(&read_buffer[0]);
+	}
+	else
+		event->set_payload(buffer);
 
 	if(controller.event_arrive(*event) != SUCCESS)
 	{
@@ -175,14 +229,195 @@ double Ssd::event_arrive(enum event_type type, ulong logical_address, uint size,
 	return start_time;
 }
 
+/* Multi-page request: one page event per page, all arriving at start_time.
+ * The time taken is that of the slowest page.  With data pages enabled, read
+ * results are gathered into read_buffer in request order. */
+double Ssd::event_arrive_pages(enum event_type type, ulong logical_address, uint size, double start_time, void *buffer)
+{
+	std::vector<Event *> events(size);
+	uint i;
+
+	read_buffer_valid = (type == READ && PAGE_ENABLE_DATA);
+	if (read_buffer_valid && read_buffer.size() < (size_t) size * PAGE_SIZE)
+		read_buffer.resize((size_t) size * PAGE_SIZE);
+	if (read_buffer_valid)
+		memset(&read_buffer[0], 0, (size_t) size * PAGE_SIZE);
+
+	for (i = 0; i < size; i++)
+	{
+		if((events[i] = new Event(type, logical_address + i, 1, start_time)) == NULL)
+		{
+			fprintf(stderr, "Ssd error: %s: could not allocate Event\n", __func__);
+			exit(MEM_ERR);
+		}
+		if (read_buffer_valid)
+			events[i] -> set_payload(&read_buffer[(size_t) i * PAGE_SIZE]);
+		else if (buffer != NULL)
+			events[i] -> set_payload((char *) buffer + (ulong) i * PAGE_SIZE);
+		if (i > 0)
+			events[i - 1] -> set_next(*events[i]);
+
+		if(controller.event_arrive(*events[i]) != SUCCESS)
+		{
+			fprintf(stderr, "Ssd error: %s: request failed:\n", __func__);
+			events[i] -> print(stderr);
+		}
+	}
+
+	Event request(type, logical_address, size, start_time);
+	request.consolidate_metaevent(*events[0]);
+
+	for (i = 0; i < size; i++)
+		delete events[i];
+
+	return request.get_time_taken();
+}
+
+/* Batch submission: requests must be sorted by start time.  Every page event
+ * of the batch goes through the controller in order, as event_arrive() would
+ * send it, but the events live in one reused array instead of being
+ * allocated per request.  Requests are completed at the end of the batch, or
+ * earlier when a request finds its submission queue full (NVME_QUEUES) and
+ * has to wait for the completion of an earlier request of the batch, so the
+ * completion times are the same as submitting the requests one by one.
+ * completion_times[i] is the start time of request i plus its service time,
+ * including any time spent waiting in its submission queue. */
+enum status Ssd::event_arrive_batch(const Batch_request *requests, uint count, double *completion_times)
+{
+	Config_scope scope(config);
+	enum status status = SUCCESS;
+	ulong num_pages = 0;
+	ulong first;
+	ulong done_first = 0;
+	uint done = 0;
+	uint i, j;
+
+	assert(requests != NULL && completion_times != NULL);
+
+	for (i = 0; i < count; i++)
+	{
+		if (i > 0 && requests[i].start_time < requests[i - 1].start_time)
+		{
+			fprintf(stderr, "Ssd error: %s: requests are not sorted by start time (request %u)\n", __func__, i);
+			return FAILURE;
+		}
+		num_pages += requests[i].size;
+	}
+
+	/* events are linked into per-request lists, so they must not move */
+	batch_events.clear();
+	batch_events.reserve(num_pages);
+	batch_starts.resize(count);
+	read_buffer_valid = false;
+
+	/* requests of the batch admitted to each queue but not completed yet */
+	std::vector<uint> pending(queues != NULL ? queues->get_num_queues() : 0, 0);
+
+	for (i = 0; i < count; i++)
+	{
+		const Batch_request &request = requests[i];
+		bool copy_data = (request.type == READ && PAGE_ENABLE_DATA && request.buffer != NULL);
+
+		batch_starts[i] = request.start_time;
+		if (queues != NULL)
+		{
+			uint queue = request.queue % queues->get_num_queues();
+
+			/* a full queue frees a slot when one of its requests completes */
+			if (pending[queue] > 0 && queues->is_full(queue, pending[queue]))
+			{
+				complete_batch(requests, done, i, done_first, completion_times, pending);
+				done_first = batch_events.size();
+				done = i;
+			}
+			batch_starts[i] = queues->admit(queue, request.start_time);
+			pending[queue]++;
+		}
+
+		first = batch_events.size();
+		for (j = 0; j < request.size; j++)
+		{
+			batch_events.emplace_back(request.type, request.logical_address + j, 1, batch_starts[i]);
+			Event &event = batch_events.back();
+
+			/* the page is read straight into the request's buffer, before
+			 * later requests of the batch can overwrite it */
+			if (copy_data)
+				memset((char *) request.buffer + (ulong) j * PAGE_SIZE, 0, PAGE_SIZE);
+			if (request.buffer != NULL && (request.type != READ || copy_data))
+				event.set_payload((char *) request.buffer + (ulong) j * PAGE_SIZE);
+			if (j > 0)
+				batch_events[first + j - 1].set_next(event);
+
+			if(controller.event_arrive(event) != SUCCESS)
+			{
+				fprintf(stderr, "Ssd error: %s: request failed:\n", __func__);
+				event.print(stderr);
+				status = FAILURE;
+			}
+		}
+	}
+
+	complete_batch(requests, done, count, done_first, completion_times, pending);
+
+	batch_events.clear();
+	return status;
+}
+
+/* completes requests [from, to) of the batch, whose events start at
+ * batch_events[first] */
+void Ssd::complete_batch(const Batch_request *requests, uint from, uint to, ulong first, double *completion_times, std::vector<uint> &pending)
+{
+	for (uint i = from; i < to; i++)
+	{
+		double time_taken = 0.0;
+
+		if (requests[i].size > 0)
+		{
+			Event request(requests[i].type, requests[i].logical_address, requests[i].size, batch_starts[i]);
+			request.consolidate_metaevent(batch_events[first]);
+			time_taken = request.get_time_taken();
+		}
+		completion_times[i] = batch_starts[i] + time_taken;
+		first += requests[i].size;
+		record(requests[i].type, requests[i].size, requests[i].start_time, completion_times[i]);
+
+		if (queues != NULL)
+		{
+			uint queue = requests[i].queue % queues->get_num_queues();
+
+			queues->complete(queue, completion_times[i]);
+			pending[queue]--;
+		}
+	}
+}
+
 /*
- * Returns a pointer to the global buffer of the Ssd.
+ * Returns a pointer to the data of the last read, NULL if the last request
+ * was not a read or data pages are disabled.
  * It is up to the user to not read out of bound and only
- * read the intended size. i.e. the page size.
+ * read the intended size. i.e. the request size.
  */
 void *Ssd::get_result_buffer()
 {
-	return global_buffer;
+	if (read_buffer_valid)
+		return &read_buffer[0];
+	return NULL;
+}
+
+/* a flush arriving at start_time: returns the time until the pages buffered
+ * by the controller's write buffer are programmed, 0 without a buffer */
+double Ssd::drain_write_buffer(double start_time)
+{
+	Config_scope scope(config);
+	double time_taken = controller.drain_write_buffer(start_time);
+
+	if (time_taken < 0.0)
+	{
+		fprintf(stderr, "Ssd error: %s: flush failed\n", __func__);
+		return 0.0;
+	}
+	return time_taken;
 }
 
 /* read write erase and merge should only pass on the event
@@ -321,29 +556,101 @@ ssd::uint Ssd::get_num_invalid(const Address &address) const
 
 void Ssd::print_statistics()
 {
+	Config_scope scope(config);
 	controller.stats.print_statistics();
+	if (queues != NULL)
+		queues->print_statistics();
+	if (PAGE_ENABLE_DATA)
+		page_store->print_statistics();
 }
 
 void Ssd::reset_statistics()
 {
+	Config_scope scope(config);
 	controller.stats.reset_statistics();
+	if (queues != NULL)
+		queues->reset_statistics();
+	if (series != NULL)
+		series->reset();
 }
 
 void Ssd::write_statistics(FILE *stream)
 {
+	Config_scope scope(config);
 	controller.stats.write_statistics(stream);
 }
 
 void Ssd::print_ftl_statistics()
 {
+	Config_scope scope(config);
 	controller.print_ftl_statistics();
 }
 
+/* erase counts over all blocks, showing how evenly the FTL and garbage
+ * collection spread the wear */
+void Ssd::print_wear_statistics()
+{
+	Config_scope scope(config);
+	ulong min_erases = ULONG_MAX;
+	ulong max_erases = 0;
+	ulong total_erases = 0;
+	ulong worn_out = 0;
+	ulong blocks = 0;
+
+	for (uint package = 0; package < size; package++)
+		for (uint die = 0; die < PACKAGE_SIZE; die++)
+			for (uint plane = 0; plane < DIE_SIZE; plane++)
+				for (uint block = 0; block < PLANE_SIZE; block++)
+				{
+					Address address(package, die, plane, block, 0, BLOCK);
+					ulong erases = BLOCK_ERASES - get_block_pointer(address)->get_erases_remaining();
+
+					if (erases < min_erases)
+						min_erases = erases;
+					if (erases > max_erases)
+						max_erases = erases;
+					if (erases >= BLOCK_ERASES)
+						worn_out++;
+					total_erases += erases;
+					blocks++;
+				}
+
+	printf("Wear:\n");
+	printf("-----------\n");
+	printf("Block Erases: %lu\t Min: %lu\t Max: %lu\t Mean: %f\n", total_erases, min_erases, max_erases, (double)total_erases/(double)blocks);
+	printf("Worn Out Blocks: %lu of %lu\n", worn_out, blocks);
+	printf("-----------\n");
+}
+
 void Ssd::write_header(FILE *stream)
 {
+	Config_scope scope(config);
 	controller.stats.write_header(stream);
 }
 
+/* the statistics time series as CSV (one line per window) or JSON (with the
+ * latency histograms), empty without STATS_WINDOW */
+void Ssd::write_time_series(FILE *stream, enum stats_format format)
+{
+	Config_scope scope(config);
+	ulong free_blocks = get_block_manager().get_num_clean_blocks();
+
+	if (series == NULL)
+	{
+		Stats_series empty(0.0);
+		empty.write(stream, format, controller.stats, free_blocks);
+	}
+	else
+		series->write(stream, format, controller.stats, free_blocks);
+}
+
+/* a request of the host completed, for the time series */
+void Ssd::record(enum event_type type, uint size, double start_time, double completion_time)
+{
+	if (series != NULL)
+		series->add(type, size, start_time, completion_time, controller.stats, get_block_manager().get_num_clean_blocks());
+}
+
 Block *Ssd::get_block_pointer(const Address & address)
 {
 	assert(address.valid >= PACKAGE);
@@ -355,11 +662,27 @@ const Controller &Ssd::get_controller(void) const
 	return controller;
 }
 
+const Config &Ssd::get_config(void) const
+{
+	return config;
+}
+
+Page_store *Ssd::get_page_store(void) const
+{
+	return page_store;
+}
+
+Block_manager &Ssd::get_block_manager(void) const
+{
+	return controller.get_block_manager();
+}
+
 /**
  * Returns the next ready time. The ready time is the latest point in time when one of the channels are ready to serve new requests.
  */
 double Ssd::ready_at(void)
 {
+	Config_scope scope(config);
 	double next_ready_time = std::numeric_limits<double>::max();
 
 	for (uint i = 0; i < size; i++)
@@ -18,6 +18,10 @@
 /****************************************************************************/
 
 /* Runtime information for the SSD Model
+ *
+ * Cumulative counters (Stats), latency histograms and the time series of
+ * windowed snapshots (Stats_series) that show how the device behaves over
+ * time, e.g. throughput dropping while GC runs.
  */
 
 #include <new>
@@ -52,6 +56,10 @@ void Stats::reset()
 	numWLWrite = 0;
 	numWLErase = 0;
 
+	// Write amplification
+	numHostWrite = 0;
+	numFlashWrite = 0;
+
 	// Log based FTL's
 	numLogMergeSwitch = 0;
 	numLogMergePartial = 0;
@@ -64,12 +72,27 @@ void Stats::reset()
 	numCacheHits = 0;
 	numCacheFaults = 0;
 
+	// Background GC
+	numBackgroundGCErase = 0;
+	numBackgroundGCPeriods = 0;
+
+	// GC time
+	timeForegroundGC = 0;
+	timeBackgroundGC = 0;
+
 	// Memory consumptions (Bytes)
 	numMemoryTranslation = 0;
 	numMemoryCache = 0;
 
 	numMemoryRead = 0;
 	numMemoryWrite = 0;
+
+	// Write buffer
+	numBufferReadHit = 0;
+	numBufferCoalesce = 0;
+	numBufferFlush = 0;
+	numBufferStall = 0;
+	timeBufferStall = 0;
 }
 
 void Stats::reset_statistics()
@@ -79,25 +102,38 @@ void Stats::reset_statistics()
 
 void Stats::write_header(FILE *stream)
 {
-	fprintf(stream, "numFTLRead;numFTLWrite;numFTLErase;numFTLTrim;numGCRead;numGCWrite;numGCErase;numWLRead;numWLWrite;numWLErase;numLogMergeSwitch;numLogMergePartial;numLogMergeFull;numPageBlockToPageConversion;numCacheHits;numCacheFaults;numMemoryTranslation;numMemoryCache;numMemoryRead;numMemoryWrite\n");
+	fprintf(stream, "numFTLRead;numFTLWrite;numFTLErase;numFTLTrim;numGCRead;numGCWrite;numGCErase;numWLRead;numWLWrite;numWLErase;numHostWrite;numFlashWrite;numLogMergeSwitch;numLogMergePartial;numLogMergeFull;numPageBlockToPageConversion;numCacheHits;numCacheFaults;numBackgroundGCErase;numBackgroundGCPeriods;timeForegroundGC;timeBackgroundGC;numMemoryTranslation;numMemoryCache;numMemoryRead;numMemoryWrite;numBufferReadHit;numBufferCoalesce;numBufferFlush;numBufferStall;timeBufferStall\n");
 }
 
 void Stats::write_statistics(FILE *stream)
 {
-	fprintf(stream, "%li;%li;%li;%li;%li;%li;%li;%li;%li;%li;%li;%li;%li;%li;%li;%li;%li;%li;%li;%li;\n",
+	fprintf(stream, "%li;%li;%li;%li;%li;%li;%li;%li;%li;%li;%li;%li;%li;%li;%li;%li;%li;%li;%li;%li;%f;%f;%li;%li;%li;%li;%li;%li;%li;%li;%f;\n",
 			numFTLRead, numFTLWrite, numFTLErase, numFTLTrim,
 			numGCRead, numGCWrite, numGCErase,
 			numWLRead, numWLWrite, numWLErase,
+			numHostWrite, numFlashWrite,
 			numLogMergeSwitch, numLogMergePartial, numLogMergeFull,
 			numPageBlockToPageConversion,
 			numCacheHits, numCacheFaults,
+			numBackgroundGCErase, numBackgroundGCPeriods,
+			timeForegroundGC, timeBackgroundGC,
 			numMemoryTranslation,
 			numMemoryCache,
-			numMemoryRead,numMemoryWrite);
+			numMemoryRead,numMemoryWrite,
+			numBufferReadHit, numBufferCoalesce, numBufferFlush,
+			numBufferStall, timeBufferStall);
 
 	//print_statistics();
 }
 
+/* page programs on flash per page written by the host */
+double Stats::write_amplification() const
+{
+	if (numHostWrite == 0)
+		return 0;
+	return (double)numFlashWrite/(double)numHostWrite;
+}
+
 void Stats::print_statistics()
 {
 	printf("Statistics:\n");
@@ -105,11 +141,246 @@ void Stats::print_statistics()
 	printf("FTL Reads: %li\t Writes: %li\t Erases: %li\t Trims: %li\n", numFTLRead, numFTLWrite, numFTLErase, numFTLTrim);
 	printf("GC  Reads: %li\t Writes: %li\t Erases: %li\n", numGCRead, numGCWrite, numGCErase);
 	printf("WL  Reads: %li\t Writes: %li\t Erases: %li\n", numWLRead, numWLWrite, numWLErase);
+	printf("GC Time Foreground: %f Background: %f Background Erases: %li Idle Periods: %li\n", timeForegroundGC, timeBackgroundGC, numBackgroundGCErase, numBackgroundGCPeriods);
+	printf("Write Amplification: %f Host Writes: %li Flash Writes: %li\n", write_amplification(), numHostWrite, numFlashWrite);
 	printf("Log FTL Switch: %li Partial: %li Full: %li\n", numLogMergeSwitch, numLogMergePartial, numLogMergeFull);
 	printf("Page FTL Convertions: %li\n", numPageBlockToPageConversion);
 	printf("Cache Hits: %li Faults: %li Hit Ratio: %f\n", numCacheHits, numCacheFaults, (double)numCacheHits/(double)(numCacheHits+numCacheFaults));
+	printf("Write Buffer Read Hits: %li Coalesced: %li Written Back: %li Stalls: %li Stall Time: %f\n", numBufferReadHit, numBufferCoalesce, numBufferFlush, numBufferStall, timeBufferStall);
 	printf("Memory Consumption:\n");
 	printf("Tranlation: %li Cache: %li\n", numMemoryTranslation, numMemoryCache);
 	printf("Reads: %li \tWrites: %li\n", numMemoryRead, numMemoryWrite);
 	printf("-----------\n");
 }
+
+static const uint HISTOGRAM_SUB_BITS = 4;
+
+Latency_histogram::Latency_histogram(void):
+	count(0),
+	sum(0.0),
+	max(0.0)
+{
+	return;
+}
+
+uint Latency_histogram::bucket_of(ulong us)
+{
+	if (us < (1u << HISTOGRAM_SUB_BITS))
+		return us;
+
+	uint msb = 63 - __builtin_clzll(us);
+	uint sub = (us >> (msb - HISTOGRAM_SUB_BITS)) & ((1 << HISTOGRAM_SUB_BITS) - 1);
+	return ((msb - HISTOGRAM_SUB_BITS + 1) << HISTOGRAM_SUB_BITS) + sub;
+}
+
+/* upper bound of a bucket, in milliseconds */
+double Latency_histogram::get_bucket_limit(uint bucket)
+{
+	if (bucket < (1u << HISTOGRAM_SUB_BITS))
+		return bucket / 1000.0;
+
+	uint msb = (bucket >> HISTOGRAM_SUB_BITS) + HISTOGRAM_SUB_BITS - 1;
+	uint sub = bucket & ((1 << HISTOGRAM_SUB_BITS) - 1);
+	ulong low = (1ul << msb) + ((ulong) sub << (msb - HISTOGRAM_SUB_BITS));
+	return (low + (1ul << (msb - HISTOGRAM_SUB_BITS)) - 1) / 1000.0;
+}
+
+void Latency_histogram::add(double latency)
+{
+	uint bucket = bucket_of((ulong) (latency * 1000.0));
+
+	if (bucket >= buckets.size())
+		buckets.resize(bucket + 1, 0);
+	buckets[bucket]++;
+	count++;
+	sum += latency;
+	if (latency > max)
+		max = latency;
+}
+
+ulong Latency_histogram::get_count(void) const
+{
+	return count;
+}
+
+double Latency_histogram::get_mean(void) const
+{
+	return count > 0 ? sum / count : 0.0;
+}
+
+double Latency_histogram::get_max(void) const
+{
+	return max;
+}
+
+/* the latency p percent of the requests did not exceed, to bucket precision */
+double Latency_histogram::percentile(double p) const
+{
+	ulong rank = (ulong) (p / 100.0 * count + 0.5);
+	ulong seen = 0;
+
+	if (rank == 0)
+		rank = 1;
+	for (uint i = 0; i < buckets.size(); i++)
+	{
+		seen += buckets[i];
+		if (seen >= rank)
+			return get_bucket_limit(i) < max ? get_bucket_limit(i) : max;
+	}
+	return max;
+}
+
+uint Latency_histogram::get_num_buckets(void) const
+{
+	return buckets.size();
+}
+
+ulong Latency_histogram::get_bucket(uint bucket) const
+{
+	return buckets[bucket];
+}
+
+Stats_series::Stats_series(double window):
+	length(window)
+{
+	reset();
+}
+
+Stats_series::~Stats_series(void)
+{
+	return;
+}
+
+/* also for after the Stats counters were reset */
+void Stats_series::reset(void)
+{
+	first_arrival = -1.0;
+	windows.clear();
+	base_gc_erases = 0;
+	base_gc_writes = 0;
+	base_gc_time = 0.0;
+}
+
+/* the GC work since the last window was opened goes to it */
+void Stats_series::close(const Stats &stats, ulong free_blocks)
+{
+	window &last = windows.back();
+
+	last.gc_erases = stats.numGCErase + stats.numBackgroundGCErase - base_gc_erases;
+	last.gc_writes = stats.numGCWrite - base_gc_writes;
+	last.gc_time = stats.timeForegroundGC + stats.timeBackgroundGC - base_gc_time;
+	last.free_blocks = free_blocks;
+
+	base_gc_erases += last.gc_erases;
+	base_gc_writes += last.gc_writes;
+	base_gc_time += last.gc_time;
+}
+
+/* a completed request; requests of a batch may complete out of order, the
+ * late ones are still counted in their own window */
+void Stats_series::add(enum event_type type, uint pages, double start_time, double completion_time, const Stats &stats, ulong free_blocks)
+{
+	if (type != READ && type != WRITE)
+		return;
+
+	if (first_arrival < 0.0)
+		first_arrival = start_time;
+
+	ulong index = completion_time > first_arrival ? (ulong) ((completion_time - first_arrival) / length) : 0;
+	if (windows.empty())
+		windows.push_back(window());
+	while (windows.size() <= index)
+	{
+		close(stats, free_blocks);
+		windows.push_back(window());
+	}
+
+	window &current = windows[index];
+	if (type == READ)
+	{
+		current.reads++;
+		current.read_pages += pages;
+		current.read_latency.add(completion_time - start_time);
+	}
+	else
+	{
+		current.writes++;
+		current.write_pages += pages;
+		current.write_latency.add(completion_time - start_time);
+	}
+}
+
+/* the last window is still open, its GC work is what was done so far */
+void Stats_series::write(FILE *stream, enum stats_format format, const Stats &stats, ulong free_blocks)
+{
+	long gc_erases = base_gc_erases;
+	long gc_writes = base_gc_writes;
+	double gc_time = base_gc_time;
+
+	if (!windows.empty())
+	{
+		close(stats, free_blocks);
+		base_gc_erases = gc_erases;
+		base_gc_writes = gc_writes;
+		base_gc_time = gc_time;
+	}
+
+	if (format == STATS_JSON)
+		write_json(stream);
+	else
+		write_csv(stream);
+}
+
+void Stats_series::write_csv(FILE *stream) const
+{
+	double seconds = length / 1000.0;
+
+	fprintf(stream, "time,reads,writes,read_iops,write_iops,read_mbps,write_mbps,read_mean,read_p50,read_p99,read_max,write_mean,write_p50,write_p99,write_max,gc_erases,gc_writes,gc_time,free_blocks\n");
+	for (uint i = 0; i < windows.size(); i++)
+	{
+		const window &w = windows[i];
+
+		fprintf(stream, "%.3f,%lu,%lu,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%li,%li,%.3f,%lu\n",
+				i * length, w.reads, w.writes,
+				w.reads / seconds, w.writes / seconds,
+				w.read_pages * PAGE_SIZE / seconds / 1e6, w.write_pages * PAGE_SIZE / seconds / 1e6,
+				w.read_latency.get_mean(), w.read_latency.percentile(50), w.read_latency.percentile(99), w.read_latency.get_max(),
+				w.write_latency.get_mean(), w.write_latency.percentile(50), w.write_latency.percentile(99), w.write_latency.get_max(),
+				w.gc_erases, w.gc_writes, w.gc_time, w.free_blocks);
+	}
+}
+
+/* non-empty buckets as [upper bound, count] pairs */
+static void write_json_latency(FILE *stream, const char *name, const Latency_histogram &latency)
+{
+	bool first = true;
+
+	fprintf(stream, "\"%s\": {\"mean\": %.3f, \"p50\": %.3f, \"p99\": %.3f, \"max\": %.3f, \"buckets\": [",
+			name, latency.get_mean(), latency.percentile(50), latency.percentile(99), latency.get_max());
+	for (uint i = 0; i < latency.get_num_buckets(); i++)
+	{
+		if (latency.get_bucket(i) == 0)
+			continue;
+		fprintf(stream, "%s[%.3f, %lu]", first ? "" : ", ", Latency_histogram::get_bucket_limit(i), latency.get_bucket(i));
+		first = false;
+	}
+	fprintf(stream, "]}");
+}
+
+void Stats_series::write_json(FILE *stream) const
+{
+	fprintf(stream, "{\"window\": %.3f, \"windows\": [", length);
+	for (uint i = 0; i < windows.size(); i++)
+	{
+		const window &w = windows[i];
+
+		fprintf(stream, "%s\n{\"time\": %.3f, \"reads\": %lu, \"writes\": %lu, \"read_pages\": %lu, \"write_pages\": %lu, ",
+				i > 0 ? "," : "", i * length, w.reads, w.writes, w.read_pages, w.write_pages);
+		write_json_latency(stream, "read_latency", w.read_latency);
+		fprintf(stream, ", ");
+		write_json_latency(stream, "write_latency", w.write_latency);
+		fprintf(stream, ", \"gc_erases\": %li, \"gc_writes\": %li, \"gc_time\": %.3f, \"free_blocks\": %lu}",
+				w.gc_erases, w.gc_writes, w.gc_time, w.free_blocks);
+	}
+	fprintf(stream, "\n]}\n");
+}
@@ -0,0 +1,332 @@
+/* ssd_wbuffer.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Write_buffer class
+ *
+ * The controller's DRAM write-back buffer (WRITE_BUFFER_PAGES).  A host page
+ * write takes a slot and completes after the RAM delay; a write to a page
+ * that is still dirty in the buffer overwrites it in place.  Dirty pages are
+ * written back through the FTL in the order they were buffered, each as its
+ * own page write starting when the flush policy picks it:
+ *
+ *   WRITE_BUFFER_FLUSH 0: every page as soon as it is buffered.
+ *   WRITE_BUFFER_FLUSH 1: nothing until WRITE_BUFFER_HIGH percent of the
+ *   slots are dirty, then the oldest pages until at most WRITE_BUFFER_LOW
+ *   percent are.
+ *
+ * A slot is free again when the write-back of its page is done, so a burst
+ * up to the capacity completes at RAM speed, while a sustained stream is
+ * throttled to the rate at which the flash programs pages. */
+
+#include <new>
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <functional>
+#include "ssd.h"
+
+using namespace ssd;
+
+Write_buffer::Write_buffer(Controller &controller, uint capacity):
+	controller(controller),
+	capacity(capacity),
+	next_sequence(0),
+	dirty(0)
+{
+	assert(capacity > 0);
+
+	pages.reserve(capacity);
+	in_flight.reserve(capacity);
+	return;
+}
+
+Write_buffer::~Write_buffer(void)
+{
+	return;
+}
+
+/* buffers the page written by event, which takes the time to wait for a slot
+ * and to copy the page into it */
+enum status Write_buffer::write(Event &event)
+{
+	ulong logical_address = event.get_logical_address();
+	double arrival = event.get_start_time();
+	double ready = arrival;
+
+	release(arrival);
+
+	std::unordered_map<ulong, buffered_page>::iterator it = pages.find(logical_address);
+	if (it != pages.end() && it->second.dirty)
+	{
+		store(it->second, event.get_payload());
+		controller.stats.numBufferCoalesce++;
+		event.incr_time_taken(RAM_WRITE_DELAY);
+		return SUCCESS;
+	}
+
+	/* every slot is taken: wait for the earliest write-back, or start one
+	 * if all of them are still dirty */
+	while (dirty + in_flight.size() >= capacity)
+	{
+		if (in_flight.empty())
+		{
+			if (flush_oldest(ready) == FAILURE)
+				return FAILURE;
+			continue;
+		}
+		if (in_flight.front().done > ready)
+			ready = in_flight.front().done;
+		release(ready);
+	}
+
+	if (ready > arrival)
+	{
+		controller.stats.numBufferStall++;
+		controller.stats.timeBufferStall += ready - arrival;
+	}
+
+	/* a copy being written back keeps its slot until it is programmed */
+	buffered_page &page = pages[logical_address];
+	page.sequence = next_sequence++;
+	page.dirty = true;
+	store(page, event.get_payload());
+	dirty_order.push_back(std::make_pair(logical_address, page.sequence));
+	dirty++;
+
+	event.incr_time_taken(ready - arrival + RAM_WRITE_DELAY);
+
+	double flush_time = ready + RAM_WRITE_DELAY;
+	if (WRITE_BUFFER_FLUSH == 0)
+	{
+		while (dirty > 0)
+			if (flush_oldest(flush_time) == FAILURE)
+				return FAILURE;
+	}
+	else if ((ulong) dirty * 100 >= (ulong) WRITE_BUFFER_HIGH * capacity)
+	{
+		while (dirty > 0 && (ulong) dirty * 100 > (ulong) WRITE_BUFFER_LOW * capacity)
+			if (flush_oldest(flush_time) == FAILURE)
+				return FAILURE;
+	}
+	return SUCCESS;
+}
+
+/* serves a read of a page that is dirty or being written back, returns false
+ * if the page is not buffered and has to be read from flash */
+bool Write_buffer::read(Event &event)
+{
+	release(event.get_start_time());
+
+	std::unordered_map<ulong, buffered_page>::const_iterator it = pages.find(event.get_logical_address());
+	if (it == pages.end())
+		return false;
+
+	if (PAGE_ENABLE_DATA && event.get_payload() != NULL)
+	{
+		if (it->second.data.empty())
+			memset(event.get_payload(), 0, PAGE_SIZE);
+		else
+			memcpy(event.get_payload(), &it->second.data[0], PAGE_SIZE);
+	}
+	controller.stats.numBufferReadHit++;
+	event.incr_time_taken(RAM_READ_DELAY);
+	return true;
+}
+
+/* drops the trimmed pages, which the FTL unmaps afterwards
+ * the slot of a page being written back stays taken until it is done */
+void Write_buffer::trim(const Event &event)
+{
+	for (uint i = 0; i < event.get_size(); i++)
+	{
+		std::unordered_map<ulong, buffered_page>::iterator it = pages.find(event.get_logical_address() + i);
+
+		if (it == pages.end())
+			continue;
+		if (it->second.dirty)
+			dirty--;
+		pages.erase(it);
+	}
+}
+
+/* writes back every dirty page starting at time, as a host flush makes the
+ * device do, and sets done to when the last write-back is programmed */
+enum status Write_buffer::drain(double time, double &done)
+{
+	release(time);
+
+	while (dirty > 0)
+		if (flush_oldest(time) == FAILURE)
+			return FAILURE;
+
+	done = time;
+	for (std::vector<write_back>::const_iterator it = in_flight.begin(); it != in_flight.end(); ++it)
+		if (it->done > done)
+			done = it->done;
+	return SUCCESS;
+}
+
+/* frees the slots of the write-backs done by time */
+void Write_buffer::release(double time)
+{
+	while (!in_flight.empty() && in_flight.front().done <= time)
+	{
+		const write_back &done = in_flight.front();
+		std::unordered_map<ulong, buffered_page>::iterator it = pages.find(done.logical_address);
+
+		/* unless the page was written again since */
+		if (it != pages.end() && it->second.sequence == done.sequence)
+			pages.erase(it);
+		std::pop_heap(in_flight.begin(), in_flight.end(), std::greater<write_back>());
+		in_flight.pop_back();
+	}
+}
+
+/* writes the oldest dirty page back through the FTL, starting at time */
+enum status Write_buffer::flush_oldest(double time)
+{
+	while (!dirty_order.empty())
+	{
+		std::pair<ulong, ulong> oldest = dirty_order.front();
+		dirty_order.pop_front();
+
+		/* skip pages trimmed since they were buffered */
+		std::unordered_map<ulong, buffered_page>::iterator it = pages.find(oldest.first);
+		if (it == pages.end() || it->second.sequence != oldest.second || !it->second.dirty)
+			continue;
+
+		buffered_page &page = it->second;
+		Event event(WRITE, oldest.first, 1, time);
+
+		if (!page.data.empty())
+			event.set_payload(&page.data[0]);
+		if (controller.ftl->write(event) == FAILURE)
+		{
+			fprintf(stderr, "Write_buffer error: %s: write-back of page %lu failed\n", __func__, oldest.first);
+			return FAILURE;
+		}
+
+		page.dirty = false;
+		dirty--;
+		controller.stats.numBufferFlush++;
+
+		write_back done = {time + event.get_time_taken(), oldest.first, oldest.second};
+		in_flight.push_back(done);
+		std::push_heap(in_flight.begin(), in_flight.end(), std::greater<write_back>());
+		return SUCCESS;
+	}
+
+	fprintf(stderr, "Write_buffer error: %s: no dirty page to write back\n", __func__);
+	return FAILURE;
+}
+
+/* keeps a copy of the written data, the requester's buffer may be reused */
+void Write_buffer::store(buffered_page &page, const void *data)
+{
+	if (!PAGE_ENABLE_DATA || data == NULL)
+	{
+		page.data.clear();
+		return;
+	}
+	page.data.resize(PAGE_SIZE);
+	memcpy(&page.data[0], data, PAGE_SIZE);
+}
+
+void Write_buffer::save_state(Checkpoint &checkpoint) const
+{
+	ulong entries = pages.size();
+
+	checkpoint.put(next_sequence);
+	checkpoint.put(dirty);
+	checkpoint.put(entries);
+	for (std::unordered_map<ulong, buffered_page>::const_iterator it = pages.begin(); it != pages.end(); ++it)
+	{
+		ulong size = it->second.data.size();
+
+		checkpoint.put(it->first);
+		checkpoint.put(it->second.sequence);
+		checkpoint.put(it->second.dirty);
+		checkpoint.put(size);
+		checkpoint.put_bytes(it->second.data.data(), size);
+	}
+
+	entries = dirty_order.size();
+	checkpoint.put(entries);
+	for (std::deque<std::pair<ulong, ulong> >::const_iterator it = dirty_order.begin(); it != dirty_order.end(); ++it)
+		checkpoint.put(*it);
+
+	entries = in_flight.size();
+	checkpoint.put(entries);
+	checkpoint.put_bytes(in_flight.data(), entries * sizeof(write_back));
+}
+
+void Write_buffer::load_state(Checkpoint &checkpoint)
+{
+	ulong entries;
+
+	pages.clear();
+	dirty_order.clear();
+	in_flight.clear();
+
+	checkpoint.get(next_sequence);
+	checkpoint.get(dirty);
+	checkpoint.get(entries);
+	if (!checkpoint.ok() || dirty > capacity || entries > capacity)
+	{
+		checkpoint.fail();
+		return;
+	}
+	for (ulong i = 0; i < entries; i++)
+	{
+		ulong logical_address;
+		ulong size;
+
+		checkpoint.get(logical_address);
+		buffered_page &page = pages[logical_address];
+		checkpoint.get(page.sequence);
+		checkpoint.get(page.dirty);
+		checkpoint.get(size);
+		if (!checkpoint.ok() || (size != 0 && size != PAGE_SIZE))
+		{
+			checkpoint.fail();
+			return;
+		}
+		page.data.resize(size);
+		checkpoint.get_bytes(page.data.data(), size);
+	}
+
+	checkpoint.get(entries);
+	if (!checkpoint.ok())
+		return;
+	for (ulong i = 0; i < entries && checkpoint.ok(); i++)
+	{
+		std::pair<ulong, ulong> oldest;
+
+		checkpoint.get(oldest);
+		dirty_order.push_back(oldest);
+	}
+
+	checkpoint.get(entries);
+	if (!checkpoint.ok() || entries > capacity)
+	{
+		checkpoint.fail();
+		return;
+	}
+	in_flight.resize(entries);
+	checkpoint.get_bytes(in_flight.data(), entries * sizeof(write_back));
+}
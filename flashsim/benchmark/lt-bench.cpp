@@ -1,8 +1,18 @@
 /**
- * Standalone FlashSim simulator benchmarking client. Passing actual data
- * here, so MUST ensure that `PAGE_ENABLE_DATA` option in conf is set to 1.
+ * FlashSim latency-throughput benchmarking client. Drives a simulated
+ * device in-process through the C interface of libflashsim (SSD/flashsim.h)
+ * and keeps a configurable number of requests outstanding per job.
  *
- * This is a synchronous benchmarking, not utilizing in-device parallelism.
+ * Every job is a closed loop: it starts IO_Depth requests, and each
+ * completion callback starts the job's next request at the simulated time
+ * the previous one completed. Requests are submitted asynchronously on the
+ * virtual clock, so the results do not depend on the speed of the host.
+ * Sweeping the queue depth for a pattern and I/O size traces its
+ * latency-vs-throughput curve.
+ *
+ * Results are printed as tables, and optionally written as CSV with one
+ * line per (pattern, I/O size, IO_Depth, NumJob) point, the dimensions the
+ * split ratio tables of the cache engine are indexed by.
  *
  * Author: Guanzhou Hu <guanzhou.hu@wisc.edu>, 2020.
  */
@@ -10,637 +20,516 @@
 
 #include <string>
 #include <vector>
-#include <deque>
 #include <random>
+#include <algorithm>
+#include <numeric>
 #include <iostream>
-#include <thread>
 #include <mutex>
 #include <condition_variable>
-#include <numeric>
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <signal.h>
 #include <unistd.h>
-#include <time.h>
-#include <sys/time.h>
-#include <sys/types.h>
-#include <sys/socket.h>
-#include <sys/un.h>
 
+#include "flashsim.h"
+
+
+/** Benchmarking parameters, defaults of the command line options. */
+static const char *DEFAULT_DEPTHS = "1,2,4,8,16,32";
+static const char *DEFAULT_JOBS = "1";
+static const char *DEFAULT_PATTERNS = "seqread,randread,seqwrite,randwrite";
+static const unsigned long DEFAULT_REQUESTS = 4096;
 
 /**
- * Assuming default config, so total flash capacity should be 160MiB
- * == 167772160 bytes. We are using 40% of them - leaving the rest
- * for page redirection or garbage collection tasks.
+ * Using 40% of the device by default - leaving the rest for page
+ * redirection or garbage collection tasks.
  */
-// static const unsigned long FLASH_SPACE = 67108864;
-static const unsigned long FLASH_SPACE = 40263680;
-static const unsigned long PAGE_SIZE = 4096;
+static const unsigned int DEFAULT_SPAN_PERCENT = 40;
 
-
-/** Benchmarking parameters. */
-static const int MAX_INTENSITY = 4000;
-static const int INTENSITY_TICK = 200;
-static const int SECS_PER_ROUND = 5;
+/** The working set is written once in requests of this size first. */
+static const unsigned int FILL_SIZE = 131072;
+static const unsigned int FILL_DEPTH = 32;
 
 
+/**
+ * Exits without running the static destructors, the event loop thread of
+ * libflashsim may still be running.
+ */
 static void
 error(std::string msg)
 {
     std::cerr << "ERROR: " << msg << std::endl;
-    exit(1);
+    std::cout.flush();
+    fflush(NULL);
+    _exit(1);
 }
 
 
 /**
- * Timing utilities for the experiments.
+ * Access patterns.
  */
-static struct timeval boot_time;
-
-uint64_t
-get_cur_time_us()
-{
-    struct timeval cur_time;
-    uint64_t cur_time_us;
+struct bench_pattern {
+    const char *name;
+    const char *title;
+    enum flashsim_dir direction;
+    bool random;
+};
 
-    gettimeofday(&cur_time, NULL);
+static const struct bench_pattern PATTERNS[] = {
+    {"seqread",   "Logical Sequential Read",  FLASHSIM_READ,  false},
+    {"randread",  "Uniformly Random Read",    FLASHSIM_READ,  true},
+    {"seqwrite",  "Logical Sequential Write", FLASHSIM_WRITE, false},
+    {"randwrite", "Uniformly Random Write",   FLASHSIM_WRITE, true},
+};
 
-    cur_time_us = (cur_time.tv_sec - boot_time.tv_sec) * 1000000
-                  + (cur_time.tv_usec - boot_time.tv_usec);
 
-    return cur_time_us;
-}
+/*========== Benchmark point BEGIN ==========*/
 
+struct bench_point;
 
 /**
- * Submission queue.
- * Submission thread runs separately.
+ * An outstanding request, with the buffer it reads into or writes from.
  */
-struct req_entry {
-    unsigned int direction;
-    unsigned long addr;
-    unsigned int size;
-    uint64_t start_time_us;
+struct bench_req {
+    struct bench_point *point;
+    unsigned int job;
+    char *buffer;
+    double start_time;
 };
 
-static std::deque<struct req_entry> submit_queue;
-
-static std::mutex submit_queue_lock;
-static std::condition_variable submit_queue_cv;
-
-
 /**
- * Open a client-side socket and connect to the given sock file.
+ * State of a job: where its sequential stream is, and how many requests it
+ * has started.
  */
-static std::string sock_name;
-static int ssock;
-
-static void
-prepare_socket()
-{
-    struct sockaddr_un saddr;
-    int ret;
-
-    ssock = socket(AF_LOCAL, SOCK_STREAM, 0);
-    if (ssock < 0)
-        error("socket() failed");
-
-    memset(&saddr, 0, sizeof(saddr));
-    saddr.sun_family = AF_LOCAL;
-    strncpy(saddr.sun_path, sock_name.c_str(), sizeof(saddr.sun_path) - 1);
-
-    ret = connect(ssock, (struct sockaddr *) &saddr, sizeof(saddr));
-    if (ret)
-        error("connect() failed");
-
-    std::cout << "Connected to local socket file `" << sock_name << "`..."
-              << std::endl;
-}
-
-
-/*========== Device log implementation BEGIN ==========*/
+struct bench_job {
+    unsigned long next_addr;
+    unsigned long issued;
+    std::default_random_engine rand_gen;
+};
 
 /**
- * Device log for throughput measurement. It records the latest IOs
- * through this device.
+ * One point of a sweep. Only touched by the event loop thread while it
+ * runs, the main thread waits for `done`.
  */
-struct log_entry {
-    uint64_t start_time_us;
-    uint64_t finish_time_us;
-    uint32_t bytes;
+struct bench_point {
+    struct flashsim_dev *dev;
+    const struct bench_pattern *pattern;
+    unsigned int size;
+    unsigned int depth;
+    unsigned int num_jobs;
+    unsigned long requests;     /** per job */
+    unsigned long span;
+
+    std::vector<struct bench_job> jobs;
+    std::vector<struct bench_req> reqs;
+    std::vector<char> buffers;
+    unsigned long outstanding;
+
+    double start_time;
+    double finish_time;
+    std::vector<double> latencies;
+
+    std::mutex done_lock;
+    std::condition_variable done_cv;
+    bool done;
 };
 
-static const int DEVICE_LOG_LENGTH = 120000;
-static std::deque<struct log_entry> device_log;
-
-static std::mutex device_log_lock;
+static void _point_end(void *priv, int error, double completion_time);
 
 /**
- * Push a new IO entry into the log, possibly erase an oldest one if
- * the log is full. Returns the timestamp for this entry.
+ * Start the next request of a job, from an event loop callback.
  */
-void
-log_push_entry(uint64_t start_time_us, uint64_t finish_time_us,
-                     uint32_t bytes)
+static void
+_point_submit(struct bench_req *req)
 {
-    struct log_entry entry;
-    entry.start_time_us = start_time_us;
-    entry.finish_time_us = finish_time_us;
-    entry.bytes = bytes;
+    struct bench_point *pt = req->point;
+    struct bench_job &job = pt->jobs[req->job];
+    unsigned long addr;
 
-    std::lock_guard<std::mutex> lk(device_log_lock);
+    if (pt->pattern->random) {
+        std::uniform_int_distribution<unsigned long> addr_dist(0,
+                                                               pt->span
+                                                               / pt->size
+                                                               - 1);
+        addr = addr_dist(job.rand_gen) * pt->size;
+    } else {
+        addr = job.next_addr;
+        job.next_addr = (job.next_addr + pt->size) % pt->span;
+    }
 
-    device_log.push_back(entry);
+    job.issued++;
+    req->start_time = flashsim_now();
 
-    if (device_log.size() > DEVICE_LOG_LENGTH)
-        device_log.pop_front();
+    if (flashsim_submit(pt->dev, pt->pattern->direction, addr, pt->size,
+                        req->buffer, _point_end, req))
+        error("flashsim_submit() failed");
 }
 
-/**
- * Query the log for throughput (KB/s) of given time interval.
- */
-double
-log_query_throughput(uint64_t begin_time_us, uint64_t end_time_us)
+static void
+_point_finish(struct bench_point *pt)
 {
-    double kilobytes = 0.0;
+    std::lock_guard<std::mutex> lk(pt->done_lock);
 
-    std::lock_guard<std::mutex> lk(device_log_lock);
-
-    for (auto it = device_log.rbegin(); it != device_log.rend(); ++it) {
-        if (it->finish_time_us <= begin_time_us)
-            break;
-
-        if (it->finish_time_us <= end_time_us)
-            kilobytes += (double) it->bytes / 1024.0;
-    }
-
-    return (kilobytes * 1000000) / (end_time_us - begin_time_us);
+    pt->done = true;
+    pt->done_cv.notify_all();
 }
 
-/*========== Device log implementation END ==========*/
-
-
-/**
- * Request header (1st message) format.
- * Message size MUST exactly match in bytes!
- */
-struct __attribute__((__packed__)) req_header {
-    uint32_t direction     : 32;
-    uint64_t addr          : 64;
-    uint32_t size          : 32;
-    uint64_t start_time_us : 64;
-};
-
-static const size_t REQ_HEADER_LENGTH = 24;
-
-static const int DIR_READ  = 0;
-static const int DIR_WRITE = 1;
-
-/**
- * Issuing a write / read request.
- */
 static void
-_submit_write(unsigned long addr, unsigned int size, uint64_t start_time_us)
+_point_end(void *priv, int err, double completion_time)
 {
-    struct req_header header;
-    int rbytes, wbytes;
-    uint64_t time_used_us;
-    void *data;
-
-    if (addr % PAGE_SIZE != 0 || size <= 0)
-        error("invalid issue_write()");
-
-    data = malloc(size);
-
-    // Request header.
-    header.direction = DIR_WRITE;
-    header.addr = addr;
-    header.size = size;
-    header.start_time_us = start_time_us;
-
-    wbytes = write(ssock, &header, REQ_HEADER_LENGTH);
-    if (wbytes != REQ_HEADER_LENGTH)
-        error("write request header send failed");
-
-    // Data to write.
-    wbytes = write(ssock, data, header.size);
-    if (wbytes != (int) header.size)
-        error("write request data send failed");
+    struct bench_req *req = (struct bench_req *) priv;
+    struct bench_point *pt = req->point;
 
-    // Processing time respond.
-    rbytes = read(ssock, &time_used_us, 8);
-    if (rbytes != 8)
-        error("write processing time recv failed");
+    if (err)
+        error("request failed");
 
-    usleep(time_used_us);
+    pt->latencies.push_back(completion_time - req->start_time);
+    pt->finish_time = completion_time;
 
-    free(data);
+    if (pt->jobs[req->job].issued < pt->requests)
+        _point_submit(req);
+    else if (--pt->outstanding == 0)
+        _point_finish(pt);
 }
 
+/**
+ * Completion of the empty request that starts a point. The event loop does
+ * not advance the simulated time while a callback runs, so all jobs start
+ * their first requests at the same time.
+ */
 static void
-_submit_read(unsigned long addr, unsigned int size, uint64_t start_time_us)
+_point_start(void *priv, int err, double completion_time)
 {
-    struct req_header header;
-    int rbytes, wbytes;
-    uint64_t time_used_us;
-    void *data;
-
-    if (addr % PAGE_SIZE != 0 || size <= 0)
-        error("invalid issue_read()");
-
-    data = malloc(size);
-
-    // Request header.
-    header.direction = DIR_READ;
-    header.addr = addr;
-    header.size = size;
-    header.start_time_us = start_time_us;
+    struct bench_point *pt = (struct bench_point *) priv;
 
-    wbytes = write(ssock, &header, REQ_HEADER_LENGTH);
-    if (wbytes != REQ_HEADER_LENGTH)
-        error("read request header send failed");
+    pt->start_time = completion_time;
 
-    // Data read out respond.
-    rbytes = read(ssock, data, header.size);
-    if (rbytes != (int) header.size)
-        error("read request data recv failed");
-
-    // Processing time respond.
-    rbytes = read(ssock, &time_used_us, 8);
-    if (rbytes != 8)
-        error("read processing time recv failed");
-
-    usleep(time_used_us);
-
-    free(data);
+    for (size_t i = 0; i < pt->reqs.size(); ++i)
+        _point_submit(&pt->reqs[i]);
 }
 
 /**
- * Submission thread runs separately.
+ * Run a point to completion: every job starts `requests` requests, keeping
+ * `depth` of them outstanding.
  */
 static void
-_submit_thread_func()
+run_point(struct bench_point *pt)
 {
-    unsigned int direction;
-    unsigned long addr;
-    unsigned int size;
-    uint64_t start_time_us;
+    unsigned long slots = (unsigned long) pt->depth * pt->num_jobs;
+
+    pt->jobs.assign(pt->num_jobs, bench_job());
+    for (unsigned int i = 0; i < pt->num_jobs; ++i) {
+        /** Sequential jobs stream through their own part of the span. */
+        pt->jobs[i].next_addr = (pt->span / pt->num_jobs / pt->size) * i
+                                * pt->size;
+        pt->jobs[i].issued = 0;
+        pt->jobs[i].rand_gen.seed(i + 1);
+    }
 
-    while (1) {
-        {
-            /** Wait when list is empty. */
-            std::unique_lock<std::mutex> lk(submit_queue_lock);
-            submit_queue_cv.wait(lk, []{ return submit_queue.size() > 0; });
+    pt->buffers.assign(slots * pt->size, 0x5a);
+    pt->reqs.resize(slots);
+    for (unsigned long i = 0; i < slots; ++i) {
+        pt->reqs[i].point = pt;
+        pt->reqs[i].job = i % pt->num_jobs;
+        pt->reqs[i].buffer = &pt->buffers[i * pt->size];
+    }
 
-            /** Extract an entry from queue head. */
-            direction = submit_queue.front().direction;
-            addr = submit_queue.front().addr;
-            size = submit_queue.front().size;
-            start_time_us = submit_queue.front().start_time_us;
+    /** A job never keeps more requests outstanding than it starts. */
+    if (pt->requests < pt->depth)
+        pt->requests = pt->depth;
 
-            submit_queue.pop_front();
-        }
+    pt->outstanding = slots;
+    pt->latencies.clear();
+    pt->latencies.reserve(pt->requests * pt->num_jobs);
+    pt->done = false;
 
-        /** Process the request. */
-        switch (direction) {
-        case DIR_WRITE:
-            _submit_write(addr, size, start_time_us);
-            break;
-        case DIR_READ:
-            _submit_read(addr, size, start_time_us);
-            break;
-        }
+    if (flashsim_submit(pt->dev, FLASHSIM_TRIM, 0, 0, NULL, _point_start,
+                        pt))
+        error("flashsim_submit() failed");
 
-        log_push_entry(start_time_us, get_cur_time_us(), size);
-    }
+    std::unique_lock<std::mutex> lk(pt->done_lock);
+    pt->done_cv.wait(lk, [pt]{ return pt->done; });
 }
 
+/*========== Benchmark point END ==========*/
 
-/*========== Benchmarking Implemention BEGIN. ==========*/
-
-/** Clearing after round. */
-static inline void
-bench_clean_up()
-{
-    usleep(2000000);
 
-    std::unique_lock<std::mutex> lk1(submit_queue_lock, std::defer_lock);
-    std::unique_lock<std::mutex> lk2(device_log_lock, std::defer_lock);
-    std::lock(lk1, lk2);
-
-    submit_queue.clear();
-    device_log.clear();
-}
+/*========== Benchmarking Implemention BEGIN ==========*/
 
 /**
- * Benchmark - sequential read.
+ * Results of a point: throughput over the time from the start of the point
+ * to its last completion, latencies in microseconds.
  */
-static void
-bench_seq_read()
-{
-    unsigned long addr = 0;
-
-    std::cout << "Benchmark - Logical Sequential Read:"         << std::endl
-              << "  Intensity (#4K-Reqs/s)   Throughput (KB/s)" << std::endl;
-
-    for (int intensity = INTENSITY_TICK; intensity <= MAX_INTENSITY;
-         intensity += INTENSITY_TICK) {
-
-        /** A round of benchmarking for given intensity. */
-        uint64_t delta_us = 1000000 / intensity;
-        uint64_t base_time_us, cur_time_us, log_interval_us = 0;
-        std::vector<double> throughputs;
-
-        base_time_us = get_cur_time_us();
-        cur_time_us = base_time_us;
-        log_interval_us = 0;
-
-        do {
-            struct req_entry entry;
-            uint64_t new_time_us = get_cur_time_us();
-
-            entry.direction = DIR_READ;
-            entry.addr = addr;
-            entry.size = PAGE_SIZE;
-            entry.start_time_us = new_time_us;
-
-            if (new_time_us - base_time_us >= 1000000)
-                log_interval_us += new_time_us - cur_time_us;
-            cur_time_us = new_time_us;
-
-            if (log_interval_us > 100000) {
-                throughputs.push_back(log_query_throughput(cur_time_us
-                                                           - log_interval_us,
-                                                           cur_time_us));
-                log_interval_us = 0;
-            }
+struct bench_result {
+    double iops;
+    double throughput;          /** KB/s */
+    double mean_lat_us;
+    double p50_lat_us;
+    double p99_lat_us;
+};
 
-            {
-                std::lock_guard<std::mutex> lk(submit_queue_lock);
+static double
+percentile(const std::vector<double> &sorted, double p)
+{
+    size_t idx = (size_t) (p * (sorted.size() - 1) + 0.5);
 
-                submit_queue.push_back(entry);
-                submit_queue_cv.notify_all();
-            }
+    return sorted[idx];
+}
 
-            usleep(delta_us);
+/** Simulated time is in milliseconds. */
+static struct bench_result
+point_result(struct bench_point *pt)
+{
+    struct bench_result res;
+    double elapsed_s = (pt->finish_time - pt->start_time) / 1000.0;
+    std::vector<double> &lat = pt->latencies;
 
-            addr = (addr + PAGE_SIZE) % FLASH_SPACE;
-        } while (cur_time_us < base_time_us + 1000000 * SECS_PER_ROUND);
+    std::sort(lat.begin(), lat.end());
 
-        double avg_throughput = std::accumulate(throughputs.begin(),
-                                                throughputs.end(),
-                                                0.0) / throughputs.size();
-        printf("  %20d     %15.5lf\n", intensity, avg_throughput);
-        fflush(stdout);
+    res.iops = lat.size() / elapsed_s;
+    res.throughput = res.iops * pt->size / 1024.0;
+    res.mean_lat_us = std::accumulate(lat.begin(), lat.end(), 0.0)
+                      / lat.size() * 1000.0;
+    res.p50_lat_us = percentile(lat, 0.50) * 1000.0;
+    res.p99_lat_us = percentile(lat, 0.99) * 1000.0;
 
-        bench_clean_up();
-    }
+    return res;
 }
 
 /**
- * Benchmark - sequential write.
+ * Fill the working set with sequentially written data, so that reads hit
+ * mapped pages.
  */
 static void
-bench_seq_write()
+bench_fill_device(struct flashsim_dev *dev, unsigned long span)
 {
-    unsigned long addr = 0;
-
-    std::cout << "Benchmark - Logical Sequential Write:"        << std::endl
-              << "  Intensity (#4K-Reqs/s)   Throughput (KB/s)" << std::endl;
-
-    for (int intensity = INTENSITY_TICK; intensity <= MAX_INTENSITY;
-         intensity += INTENSITY_TICK) {
-
-        /** A round of benchmarking for given intensity. */
-        uint64_t delta_us = 1000000 / intensity;
-        uint64_t base_time_us, cur_time_us, log_interval_us = 0;
-        std::vector<double> throughputs;
-
-        base_time_us = get_cur_time_us();
-        cur_time_us = base_time_us;
-        log_interval_us = 0;
-
-        do {
-            struct req_entry entry;
-            uint64_t new_time_us = get_cur_time_us();
-
-            entry.direction = DIR_WRITE;
-            entry.addr = addr;
-            entry.size = PAGE_SIZE;
-            entry.start_time_us = new_time_us;
-
-            if (new_time_us - base_time_us >= 1000000)
-                log_interval_us += new_time_us - cur_time_us;
-            cur_time_us = new_time_us;
-
-            if (log_interval_us > 100000) {
-                throughputs.push_back(log_query_throughput(cur_time_us
-                                                           - log_interval_us,
-                                                           cur_time_us));
-                log_interval_us = 0;
-            }
-
-            {
-                std::lock_guard<std::mutex> lk(submit_queue_lock);
-
-                submit_queue.push_back(entry);
-                submit_queue_cv.notify_all();
-            }
-
-            usleep(delta_us);
-
-            addr = (addr + PAGE_SIZE) % FLASH_SPACE;
-        } while (cur_time_us < base_time_us + 1000000 * SECS_PER_ROUND);
-
-        double avg_throughput = std::accumulate(throughputs.begin(),
-                                                throughputs.end(),
-                                                0.0) / throughputs.size();
-        printf("  %20d     %15.5lf\n", intensity, avg_throughput);
-        fflush(stdout);
-
-        bench_clean_up();
-    }
+    struct bench_point pt;
+    static const struct bench_pattern fill = {"fill", "Fill",
+                                              FLASHSIM_WRITE, false};
+
+    pt.dev = dev;
+    pt.pattern = &fill;
+    pt.size = FILL_SIZE;
+    pt.depth = FILL_DEPTH;
+    pt.num_jobs = 1;
+    pt.requests = span / FILL_SIZE;
+    pt.span = span;
+
+    run_point(&pt);
 }
 
 /**
- * Benchmark - uniformly random read.
+ * Sweep the queue depths and job counts for a pattern and I/O size.
  */
 static void
-bench_rnd_read()
+bench_pattern(struct flashsim_dev *dev, const struct bench_pattern *pattern,
+              unsigned int size, const std::vector<unsigned int> &depths,
+              const std::vector<unsigned int> &jobs, unsigned long requests,
+              unsigned long span, FILE *csv)
 {
-    std::default_random_engine rand_gen;
-    std::uniform_int_distribution<unsigned long> addr_dist(0,
-                                                           FLASH_SPACE
-                                                           / PAGE_SIZE);
-
-    std::cout << "Benchmark - Uniformly Random Read:"           << std::endl
-              << "  Intensity (#4K-Reqs/s)   Throughput (KB/s)" << std::endl;
-
-    for (int intensity = INTENSITY_TICK; intensity <= MAX_INTENSITY;
-         intensity += INTENSITY_TICK) {
-
-        /** A round of benchmarking for given intensity. */
-        uint64_t delta_us = 1000000 / intensity;
-        uint64_t base_time_us, cur_time_us, log_interval_us = 0;
-        std::vector<double> throughputs;
-
-        base_time_us = get_cur_time_us();
-        cur_time_us = base_time_us;
-        log_interval_us = 0;
-
-        do {
-            struct req_entry entry;
-            uint64_t new_time_us = get_cur_time_us();
-
-            entry.direction = DIR_READ;
-            entry.addr = PAGE_SIZE * addr_dist(rand_gen);;
-            entry.size = PAGE_SIZE;
-            entry.start_time_us = new_time_us;
-
-            if (new_time_us - base_time_us >= 1000000)
-                log_interval_us += new_time_us - cur_time_us;
-            cur_time_us = new_time_us;
-
-            if (log_interval_us > 100000) {
-                throughputs.push_back(log_query_throughput(cur_time_us
-                                                           - log_interval_us,
-                                                           cur_time_us));
-                log_interval_us = 0;
-            }
-
-            {
-                std::lock_guard<std::mutex> lk(submit_queue_lock);
-
-                submit_queue.push_back(entry);
-                submit_queue_cv.notify_all();
+    std::cout << "Benchmark - " << pattern->title << " (" << size
+              << " B):" << std::endl
+              << "  IO_Depth  NumJob          IOPS   Throughput (KB/s)"
+              << "   Mean Lat (us)    P99 Lat (us)" << std::endl;
+
+    for (size_t j = 0; j < jobs.size(); ++j) {
+        for (size_t d = 0; d < depths.size(); ++d) {
+            struct bench_point pt;
+            struct bench_result res;
+
+            pt.dev = dev;
+            pt.pattern = pattern;
+            pt.size = size;
+            pt.depth = depths[d];
+            pt.num_jobs = jobs[j];
+            pt.requests = requests;
+            pt.span = span;
+
+            run_point(&pt);
+            res = point_result(&pt);
+
+            printf("  %8u  %6u  %12.1lf     %15.5lf %15.3lf %15.3lf\n",
+                   pt.depth, pt.num_jobs, res.iops, res.throughput,
+                   res.mean_lat_us, res.p99_lat_us);
+            fflush(stdout);
+
+            if (csv != NULL) {
+                fprintf(csv, "%s,%u,%u,%u,%.1lf,%.0lf,%.3lf,%.3lf,%.3lf\n",
+                        pattern->name, size, pt.depth, pt.num_jobs,
+                        res.iops, res.throughput, res.mean_lat_us,
+                        res.p50_lat_us, res.p99_lat_us);
+                fflush(csv);
             }
-
-            usleep(delta_us);
-        } while (cur_time_us < base_time_us + 1000000 * SECS_PER_ROUND);
-
-        double avg_throughput = std::accumulate(throughputs.begin(),
-                                                throughputs.end(),
-                                                0.0) / throughputs.size();
-        printf("  %20d     %15.5lf\n", intensity, avg_throughput);
-        fflush(stdout);
-
-        bench_clean_up();
+        }
     }
 }
 
+/*========== Benchmarking Implemention END ==========*/
+
+
 /**
- * Benchmark - uniformly random read.
+ * Parse a comma separated list of positive numbers.
  */
-static void
-bench_rnd_write()
+static std::vector<unsigned int>
+parse_list(const char *arg, const char *option)
 {
-    std::default_random_engine rand_gen;
-    std::uniform_int_distribution<unsigned long> addr_dist(0,
-                                                           FLASH_SPACE
-                                                           / PAGE_SIZE);
-
-    std::cout << "Benchmark - Uniformly Random Write:"          << std::endl
-              << "  Intensity (#4K-Reqs/s)   Throughput (KB/s)" << std::endl;
-
-    for (int intensity = INTENSITY_TICK; intensity <= MAX_INTENSITY;
-         intensity += INTENSITY_TICK) {
-
-        /** A round of benchmarking for given intensity. */
-        uint64_t delta_us = 1000000 / intensity;
-        uint64_t base_time_us, cur_time_us, log_interval_us = 0;
-        std::vector<double> throughputs;
-
-        base_time_us = get_cur_time_us();
-        cur_time_us = base_time_us;
-        log_interval_us = 0;
-
-        do {
-            struct req_entry entry;
-            uint64_t new_time_us = get_cur_time_us();
-
-            entry.direction = DIR_WRITE;
-            entry.addr = PAGE_SIZE * addr_dist(rand_gen);;
-            entry.size = PAGE_SIZE;
-            entry.start_time_us = new_time_us;
-
-            if (new_time_us - base_time_us >= 1000000)
-                log_interval_us += new_time_us - cur_time_us;
-            cur_time_us = new_time_us;
-
-            if (log_interval_us > 100000) {
-                throughputs.push_back(log_query_throughput(cur_time_us
-                                                           - log_interval_us,
-                                                           cur_time_us));
-                log_interval_us = 0;
-            }
+    std::vector<unsigned int> values;
+    std::string list(arg);
+    size_t pos = 0;
 
-            {
-                std::lock_guard<std::mutex> lk(submit_queue_lock);
+    while (pos <= list.size()) {
+        size_t end = list.find(',', pos);
+        std::string item;
+        char *rest;
 
-                submit_queue.push_back(entry);
-                submit_queue_cv.notify_all();
-            }
-
-            usleep(delta_us);
-        } while (cur_time_us < base_time_us + 1000000 * SECS_PER_ROUND);
+        if (end == std::string::npos)
+            end = list.size();
+        item = list.substr(pos, end - pos);
 
-        double avg_throughput = std::accumulate(throughputs.begin(),
-                                                throughputs.end(),
-                                                0.0) / throughputs.size();
-        printf("  %20d     %15.5lf\n", intensity, avg_throughput);
-        fflush(stdout);
+        unsigned long value = strtoul(item.c_str(), &rest, 0);
+        if (item.empty() || *rest != '\0' || value == 0)
+            error(std::string("invalid list for ") + option + ": " + arg);
+        values.push_back(value);
 
-        bench_clean_up();
+        pos = end + 1;
     }
-}
 
+    return values;
+}
 
-/**
- * Fill device with randomly written data.
- */
-static void
-bench_fill_device()
+static const struct bench_pattern *
+find_pattern(const std::string &name)
 {
-    unsigned long addr = 0;
-    
-    for (size_t i = 0; i < (FLASH_SPACE / PAGE_SIZE); ++i) {
-        addr = i * PAGE_SIZE;
-        _submit_write(addr, PAGE_SIZE, get_cur_time_us());
+    for (size_t i = 0; i < sizeof(PATTERNS) / sizeof(PATTERNS[0]); ++i) {
+        if (name == PATTERNS[i].name)
+            return &PATTERNS[i];
     }
 
-    bench_clean_up();
+    error("unknown pattern: " + name);
+    return NULL;
 }
 
-/*========== Benchmarking Implemention BEGIN. ==========*/
+static void
+usage(const char *prog)
+{
+    std::cerr << "usage: " << prog << " [options] <config>" << std::endl
+              << "  -q <list>   queue depths per job (default "
+              << DEFAULT_DEPTHS << ")" << std::endl
+              << "  -j <list>   numbers of jobs (default "
+              << DEFAULT_JOBS << ")" << std::endl
+              << "  -b <list>   I/O sizes in bytes, multiples of the page"
+              << " size (default one page)" << std::endl
+              << "  -p <list>   patterns: seqread, randread, seqwrite,"
+              << " randwrite (default all)" << std::endl
+              << "  -n <num>    requests per job and point (default "
+              << DEFAULT_REQUESTS << ")" << std::endl
+              << "  -s <pct>    working set in percent of the capacity"
+              << " (default " << DEFAULT_SPAN_PERCENT << ")" << std::endl
+              << "  -o <file>   also write the results as CSV" << std::endl;
+    exit(1);
+}
 
 
 int
 main(int argc, char *argv[])
 {
-    if (argc != 2)
-        error("please provide one argument: the socket file path");
+    std::vector<unsigned int> depths = parse_list(DEFAULT_DEPTHS, "-q");
+    std::vector<unsigned int> jobs = parse_list(DEFAULT_JOBS, "-j");
+    std::vector<unsigned int> sizes;
+    std::vector<const struct bench_pattern *> patterns;
+    std::string pattern_list = DEFAULT_PATTERNS;
+    unsigned long requests = DEFAULT_REQUESTS;
+    unsigned int span_percent = DEFAULT_SPAN_PERCENT;
+    const char *csv_name = NULL;
+    FILE *csv = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "q:j:b:p:n:s:o:")) != -1) {
+        switch (opt) {
+        case 'q':
+            depths = parse_list(optarg, "-q");
+            break;
+        case 'j':
+            jobs = parse_list(optarg, "-j");
+            break;
+        case 'b':
+            sizes = parse_list(optarg, "-b");
+            break;
+        case 'p':
+            pattern_list = optarg;
+            break;
+        case 'n':
+            requests = strtoul(optarg, NULL, 0);
+            break;
+        case 's':
+            span_percent = strtoul(optarg, NULL, 0);
+            break;
+        case 'o':
+            csv_name = optarg;
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
 
-    sock_name = argv[1];
+    if (optind != argc - 1 || requests == 0 || span_percent == 0
+        || span_percent > 100)
+        usage(argv[0]);
 
-    if (sizeof(struct req_header) != REQ_HEADER_LENGTH)
-        error("request header length incorrect");
+    for (size_t pos = 0; pos <= pattern_list.size(); ) {
+        size_t end = pattern_list.find(',', pos);
 
-    gettimeofday(&boot_time, NULL);
+        if (end == std::string::npos)
+            end = pattern_list.size();
+        patterns.push_back(find_pattern(pattern_list.substr(pos,
+                                                            end - pos)));
+        pos = end + 1;
+    }
+
+    struct flashsim_dev *dev = flashsim_open(argv[optind]);
+    if (dev == NULL)
+        error("flashsim_open() failed");
+
+    uint32_t page_size = flashsim_get_page_size(dev);
+    unsigned int max_size = FILL_SIZE;
 
-    /** Open client socket & connect. */
-    prepare_socket();
+    if (sizes.empty())
+        sizes.push_back(page_size);
+
+    for (size_t i = 0; i < sizes.size(); ++i) {
+        if (sizes[i] % page_size != 0)
+            error("I/O sizes must be multiples of the page size");
+        max_size = std::max(max_size, sizes[i]);
+    }
 
-    bench_fill_device();
+    /** The working set is a multiple of every I/O size used. */
+    unsigned long span = flashsim_get_capacity(dev) / 100 * span_percent;
+    span -= span % max_size;
+    if (span == 0)
+        error("working set smaller than the largest I/O size");
 
-    /** Create the separate submission thread. */
-    std::thread submit_thread(_submit_thread_func);
-    submit_thread.detach();
+    std::cout << "Working set " << span / 1024 << " KB of "
+              << flashsim_get_capacity(dev) / 1024 << " KB, filling..."
+              << std::endl;
+    bench_fill_device(dev, span);
+
+    if (csv_name != NULL) {
+        csv = fopen(csv_name, "w");
+        if (csv == NULL)
+            error(std::string("cannot open ") + csv_name);
+        fprintf(csv, "Pattern,Block_Size,IO_Depth,NumJob,IOPS,Actual_BW,"
+                     "Mean_Lat_us,P50_Lat_us,P99_Lat_us\n");
+    }
+
+    for (size_t p = 0; p < patterns.size(); ++p) {
+        for (size_t s = 0; s < sizes.size(); ++s)
+            bench_pattern(dev, patterns[p], sizes[s], depths, jobs,
+                          requests, span, csv);
+    }
 
-    bench_seq_read();
-    bench_rnd_read();
-    bench_seq_write();
-    bench_rnd_write();
+    if (csv != NULL)
+        fclose(csv);
+    flashsim_close(dev);
 
     return 0;
 }
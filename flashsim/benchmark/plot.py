@@ -1,52 +1,48 @@
+import sys
+import csv
+
 import matplotlib
 matplotlib.use('Agg')
 
 import matplotlib.pyplot as plt
 
 
-PAGE_SIZE = 4096
-
-
-intensities = {}
-throughputs = {}
+# CSV written by `lt-bench -o`: one latency-vs-throughput curve per pattern,
+# I/O size and number of jobs, with a point per queue depth.
+results = sys.argv[1] if len(sys.argv) > 1 else "results.csv"
 
-with open("results.txt") as fres:
-    cur_bench = None
+curves = {}
 
-    for line in fres.readlines():
-        line = line.strip()
-        if line.startswith("Benchmark"):
-            cur_bench = line[12:line.find(':')]
-            intensities[cur_bench] = []
-            throughputs[cur_bench] = []
-        elif cur_bench is not None \
-             and len(line) > 0 and line[0].isdecimal():
-            line = line.split()
-            intensity, throughput = int(line[0]), float(line[1])
-            intensities[cur_bench].append(intensity)
-            throughputs[cur_bench].append(throughput)
+with open(results) as fres:
+    for row in csv.DictReader(fres):
+        key = (row["Block_Size"], row["NumJob"])
+        curve = curves.setdefault(row["Pattern"], {}).setdefault(key, [])
+        curve.append((int(row["IO_Depth"]), float(row["Actual_BW"]),
+                      float(row["Mean_Lat_us"])))
 
-# print(intensities)
-# print(throughputs)
+# print(curves)
 
 
-fig, axs = plt.subplots(2, 2)
-colors = ['b', 'g', 'r', 'c']
+fig, axs = plt.subplots(2, 2, squeeze=False)
 
-i = 0
-for bench in intensities:
+for i, pattern in enumerate(curves):
+    if i >= 4:
+        break
     ax = axs[i // 2, i % 2]
 
-    ax.plot(intensities[bench], throughputs[bench],
-            color=colors[i], label=bench)
-    ax.set_xlabel("Intensity (#4K-Reqs/s)")
-    ax.set_ylabel("Throughput (KB/s)")
-    # ax.tick_params(axis='x', labelrotation=30)
-    ax.set_title(bench)
+    for (size, jobs), points in sorted(curves[pattern].items()):
+        points.sort()
+        ax.plot([p[1] for p in points], [p[2] for p in points], marker='o',
+                label="%sB x%s" % (size, jobs))
+        for depth, bw, lat in points:
+            ax.annotate(str(depth), (bw, lat), fontsize=6)
 
-    i += 1
+    ax.set_xlabel("Throughput (KB/s)")
+    ax.set_ylabel("Mean Latency (us)")
+    ax.set_title(pattern)
+    ax.legend(fontsize=6)
 
-fig.suptitle("Throughput Benchmarking (FTL = BAST)")
+fig.suptitle("Latency vs Throughput by Queue Depth")
 fig.tight_layout(pad=2.0)
 
 plt.savefig("results.png")
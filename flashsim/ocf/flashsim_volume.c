@@ -0,0 +1,285 @@
+/*
+ * Copyright(c) 2012-2020 Intel Corporation
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include <ocf/ocf.h>
+#include "ocf_env.h"
+#include "flashsim.h"
+#include "flashsim_volume.h"
+
+/* Largest I/O OCF may submit in one piece */
+#define FLASHSIM_VOLUME_MAX_IO_SIZE (128 * KiB)
+
+/* Simulated device shared by all volumes opened with the same uuid */
+struct flashsim_volume_dev {
+	struct list_head list;
+	char *uuid;
+	struct flashsim_dev *dev;
+	unsigned int refs;
+		/*!< Volumes having device open */
+};
+
+struct flashsim_volume {
+	struct flashsim_volume_dev *vdev;
+};
+
+struct flashsim_volume_io {
+	ctx_data_t *data;
+	uint32_t offset;
+	void *buffer;
+		/*!< Bounce buffer the simulated device reads and writes */
+};
+
+static const struct ocf_data_ops *flashsim_data_ops;
+
+/*
+ * Devices outlive the volumes which opened them, so that data written before
+ * cache is stopped is there when it is loaded again. They are destroyed when
+ * the volume type is unregistered.
+ */
+static struct {
+	env_mutex lock;
+	struct list_head devs;
+} flashsim_volume_devs;
+
+static inline struct flashsim_dev *flashsim_volume_dev(ocf_volume_t volume)
+{
+	struct flashsim_volume *fvolume = ocf_volume_get_priv(volume);
+
+	return fvolume->vdev->dev;
+}
+
+static void flashsim_volume_end(void *priv, int error, double completion_time)
+{
+	struct ocf_io *io = priv;
+	struct flashsim_volume_io *fio = ocf_io_get_priv(io);
+
+	if (!error && io->dir == OCF_READ) {
+		flashsim_data_ops->seek(fio->data, ctx_data_seek_begin,
+				fio->offset);
+		flashsim_data_ops->write(fio->data, fio->buffer, io->bytes);
+	}
+
+	env_free(fio->buffer);
+	fio->buffer = NULL;
+
+	io->end(io, error);
+}
+
+static void flashsim_volume_submit(struct ocf_io *io, enum flashsim_dir dir)
+{
+	struct flashsim_volume_io *fio = ocf_io_get_priv(io);
+	struct flashsim_dev *dev = flashsim_volume_dev(ocf_io_get_volume(io));
+	int result;
+
+	result = flashsim_submit(dev, dir, io->addr, io->bytes, fio->buffer,
+			flashsim_volume_end, io);
+	if (result) {
+		env_free(fio->buffer);
+		fio->buffer = NULL;
+		io->end(io, result);
+	}
+}
+
+static void flashsim_volume_submit_io(struct ocf_io *io)
+{
+	struct flashsim_volume_io *fio = ocf_io_get_priv(io);
+
+	fio->buffer = env_malloc(io->bytes, ENV_MEM_NOIO);
+	if (!fio->buffer) {
+		io->end(io, -OCF_ERR_NO_MEM);
+		return;
+	}
+
+	if (io->dir == OCF_WRITE) {
+		flashsim_data_ops->seek(fio->data, ctx_data_seek_begin,
+				fio->offset);
+		flashsim_data_ops->read(fio->buffer, fio->data, io->bytes);
+	}
+
+	flashsim_volume_submit(io, io->dir == OCF_WRITE ?
+			FLASHSIM_WRITE : FLASHSIM_READ);
+}
+
+static void flashsim_volume_submit_flush(struct ocf_io *io)
+{
+	struct flashsim_volume_io *fio = ocf_io_get_priv(io);
+
+	/* Completes once device write buffer is written back to flash */
+	fio->buffer = NULL;
+	flashsim_volume_submit(io, FLASHSIM_FLUSH);
+}
+
+static void flashsim_volume_submit_discard(struct ocf_io *io)
+{
+	struct flashsim_volume_io *fio = ocf_io_get_priv(io);
+
+	fio->buffer = NULL;
+	flashsim_volume_submit(io, FLASHSIM_TRIM);
+}
+
+static void flashsim_volume_submit_write_zeroes(struct ocf_io *io)
+{
+	struct flashsim_volume_io *fio = ocf_io_get_priv(io);
+
+	fio->buffer = env_zalloc(io->bytes, ENV_MEM_NOIO);
+	if (!fio->buffer) {
+		io->end(io, -OCF_ERR_NO_MEM);
+		return;
+	}
+
+	flashsim_volume_submit(io, FLASHSIM_WRITE);
+}
+
+static struct flashsim_volume_dev *flashsim_volume_dev_get(const char *uuid)
+{
+	struct flashsim_volume_dev *vdev;
+	size_t uuid_size = env_strnlen(uuid, OCF_VOLUME_UUID_MAX_SIZE) + 1;
+
+	list_for_each_entry(vdev, &flashsim_volume_devs.devs, list) {
+		if (!env_strncmp(vdev->uuid, uuid_size, uuid, uuid_size)) {
+			vdev->refs++;
+			return vdev;
+		}
+	}
+
+	vdev = env_zalloc(sizeof(*vdev) + uuid_size, ENV_MEM_NORMAL);
+	if (!vdev)
+		return NULL;
+
+	vdev->uuid = (char *)(vdev + 1);
+	env_strncpy(vdev->uuid, uuid_size, uuid, uuid_size);
+
+	vdev->dev = flashsim_open(uuid);
+	if (!vdev->dev) {
+		env_free(vdev);
+		return NULL;
+	}
+
+	vdev->refs = 1;
+	list_add_tail(&vdev->list, &flashsim_volume_devs.devs);
+
+	return vdev;
+}
+
+static int flashsim_volume_open(ocf_volume_t volume, void *volume_params)
+{
+	struct flashsim_volume *fvolume = ocf_volume_get_priv(volume);
+	const struct ocf_volume_uuid *uuid = ocf_volume_get_uuid(volume);
+
+	if (!uuid->data || !uuid->size)
+		return -OCF_ERR_INVAL;
+
+	env_mutex_lock(&flashsim_volume_devs.lock);
+	fvolume->vdev = flashsim_volume_dev_get(ocf_uuid_to_str(uuid));
+	env_mutex_unlock(&flashsim_volume_devs.lock);
+
+	if (!fvolume->vdev)
+		return -OCF_ERR_INVAL;
+
+	return 0;
+}
+
+static void flashsim_volume_close(ocf_volume_t volume)
+{
+	struct flashsim_volume *fvolume = ocf_volume_get_priv(volume);
+
+	env_mutex_lock(&flashsim_volume_devs.lock);
+	fvolume->vdev->refs--;
+	env_mutex_unlock(&flashsim_volume_devs.lock);
+
+	fvolume->vdev = NULL;
+}
+
+static void flashsim_volume_deinit(void)
+{
+	struct flashsim_volume_dev *vdev, *tmp;
+
+	list_for_each_entry_safe(vdev, tmp, &flashsim_volume_devs.devs, list) {
+		ENV_WARN_ON(vdev->refs);
+		list_del(&vdev->list);
+		flashsim_close(vdev->dev);
+		env_free(vdev);
+	}
+
+	env_mutex_destroy(&flashsim_volume_devs.lock);
+}
+
+static unsigned int flashsim_volume_get_max_io_size(ocf_volume_t volume)
+{
+	return FLASHSIM_VOLUME_MAX_IO_SIZE;
+}
+
+static uint64_t flashsim_volume_get_length(ocf_volume_t volume)
+{
+	return flashsim_get_capacity(flashsim_volume_dev(volume));
+}
+
+static int flashsim_volume_io_set_data(struct ocf_io *io, ctx_data_t *data,
+		uint32_t offset)
+{
+	struct flashsim_volume_io *fio = ocf_io_get_priv(io);
+
+	fio->data = data;
+	fio->offset = offset;
+
+	return 0;
+}
+
+static ctx_data_t *flashsim_volume_io_get_data(struct ocf_io *io)
+{
+	struct flashsim_volume_io *fio = ocf_io_get_priv(io);
+
+	return fio->data;
+}
+
+static const struct ocf_volume_properties flashsim_volume_properties = {
+	.name = "FlashSim",
+	.io_priv_size = sizeof(struct flashsim_volume_io),
+	.volume_priv_size = sizeof(struct flashsim_volume),
+	.caps = {
+		.atomic_writes = 0,
+	},
+	.ops = {
+		.submit_io = flashsim_volume_submit_io,
+		.submit_flush = flashsim_volume_submit_flush,
+		.submit_discard = flashsim_volume_submit_discard,
+		.submit_write_zeroes = flashsim_volume_submit_write_zeroes,
+		.submit_metadata = NULL,
+
+		.open = flashsim_volume_open,
+		.close = flashsim_volume_close,
+		.get_max_io_size = flashsim_volume_get_max_io_size,
+		.get_length = flashsim_volume_get_length,
+	},
+	.io_ops = {
+		.set_data = flashsim_volume_io_set_data,
+		.get_data = flashsim_volume_io_get_data,
+	},
+	.deinit = flashsim_volume_deinit,
+};
+
+int flashsim_volume_register(ocf_ctx_t ctx, uint8_t type_id,
+		const struct ocf_data_ops *data_ops)
+{
+	int result;
+
+	if (!data_ops)
+		return -OCF_ERR_INVAL;
+
+	flashsim_data_ops = data_ops;
+
+	result = env_mutex_init(&flashsim_volume_devs.lock);
+	if (result)
+		return result;
+
+	INIT_LIST_HEAD(&flashsim_volume_devs.devs);
+
+	result = ocf_ctx_register_volume_type(ctx, type_id,
+			&flashsim_volume_properties);
+	if (result)
+		env_mutex_destroy(&flashsim_volume_devs.lock);
+
+	return result;
+}
@@ -0,0 +1,38 @@
+/*
+ * Copyright(c) 2012-2020 Intel Corporation
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef __FLASHSIM_VOLUME_H__
+#define __FLASHSIM_VOLUME_H__
+
+/**
+ * @file
+ * @brief OCF volume type backed by an in-process FlashSim device
+ *
+ * The uuid of a volume of this type is the path of the FlashSim config file
+ * (ssd.conf format) describing the device. Volumes opened with the same uuid
+ * share one simulated device, which keeps its contents when the volumes are
+ * closed and is destroyed when the volume type is unregistered. I/Os complete
+ * from the FlashSim event loop at their simulated completion time, see
+ * flashsim_set_clock() in flashsim.h; a flush completes once the device write
+ * buffer is written back.
+ */
+
+#include <ocf/ocf.h>
+
+/**
+ * @brief Register the FlashSim volume type
+ *
+ * @param[in] ctx OCF context
+ * @param[in] type_id Volume type id to register under
+ * @param[in] data_ops Data ops the context was created with, used to copy
+ *		between I/O data and the simulated device
+ *
+ * @retval 0 Volume type registered
+ * @retval Non-zero Registration failure
+ */
+int flashsim_volume_register(ocf_ctx_t ctx, uint8_t type_id,
+		const struct ocf_data_ops *data_ops);
+
+#endif /* __FLASHSIM_VOLUME_H__ */
@@ -8,6 +8,7 @@
 
 #include <string>
 #include <iostream>
+#include <algorithm>
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -51,6 +52,9 @@ static const size_t REQ_HEADER_LENGTH = 24;
 
 static const int DIR_READ  = 0;
 static const int DIR_WRITE = 1;
+static const int DIR_STATS = 2;
+
+static const int STATS_FORMAT_CSV = 0;
 
 
 /**
@@ -172,4 +176,40 @@ main(int argc, char *argv[])
 
         printf("Read \"%s\" from SSD, took %lu us\n", data, time_used_us);
     }
+
+    /** Ask for the statistics time series, as CSV. */
+    {
+        struct req_header header;
+        int rbytes, wbytes;
+        uint64_t length;
+        std::string text;
+        char chunk[4096];
+
+        // Request header, the format goes in the address field.
+        header.direction = DIR_STATS;
+        header.addr = STATS_FORMAT_CSV;
+        header.size = 0;
+        header.start_time_us = 0;
+
+        wbytes = write(ssock, &header, REQ_HEADER_LENGTH);
+        if (wbytes != REQ_HEADER_LENGTH)
+            error("statistics request header send failed");
+
+        // Text length, then the text.
+        rbytes = read(ssock, &length, 8);
+        if (rbytes != 8)
+            error("statistics length recv failed");
+
+        while (text.size() < length) {
+            size_t want = std::min((size_t) (length - text.size()),
+                                   sizeof(chunk));
+
+            rbytes = read(ssock, chunk, want);
+            if (rbytes <= 0)
+                error("statistics recv failed");
+            text.append(chunk, rbytes);
+        }
+
+        printf("Statistics:\n%s", text.c_str());
+    }
 }
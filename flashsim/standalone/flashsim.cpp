@@ -13,6 +13,7 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <errno.h>
 #include <signal.h>
 #include <unistd.h>
 #include <sys/time.h>
@@ -29,33 +30,58 @@ using namespace ssd;
 static Ssd *ssd_handle;
 static std::string sock_name;
 static int ssock;
+static std::string restore_name;
+static std::string save_name;
+
+/** Set by Ctrl+C handler, checked by the request loops. */
+static volatile sig_atomic_t stop_requested = 0;
+
+/**
+ * SSD state may be saved only if it was not asked to be restored, or
+ * restoring succeeded, so that a failed restore does not overwrite the
+ * checkpoint with an empty device.
+ */
+static bool state_valid = false;
 
 
 /**
  * Helper functions.
  */
 static void
-clean_up(int signal)
+clean_up()
 {
-    std::cout << "Caught signal " << signal << std::endl;
-
     if (ssock >= 0)
         close(ssock);
 
     if (!sock_name.empty())
         unlink(sock_name.c_str());
 
-    if (ssd_handle != NULL)
+    if (ssd_handle != NULL) {
+        if (!save_name.empty() && state_valid) {
+            if (ssd_handle->save_checkpoint(save_name.c_str()) == SUCCESS)
+                std::cout << "SSD state SAVED to " << save_name << std::endl;
+            else
+                std::cerr << "ERROR: saving SSD state failed" << std::endl;
+        }
         delete ssd_handle;
+    }
 
     std::cout << "SSD simulator KILLED" << std::endl;
     exit(1);
 }
 
+static void
+handle_sigint(int signal)
+{
+    stop_requested = 1;
+}
+
 static void
 usage()
 {
-    std::cout << "Usage: ./flashsim SOCK_NAME [CONFIG_FILE]" << std::endl;
+    std::cout << "Usage: ./flashsim [-r RESTORE_FILE] [-s SAVE_FILE] SOCK_NAME [CONFIG_FILE]" << std::endl
+              << "  -r  restore the SSD state from a checkpoint at startup" << std::endl
+              << "  -s  save the SSD state to a checkpoint on Ctrl+C" << std::endl;
     exit(1);
 }
 
@@ -63,7 +89,7 @@ static void
 error(std::string msg)
 {
     std::cerr << "ERROR: " << msg << std::endl;
-    clean_up(SIGINT);
+    clean_up();
 }
 
 
@@ -83,6 +109,10 @@ static const size_t REQ_HEADER_LENGTH = 24;
 
 static const int DIR_READ  = 0;
 static const int DIR_WRITE = 1;
+static const int DIR_STATS = 2;
+
+static const int STATS_FORMAT_CSV  = 0;
+static const int STATS_FORMAT_JSON = 1;
 
 
 /**
@@ -136,6 +166,43 @@ process_read(ulong addr, uint size, double start_time_ms)
 }
 
 
+/**
+ * Process a statistics request: the time series of the device statistics
+ * (see STATS_WINDOW in the conf), as CSV or JSON text. The reply is a
+ * packet of length 8 holding the text length, followed by the text.
+ */
+static void
+process_stats(int csock, uint64_t format)
+{
+    char *text = NULL;
+    size_t length = 0;
+    uint64_t text_length;
+    FILE *stream;
+    int wbytes;
+
+    stream = open_memstream(&text, &length);
+    if (stream == NULL)
+        error("open_memstream() failed");
+
+    ssd_handle->write_time_series(stream, format == STATS_FORMAT_JSON
+                                          ? STATS_JSON : STATS_CSV);
+    fclose(stream);
+
+    text_length = length;
+    wbytes = write(csock, &text_length, 8);
+    if (wbytes != 8)
+        error("send back statistics length failed");
+
+    for (size_t sent = 0; sent < length; sent += wbytes) {
+        wbytes = write(csock, text + sent, length - sent);
+        if (wbytes <= 0)
+            error("send back statistics failed");
+    }
+
+    free(text);
+}
+
+
 /**
  * Open a server-side socket for clients to make requests.
  * We only allow one client connection at a time.
@@ -174,7 +241,7 @@ prepare_socket()
 static void
 request_loop(int csock)
 {
-    while (1) {
+    while (!stop_requested) {
         char buf[REQ_HEADER_LENGTH];
         int rbytes, wbytes;
 
@@ -184,6 +251,8 @@ request_loop(int csock)
 
         if (rbytes == 0) {
             break;
+        } else if (rbytes < 0 && errno == EINTR) {
+            continue;
         } else if (rbytes != REQ_HEADER_LENGTH) {
             error("request header wrong length");
         } else {
@@ -193,6 +262,15 @@ request_loop(int csock)
             double start_time_ms, time_used_ms;
             unsigned long time_used_us;
 
+            /**
+             * Statistics requests carry the format in the logical
+             * address field, the other fields are ignored.
+             */
+            if (header->direction == DIR_STATS) {
+                process_stats(csock, header->addr);
+                continue;
+            }
+
             if (header->size <= 0)
                 error("request header invalid size");
 
@@ -274,16 +352,30 @@ int
 main(int argc, char *argv[])
 {
     struct sigaction sigint_handler;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "r:s:")) != -1) {
+        switch (opt) {
+        case 'r':
+            restore_name = optarg;
+            break;
+        case 's':
+            save_name = optarg;
+            break;
+        default:
+            usage();
+        }
+    }
 
-    if (argc != 2 && argc != 3)
+    if (argc - optind != 1 && argc - optind != 2)
         usage();
 
-    sock_name = argv[1];
+    sock_name = argv[optind];
 
-    if (argc == 2)
+    if (argc - optind == 1)
         load_config();
     else
-        load_config(argv[2]);
+        load_config(argv[optind + 1]);
 
     /** Check that request header struct compiles to correct size. */
     if (sizeof(struct req_header) != REQ_HEADER_LENGTH)
@@ -297,12 +389,23 @@ main(int argc, char *argv[])
     ssd_handle = new Ssd();
     std::cout << "=== Create New SSD Simulator ===" << std::endl << std::endl;
 
+    /** Start from a preconditioned device if asked to. */
+    if (!restore_name.empty()) {
+        if (ssd_handle->load_checkpoint(restore_name.c_str()) == FAILURE)
+            error("restoring SSD state from " + restore_name + " failed");
+        std::cout << "SSD state RESTORED from " << restore_name << std::endl;
+    }
+    state_valid = true;
+
     /** Open server socket, bind, & listen. */
     prepare_socket();
     std::cout << "SSD simulator BOOTED" << std::endl;
 
-    /** Register Ctrl+C handler. */
-    sigint_handler.sa_handler = clean_up;
+    /**
+     * Register Ctrl+C handler. It only sets a flag, blocking calls are
+     * interrupted (no SA_RESTART) and the state is saved from main flow.
+     */
+    sigint_handler.sa_handler = handle_sigint;
     sigemptyset(&sigint_handler.sa_mask);
     sigint_handler.sa_flags = 0;
     sigaction(SIGINT, &sigint_handler, NULL);
@@ -311,12 +414,14 @@ main(int argc, char *argv[])
      * Wait for client connection. If running correctly, should only have
      * one client connecting and this connection should never fail.
      */
-    while (1) {
+    while (!stop_requested) {
         int csock = accept(ssock, NULL, NULL);
 
-        if (csock < 0)
+        if (csock < 0) {
+            if (errno == EINTR)
+                continue;
             error("accept() failed");
-        else {
+        } else {
             std::cout << "New connection ACCEPTED" << std::endl;
             request_loop(csock);
             std::cout << "Client connection ENDED" << std::endl;
@@ -325,6 +430,9 @@ main(int argc, char *argv[])
         close(csock);
     }
 
+    std::cout << "Caught signal " << SIGINT << std::endl;
+    clean_up();
+
     // Not reached.
     return 0;
 }
@@ -0,0 +1,740 @@
+/**
+ * FlashSim trace replay driver.
+ *
+ * Streams a block trace through a simulated SSD (or RAID of SSDs) and
+ * reports latency histograms, throughput over time, and GC & wear
+ * statistics. Supported trace formats:
+ *   - blkparse: default text output of `blkparse`, replaying one action
+ *               (queue `Q` by default) of each request
+ *   - fio:      fio iolog version 2 (no timestamps) or version 3
+ *               (nanosecond timestamps)
+ *   - bin:      compact binary format written by `-c`, see `bin_record`
+ *
+ * Traces are mapped with mmap and consumed ranges are dropped from memory
+ * as the replay goes on, so traces far larger than memory replay with a
+ * bounded footprint.
+ *
+ * Requests are replayed either open-loop, arriving at their (scaled) trace
+ * timestamps, or closed-loop, keeping a fixed number of requests
+ * outstanding and issuing the next one as soon as the earliest completes.
+ * Unit of time in the configuration file MUST BE in milliseconds (ms).
+ */
+
+
+#include <string>
+#include <vector>
+#include <queue>
+#include <functional>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "ssd.h"
+
+using namespace ssd;
+
+
+/**
+ * Helper functions.
+ */
+static void
+usage()
+{
+    std::cout << "Usage: ./replay [-f FORMAT] [-m MODE] [-q DEPTH] [-s QUEUES] [-a ACTION]" << std::endl
+              << "                [-x SCALE] [-w WINDOW_MS] [-t CSV_FILE] [-n COUNT] [-c BIN_FILE]" << std::endl
+              << "                [-R]" << std::endl
+              << "                TRACE_FILE [CONFIG_FILE]" << std::endl
+              << "  -f  trace format: blkparse, fio or bin (default: blkparse)" << std::endl
+              << "  -m  replay mode: open (trace timestamps) or closed (default: open)" << std::endl
+              << "  -q  requests outstanding in closed mode (default: 1)" << std::endl
+              << "  -s  submit round robin to QUEUES submission queues (see NVME_QUEUES," << std::endl
+              << "      default: 1)" << std::endl
+              << "  -a  blkparse action to replay, e.g. Q, D or C (default: Q)" << std::endl
+              << "  -x  multiply trace timestamps by SCALE (default: 1)" << std::endl
+              << "  -w  throughput window length in ms (default: 1000)" << std::endl
+              << "  -t  write throughput over time to CSV_FILE instead of stdout" << std::endl
+              << "  -n  replay at most COUNT requests" << std::endl
+              << "  -c  convert the trace to the binary format instead of replaying" << std::endl
+              << "  -R  replay on a RaidSsd instead of a single Ssd" << std::endl;
+    exit(1);
+}
+
+static void
+error(std::string msg)
+{
+    std::cerr << "ERROR: " << msg << std::endl;
+    exit(1);
+}
+
+
+/**
+ * One request of the trace, in bytes and milliseconds.
+ */
+struct trace_record {
+    double time_ms;
+    uint64_t offset;
+    uint32_t length;
+    enum event_type type;
+};
+
+/**
+ * Binary trace format: an 8-byte magic followed by fixed-size records.
+ * `op` is 0 for reads and 1 for writes, as in the socket protocol.
+ */
+static const char BIN_MAGIC[8] = {'F', 'S', 'T', 'R', 'A', 'C', 'E', '1'};
+
+struct __attribute__((__packed__)) bin_record {
+    uint64_t time_ns;
+    uint64_t offset;
+    uint32_t length;
+    uint32_t op;
+};
+
+static const int DIR_READ  = 0;
+static const int DIR_WRITE = 1;
+
+enum trace_format { FORMAT_BLKPARSE, FORMAT_FIO, FORMAT_BIN };
+
+
+/**
+ * Sequential reader over a memory-mapped trace file.
+ * Every `RELEASE_BYTES` consumed, the pages behind the read position are
+ * dropped from the mapping to keep memory use bounded.
+ */
+class trace_reader {
+public:
+    trace_reader(const char *file_name, enum trace_format format,
+                 char action);
+    ~trace_reader();
+
+    bool next(struct trace_record &record);
+    uint64_t get_skipped() const { return skipped; }
+
+private:
+    static const size_t RELEASE_BYTES = 64 << 20;
+    static const size_t MAX_LINE = 512;
+
+    bool next_line(char *line);
+    void release();
+    bool parse_blkparse(const char *line, struct trace_record &record);
+    bool parse_fio(const char *line, struct trace_record &record);
+
+    enum trace_format format;
+    char action;
+    int fio_version;
+
+    int fd;
+    const char *base;
+    size_t length;
+    size_t pos;
+    size_t released;
+    uint64_t skipped;
+};
+
+trace_reader::trace_reader(const char *file_name, enum trace_format format,
+                           char action)
+    : format(format), action(action), fio_version(0), base(NULL),
+      length(0), pos(0), released(0), skipped(0)
+{
+    struct stat st;
+
+    fd = open(file_name, O_RDONLY);
+    if (fd < 0)
+        error(std::string("cannot open trace ") + file_name);
+    if (fstat(fd, &st) != 0)
+        error(std::string("cannot stat trace ") + file_name);
+
+    length = st.st_size;
+    if (length > 0) {
+        base = (const char *) mmap(NULL, length, PROT_READ, MAP_PRIVATE,
+                                   fd, 0);
+        if (base == MAP_FAILED)
+            error(std::string("cannot mmap trace ") + file_name);
+        madvise((void *) base, length, MADV_SEQUENTIAL);
+    }
+
+    if (format == FORMAT_BIN) {
+        if (length < sizeof(BIN_MAGIC)
+            || memcmp(base, BIN_MAGIC, sizeof(BIN_MAGIC)) != 0)
+            error("not a binary FlashSim trace");
+        pos = sizeof(BIN_MAGIC);
+    } else if (format == FORMAT_FIO) {
+        char line[MAX_LINE];
+
+        if (!next_line(line) || sscanf(line, "fio version %d iolog",
+                                       &fio_version) != 1
+            || (fio_version != 2 && fio_version != 3))
+            error("not a fio version 2 or 3 iolog");
+    }
+}
+
+trace_reader::~trace_reader()
+{
+    if (base != NULL)
+        munmap((void *) base, length);
+    close(fd);
+}
+
+void
+trace_reader::release()
+{
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t upto = pos / page * page;
+
+    if (upto >= released + RELEASE_BYTES) {
+        madvise((void *) (base + released), upto - released, MADV_DONTNEED);
+        released = upto;
+    }
+}
+
+/**
+ * Copy the next line into `line`, truncating overlong lines.
+ */
+bool
+trace_reader::next_line(char *line)
+{
+    const char *start, *end;
+    size_t len;
+
+    if (pos >= length)
+        return false;
+
+    start = base + pos;
+    end = (const char *) memchr(start, '\n', length - pos);
+    if (end == NULL)
+        end = base + length;
+
+    len = end - start;
+    if (len > MAX_LINE - 1)
+        len = MAX_LINE - 1;
+    memcpy(line, start, len);
+    line[len] = '\0';
+
+    pos = end - base + 1;
+    release();
+    return true;
+}
+
+/**
+ * Default blkparse output, e.g.
+ *   8,0    3        1     0.000000000  697  Q   W 223490 + 8 [kjournald]
+ * Discards, flushes and other actions are skipped.
+ */
+bool
+trace_reader::parse_blkparse(const char *line, struct trace_record &record)
+{
+    char dev[32], act[8], rwbs[8];
+    unsigned int cpu, pid, sectors;
+    unsigned long seq, sector;
+    double time_s;
+
+    if (sscanf(line, "%31s %u %lu %lf %u %7s %7s %lu + %u", dev, &cpu, &seq,
+               &time_s, &pid, act, rwbs, &sector, &sectors) != 9)
+        return false;
+    if (act[0] != action || act[1] != '\0' || sectors == 0)
+        return false;
+    if (strchr(rwbs, 'D') != NULL)
+        return false;
+
+    if (strchr(rwbs, 'R') != NULL)
+        record.type = READ;
+    else if (strchr(rwbs, 'W') != NULL)
+        record.type = WRITE;
+    else
+        return false;
+
+    record.time_ms = time_s * 1000.0;
+    record.offset = (uint64_t) sector * 512;
+    record.length = sectors * 512;
+    return true;
+}
+
+/**
+ * fio iolog lines, `[TIMESTAMP] FILENAME ACTION OFFSET LENGTH`.
+ * Version 2 has no timestamps, so all requests arrive at time 0.
+ */
+bool
+trace_reader::parse_fio(const char *line, struct trace_record &record)
+{
+    char file[256], act[16];
+    unsigned long long time_ns = 0, offset;
+    unsigned int len;
+
+    if (fio_version == 3) {
+        if (sscanf(line, "%llu %255s %15s %llu %u", &time_ns, file, act,
+                   &offset, &len) != 5)
+            return false;
+    } else {
+        if (sscanf(line, "%255s %15s %llu %u", file, act, &offset,
+                   &len) != 4)
+            return false;
+    }
+
+    if (strcmp(act, "read") == 0)
+        record.type = READ;
+    else if (strcmp(act, "write") == 0)
+        record.type = WRITE;
+    else
+        return false;
+    if (len == 0)
+        return false;
+
+    record.time_ms = time_ns / 1000000.0;
+    record.offset = offset;
+    record.length = len;
+    return true;
+}
+
+/**
+ * Fetch the next replayable request. Lines that are not requests (headers,
+ * summaries, other actions) are skipped and counted.
+ */
+bool
+trace_reader::next(struct trace_record &record)
+{
+    if (format == FORMAT_BIN) {
+        while (pos + sizeof(struct bin_record) <= length) {
+            struct bin_record bin;
+
+            memcpy(&bin, base + pos, sizeof(bin));
+            pos += sizeof(bin);
+            release();
+
+            if (bin.length == 0 || bin.op > DIR_WRITE) {
+                skipped++;
+                continue;
+            }
+            record.time_ms = bin.time_ns / 1000000.0;
+            record.offset = bin.offset;
+            record.length = bin.length;
+            record.type = bin.op == DIR_READ ? READ : WRITE;
+            return true;
+        }
+        return false;
+    }
+
+    char line[MAX_LINE];
+
+    while (next_line(line)) {
+        bool parsed = format == FORMAT_BLKPARSE
+                      ? parse_blkparse(line, record)
+                      : parse_fio(line, record);
+        if (parsed)
+            return true;
+        if (line[0] != '\0')
+            skipped++;
+    }
+    return false;
+}
+
+
+/**
+ * Throughput accounting, by completion time.
+ */
+struct throughput_window {
+    uint64_t reads, writes;
+    uint64_t read_bytes, write_bytes;
+};
+
+
+/** Global options & results. */
+static enum trace_format format = FORMAT_BLKPARSE;
+static bool closed_loop = false;
+static uint queue_depth = 1;
+static uint submit_queues = 1;
+static char blk_action = 'Q';
+static double time_scale = 1.0;
+static double window_ms = 1000.0;
+static std::string csv_name;
+static uint64_t max_requests = 0;
+static std::string convert_name;
+static bool use_raid = false;
+
+static Latency_histogram read_latency, write_latency;
+static std::vector<struct throughput_window> windows;
+static uint64_t replayed, clipped;
+static double first_arrival_ms = -1, last_completion_ms;
+
+
+/**
+ * Map a byte range of the trace onto the logical pages of the device.
+ * Offsets wrap around the device size and requests larger than the device
+ * are clipped, so traces from larger devices still replay.
+ */
+static void
+map_record(const struct trace_record &record, Batch_request &request)
+{
+    ulong capacity = (ulong) NUMBER_OF_ADDRESSABLE_BLOCKS * BLOCK_SIZE;
+
+    /* RAID-0 spans whole stripe units of all members */
+    if (use_raid && PARALLELISM_MODE == 3)
+        capacity = capacity / RAID_STRIPE_UNIT * RAID_STRIPE_UNIT * RAID_NUMBER_OF_PHYSICAL_SSDS;
+    ulong first = record.offset / PAGE_SIZE;
+    ulong last = (record.offset + record.length - 1) / PAGE_SIZE;
+    ulong pages = last - first + 1;
+
+    if (pages > capacity) {
+        pages = capacity;
+        clipped++;
+    }
+    first %= capacity;
+    if (first + pages > capacity)
+        first = capacity - pages;
+
+    request.type = record.type;
+    request.logical_address = first;
+    request.size = pages;
+    request.buffer = NULL;
+}
+
+static void
+account(const Batch_request &request, double completion_ms)
+{
+    double latency_ms = completion_ms - request.start_time;
+    uint64_t bytes = (uint64_t) request.size * PAGE_SIZE;
+    size_t window;
+
+    if (request.type == READ)
+        read_latency.add(latency_ms);
+    else
+        write_latency.add(latency_ms);
+
+    if (first_arrival_ms < 0)
+        first_arrival_ms = request.start_time;
+    if (completion_ms > last_completion_ms)
+        last_completion_ms = completion_ms;
+
+    window = (size_t) ((completion_ms - first_arrival_ms) / window_ms);
+    if (window >= windows.size())
+        windows.resize(window + 1, throughput_window());
+    if (request.type == READ) {
+        windows[window].reads++;
+        windows[window].read_bytes += bytes;
+    } else {
+        windows[window].writes++;
+        windows[window].write_bytes += bytes;
+    }
+    replayed++;
+}
+
+
+/**
+ * Open loop: requests arrive at their trace timestamps regardless of how
+ * busy the device is, submitted in batches. Arrival times are kept
+ * non-decreasing, as traces merged from several CPUs may be slightly out
+ * of order.
+ */
+template <class Device>
+static void
+replay_open(Device &device, trace_reader &reader)
+{
+    static const uint BATCH_SIZE = 256;
+    std::vector<Batch_request> batch;
+    std::vector<double> completions(BATCH_SIZE);
+    struct trace_record record;
+    double trace_start = -1, last_arrival = 0;
+    uint64_t issued = 0;
+
+    batch.reserve(BATCH_SIZE);
+    while (true) {
+        bool more = (max_requests == 0 || issued < max_requests)
+                    && reader.next(record);
+
+        if (more) {
+            Batch_request request;
+
+            if (trace_start < 0)
+                trace_start = record.time_ms;
+            map_record(record, request);
+            request.start_time = std::max(last_arrival,
+                                          (record.time_ms - trace_start)
+                                          * time_scale);
+            last_arrival = request.start_time;
+            request.queue = issued % submit_queues;
+            batch.push_back(request);
+            issued++;
+        }
+
+        if (batch.size() == BATCH_SIZE || (!more && !batch.empty())) {
+            if (device.event_arrive_batch(&batch[0], batch.size(),
+                                          &completions[0]) == FAILURE)
+                error("replaying a batch failed");
+            for (size_t i = 0; i < batch.size(); i++)
+                account(batch[i], completions[i]);
+            batch.clear();
+        }
+
+        if (!more)
+            break;
+    }
+}
+
+/**
+ * Closed loop: keep `queue_depth` requests outstanding, ignoring the trace
+ * timestamps. A new request is issued when the earliest outstanding one
+ * completes.
+ */
+template <class Device>
+static void
+replay_closed(Device &device, trace_reader &reader)
+{
+    std::priority_queue<double, std::vector<double>,
+                        std::greater<double> > outstanding;
+    struct trace_record record;
+    double now = 0, completion;
+    uint64_t issued = 0;
+
+    while ((max_requests == 0 || issued < max_requests)
+           && reader.next(record)) {
+        Batch_request request;
+
+        if (outstanding.size() >= queue_depth) {
+            now = std::max(now, outstanding.top());
+            outstanding.pop();
+        }
+
+        map_record(record, request);
+        request.start_time = now;
+        request.queue = issued % submit_queues;
+        if (device.event_arrive_batch(&request, 1, &completion) == FAILURE)
+            error("replaying a request failed");
+
+        outstanding.push(completion);
+        account(request, completion);
+        issued++;
+    }
+}
+
+
+/**
+ * Write the requests of a trace out in the binary format.
+ */
+static void
+convert(trace_reader &reader)
+{
+    std::ofstream out(convert_name.c_str(), std::ios::binary);
+    struct trace_record record;
+    uint64_t converted = 0;
+
+    if (!out)
+        error("cannot create " + convert_name);
+
+    out.write(BIN_MAGIC, sizeof(BIN_MAGIC));
+    while ((max_requests == 0 || converted < max_requests)
+           && reader.next(record)) {
+        struct bin_record bin;
+
+        bin.time_ns = (uint64_t) (record.time_ms * 1000000.0 + 0.5);
+        bin.offset = record.offset;
+        bin.length = record.length;
+        bin.op = record.type == READ ? DIR_READ : DIR_WRITE;
+        out.write((const char *) &bin, sizeof(bin));
+        converted++;
+    }
+    if (!out)
+        error("writing " + convert_name + " failed");
+
+    std::cout << "Converted " << converted << " requests to "
+              << convert_name << " (" << reader.get_skipped()
+              << " lines skipped)" << std::endl;
+}
+
+
+/**
+ * Result reporting.
+ */
+static void
+print_latency(const char *name, const Latency_histogram &hist)
+{
+    std::cout << std::left << std::setw(7) << name << std::right
+              << std::setw(10) << hist.get_count();
+    if (hist.get_count() == 0) {
+        std::cout << std::endl;
+        return;
+    }
+    std::cout << std::fixed << std::setprecision(3)
+              << std::setw(10) << hist.get_mean()
+              << std::setw(10) << hist.percentile(50)
+              << std::setw(10) << hist.percentile(90)
+              << std::setw(10) << hist.percentile(99)
+              << std::setw(10) << hist.percentile(99.9)
+              << std::setw(10) << hist.get_max() << std::endl;
+}
+
+static void
+print_throughput(std::ostream &out)
+{
+    out << "time_ms,read_iops,write_iops,read_mbps,write_mbps" << std::endl;
+    for (size_t i = 0; i < windows.size(); i++) {
+        double seconds = window_ms / 1000.0;
+
+        out << std::fixed << std::setprecision(3) << i * window_ms << ","
+            << windows[i].reads / seconds << ","
+            << windows[i].writes / seconds << ","
+            << windows[i].read_bytes / seconds / 1e6 << ","
+            << windows[i].write_bytes / seconds / 1e6 << std::endl;
+    }
+}
+
+static void
+print_results(const trace_reader &reader)
+{
+    double span_ms = last_completion_ms - std::max(first_arrival_ms, 0.0);
+    uint64_t bytes = 0;
+
+    for (size_t i = 0; i < windows.size(); i++)
+        bytes += windows[i].read_bytes + windows[i].write_bytes;
+
+    std::cout << "=== Replay Results ===" << std::endl
+              << "Requests replayed: " << replayed
+              << "  Lines skipped: " << reader.get_skipped()
+              << "  Requests clipped: " << clipped << std::endl
+              << std::fixed << std::setprecision(3)
+              << "Simulated time: " << span_ms << " ms";
+    if (span_ms > 0)
+        std::cout << "  IOPS: " << replayed / (span_ms / 1000.0)
+                  << "  MB/s: " << bytes / (span_ms / 1000.0) / 1e6;
+    std::cout << std::endl << std::endl;
+
+    std::cout << "Latency (ms)    count      mean       p50       p90"
+              << "       p99     p99.9       max" << std::endl;
+    print_latency("read", read_latency);
+    print_latency("write", write_latency);
+    std::cout << std::endl;
+
+    std::cout << "Throughput over time (" << window_ms << " ms windows)";
+    if (!csv_name.empty()) {
+        std::ofstream csv(csv_name.c_str());
+
+        if (!csv)
+            error("cannot create " + csv_name);
+        print_throughput(csv);
+        std::cout << " written to " << csv_name << std::endl;
+    } else {
+        std::cout << ":" << std::endl;
+        print_throughput(std::cout);
+    }
+    std::cout << "=== Replay Results ===" << std::endl << std::endl;
+}
+
+template <class Device>
+static void
+replay(trace_reader &reader)
+{
+    std::cout << "=== Create New SSD Simulator ===" << std::endl;
+    Device *device = new Device();
+    std::cout << "=== Create New SSD Simulator ===" << std::endl << std::endl;
+
+    if (closed_loop)
+        replay_closed(*device, reader);
+    else
+        replay_open(*device, reader);
+
+    print_results(reader);
+    device->print_statistics();
+    device->print_wear_statistics();
+
+    delete device;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+    int opt;
+
+    while ((opt = getopt(argc, argv, "f:m:q:s:a:x:w:t:n:c:R")) != -1) {
+        switch (opt) {
+        case 'f':
+            if (strcmp(optarg, "blkparse") == 0)
+                format = FORMAT_BLKPARSE;
+            else if (strcmp(optarg, "fio") == 0)
+                format = FORMAT_FIO;
+            else if (strcmp(optarg, "bin") == 0)
+                format = FORMAT_BIN;
+            else
+                usage();
+            break;
+        case 'm':
+            if (strcmp(optarg, "open") == 0)
+                closed_loop = false;
+            else if (strcmp(optarg, "closed") == 0)
+                closed_loop = true;
+            else
+                usage();
+            break;
+        case 'q':
+            queue_depth = atoi(optarg);
+            if (queue_depth == 0)
+                usage();
+            break;
+        case 's':
+            submit_queues = atoi(optarg);
+            if (submit_queues == 0)
+                usage();
+            break;
+        case 'a':
+            blk_action = optarg[0];
+            break;
+        case 'x':
+            time_scale = atof(optarg);
+            if (time_scale <= 0)
+                usage();
+            break;
+        case 'w':
+            window_ms = atof(optarg);
+            if (window_ms <= 0)
+                usage();
+            break;
+        case 't':
+            csv_name = optarg;
+            break;
+        case 'n':
+            max_requests = strtoull(optarg, NULL, 10);
+            break;
+        case 'c':
+            convert_name = optarg;
+            break;
+        case 'R':
+            use_raid = true;
+            break;
+        default:
+            usage();
+        }
+    }
+
+    if (argc - optind != 1 && argc - optind != 2)
+        usage();
+
+    trace_reader reader(argv[optind], format, blk_action);
+
+    if (!convert_name.empty()) {
+        convert(reader);
+        return 0;
+    }
+
+    if (argc - optind == 1)
+        load_config();
+    else
+        load_config(argv[optind + 1]);
+
+    std::cout << "=== SSD Device Configuration ===" << std::endl;
+    print_config(NULL);
+    std::cout << "=== SSD Device Configuration ===" << std::endl << std::endl;
+
+    if (use_raid)
+        replay<RaidSsd>(reader);
+    else
+        replay<Ssd>(reader);
+
+    return 0;
+}
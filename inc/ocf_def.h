@@ -217,6 +217,10 @@ typedef enum {
 	ocf_eviction_lru = 0,
 		/*!< Last recently used eviction policy */
 
+	ocf_eviction_clock,
+		/*!< CLOCK eviction policy, keeps one reference bit per
+		 * cache line instead of LRU list pointers */
+
 	ocf_eviction_max,
 		/*!< Stopper of enumerator */
 
@@ -336,6 +340,9 @@ typedef enum {
 /** Maximum size of the IO class name */
 #define OCF_IO_CLASS_NAME_MAX 1024
 
+/** Maximum number of IO class LBA ranges per core */
+#define OCF_IO_CLASS_RANGES_MAX 65536
+
 /** IO class priority which indicates pinning */
 #define OCF_IO_CLASS_PRIO_PINNED -1
 
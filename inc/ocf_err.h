@@ -125,6 +125,9 @@ typedef enum {
 
 	/** Device does not meet requirements */
 	OCF_ERR_INVAL_CACHE_DEV,
+
+	/** Core device exceeds size supported by cache metadata */
+	OCF_ERR_CORE_SIZE_UNSUPPORTED,
 } ocf_error_t;
 
 #endif /* __OCF_ERR_H__ */
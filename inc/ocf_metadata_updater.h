@@ -12,6 +12,29 @@
  *
  */
 
+/**
+ * @brief Metadata updater statistics
+ */
+struct ocf_metadata_updater_stats {
+	uint64_t flush_requests;
+		/*!< User requests which flushed metadata */
+
+	uint64_t write_requests;
+		/*!< Metadata page range writes submitted to the updater */
+
+	uint64_t merged_writes;
+		/*!< Writes merged into a pending write of the same pages */
+
+	uint64_t write_ios;
+		/*!< Metadata write I/Os issued to the cache volume */
+
+	uint64_t lock_acquisitions;
+		/*!< Number of times the updater lock was taken */
+
+	uint64_t lock_held_ns;
+		/*!< Total time the updater lock was held */
+};
+
 /**
  * @brief Run metadata updater
  *
@@ -47,4 +70,15 @@ void *ocf_metadata_updater_get_priv(ocf_metadata_updater_t mu);
  */
 ocf_cache_t ocf_metadata_updater_get_cache(ocf_metadata_updater_t mu);
 
+/**
+ * @brief Get metadata updater statistics
+ *
+ * Metadata I/Os per user write is write_ios / flush_requests.
+ *
+ * @param[in] cache Cache instance
+ * @param[out] stats Metadata updater statistics
+ */
+void ocf_metadata_updater_get_stats(ocf_cache_t cache,
+		struct ocf_metadata_updater_stats *stats);
+
 #endif /* __OCF_METADATA_UPDATER_H__ */
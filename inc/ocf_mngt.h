@@ -416,6 +416,44 @@ struct ocf_mngt_cache_device_config
 	 */
 	bool discard_on_start;
 
+	/**
+	 * @brief If set, cache lines of each core are tracked in a per-core
+	 *		index, so that flush, purge and removal of a core visit
+	 *		only the lines of that core instead of whole collision
+	 *		table, and discard skips ranges with nothing cached
+	 *
+	 * @note The index takes 8 bytes of RAM per cache line and adds
+	 *       a per-core spinlock to every cache line mapping change.
+	 *       If not set, the index is not allocated and mapping changes
+	 *       do not touch it.
+	 */
+	bool core_line_index;
+
+	/**
+	 * @brief If set, metadata of newly initialized cache is initialized
+	 *		in background in chunks, and cache lines become
+	 *		available as their chunks get initialized. Attach
+	 *		completes without waiting for it. Ignored on load.
+	 *
+	 * @note Metadata is flushed to cache device once initialization
+	 *       completes. Until then cache can not be recovered after
+	 *       dirty shutdown.
+	 */
+	bool lazy_init;
+
+	/**
+	 * @brief If set, newly initialized cache uses compact metadata
+	 *		encoding: core id and core line of each cache line are
+	 *		packed into 6 bytes together with a reference bit of
+	 *		CLOCK eviction policy, which replaces LRU list pointers.
+	 *		Ignored on load, where encoding stored on cache device
+	 *		is used.
+	 *
+	 * @note Cores attached to compact metadata cache can not exceed
+	 *       2^34 - 1 cache lines (64 TiB with 4 KiB cache lines).
+	 */
+	bool compact_metadata;
+
 	/**
 	 * @brief Optional opaque volume parameters, passed down to cache volume
 	 * open callback
@@ -439,6 +477,9 @@ static inline void ocf_mngt_cache_device_config_set_default(
 	cfg->force = false;
 	cfg->perform_test = true;
 	cfg->discard_on_start = true;
+	cfg->core_line_index = false;
+	cfg->lazy_init = false;
+	cfg->compact_metadata = false;
 	cfg->volume_params = NULL;
 }
 
@@ -687,6 +728,87 @@ void ocf_mngt_core_purge(ocf_core_t core,
  */
 void ocf_mngt_cache_flush_interrupt(ocf_cache_t cache);
 
+/**
+ * @brief Flush throttling limits
+ *
+ * Limits are shared by all cores flushed by one cache or core flush
+ * operation and take effect immediately, also for flush in progress.
+ */
+struct ocf_mngt_flush_limits {
+	uint32_t max_inflight;
+		/*!< Maximum number of cache lines being written back to cores
+		 * at once, 0 for no limit */
+
+	uint64_t max_rate;
+		/*!< Maximum flush throughput in bytes per second,
+		 * 0 for no limit */
+};
+
+/**
+ * @brief Set flush throttling limits
+ *
+ * @param[in] cache Cache handle
+ * @param[in] limits Flush limits
+ *
+ * @retval 0 Limits have been set successfully
+ * @retval Non-zero Error occurred and limits have not been set
+ */
+int ocf_mngt_cache_set_flush_limits(ocf_cache_t cache,
+		const struct ocf_mngt_flush_limits *limits);
+
+/**
+ * @brief Get flush throttling limits
+ *
+ * @param[in] cache Cache handle
+ * @param[out] limits Flush limits
+ *
+ * @retval 0 Limits have been read successfully
+ * @retval Non-zero Error occurred
+ */
+int ocf_mngt_cache_get_flush_limits(ocf_cache_t cache,
+		struct ocf_mngt_flush_limits *limits);
+
+/**
+ * @brief Progress of cache or core flush operation
+ */
+struct ocf_mngt_flush_progress {
+	bool in_progress;
+		/*!< True if flush or purge operation is running */
+
+	uint64_t total_bytes;
+		/*!< Dirty data found at start of the operation */
+
+	uint64_t flushed_bytes;
+		/*!< Data already written back to cores */
+
+	uint64_t remaining_bytes;
+		/*!< Data still to be written back */
+
+	uint64_t rate;
+		/*!< Average flush throughput since start in bytes per second */
+
+	uint64_t elapsed;
+		/*!< Time since start of the operation in seconds */
+
+	uint64_t eta;
+		/*!< Estimated time to completion in seconds, 0 if unknown */
+};
+
+/**
+ * @brief Get progress of flush operation
+ *
+ * Can be called while flush is in progress. After the operation ends,
+ * progress of the last one is reported with in_progress set to false.
+ *
+ * @param[in] cache Cache handle
+ * @param[out] progress Flush progress
+ *
+ * @retval 0 Progress has been read successfully
+ * @retval Non-zero Error occurred
+ */
+int ocf_mngt_cache_get_flush_progress(ocf_cache_t cache,
+		struct ocf_mngt_flush_progress *progress);
+
 /**
  * @brief Completion callback of save operation
  *
@@ -898,6 +1020,61 @@ struct ocf_mngt_io_classes_config
 int ocf_mngt_cache_io_classes_configure(ocf_cache_t cache,
 										const struct ocf_mngt_io_classes_config *cfg);
 
+/**
+ * @brief IO class LBA range
+ */
+struct ocf_mngt_io_class_range
+{
+	/**
+	 * @brief First byte of range on core volume
+	 */
+	uint64_t start;
+
+	/**
+	 * @brief First byte past the range on core volume
+	 */
+	uint64_t end;
+
+	/**
+	 * @brief IO class ID assigned to I/O starting within the range
+	 */
+	uint32_t class_id;
+};
+
+/**
+ * @brief Classify I/O to given core by its start address
+ *
+ * I/O starting within one of the ranges is assigned IO class of that range,
+ * regardless of IO class supplied by its submitter. I/O starting outside of
+ * all ranges keeps its own IO class. Ranges replace previously set ones at
+ * once, I/O in flight is classified either by old or by new set of ranges.
+ *
+ * @attention This changes only runtime state. Ranges are not stored in
+ *            metadata and are dropped when core is removed.
+ *
+ * @param[in] core Core handle
+ * @param[in] ranges Array of non overlapping ranges, in any order
+ * @param[in] count Number of ranges, up to OCF_IO_CLASS_RANGES_MAX,
+ *		zero removes all ranges
+ *
+ * @retval 0 Ranges have been set successfully
+ * @retval Non-zero Error occurred and ranges have not been changed
+ */
+int ocf_mngt_core_set_io_class_ranges(ocf_core_t core,
+		const struct ocf_mngt_io_class_range *ranges, uint32_t count);
+
+/**
+ * @brief Get number of IO class LBA ranges set for given core
+ *
+ * @param[in] core Core handle
+ * @param[out] count Number of ranges
+ *
+ * @retval 0 Number of ranges has been retrieved successfully
+ * @retval Non-zero Error occurred
+ */
+int ocf_mngt_core_get_io_class_ranges_count(ocf_core_t core,
+		uint32_t *count);
+
 /**
  * @brief Asociate new UUID value with given core
  *
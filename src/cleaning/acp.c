@@ -250,6 +250,13 @@ static void _acp_rebuild(struct ocf_cache *cache)
 	ocf_core_id_t cline_core_id;
 	uint32_t step = 0;
 
+	/* No line is mapped before lazy initialization adds any to freelist */
+	if (ocf_lazy_init_pending(cache->lazy_init) ==
+			cache->device->collision_table_entries) {
+		return;
+	}
+	ocf_lazy_init_complete(cache->lazy_init);
+
 	for (cline = 0; cline < cache->device->collision_table_entries; cline++) {
 		ocf_metadata_get_core_and_part_id(cache, cline, &cline_core_id,
 				NULL);
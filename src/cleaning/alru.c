@@ -350,6 +350,14 @@ int cleaning_policy_alru_purge_range(struct ocf_cache *cache, int core_id,
 	ocf_part_id_t part_id;
 	int ret = 0;
 
+	/* Lines of all partitions are visited in one pass over core index */
+	if (core_id != OCF_CORE_ID_INVALID &&
+			ocf_core_index_active(cache->core_index)) {
+		return ocf_metadata_actor(cache, PARTITION_INVALID,
+				core_id, start_byte, end_byte,
+				__cleaning_policy_alru_purge_cache_block_any);
+	}
+
 	for_each_part(cache, part, part_id) {
 		if (env_atomic_read(&part->runtime->cleaning.
 				policy.alru.size) == 0)
@@ -415,6 +423,13 @@ static void _alru_rebuild(struct ocf_cache *cache)
 		cache->device->runtime_meta->cleaning_thread_access = 0;
 	}
 
+	/* No line is mapped before lazy initialization adds any to freelist */
+	if (ocf_lazy_init_pending(cache->lazy_init) ==
+			cache->device->collision_table_entries) {
+		return;
+	}
+	ocf_lazy_init_complete(cache->lazy_init);
+
 	for (cline = 0; cline < cache->device->collision_table_entries; cline++) {
 		ocf_metadata_get_core_and_part_id(cache, cline, &core_id,
 				NULL);
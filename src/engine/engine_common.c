@@ -243,16 +243,45 @@ int ocf_engine_check(struct ocf_request *req)
 	return result;
 }
 
+/* Cache lines taken from freelist at once when mapping a request */
+#define OCF_ENGINE_MAP_BATCH 64
+
+struct ocf_engine_map_lines {
+	ocf_cache_line_t line[OCF_ENGINE_MAP_BATCH];
+	uint32_t count;
+	uint32_t next;
+	uint32_t remaining;
+};
+
+static bool ocf_engine_map_get_cache_line(struct ocf_cache *cache,
+		struct ocf_engine_map_lines *lines, ocf_cache_line_t *cache_line)
+{
+	if (lines->next == lines->count) {
+		lines->count = ocf_freelist_get_cache_lines(cache->freelist,
+				lines->line, OCF_MIN(OCF_MAX(lines->remaining, 1),
+						OCF_ENGINE_MAP_BATCH));
+		lines->next = 0;
+		if (!lines->count)
+			return false;
+	}
+
+	*cache_line = lines->line[lines->next++];
+	if (lines->remaining)
+		lines->remaining--;
+
+	return true;
+}
+
 static void ocf_engine_map_cache_line(struct ocf_request *req,
 		uint64_t core_line, unsigned int hash_index,
-		ocf_cache_line_t *cache_line)
+		struct ocf_engine_map_lines *lines, ocf_cache_line_t *cache_line)
 {
 	struct ocf_cache *cache = req->cache;
 	ocf_core_id_t core_id = ocf_core_get_id(req->core);
 	ocf_part_id_t part_id = req->part_id;
 	ocf_cleaning_t clean_policy_type;
 
-	if (!ocf_freelist_get_cache_line(cache->freelist, cache_line)) {
+	if (!ocf_engine_map_get_cache_line(cache, lines, cache_line)) {
 		req->info.mapping_error = 1;
 		return;
 	}
@@ -325,16 +354,28 @@ static void ocf_engine_map(struct ocf_request *req)
 	uint64_t core_line;
 	int status = LOOKUP_MAPPED;
 	ocf_core_id_t core_id = ocf_core_get_id(req->core);
+	struct ocf_engine_map_lines lines;
+	ocf_cache_line_t free;
 
 	if (!ocf_engine_unmapped_count(req))
 		return;
 
-	if (ocf_engine_unmapped_count(req) >
-			ocf_freelist_num_free(cache->freelist)) {
+	free = ocf_freelist_num_free(cache->freelist);
+	if (ocf_engine_unmapped_count(req) > free) {
+		/* Initialize more lines rather than evict, if possible */
+		free += ocf_lazy_init_on_demand(cache->lazy_init,
+				ocf_engine_unmapped_count(req) - free);
+	}
+
+	if (ocf_engine_unmapped_count(req) > free) {
 		req->info.mapping_error = 1;
 		return;
 	}
 
+	lines.count = 0;
+	lines.next = 0;
+	lines.remaining = ocf_engine_unmapped_count(req);
+
 	ocf_req_clear_info(req);
 	req->info.seq_req = true;
 
@@ -348,7 +389,7 @@ static void ocf_engine_map(struct ocf_request *req)
 
 		if (entry->status != LOOKUP_HIT) {
 			ocf_engine_map_cache_line(req, entry->core_line,
-					entry->hash, &entry->coll_idx);
+					entry->hash, &lines, &entry->coll_idx);
 
 			if (req->info.mapping_error) {
 				/*
@@ -372,6 +413,13 @@ static void ocf_engine_map(struct ocf_request *req)
 
 	}
 
+	/* Return lines got in advance for entries found mapped meanwhile
+	 * or not reached due to mapping error */
+	if (lines.next < lines.count) {
+		ocf_freelist_put_cache_lines(cache->freelist,
+				&lines.line[lines.next], lines.count - lines.next);
+	}
+
 	if (!req->info.mapping_error) {
 		/* request has been inserted into cache - purge it from promotion
 		 * policy */
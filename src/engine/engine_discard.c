@@ -12,12 +12,17 @@
 #include "../utils/utils_io.h"
 #include "../utils/utils_cache_line.h"
 #include "../concurrency/ocf_concurrency.h"
+#include "../ocf_queue_priv.h"
+#include "../ocf_core_index.h"
 
 #define OCF_ENGINE_DEBUG 0
 
 #define OCF_ENGINE_DEBUG_IO_NAME "discard"
 #include "engine_debug.h"
 
+/* Number of discard steps processed concurrently for one request */
+#define OCF_DISCARD_WORKERS 4
+
 static int _ocf_discard_step_do(struct ocf_request *req);
 static int _ocf_discard_step(struct ocf_request *req);
 static int _ocf_discard_flush_cache(struct ocf_request *req);
@@ -45,6 +50,17 @@ static const struct ocf_io_if _io_if_discard_core = {
 
 static void _ocf_discard_complete_req(struct ocf_request *req, int error)
 {
+	uint64_t time = env_get_tick_count() - req->discard.start_time;
+
+	ocf_core_stats_discard_update(req->core,
+			SECTORS_TO_BYTES(req->discard.nr_sects),
+			SECTORS_TO_BYTES(env_atomic64_read(&req->discard.skipped)),
+			env_atomic64_read(&req->discard.invalidated),
+			env_ticks_to_nsecs(time));
+
+	env_free(req->discard.core_lines);
+	req->discard.core_lines = NULL;
+
 	req->complete(req, error);
 
 	ocf_req_put(req);
@@ -122,16 +138,47 @@ static int _ocf_discard_flush_cache(struct ocf_request *req)
 	return 0;
 }
 
-static void _ocf_discard_finish_step(struct ocf_request *req)
+static void _ocf_discard_finish(struct ocf_request *req)
 {
-	req->discard.handled += BYTES_TO_SECTORS(req->byte_length);
+	int error = env_atomic_read(&req->discard.error);
 
-	if (req->discard.handled < req->discard.nr_sects)
-		req->io_if = &_io_if_discard_step;
-	else if (req->cache->device->init_mode != ocf_init_mode_metadata_volatile)
+	if (error) {
+		_ocf_discard_complete_req(req, error);
+		return;
+	}
+
+	/* Cache device needs to be flushed only if metadata was updated */
+	if (env_atomic64_read(&req->discard.invalidated) &&
+			req->cache->device->init_mode !=
+					ocf_init_mode_metadata_volatile) {
 		req->io_if = &_io_if_discard_flush_cache;
-	else
+	} else {
 		req->io_if = &_io_if_discard_core;
+	}
+
+	ocf_engine_push_req_front(req, true);
+}
+
+static void _ocf_discard_worker_end(struct ocf_request *req)
+{
+	struct ocf_request *master = req->discard.parent;
+
+	/* Workers may end concurrently, only first error is kept */
+	if (req->error)
+		env_atomic_cmpxchg(&master->discard.error, 0, req->error);
+
+	if (req != master)
+		ocf_req_put(req);
+
+	if (env_atomic_dec_return(&master->discard.workers))
+		return;
+
+	_ocf_discard_finish(master);
+}
+
+static void _ocf_discard_finish_step(struct ocf_request *req)
+{
+	req->io_if = &_io_if_discard_step;
 
 	ocf_engine_push_req_front(req, true);
 }
@@ -151,7 +198,7 @@ static void _ocf_discard_step_complete(struct ocf_request *req, int error)
 
 	if (req->error) {
 		ocf_metadata_error(req->cache);
-		_ocf_discard_complete_req(req, req->error);
+		_ocf_discard_worker_end(req);
 		return;
 	}
 
@@ -161,13 +208,15 @@ static void _ocf_discard_step_complete(struct ocf_request *req, int error)
 int _ocf_discard_step_do(struct ocf_request *req)
 {
 	struct ocf_cache *cache = req->cache;
+	uint32_t mapped;
 
 	/* Get OCF request - increase reference counter */
 	ocf_req_get(req);
 
 	env_atomic_set(&req->req_remaining, 1); /* One core IO */
 
-	if (ocf_engine_mapped_count(req)) {
+	mapped = ocf_engine_mapped_count(req);
+	if (mapped) {
 		/* There are mapped cache line, need to remove them */
 
 		ocf_req_hash_lock_wr(req);
@@ -177,11 +226,15 @@ int _ocf_discard_step_do(struct ocf_request *req)
 
 		if (req->info.flush_metadata) {
 			/* Request was dirty and need to flush metadata */
+			env_atomic_inc(&req->req_remaining);
 			ocf_metadata_flush_do_asynch(cache, req,
 					_ocf_discard_step_complete);
 		}
 
 		ocf_req_hash_unlock_wr(req);
+
+		env_atomic64_add(mapped,
+				&req->discard.parent->discard.invalidated);
 	}
 
 	ocf_req_hash_lock_rd(req);
@@ -207,6 +260,148 @@ static void _ocf_discard_on_resume(struct ocf_request *req)
 	ocf_engine_push_req_front(req, true);
 }
 
+static int _ocf_discard_core_line_cmp(const void *a, const void *b)
+{
+	const uint64_t *l = a, *r = b;
+
+	if (*l < *r)
+		return -1;
+
+	return *l > *r;
+}
+
+/*
+ * Collect mapped core lines of the range from the list of the core, when
+ * the core has fewer cache lines than the range has core lines. Lines
+ * mapped in the range after this are not discarded, as if they were
+ * written after the discard.
+ */
+static void _ocf_discard_collect_lines(struct ocf_request *req)
+{
+	struct ocf_cache *cache = req->cache;
+	ocf_core_id_t core_id = ocf_core_get_id(req->core);
+	uint64_t core_line_first, core_line_last;
+	uint64_t count, found;
+	uint64_t *core_lines;
+
+	req->discard.core_lines = NULL;
+	req->discard.core_lines_count = 0;
+
+	if (!ocf_core_index_active(cache->core_index))
+		return;
+
+	core_line_first = ocf_bytes_2_lines(cache,
+			SECTORS_TO_BYTES(req->discard.sector));
+	core_line_last = ocf_bytes_2_lines(cache, SECTORS_TO_BYTES(
+			req->discard.sector + req->discard.nr_sects) - 1);
+
+	count = ocf_core_index_count(cache->core_index, core_id);
+	if (count > core_line_last - core_line_first)
+		return;
+
+	core_lines = env_malloc(sizeof(*core_lines) * OCF_MAX(count, 1),
+			ENV_MEM_NOIO);
+	if (!core_lines)
+		return;
+
+	found = ocf_core_index_collect(cache->core_index, core_id,
+			core_line_first, core_line_last, core_lines, count);
+	if (found > count) {
+		/* Lines were mapped meanwhile, look up regions instead */
+		env_free(core_lines);
+		return;
+	}
+
+	env_sort(core_lines, found, sizeof(*core_lines),
+			_ocf_discard_core_line_cmp, NULL);
+
+	req->discard.core_lines = core_lines;
+	req->discard.core_lines_count = found;
+}
+
+/*
+ * Returns first core line from given range that is mapped, or lies in
+ * a region with mapped lines if they were not collected, or
+ * core_line_last + 1 if there is none
+ */
+static uint64_t _ocf_discard_next_mapped(struct ocf_request *master,
+		uint64_t core_line, uint64_t core_line_last)
+{
+	uint64_t *core_lines = master->discard.core_lines;
+	uint64_t left = 0, right = master->discard.core_lines_count, mid;
+
+	if (!core_lines) {
+		return ocf_core_index_next_mapped(master->cache->core_index,
+				ocf_core_get_id(master->core), core_line,
+				core_line_last);
+	}
+
+	while (left < right) {
+		mid = left + (right - left) / 2;
+		if (core_lines[mid] < core_line)
+			left = mid + 1;
+		else
+			right = mid;
+	}
+
+	if (left == master->discard.core_lines_count ||
+			core_lines[left] > core_line_last) {
+		return core_line_last + 1;
+	}
+
+	return core_lines[left];
+}
+
+/*
+ * Claim next step of the discarded range. Step starts at the next mapped
+ * core line, found without looking up core lines in which nothing is
+ * cached. Returns false if the whole range has been claimed already.
+ */
+static bool _ocf_discard_claim_step(struct ocf_request *req)
+{
+	struct ocf_request *master = req->discard.parent;
+	struct ocf_cache *cache = req->cache;
+	sector_t nr_sects = master->discard.nr_sects;
+	sector_t curr, start, end;
+	uint64_t core_line, core_line_last, next_line;
+
+	core_line_last = ocf_bytes_2_lines(cache, SECTORS_TO_BYTES(
+			master->discard.sector + nr_sects) - 1);
+
+	do {
+		curr = env_atomic64_read(&master->discard.next);
+		if (curr >= nr_sects)
+			return false;
+
+		start = curr;
+		core_line = ocf_bytes_2_lines(cache, SECTORS_TO_BYTES(
+				master->discard.sector + curr));
+		next_line = _ocf_discard_next_mapped(master, core_line,
+				core_line_last);
+		if (next_line > core_line_last) {
+			start = nr_sects;
+		} else if (next_line > core_line) {
+			start = BYTES_TO_SECTORS(ocf_lines_2_bytes(cache,
+					next_line)) - master->discard.sector;
+		}
+
+		end = OCF_MIN(nr_sects, start +
+				BYTES_TO_SECTORS(MAX_TRIM_RQ_SIZE));
+	} while (env_atomic64_cmpxchg(&master->discard.next, curr, end) !=
+			curr);
+
+	if (start > curr)
+		env_atomic64_add(start - curr, &master->discard.skipped);
+
+	if (start == end)
+		return false;
+
+	req->byte_position = SECTORS_TO_BYTES(master->discard.sector + start);
+	req->byte_length = SECTORS_TO_BYTES(end - start);
+
+	return true;
+}
+
 static int _ocf_discard_step(struct ocf_request *req)
 {
 	int lock;
@@ -214,16 +409,19 @@ static int _ocf_discard_step(struct ocf_request *req)
 
 	OCF_DEBUG_TRACE(req->cache);
 
-	req->byte_position = SECTORS_TO_BYTES(req->discard.sector +
-			req->discard.handled);
-	req->byte_length = OCF_MIN(SECTORS_TO_BYTES(req->discard.nr_sects -
-			req->discard.handled), MAX_TRIM_RQ_SIZE);
+	if (env_atomic_read(&req->discard.parent->discard.error) ||
+			!_ocf_discard_claim_step(req)) {
+		_ocf_discard_worker_end(req);
+		return 0;
+	}
+
 	req->core_line_first = ocf_bytes_2_lines(cache, req->byte_position);
 	req->core_line_last =
 		ocf_bytes_2_lines(cache, req->byte_position + req->byte_length - 1);
 	req->core_line_count = req->core_line_last - req->core_line_first + 1;
 	req->io_if = &_io_if_discard_step_resume;
 
+	ENV_BUG_ON(req->core_line_count > req->alloc_core_line_count);
 	ENV_BUG_ON(env_memset(req->map, sizeof(*req->map) * req->core_line_count,
 			0));
 
@@ -252,7 +450,7 @@ static int _ocf_discard_step(struct ocf_request *req)
 	} else {
 		OCF_DEBUG_RQ(req, "LOCK ERROR %d", lock);
 		req->error |= lock;
-		_ocf_discard_finish_step(req);
+		_ocf_discard_worker_end(req);
 	}
 
 	env_cond_resched();
@@ -260,6 +458,60 @@ static int _ocf_discard_step(struct ocf_request *req)
 	return 0;
 }
 
+/* Next I/O queue of the cache after given one, wrapping around */
+static ocf_queue_t _ocf_discard_next_queue(ocf_cache_t cache,
+		ocf_queue_t queue)
+{
+	ocf_queue_t next = queue;
+
+	do {
+		next = list_entry(next->list.next, struct ocf_queue, list);
+		if (&next->list == &cache->io_queues)
+			continue;
+		if (next != cache->mngt_queue)
+			return next;
+	} while (next != queue);
+
+	return queue;
+}
+
+/*
+ * Start additional step workers, each with its own request and map, so
+ * that steps of a large discard are processed concurrently. Workers are
+ * spread over I/O queues of the cache, starting from the one after the
+ * queue of the discard.
+ */
+static void _ocf_discard_start_workers(struct ocf_request *req)
+{
+	sector_t step = BYTES_TO_SECTORS(MAX_TRIM_RQ_SIZE);
+	uint32_t workers = OCF_MIN(OCF_DISCARD_WORKERS,
+			OCF_DIV_ROUND_UP(req->discard.nr_sects, step));
+	ocf_queue_t queue = req->io_queue;
+	struct ocf_request *worker;
+	uint32_t i;
+
+	for (i = 1; i < workers; i++) {
+		queue = _ocf_discard_next_queue(req->cache, queue);
+		worker = ocf_req_new_discard(queue, req->core,
+				SECTORS_TO_BYTES(req->discard.sector),
+				SECTORS_TO_BYTES(req->discard.nr_sects),
+				OCF_WRITE);
+		if (!worker)
+			break;
+
+		if (worker->d2c) {
+			ocf_req_put(worker);
+			break;
+		}
+
+		worker->discard.parent = req;
+		worker->io_if = &_io_if_discard_step;
+
+		env_atomic_inc(&req->discard.workers);
+		ocf_engine_push_req_front(worker, true);
+	}
+}
+
 int ocf_discard(struct ocf_request *req)
 {
 	OCF_DEBUG_TRACE(req->cache);
@@ -275,6 +527,18 @@ int ocf_discard(struct ocf_request *req)
 	/* Get OCF request - increase reference counter */
 	ocf_req_get(req);
 
+	req->discard.parent = req;
+	req->discard.start_time = env_get_tick_count();
+	env_atomic64_set(&req->discard.next, 0);
+	env_atomic64_set(&req->discard.skipped, 0);
+	env_atomic64_set(&req->discard.invalidated, 0);
+	env_atomic_set(&req->discard.error, 0);
+	_ocf_discard_collect_lines(req);
+
+	/* The request itself is the first step worker */
+	env_atomic_set(&req->discard.workers, 1);
+	_ocf_discard_start_workers(req);
+
 	_ocf_discard_step(req);
 
 	/* Put OCF request - decrease reference counter */
@@ -0,0 +1,222 @@
+/*
+ * Copyright(c) 2020 Intel Corporation
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include "eviction.h"
+#include "clock.h"
+#include "ops.h"
+#include "../utils/utils_cleaner.h"
+#include "../utils/utils_cache_line.h"
+#include "../concurrency/ocf_concurrency.h"
+#include "../mngt/ocf_mngt_common.h"
+#include "../ocf_request.h"
+
+/* Maximal number of dirty cache lines passed to cleaner at once */
+#define OCF_EVICTION_CLOCK_CLEAN_MAX 32
+
+/*
+ * Maximal number of cache lines visited by clock hand in one call. Scan is
+ * done under metadata lock, so when most lines are referenced or dirty it
+ * stops early and returns less lines than requested. Hand position is kept,
+ * so next call continues where this one stopped. Partitions smaller than
+ * half of this limit are swept twice instead.
+ */
+#define OCF_EVICTION_CLOCK_SCAN_MAX 4096
+
+/*
+ * CLOCK keeps single reference bit per cache line instead of LRU list
+ * pointers. Clock hand of each partition sweeps lines of partition list,
+ * clearing reference bits and evicting first clean line which was not
+ * referenced since previous sweep. Dirty lines found on the way are passed
+ * to cleaner.
+ */
+
+struct evp_clock_clean_ctx {
+	ocf_cache_line_t lines[OCF_EVICTION_CLOCK_CLEAN_MAX];
+	uint32_t count;
+};
+
+static void evp_clock_set_referenced(ocf_cache_t cache,
+		ocf_cache_line_t cline, uint8_t referenced)
+{
+	union eviction_policy_meta eviction = {
+		.clock.referenced = referenced,
+	};
+
+	ocf_metadata_set_evicition_policy(cache, cline, &eviction);
+}
+
+void evp_clock_init_cline(ocf_cache_t cache, ocf_cache_line_t cline)
+{
+	evp_clock_set_referenced(cache, cline, 0);
+}
+
+/* the caller must hold the metadata lock */
+void evp_clock_rm_cline(ocf_cache_t cache, ocf_cache_line_t cline)
+{
+	evp_clock_set_referenced(cache, cline, 0);
+}
+
+/* the caller must hold the metadata lock */
+void evp_clock_hot_cline(ocf_cache_t cache, ocf_cache_line_t cline)
+{
+	evp_clock_set_referenced(cache, cline, 1);
+}
+
+void evp_clock_init_evp(ocf_cache_t cache, ocf_part_id_t part_id)
+{
+	struct ocf_user_part *part = &cache->user_parts[part_id];
+
+	part->runtime->eviction.policy.clock.hand =
+			cache->device->collision_table_entries;
+}
+
+static void evp_clock_clean_end(void *private_data, int error)
+{
+	struct ocf_refcnt *counter = private_data;
+
+	ocf_refcnt_dec(counter);
+}
+
+static int evp_clock_clean_getter(ocf_cache_t cache,
+		void *getter_context, uint32_t item, ocf_cache_line_t *line)
+{
+	struct evp_clock_clean_ctx *ctx = getter_context;
+
+	if (item >= ctx->count)
+		return -1;
+
+	*line = ctx->lines[item];
+	return 0;
+}
+
+static void evp_clock_clean(ocf_cache_t cache, ocf_queue_t io_queue,
+		ocf_part_id_t part_id, struct evp_clock_clean_ctx *ctx)
+{
+	struct ocf_refcnt *counter = &cache->refcnt.cleaning[part_id];
+	struct ocf_cleaner_attribs attribs = {
+		.cache_line_lock = true,
+		.do_sort = true,
+
+		.cmpl_context = counter,
+		.cmpl_fn = evp_clock_clean_end,
+
+		.getter = evp_clock_clean_getter,
+		.getter_context = ctx,
+
+		.count = ctx->count,
+
+		.io_queue = io_queue
+	};
+	int cnt;
+
+	if (ocf_mngt_cache_is_locked(cache))
+		return;
+
+	cnt = ocf_refcnt_inc(counter);
+	if (!cnt) {
+		/* cleaner disabled by management operation */
+		return;
+	}
+	if (cnt > 1) {
+		/* cleaning already running for this partition */
+		ocf_refcnt_dec(counter);
+		return;
+	}
+
+	/* Cache lines are collected by getter before fire returns */
+	ocf_cleaner_fire(cache, &attribs);
+}
+
+static inline bool evp_clock_can_evict(ocf_cache_t cache)
+{
+	return env_atomic_read(&cache->pending_eviction_clines) <
+			OCF_PENDING_EVICTION_LIMIT;
+}
+
+static void evp_clock_evict_line(ocf_cache_t cache, ocf_queue_t io_queue,
+		ocf_cache_line_t cline)
+{
+	if (ocf_volume_is_atomic(&cache->device->volume)) {
+		/* atomic cache, we have to trim cache lines before
+		 * eviction
+		 */
+		evp_lru_zero_line(cache, io_queue, cline);
+		return;
+	}
+
+	ocf_metadata_start_collision_shared_access(cache, cline);
+	set_cache_line_invalid_no_flush(cache, 0, ocf_line_end_sector(cache),
+			cline);
+	ocf_metadata_end_collision_shared_access(cache, cline);
+}
+
+/* the caller must hold the metadata lock */
+uint32_t evp_clock_req_clines(ocf_cache_t cache, ocf_queue_t io_queue,
+		ocf_part_id_t part_id, uint32_t cline_no)
+{
+	struct ocf_user_part *part = &cache->user_parts[part_id];
+	ocf_cache_line_t entries = cache->device->collision_table_entries;
+	ocf_cache_line_t cline = part->runtime->eviction.policy.clock.hand;
+	ocf_cache_line_t next;
+	struct evp_clock_clean_ctx clean = { .count = 0 };
+	union eviction_policy_meta eviction;
+	uint64_t scanned, scan_max;
+	uint32_t i = 0;
+
+	if (cline_no == 0 || part->runtime->curr_size == 0)
+		return 0;
+
+	/* Second sweep finds lines unreferenced by the first one */
+	scan_max = OCF_MIN(2ULL * part->runtime->curr_size,
+			OCF_EVICTION_CLOCK_SCAN_MAX);
+
+	/* Line under hand might have been evicted or moved meanwhile */
+	if (cline >= entries ||
+			ocf_metadata_get_partition_id(cache, cline) != part_id) {
+		cline = part->runtime->head;
+	}
+
+	for (scanned = 0; scanned < scan_max && i < cline_no; scanned++) {
+		if (!evp_clock_can_evict(cache))
+			break;
+
+		/* Eviction removes line from partition list */
+		next = ocf_metadata_get_partition_next(cache, cline);
+		if (next >= entries)
+			next = part->runtime->head;
+
+		/* Prevent evicting already locked items */
+		if (ocf_cache_line_is_used(cache, cline))
+			goto next;
+
+		ocf_metadata_get_evicition_policy(cache, cline, &eviction);
+		if (eviction.clock.referenced) {
+			evp_clock_set_referenced(cache, cline, 0);
+			goto next;
+		}
+
+		if (metadata_test_dirty(cache, cline)) {
+			if (clean.count < OCF_EVICTION_CLOCK_CLEAN_MAX)
+				clean.lines[clean.count++] = cline;
+			goto next;
+		}
+
+		evp_clock_evict_line(cache, io_queue, cline);
+		if (!ocf_volume_is_atomic(&cache->device->volume))
+			i++;
+next:
+		cline = next;
+		if (cline >= entries)
+			break;
+	}
+
+	part->runtime->eviction.policy.clock.hand = cline;
+
+	if (i < cline_no && clean.count)
+		evp_clock_clean(cache, io_queue, part_id, &clean);
+
+	/* Return number of clines that were really evicted */
+	return i;
+}
@@ -0,0 +1,21 @@
+/*
+ * Copyright(c) 2020 Intel Corporation
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+#ifndef __EVICTION_CLOCK_STRUCTS_H__
+
+#define __EVICTION_CLOCK_STRUCTS_H__
+
+struct clock_eviction_policy_meta {
+	/* Set on access, cleared when passed by clock hand. Compact metadata
+	 * keeps it in collision entry instead */
+	uint8_t referenced;
+} __attribute__((packed));
+
+struct clock_eviction_policy {
+	/* Next partition line to be visited by clock hand, restarts at
+	 * partition list head if the line left partition */
+	uint32_t hand;
+};
+
+#endif
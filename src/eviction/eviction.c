@@ -18,6 +18,14 @@ struct eviction_policy_ops evict_policy_ops[ocf_eviction_max] = {
 		.clean_cline = evp_lru_clean_cline,
 		.name = "lru",
 	},
+	[ocf_eviction_clock] = {
+		.init_cline = evp_clock_init_cline,
+		.rm_cline = evp_clock_rm_cline,
+		.req_clines = evp_clock_req_clines,
+		.hot_cline = evp_clock_hot_cline,
+		.init_evp = evp_clock_init_evp,
+		.name = "clock",
+	},
 };
 
 static uint32_t ocf_evict_calculate(struct ocf_user_part *part,
@@ -9,6 +9,8 @@
 #include "ocf/ocf.h"
 #include "lru.h"
 #include "lru_structs.h"
+#include "clock.h"
+#include "clock_structs.h"
 #include "../ocf_request.h"
 
 #define OCF_TO_EVICTION_MIN 128UL
@@ -17,12 +19,14 @@
 struct eviction_policy {
 	union {
 		struct lru_eviction_policy lru;
+		struct clock_eviction_policy clock;
 	} policy;
 };
 
 /* Eviction policy metadata per cache line */
 union eviction_policy_meta {
 	struct lru_eviction_policy_meta lru;
+	struct clock_eviction_policy_meta clock;
 } __attribute__((packed));
 
 /* the caller must hold the metadata lock for all operations
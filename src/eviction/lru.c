@@ -350,7 +350,7 @@ static void evp_lru_zero_line_complete(struct ocf_request *ocf_req, int error)
 	env_atomic_dec(&ocf_req->cache->pending_eviction_clines);
 }
 
-static void evp_lru_zero_line(ocf_cache_t cache, ocf_queue_t io_queue,
+void evp_lru_zero_line(ocf_cache_t cache, ocf_queue_t io_queue,
 		ocf_cache_line_t line)
 {
 	struct ocf_request *req;
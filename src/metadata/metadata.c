@@ -72,6 +72,13 @@ void ocf_metadata_init_collision(struct ocf_cache *cache)
 	cache->metadata.iface.init_collision(cache);
 }
 
+void ocf_metadata_init_collision_range(struct ocf_cache *cache,
+		ocf_cache_line_t phys, ocf_cache_line_t count)
+{
+	OCF_DEBUG_TRACE(cache);
+	cache->metadata.iface.init_collision_range(cache, phys, count);
+}
+
 void ocf_metadata_deinit(struct ocf_cache *cache)
 {
 	OCF_DEBUG_TRACE(cache);
@@ -125,6 +132,14 @@ void ocf_metadata_flush_all(ocf_cache_t cache,
 	ocf_metadata_end_shared_access(&cache->metadata.lock);
 }
 
+void ocf_metadata_flush_initialized(ocf_cache_t cache,
+		ocf_metadata_end_t cmpl, void *priv)
+{
+	ocf_metadata_start_shared_access(&cache->metadata.lock);
+	cache->metadata.iface.flush_initialized(cache, cmpl, priv);
+	ocf_metadata_end_shared_access(&cache->metadata.lock);
+}
+
 void ocf_metadata_load_all(ocf_cache_t cache,
 		ocf_metadata_end_t cmpl, void *priv)
 {
@@ -149,6 +164,11 @@ void ocf_metadata_flush_mark(struct ocf_cache *cache, struct ocf_request *req,
 void ocf_metadata_flush_do_asynch(struct ocf_cache *cache,
 		struct ocf_request *req, ocf_req_end_t complete)
 {
+	if (req->info.flush_metadata) {
+		env_atomic64_inc(
+			&cache->metadata_updater.stats.flush_requests);
+	}
+
 	cache->metadata.iface.flush_do_asynch(cache, req, complete);
 }
 
@@ -294,6 +314,8 @@ static void ocf_metadata_load_properties_cmpl(
 
 	properties.line_size = superblock->line_size;
 	properties.layout = superblock->metadata_layout;
+	properties.compact = superblock->compact_metadata;
+	properties.lazy_init_pending = superblock->lazy_init_pending;
 	properties.cache_mode = superblock->cache_mode;
 	properties.shutdown_status = superblock->clean_shutdown;
 	properties.dirty_flushed = superblock->dirty_flushed;
@@ -67,6 +67,16 @@ void ocf_metadata_init_hash_table(struct ocf_cache *cache);
  */
 void ocf_metadata_init_collision(struct ocf_cache *cache);
 
+/**
+ * @brief Initialize collision table entries of physical cache lines range
+ *
+ * @param cache - Cache instance
+ * @param phys - First physical cache line
+ * @param count - Number of cache lines
+ */
+void ocf_metadata_init_collision_range(struct ocf_cache *cache,
+		ocf_cache_line_t phys, ocf_cache_line_t count);
+
 /**
  * @brief De-Initialize metadata
  *
@@ -123,6 +133,19 @@ ocf_cache_line_t ocf_metadata_get_pages_count(struct ocf_cache *cache);
 void ocf_metadata_flush_all(ocf_cache_t cache,
 		ocf_metadata_end_t cmpl, void *priv);
 
+/**
+ * @brief Flush metadata of running cache after lazy initialization
+ *
+ * Unlike ocf_metadata_flush_all() shutdown status stays dirty, superblock
+ * stops marking collision segment as not initialized once it is written.
+ *
+ * @param cache - Cache instance
+ * @param cmpl - Completion callback
+ * @param priv - Completion context
+ */
+void ocf_metadata_flush_initialized(ocf_cache_t cache,
+		ocf_metadata_end_t cmpl, void *priv);
+
 /**
  * @brief Mark specified cache line to be flushed
  *
@@ -204,6 +227,8 @@ struct ocf_metadata_load_properties {
 	enum ocf_metadata_shutdown_status shutdown_status;
 	uint8_t dirty_flushed;
 	ocf_metadata_layout_t layout;
+	bool compact;
+	bool lazy_init_pending;
 	ocf_cache_line_size_t line_size;
 	ocf_cache_mode_t cache_mode;
 	char *cache_name;
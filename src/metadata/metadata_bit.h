@@ -45,8 +45,7 @@ static inline u128 _get_mask_u128(uint8_t start, uint8_t stop)
 }
 
 #define ocf_metadata_bit_struct(type) \
-struct ocf_metadata_map_##type { \
-	struct ocf_metadata_map map; \
+struct ocf_metadata_status_##type { \
 	type valid; \
 	type dirty; \
 } __attribute__((packed))
@@ -63,18 +62,19 @@ static bool _ocf_metadata_test_##what##_##type(struct ocf_cache *cache, \
 	struct ocf_metadata_raw *raw = \
 			&ctrl->raw_desc[metadata_segment_collision]; \
 \
-	const struct ocf_metadata_map_##type *map = raw->mem_pool; \
+	const struct ocf_metadata_status_##type *map = \
+			_ocf_metadata_hash_status(ctrl, line); \
 \
 	_raw_bug_on(raw, line); \
 \
 	if (all) { \
-		if (mask == (map[line].what & mask)) { \
+		if (mask == (map->what & mask)) { \
 			return true; \
 		} else { \
 			return false; \
 		} \
 	} else { \
-		if (map[line].what & mask) { \
+		if (map->what & mask) { \
 			return true; \
 		} else { \
 			return false; \
@@ -93,11 +93,12 @@ static bool _ocf_metadata_test_out_##what##_##type(struct ocf_cache *cache, \
 	struct ocf_metadata_raw *raw = \
 			&ctrl->raw_desc[metadata_segment_collision]; \
 \
-	const struct ocf_metadata_map_##type *map = raw->mem_pool; \
+	const struct ocf_metadata_status_##type *map = \
+			_ocf_metadata_hash_status(ctrl, line); \
 \
 	_raw_bug_on(raw, line); \
 \
-	if (map[line].what & ~mask) { \
+	if (map->what & ~mask) { \
 		return true; \
 	} else { \
 		return false; \
@@ -115,13 +116,14 @@ static bool _ocf_metadata_clear_##what##_##type(struct ocf_cache *cache, \
 	struct ocf_metadata_raw *raw = \
 			&ctrl->raw_desc[metadata_segment_collision]; \
 \
-	struct ocf_metadata_map_##type *map = raw->mem_pool; \
+	struct ocf_metadata_status_##type *map = \
+			_ocf_metadata_hash_status(ctrl, line); \
 \
 	_raw_bug_on(raw, line); \
 \
-	map[line].what &= ~mask; \
+	map->what &= ~mask; \
 \
-	if (map[line].what) { \
+	if (map->what) { \
 		return true; \
 	} else { \
 		return false; \
@@ -140,13 +142,14 @@ static bool _ocf_metadata_set_##what##_##type(struct ocf_cache *cache, \
 	struct ocf_metadata_raw *raw = \
 			&ctrl->raw_desc[metadata_segment_collision]; \
 \
-	struct ocf_metadata_map_##type *map = raw->mem_pool; \
+	struct ocf_metadata_status_##type *map = \
+			_ocf_metadata_hash_status(ctrl, line); \
 \
 	_raw_bug_on(raw, line); \
 \
-	result = map[line].what ? true : false; \
+	result = map->what ? true : false; \
 \
-	map[line].what |= mask; \
+	map->what |= mask; \
 \
 	return result; \
 } \
@@ -164,25 +167,26 @@ static bool _ocf_metadata_test_and_set_##what##_##type( \
 	struct ocf_metadata_raw *raw = \
 			&ctrl->raw_desc[metadata_segment_collision]; \
 \
-	struct ocf_metadata_map_##type *map = raw->mem_pool; \
+	struct ocf_metadata_status_##type *map = \
+			_ocf_metadata_hash_status(ctrl, line); \
 \
 	_raw_bug_on(raw, line); \
 \
 	if (all) { \
-		if (mask == (map[line].what & mask)) { \
+		if (mask == (map->what & mask)) { \
 			test = true; \
 		} else { \
 			test = false; \
 		} \
 	} else { \
-		if (map[line].what & mask) { \
+		if (map->what & mask) { \
 			test = true; \
 		} else { \
 			test = false; \
 		} \
 	} \
 \
-	map[line].what |= mask; \
+	map->what |= mask; \
 	return test; \
 } \
 \
@@ -199,25 +203,26 @@ static bool _ocf_metadata_test_and_clear_##what##_##type( \
 	struct ocf_metadata_raw *raw = \
 			&ctrl->raw_desc[metadata_segment_collision]; \
 \
-	struct ocf_metadata_map_##type *map = raw->mem_pool; \
+	struct ocf_metadata_status_##type *map = \
+			_ocf_metadata_hash_status(ctrl, line); \
 \
 	_raw_bug_on(raw, line); \
 \
 	if (all) { \
-		if (mask == (map[line].what & mask)) { \
+		if (mask == (map->what & mask)) { \
 			test = true; \
 		} else { \
 			test = false; \
 		} \
 	} else { \
-		if (map[line].what & mask) { \
+		if (map->what & mask) { \
 			test = true; \
 		} else { \
 			test = false; \
 		} \
 	} \
 \
-	map[line].what &= ~mask; \
+	map->what &= ~mask; \
 	return test; \
 } \
 
@@ -38,6 +38,31 @@ struct ocf_metadata_map {
 		/*!<  Entry status structure e.g. valid, dirty...*/
 } __attribute__((packed));
 
+#define OCF_METADATA_COMPACT_CORE_ID_BITS 13
+#define OCF_METADATA_COMPACT_CORE_LINE_BITS 34
+
+/* Core line value marking unmapped entry in compact metadata map */
+#define OCF_METADATA_COMPACT_CORE_LINE_INVALID \
+	((1ULL << OCF_METADATA_COMPACT_CORE_LINE_BITS) - 1)
+
+/**
+ * @brief Compact metadata map structure
+ */
+
+struct ocf_metadata_map_compact {
+	uint64_t core_id : OCF_METADATA_COMPACT_CORE_ID_BITS;
+		/*!<  ID of core where is assigned this cache line*/
+
+	uint64_t core_line : OCF_METADATA_COMPACT_CORE_LINE_BITS;
+		/*!<  Core line addres on cache mapped by this strcture */
+
+	uint64_t referenced : 1;
+		/*!<  CLOCK reference bit, there is no eviction segment */
+
+	uint8_t status[];
+		/*!<  Entry status structure e.g. valid, dirty...*/
+} __attribute__((packed));
+
 static inline ocf_cache_line_t ocf_metadata_map_lg2phy(
 		struct ocf_cache *cache, ocf_cache_line_t coll_idx)
 {
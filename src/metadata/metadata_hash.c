@@ -14,6 +14,7 @@
 #include "../ocf_def_priv.h"
 #include "../ocf_priv.h"
 #include "../ocf_freelist.h"
+#include "../ocf_core_index.h"
 
 #define OCF_METADATA_HASH_DEBUG 0
 
@@ -64,15 +65,80 @@ struct ocf_metadata_hash_ctrl {
 	ocf_cache_line_t count_pages;
 	uint32_t device_lines;
 	size_t mapping_size;
+	size_t status_offset;
+	bool compact;
 	struct ocf_metadata_raw raw_desc[metadata_segment_max];
 };
 
+/*
+ * Collision entry core info encoding
+ */
+static inline void _ocf_metadata_hash_map_get(
+		const struct ocf_metadata_hash_ctrl *ctrl, const void *entry,
+		ocf_core_id_t *core_id, uint64_t *core_line)
+{
+	const struct ocf_metadata_map_compact *compact = entry;
+	const struct ocf_metadata_map *map = entry;
+
+	if (!ctrl->compact) {
+		if (core_id)
+			*core_id = map->core_id;
+		if (core_line)
+			*core_line = map->core_line;
+		return;
+	}
+
+	if (core_id)
+		*core_id = compact->core_id;
+	if (core_line) {
+		*core_line = compact->core_line ==
+				OCF_METADATA_COMPACT_CORE_LINE_INVALID ?
+				ULLONG_MAX : compact->core_line;
+	}
+}
+
+static inline void _ocf_metadata_hash_map_set(
+		const struct ocf_metadata_hash_ctrl *ctrl, void *entry,
+		ocf_core_id_t core_id, uint64_t core_line)
+{
+	struct ocf_metadata_map_compact *compact = entry;
+	struct ocf_metadata_map *map = entry;
+
+	ENV_BUILD_BUG_ON(OCF_CORE_MAX >=
+			(1 << OCF_METADATA_COMPACT_CORE_ID_BITS));
+
+	if (!ctrl->compact) {
+		map->core_id = core_id;
+		map->core_line = core_line;
+		return;
+	}
+
+	/* Core size is checked on core add, so only unmapped entry is
+	 * truncated here */
+	compact->core_id = core_id;
+	compact->core_line = OCF_MIN(core_line,
+			OCF_METADATA_COMPACT_CORE_LINE_INVALID);
+}
+
+/*
+ * Status bits of collision entry, placed after core info
+ */
+static inline void *_ocf_metadata_hash_status(
+		struct ocf_metadata_hash_ctrl *ctrl, ocf_cache_line_t line)
+{
+	struct ocf_metadata_raw *raw =
+			&ctrl->raw_desc[metadata_segment_collision];
+
+	return raw->mem_pool + (uint64_t)raw->entry_size * line +
+			ctrl->status_offset;
+}
+
 /*
  * get entries for specified metadata hash type
  */
 static ocf_cache_line_t ocf_metadata_hash_get_entries(
 		enum ocf_metadata_segment type,
-		ocf_cache_line_t cache_lines)
+		ocf_cache_line_t cache_lines, bool compact)
 {
 	ENV_BUG_ON(type >= metadata_segment_variable_size_start && cache_lines == 0);
 
@@ -80,6 +146,9 @@ static ocf_cache_line_t ocf_metadata_hash_get_entries(
 	case metadata_segment_collision:
 	case metadata_segment_cleaning:
 	case metadata_segment_eviction:
+		/* Compact entries hold CLOCK reference bit in collision */
+		return compact ? 0 : cache_lines;
+
 	case metadata_segment_list_info:
 		return cache_lines;
 
@@ -125,7 +194,7 @@ static ocf_cache_line_t ocf_metadata_hash_get_entries(
  */
 static int64_t ocf_metadata_hash_get_element_size(
 		enum ocf_metadata_segment type,
-		const struct ocf_cache_line_settings *settings)
+		const struct ocf_cache_line_settings *settings, bool compact)
 {
 	int64_t size = 0;
 
@@ -133,7 +202,10 @@ static int64_t ocf_metadata_hash_get_element_size(
 
 	switch (type) {
 	case metadata_segment_eviction:
-		size = sizeof(union eviction_policy_meta);
+		if (compact)
+			size = sizeof(struct clock_eviction_policy_meta);
+		else
+			size = sizeof(union eviction_policy_meta);
 		break;
 
 	case metadata_segment_cleaning:
@@ -141,8 +213,11 @@ static int64_t ocf_metadata_hash_get_element_size(
 		break;
 
 	case metadata_segment_collision:
-		size = sizeof(struct ocf_metadata_map)
-			+ ocf_metadata_status_sizeof(settings);
+		if (compact)
+			size = sizeof(struct ocf_metadata_map_compact);
+		else
+			size = sizeof(struct ocf_metadata_map);
+		size += ocf_metadata_status_sizeof(settings);
 		break;
 
 	case metadata_segment_list_info:
@@ -255,8 +330,8 @@ static int ocf_metadata_hash_calculate_metadata_size(
 			struct ocf_metadata_raw *raw = &ctrl->raw_desc[i];
 
 			/* Setup number of entries */
-			raw->entries
-				= ocf_metadata_hash_get_entries(i, cache_lines);
+			raw->entries = ocf_metadata_hash_get_entries(i,
+					cache_lines, ctrl->compact);
 
 			/*
 			 * Setup SSD location and size
@@ -492,11 +567,11 @@ static struct ocf_metadata_hash_ctrl *ocf_metadata_hash_ctrl_init(
 
 		/* Entry size configuration */
 		raw->entry_size
-			= ocf_metadata_hash_get_element_size(i, NULL);
+			= ocf_metadata_hash_get_element_size(i, NULL, false);
 		raw->entries_in_page = PAGE_SIZE / raw->entry_size;
 
 		/* Setup number of entries */
-		raw->entries = ocf_metadata_hash_get_entries(i, 0);
+		raw->entries = ocf_metadata_hash_get_entries(i, 0, false);
 
 		/*
 		 * Setup SSD location and size
@@ -935,8 +1010,12 @@ static int ocf_metadata_hash_init_variable_size(struct ocf_cache *cache,
 		/* Re-initialize settings with different cache line size */
 		ocf_metadata_config_init(cache, settings, cache_line_size);
 
+	ctrl->compact = cache->conf_meta->compact_metadata;
+	ctrl->status_offset = ctrl->compact ?
+			sizeof(struct ocf_metadata_map_compact) :
+			sizeof(struct ocf_metadata_map);
 	ctrl->mapping_size = ocf_metadata_status_sizeof(settings)
-		+ sizeof(struct ocf_metadata_map);
+		+ ctrl->status_offset;
 
 	ocf_metadata_hash_init_iface(cache, layout);
 
@@ -950,7 +1029,11 @@ static int ocf_metadata_hash_init_variable_size(struct ocf_cache *cache,
 		/* Default type for metadata RAW container */
 		raw->raw_type = metadata_raw_type_ram;
 
-		if (cache->device->init_mode == ocf_init_mode_metadata_volatile) {
+		if (i == metadata_segment_eviction && ctrl->compact) {
+			/* Empty, nothing to allocate */
+			raw->raw_type = metadata_raw_type_dynamic;
+		} else if (cache->device->init_mode ==
+				ocf_init_mode_metadata_volatile) {
 			raw->raw_type = metadata_raw_type_volatile;
 		} else if (i == metadata_segment_collision &&
 				ocf_volume_is_atomic(&cache->device->volume)) {
@@ -959,7 +1042,8 @@ static int ocf_metadata_hash_init_variable_size(struct ocf_cache *cache,
 
 		/* Entry size configuration */
 		raw->entry_size
-			= ocf_metadata_hash_get_element_size(i, settings);
+			= ocf_metadata_hash_get_element_size(i, settings,
+					ctrl->compact);
 		raw->entries_in_page = PAGE_SIZE / raw->entry_size;
 	}
 
@@ -1089,10 +1173,23 @@ static inline void _ocf_init_collision_entry(struct ocf_cache *cache,
 		ocf_cache_line_t idx)
 {
 	ocf_cache_line_t invalid_idx = cache->device->collision_table_entries;
+	struct ocf_metadata_hash_ctrl *ctrl =
+		(struct ocf_metadata_hash_ctrl *) cache->metadata.iface_priv;
+	void *collision;
 
 	ocf_metadata_set_collision_info(cache, idx, invalid_idx, invalid_idx);
-	ocf_metadata_set_core_info(cache, idx,
-			OCF_CORE_MAX, ULONG_MAX);
+
+	/* Entry may hold garbage, so core info is set directly instead of
+	 * moving the line between lists of core index */
+	collision = ocf_metadata_raw_wr_access(cache,
+			&(ctrl->raw_desc[metadata_segment_collision]), idx);
+	if (collision) {
+		_ocf_metadata_hash_map_set(ctrl, collision, OCF_CORE_MAX,
+				ULLONG_MAX);
+	} else {
+		ocf_metadata_error(cache);
+	}
+
 	metadata_init_status_bits(cache, idx);
 }
 
@@ -1110,6 +1207,22 @@ static void ocf_metadata_hash_init_collision(struct ocf_cache *cache)
 	}
 }
 
+/*
+ * Initialize collision table entries of range of physical cache lines
+ */
+static void ocf_metadata_hash_init_collision_range(struct ocf_cache *cache,
+		ocf_cache_line_t phys, ocf_cache_line_t count)
+{
+	ocf_cache_line_t end = phys + count;
+
+	ENV_BUG_ON(end > cache->device->collision_table_entries);
+
+	for (; phys < end; phys++) {
+		_ocf_init_collision_entry(cache,
+				ocf_metadata_map_phy2lg(cache, phys));
+	}
+}
+
 /*
  * Initialize hash table
  */
@@ -1684,6 +1797,18 @@ static void ocf_medatata_hash_flush_all_set_status(ocf_pipeline_t pipeline,
 			context);
 }
 
+static void ocf_medatata_hash_flush_all_initialized(ocf_pipeline_t pipeline,
+		void *priv, ocf_pipeline_arg_t arg)
+{
+	struct ocf_metadata_hash_context *context = priv;
+	ocf_cache_t cache = context->cache;
+
+	/* Collision segment is written, recovery may use it from now */
+	cache->conf_meta->lazy_init_pending = false;
+
+	ocf_pipeline_next(pipeline);
+}
+
 static void ocf_metadata_hash_flush_all_finish(ocf_pipeline_t pipeline,
 		void *priv, int error)
 {
@@ -1732,9 +1857,29 @@ struct ocf_pipeline_properties ocf_metadata_hash_flush_all_pipeline_props = {
 };
 
 /*
- * Flush all metadata
+ * Same as flush all, but cache keeps running, so shutdown status is never
+ * set to clean
  */
-static void ocf_metadata_hash_flush_all(ocf_cache_t cache,
+struct ocf_pipeline_properties
+ocf_metadata_hash_flush_initialized_pipeline_props = {
+	.priv_size = sizeof(struct ocf_metadata_hash_context),
+	.finish = ocf_metadata_hash_flush_superblock_finish,
+	.steps = {
+		OCF_PL_STEP_ARG_INT(ocf_medatata_hash_flush_all_set_status,
+				ocf_metadata_dirty_shutdown),
+		OCF_PL_STEP_FOREACH(ocf_medatata_hash_flush_segment,
+				ocf_metadata_hash_flush_all_args),
+		OCF_PL_STEP_FOREACH(ocf_medatata_hash_calculate_crc,
+				ocf_metadata_hash_flush_all_args),
+		OCF_PL_STEP(ocf_medatata_hash_flush_all_initialized),
+		OCF_PL_STEP_ARG_INT(ocf_medatata_hash_flush_all_set_status,
+				ocf_metadata_dirty_shutdown),
+		OCF_PL_STEP_TERMINATOR(),
+	},
+};
+
+static void _ocf_metadata_hash_flush_all(ocf_cache_t cache,
+		struct ocf_pipeline_properties *props,
 		ocf_metadata_end_t cmpl, void *priv)
 {
 	struct ocf_metadata_hash_context *context;
@@ -1743,8 +1888,7 @@ static void ocf_metadata_hash_flush_all(ocf_cache_t cache,
 
 	OCF_DEBUG_TRACE(cache);
 
-	result = ocf_pipeline_create(&pipeline, cache,
-			&ocf_metadata_hash_flush_all_pipeline_props);
+	result = ocf_pipeline_create(&pipeline, cache, props);
 	if (result)
 		OCF_CMPL_RET(priv, result);
 
@@ -1758,6 +1902,28 @@ static void ocf_metadata_hash_flush_all(ocf_cache_t cache,
 	ocf_pipeline_next(pipeline);
 }
 
+/*
+ * Flush all metadata
+ */
+static void ocf_metadata_hash_flush_all(ocf_cache_t cache,
+		ocf_metadata_end_t cmpl, void *priv)
+{
+	_ocf_metadata_hash_flush_all(cache,
+			&ocf_metadata_hash_flush_all_pipeline_props,
+			cmpl, priv);
+}
+
+/*
+ * Flush all metadata of running cache after lazy initialization
+ */
+static void ocf_metadata_hash_flush_initialized(ocf_cache_t cache,
+		ocf_metadata_end_t cmpl, void *priv)
+{
+	_ocf_metadata_hash_flush_all(cache,
+			&ocf_metadata_hash_flush_initialized_pipeline_props,
+			cmpl, priv);
+}
+
 /*
  * Flush specified cache line
  */
@@ -2204,17 +2370,15 @@ static void ocf_metadata_hash_get_core_info(struct ocf_cache *cache,
 		ocf_cache_line_t line, ocf_core_id_t *core_id,
 		uint64_t *core_sector)
 {
-	const struct ocf_metadata_map *collision;
+	const void *collision;
 	struct ocf_metadata_hash_ctrl *ctrl =
 		(struct ocf_metadata_hash_ctrl *) cache->metadata.iface_priv;
 
 	collision = ocf_metadata_raw_rd_access(cache,
 			&(ctrl->raw_desc[metadata_segment_collision]), line);
 	if (collision) {
-		if (core_id)
-			*core_id = collision->core_id;
-		if (core_sector)
-			*core_sector = collision->core_line;
+		_ocf_metadata_hash_map_get(ctrl, collision, core_id,
+				core_sector);
 	} else {
 		ocf_metadata_error(cache);
 
@@ -2229,7 +2393,9 @@ static void ocf_metadata_hash_set_core_info(struct ocf_cache *cache,
 		ocf_cache_line_t line, ocf_core_id_t core_id,
 		uint64_t core_sector)
 {
-	struct ocf_metadata_map *collision;
+	void *collision;
+	ocf_core_id_t old_core_id;
+	uint64_t old_core_line;
 	struct ocf_metadata_hash_ctrl *ctrl =
 		(struct ocf_metadata_hash_ctrl *) cache->metadata.iface_priv;
 
@@ -2237,8 +2403,15 @@ static void ocf_metadata_hash_set_core_info(struct ocf_cache *cache,
 			&(ctrl->raw_desc[metadata_segment_collision]), line);
 
 	if (collision) {
-		collision->core_id = core_id;
-		collision->core_line = core_sector;
+		if (cache->core_index) {
+			_ocf_metadata_hash_map_get(ctrl, collision,
+					&old_core_id, &old_core_line);
+			ocf_core_index_move(cache->core_index, line,
+					old_core_id, old_core_line,
+					core_id, core_sector);
+		}
+		_ocf_metadata_hash_map_set(ctrl, collision, core_id,
+				core_sector);
 	} else {
 		ocf_metadata_error(cache);
 	}
@@ -2247,15 +2420,18 @@ static void ocf_metadata_hash_set_core_info(struct ocf_cache *cache,
 static ocf_core_id_t ocf_metadata_hash_get_core_id(
 		struct ocf_cache *cache, ocf_cache_line_t line)
 {
-	const struct ocf_metadata_map *collision;
+	const void *collision;
+	ocf_core_id_t core_id;
 	struct ocf_metadata_hash_ctrl *ctrl =
 		(struct ocf_metadata_hash_ctrl *) cache->metadata.iface_priv;
 
 	collision = ocf_metadata_raw_rd_access(cache,
 			&(ctrl->raw_desc[metadata_segment_collision]), line);
 
-	if (collision)
-		return collision->core_id;
+	if (collision) {
+		_ocf_metadata_hash_map_get(ctrl, collision, &core_id, NULL);
+		return core_id;
+	}
 
 	ocf_metadata_error(cache);
 	return OCF_CORE_MAX;
@@ -2285,7 +2461,7 @@ static void ocf_metadata_hash_get_core_and_part_id(
 		struct ocf_cache *cache, ocf_cache_line_t line,
 		ocf_core_id_t *core_id, ocf_part_id_t *part_id)
 {
-	const struct ocf_metadata_map *collision;
+	const void *collision;
 	const struct ocf_metadata_list_info *info;
 	struct ocf_metadata_hash_ctrl *ctrl =
 		(struct ocf_metadata_hash_ctrl *) cache->metadata.iface_priv;
@@ -2297,8 +2473,7 @@ static void ocf_metadata_hash_get_core_and_part_id(
 			&(ctrl->raw_desc[metadata_segment_list_info]), line);
 
 	if (collision && info) {
-		if (core_id)
-			*core_id = collision->core_id;
+		_ocf_metadata_hash_map_get(ctrl, collision, core_id, NULL);
 		if (part_id)
 			*part_id = info->partition_id;
 	} else {
@@ -2404,9 +2579,23 @@ static void ocf_metadata_hash_get_eviction_policy(
 		union eviction_policy_meta *eviction_policy)
 {
 	int result = 0;
+	const struct ocf_metadata_map_compact *compact;
 	struct ocf_metadata_hash_ctrl *ctrl
 		= (struct ocf_metadata_hash_ctrl *) cache->metadata.iface_priv;
 
+	if (ctrl->compact) {
+		compact = ocf_metadata_raw_rd_access(cache,
+				&(ctrl->raw_desc[metadata_segment_collision]),
+				line);
+		if (!compact) {
+			ocf_metadata_error(cache);
+			return;
+		}
+
+		eviction_policy->clock.referenced = compact->referenced;
+		return;
+	}
+
 	result = ocf_metadata_raw_get(cache,
 			&(ctrl->raw_desc[metadata_segment_eviction]), line,
 			eviction_policy);
@@ -2423,9 +2612,23 @@ static void ocf_metadata_hash_set_eviction_policy(
 		union eviction_policy_meta *eviction_policy)
 {
 	int result = 0;
+	struct ocf_metadata_map_compact *compact;
 	struct ocf_metadata_hash_ctrl *ctrl
 		= (struct ocf_metadata_hash_ctrl *) cache->metadata.iface_priv;
 
+	if (ctrl->compact) {
+		compact = ocf_metadata_raw_wr_access(cache,
+				&(ctrl->raw_desc[metadata_segment_collision]),
+				line);
+		if (!compact) {
+			ocf_metadata_error(cache);
+			return;
+		}
+
+		compact->referenced = !!eviction_policy->clock.referenced;
+		return;
+	}
+
 	result = ocf_metadata_raw_set(cache,
 			&(ctrl->raw_desc[metadata_segment_eviction]), line,
 			eviction_policy);
@@ -2713,6 +2916,7 @@ static const struct ocf_metadata_iface metadata_hash_iface = {
 	.deinit_variable_size = ocf_metadata_hash_deinit_variable_size,
 	.init_hash_table = ocf_metadata_hash_init_hash_table,
 	.init_collision = ocf_metadata_hash_init_collision,
+	.init_collision_range = ocf_metadata_hash_init_collision_range,
 
 	.layout_iface = NULL,
 	.pages = ocf_metadata_hash_pages,
@@ -2723,6 +2927,7 @@ static const struct ocf_metadata_iface metadata_hash_iface = {
 	 * Load all, flushing all, etc...
 	 */
 	.flush_all = ocf_metadata_hash_flush_all,
+	.flush_initialized = ocf_metadata_hash_flush_initialized,
 	.flush_mark = ocf_metadata_hash_flush_mark,
 	.flush_do_asynch = ocf_metadata_hash_flush_do_asynch,
 	.load_all = ocf_metadata_hash_load_all,
@@ -269,15 +269,17 @@ static void metadata_io_io_end(struct metadata_io_request *m_req, int error)
 
 	OCF_DEBUG_PARAM(cache, "Page = %u", m_req->page);
 
+	m_req->error = error;
 	metadata_io_req_advance(m_req);
 
-	env_atomic_set(&m_req->finished, 1);
+	metadata_updater_finish(m_req);
 	ocf_metadata_updater_kick(cache);
 }
 
 static void metadata_io_req_submit(struct metadata_io_request *m_req)
 {
-	env_atomic_set(&m_req->finished, 0);
+	m_req->error = 0;
+	INIT_LIST_HEAD(&m_req->group);
 	metadata_updater_submit(m_req);
 }
 
@@ -357,13 +359,27 @@ void metadata_io_req_complete(struct metadata_io_request *m_req)
 	metadata_io_req_submit(m_req);
 }
 
+/*
+ * Complete write merged into another one, which has written its pages
+ */
+void metadata_io_req_merged_end(struct metadata_io_request *m_req, int error)
+{
+	struct metadata_io_request_asynch *a_req = m_req->asynch;
+
+	if (error)
+		a_req->error = a_req->error ?: error;
+
+	metadata_io_req_advance(m_req);
+	metadata_io_req_complete(m_req);
+}
+
 /*
  * Iterative write request asynchronously
  */
 static int metadata_io_i_asynch(ocf_cache_t cache, ocf_queue_t queue, int dir,
 		void *context, uint32_t page, uint32_t count,
 		ocf_metadata_io_event_t io_hndl,
-		ocf_metadata_io_end_t compl_hndl)
+		ocf_metadata_io_end_t compl_hndl, bool live)
 {
 	struct metadata_io_request_asynch *a_req;
 	struct metadata_io_request *m_req;
@@ -396,6 +412,7 @@ static int metadata_io_i_asynch(ocf_cache_t cache, ocf_queue_t queue, int dir,
 		m_req->context = context;
 		m_req->on_meta_fill = io_hndl;
 		m_req->on_meta_drain = io_hndl;
+		m_req->live = live;
 		m_req->req.io_if = &metadata_io_restart_if;
 		m_req->req.io_queue = queue;
 		m_req->req.cache = cache;
@@ -440,7 +457,16 @@ int metadata_io_write_i_asynch(ocf_cache_t cache, ocf_queue_t queue,
 		ocf_metadata_io_end_t compl_hndl)
 {
 	return metadata_io_i_asynch(cache, queue, OCF_WRITE, context,
-			page, count, fill_hndl, compl_hndl);
+			page, count, fill_hndl, compl_hndl, false);
+}
+
+int metadata_io_write_live_i_asynch(ocf_cache_t cache, ocf_queue_t queue,
+		void *context, uint32_t page, uint32_t count,
+		ocf_metadata_io_event_t fill_hndl,
+		ocf_metadata_io_end_t compl_hndl)
+{
+	return metadata_io_i_asynch(cache, queue, OCF_WRITE, context,
+			page, count, fill_hndl, compl_hndl, true);
 }
 
 int metadata_io_read_i_asynch(ocf_cache_t cache, ocf_queue_t queue,
@@ -449,7 +475,7 @@ int metadata_io_read_i_asynch(ocf_cache_t cache, ocf_queue_t queue,
 		ocf_metadata_io_end_t compl_hndl)
 {
 	return metadata_io_i_asynch(cache, queue, OCF_READ, context,
-			page, count, drain_hndl, compl_hndl);
+			page, count, drain_hndl, compl_hndl, false);
 }
 
 int ocf_metadata_io_init(ocf_cache_t cache)
@@ -51,13 +51,18 @@ struct metadata_io_request {
 	uint32_t count;
 	ocf_metadata_io_event_t on_meta_fill;
 	ocf_metadata_io_event_t on_meta_drain;
+	/* fill copies live metadata, context only tells where it is */
+	bool live;
 	ctx_data_t *data;
 	int error;
 	struct metadata_io_request_asynch *asynch;
-	env_atomic finished;
 
 	struct ocf_request req;
 	struct list_head list;
+	struct list_head finished_list;
+
+	/* Writes merged into this one, completed along with it */
+	struct list_head group;
 };
 
 #define METADATA_IO_REQS_LIMIT 128
@@ -79,6 +84,8 @@ struct metadata_io_request_asynch {
 
 void metadata_io_req_complete(struct metadata_io_request *m_req);
 
+void metadata_io_req_merged_end(struct metadata_io_request *m_req, int error);
+
 /**
  * @brief Metadata read end callback
  *
@@ -126,6 +133,19 @@ int metadata_io_write_i_asynch(ocf_cache_t cache, ocf_queue_t queue,
 		ocf_metadata_io_event_t fill_hndl,
 		ocf_metadata_io_end_t compl_hndl);
 
+/**
+ * @brief Iterative asynchronous pages write of live metadata
+ *
+ * Same as metadata_io_write_i_asynch(), but fill_hndl has to copy current
+ * in-memory metadata of the page and use context only to locate it. Only
+ * such writes are merged into pending write of the same pages issued with
+ * other context, as the pending one fills in the same data.
+ */
+int metadata_io_write_live_i_asynch(ocf_cache_t cache, ocf_queue_t queue,
+		void *context, uint32_t page, uint32_t count,
+		ocf_metadata_io_event_t fill_hndl,
+		ocf_metadata_io_end_t compl_hndl);
+
 /**
  * @brief Iterative asynchronous pages read
  *
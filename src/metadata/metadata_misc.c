@@ -6,6 +6,8 @@
 #include "ocf/ocf.h"
 #include "metadata.h"
 #include "../ocf_freelist.h"
+#include "../ocf_core_index.h"
+#include "../ocf_lazy_init.h"
 #include "../utils/utils_cache_line.h"
 
 static bool _is_cache_line_acting(struct ocf_cache *cache,
@@ -40,6 +42,8 @@ static bool _is_cache_line_acting(struct ocf_cache *cache,
  *
  * set partition_id to PARTITION_INVALID to not care about partition_id
  *
+ * if core index is active, only lines of the core are visited
+ *
  * METADATA lock must be held before calling this function
  */
 int ocf_metadata_actor(struct ocf_cache *cache,
@@ -55,7 +59,31 @@ int ocf_metadata_actor(struct ocf_cache *cache,
 	start_line = ocf_bytes_2_lines(cache, start_byte);
 	end_line = ocf_bytes_2_lines(cache, end_byte);
 
-	if (part_id != PARTITION_INVALID) {
+	if (core_id != OCF_CORE_ID_INVALID &&
+			ocf_core_index_active(cache->core_index)) {
+		/* Visit only lines of the core */
+		for (i = ocf_core_index_first(cache->core_index, core_id);
+				i != cache->device->collision_table_entries;
+				i = next_i) {
+			next_i = ocf_core_index_next(cache->core_index, i);
+
+			if (part_id != PARTITION_INVALID &&
+					ocf_metadata_get_partition_id(cache, i)
+							!= part_id) {
+				continue;
+			}
+
+			if (_is_cache_line_acting(cache, i, core_id,
+					start_line, end_line)) {
+				if (ocf_cache_line_is_used(cache, i))
+					ret = -OCF_ERR_AGAIN;
+				else
+					actor(cache, i);
+			}
+
+			OCF_COND_RESCHED_DEFAULT(step);
+		}
+	} else if (part_id != PARTITION_INVALID) {
 		for (i = cache->user_parts[part_id].runtime->head;
 				i != cache->device->collision_table_entries;
 				i = next_i) {
@@ -72,6 +100,9 @@ int ocf_metadata_actor(struct ocf_cache *cache,
 			OCF_COND_RESCHED_DEFAULT(step);
 		}
 	} else {
+		/* Whole collision table has to be initialized */
+		ocf_lazy_init_complete(cache->lazy_init);
+
 		for (i = 0; i < cache->device->collision_table_entries; ++i) {
 			if (_is_cache_line_acting(cache, i, core_id,
 					start_line, end_line)) {
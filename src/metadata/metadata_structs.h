@@ -144,6 +144,17 @@ struct ocf_metadata_iface {
 	 */
 	void (*init_collision)(struct ocf_cache *cache);
 
+	/**
+	 * @brief Initialize collision table entries of physical cache
+	 * lines range
+	 *
+	 * @param cache - Cache instance
+	 * @param phys - First physical cache line
+	 * @param count - Number of cache lines
+	 */
+	void (*init_collision_range)(struct ocf_cache *cache,
+			ocf_cache_line_t phys, ocf_cache_line_t count);
+
 	/**
 	 * @brief De-Initialize metadata
 	 *
@@ -212,6 +223,17 @@ struct ocf_metadata_iface {
 	void (*flush_all)(ocf_cache_t cache,
 			ocf_metadata_end_t cmpl, void *priv);
 
+	/**
+	 * @brief Flush metadata of running cache once lazy initialization
+	 *	is done, keeping dirty shutdown status
+	 *
+	 * @param[in] cache - Cache instance
+	 * @param[in] cmpl - Completion callback
+	 * @param[in] priv - Completion callback context
+	 */
+	void (*flush_initialized)(ocf_cache_t cache,
+			ocf_metadata_end_t cmpl, void *priv);
+
 	/**
 	 * @brief Mark specified cache line to be flushed
 	 *
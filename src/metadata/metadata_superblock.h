@@ -49,6 +49,12 @@ struct ocf_superblock_config {
 	/* Current core sequence number */
 	ocf_core_id_t curr_core_seq_no;
 
+	/* Fields below are appended to layout of previous revisions */
+	bool compact_metadata;
+	/* Collision segment on cache device not initialized yet, set from
+	 * attach with lazy initialization until it is flushed */
+	bool lazy_init_pending;
+
 	/*
 	 * Checksum for each metadata region.
 	 * This field has to be the last one!
@@ -16,12 +16,41 @@ int ocf_metadata_updater_init(ocf_cache_t cache)
 {
 	ocf_metadata_updater_t mu = &cache->metadata_updater;
 	struct ocf_metadata_io_syncher *syncher = &mu->syncher;
+	int result;
+	int i;
 
-	INIT_LIST_HEAD(&syncher->in_progress_head);
+	for (i = 0; i < METADATA_UPDATER_INDEX_SIZE; i++) {
+		INIT_LIST_HEAD(&syncher->in_progress[i]);
+		syncher->bucket_max_count[i] = 0;
+	}
+	syncher->max_count = 0;
 	INIT_LIST_HEAD(&syncher->pending_head);
-	env_mutex_init(&syncher->lock);
+	INIT_LIST_HEAD(&syncher->finished_head);
+
+	result = env_spinlock_init(&syncher->finished_lock);
+	if (result)
+		return result;
+
+	result = env_mutex_init(&syncher->lock);
+	if (result) {
+		env_spinlock_destroy(&syncher->finished_lock);
+		return result;
+	}
+
+	env_atomic64_set(&mu->stats.flush_requests, 0);
+	env_atomic64_set(&mu->stats.write_requests, 0);
+	env_atomic64_set(&mu->stats.merged_writes, 0);
+	env_atomic64_set(&mu->stats.write_ios, 0);
+	env_atomic64_set(&mu->stats.lock_acquisitions, 0);
+	env_atomic64_set(&mu->stats.lock_held_ticks, 0);
 
-	return ctx_metadata_updater_init(cache->owner, mu);
+	result = ctx_metadata_updater_init(cache->owner, mu);
+	if (result) {
+		env_mutex_destroy(&syncher->lock);
+		env_spinlock_destroy(&syncher->finished_lock);
+	}
+
+	return result;
 }
 
 void ocf_metadata_updater_kick(ocf_cache_t cache)
@@ -33,6 +62,7 @@ void ocf_metadata_updater_stop(ocf_cache_t cache)
 {
 	ctx_metadata_updater_stop(cache->owner, &cache->metadata_updater);
 	env_mutex_destroy(&cache->metadata_updater.syncher.lock);
+	env_spinlock_destroy(&cache->metadata_updater.syncher.finished_lock);
 }
 
 void ocf_metadata_updater_set_priv(ocf_metadata_updater_t mu, void *priv)
@@ -53,20 +83,136 @@ ocf_cache_t ocf_metadata_updater_get_cache(ocf_metadata_updater_t mu)
 	return container_of(mu, struct ocf_cache, metadata_updater);
 }
 
-static int _metadata_updater_iterate_in_progress(ocf_cache_t cache,
-		struct list_head *finished, struct metadata_io_request *new_req)
+void ocf_metadata_updater_get_stats(ocf_cache_t cache,
+		struct ocf_metadata_updater_stats *stats)
+{
+	ocf_metadata_updater_t mu;
+
+	OCF_CHECK_NULL(cache);
+	OCF_CHECK_NULL(stats);
+
+	mu = &cache->metadata_updater;
+
+	stats->flush_requests = env_atomic64_read(&mu->stats.flush_requests);
+	stats->write_requests = env_atomic64_read(&mu->stats.write_requests);
+	stats->merged_writes = env_atomic64_read(&mu->stats.merged_writes);
+	stats->write_ios = env_atomic64_read(&mu->stats.write_ios);
+	stats->lock_acquisitions =
+			env_atomic64_read(&mu->stats.lock_acquisitions);
+	stats->lock_held_ns = env_ticks_to_nsecs(
+			env_atomic64_read(&mu->stats.lock_held_ticks));
+}
+
+static void metadata_updater_lock(ocf_metadata_updater_t mu)
+{
+	env_mutex_lock(&mu->syncher.lock);
+	mu->syncher.lock_ticks = env_get_tick_count();
+	env_atomic64_inc(&mu->stats.lock_acquisitions);
+}
+
+static void metadata_updater_unlock(ocf_metadata_updater_t mu)
+{
+	uint64_t held = env_get_tick_count() - mu->syncher.lock_ticks;
+
+	env_atomic64_add(held, &mu->stats.lock_held_ticks);
+	env_mutex_unlock(&mu->syncher.lock);
+}
+
+static inline uint32_t _metadata_updater_bucket(uint32_t page)
+{
+	return (page >> METADATA_UPDATER_RANGE_SHIFT) %
+			METADATA_UPDATER_INDEX_SIZE;
+}
+
+/*
+ * Recompute longest request of the bucket, and of all buckets if the bucket
+ * held the longest one. Called under the syncher lock after requests were
+ * removed from the bucket.
+ */
+static void _metadata_updater_update_max_count(
+		struct ocf_metadata_io_syncher *syncher, uint32_t bucket)
+{
+	struct metadata_io_request *curr;
+	uint32_t old_max = syncher->bucket_max_count[bucket];
+	uint32_t max = 0;
+	uint32_t i;
+
+	list_for_each_entry(curr, &syncher->in_progress[bucket], list)
+		max = OCF_MAX(max, curr->count);
+	syncher->bucket_max_count[bucket] = max;
+
+	if (old_max < syncher->max_count)
+		return;
+
+	max = 0;
+	for (i = 0; i < METADATA_UPDATER_INDEX_SIZE; i++)
+		max = OCF_MAX(max, syncher->bucket_max_count[i]);
+	syncher->max_count = max;
+}
+
+/*
+ * Move requests whose I/O has completed out of the in-progress index to
+ * the empty finished list. Called under the syncher lock.
+ */
+static void _metadata_updater_collect_finished(
+		struct ocf_metadata_io_syncher *syncher,
+		struct list_head *finished)
 {
-	struct ocf_metadata_io_syncher *syncher =
-			&cache->metadata_updater.syncher;
 	struct metadata_io_request *curr, *temp;
+	unsigned long flags = 0;
+	uint32_t bucket;
+
+	env_spinlock_lock_irqsave(&syncher->finished_lock, flags);
+	list_for_each_entry_safe(curr, temp, &syncher->finished_head,
+			finished_list) {
+		list_del(&curr->finished_list);
+		list_move_tail(&curr->list, finished);
+	}
+	env_spinlock_unlock_irqrestore(&syncher->finished_lock, flags);
+
+	/* Bucket is scanned again only if its longest request finished */
+	list_for_each_entry(curr, finished, list) {
+		bucket = _metadata_updater_bucket(curr->page);
+		if (curr->count >= syncher->bucket_max_count[bucket])
+			_metadata_updater_update_max_count(syncher, bucket);
+	}
+}
+
+/*
+ * Check if request overlaps any one in progress. Only buckets of ranges
+ * in which an overlapping request could start are searched, and buckets
+ * of ranges before the request only if their longest request reaches it.
+ */
+static int _metadata_updater_overlaps(struct ocf_metadata_io_syncher *syncher,
+		struct metadata_io_request *new_req)
+{
+	struct metadata_io_request *curr;
+	uint32_t first, last, range, bucket;
+	uint64_t range_end;
+	bool wrapped = false;
 
-	list_for_each_entry_safe(curr, temp, &syncher->in_progress_head, list) {
-		if (env_atomic_read(&curr->finished)) {
-			list_move_tail(&curr->list, finished);
+	first = new_req->page > syncher->max_count ?
+			new_req->page - syncher->max_count + 1 : 0;
+	first >>= METADATA_UPDATER_RANGE_SHIFT;
+	last = (new_req->page + new_req->count - 1) >>
+			METADATA_UPDATER_RANGE_SHIFT;
+
+	if (last - first >= METADATA_UPDATER_INDEX_SIZE) {
+		/* Every bucket holds ranges within the request */
+		last = first + METADATA_UPDATER_INDEX_SIZE - 1;
+		wrapped = true;
+	}
+
+	for (range = first; range <= last; range++) {
+		bucket = range % METADATA_UPDATER_INDEX_SIZE;
+		range_end = (uint64_t)(range + 1) << METADATA_UPDATER_RANGE_SHIFT;
+		if (!wrapped && range_end - 1 +
+				syncher->bucket_max_count[bucket] <=
+				new_req->page) {
 			continue;
 		}
-		if (new_req) {
-			/* If request specified, check if overlap occurs. */
+
+		list_for_each_entry(curr, &syncher->in_progress[bucket], list) {
 			if (ocf_io_overlaps(new_req->page, new_req->count,
 					curr->page, curr->count)) {
 				return 1;
@@ -77,39 +223,119 @@ static int _metadata_updater_iterate_in_progress(ocf_cache_t cache,
 	return 0;
 }
 
+static void _metadata_updater_start(ocf_metadata_updater_t mu,
+		struct metadata_io_request *m_req)
+{
+	struct ocf_metadata_io_syncher *syncher = &mu->syncher;
+	uint32_t bucket = _metadata_updater_bucket(m_req->page);
+
+	list_add_tail(&m_req->list, &syncher->in_progress[bucket]);
+	syncher->bucket_max_count[bucket] = OCF_MAX(
+			syncher->bucket_max_count[bucket], m_req->count);
+	syncher->max_count = OCF_MAX(syncher->max_count, m_req->count);
+
+	if (m_req->req.rw == OCF_WRITE)
+		env_atomic64_inc(&mu->stats.write_ios);
+}
+
+/*
+ * Find pending write which will fill all the pages of the new one with
+ * the same handler. Metadata is filled in when the write is dispatched,
+ * so it also carries the update the new request was issued for. Writes of
+ * different contexts are merged only if their handler fills in live
+ * metadata, otherwise pending write could carry other data.
+ */
+static struct metadata_io_request *_metadata_updater_find_leader(
+		struct ocf_metadata_io_syncher *syncher,
+		struct metadata_io_request *new_req)
+{
+	struct metadata_io_request *curr;
+
+	if (new_req->req.rw != OCF_WRITE)
+		return NULL;
+
+	list_for_each_entry(curr, &syncher->pending_head, list) {
+		if (curr->req.rw != OCF_WRITE ||
+				curr->on_meta_fill != new_req->on_meta_fill) {
+			continue;
+		}
+
+		/* Handler is registered either as live or not everywhere */
+		ENV_BUG_ON(curr->live != new_req->live);
+
+		if (curr->context != new_req->context && !curr->live)
+			continue;
+
+		if (curr->page <= new_req->page && curr->page + curr->count >=
+				new_req->page + new_req->count) {
+			return curr;
+		}
+	}
+
+	return NULL;
+}
+
 static void metadata_updater_process_finished(struct list_head *finished)
 {
-	struct metadata_io_request *curr, *temp;
+	struct metadata_io_request *curr, *temp, *member, *next;
 
 	list_for_each_entry_safe(curr, temp, finished, list) {
 		list_del(&curr->list);
+		list_for_each_entry_safe(member, next, &curr->group, list) {
+			list_del(&member->list);
+			metadata_io_req_merged_end(member, curr->error);
+		}
 		metadata_io_req_complete(curr);
 	}
 }
 
+void metadata_updater_finish(struct metadata_io_request *m_req)
+{
+	struct ocf_metadata_io_syncher *syncher =
+			&m_req->cache->metadata_updater.syncher;
+	unsigned long flags = 0;
+
+	env_spinlock_lock_irqsave(&syncher->finished_lock, flags);
+	list_add_tail(&m_req->finished_list, &syncher->finished_head);
+	env_spinlock_unlock_irqrestore(&syncher->finished_lock, flags);
+}
+
 void metadata_updater_submit(struct metadata_io_request *m_req)
 {
 	ocf_cache_t cache = m_req->cache;
-	struct ocf_metadata_io_syncher *syncher =
-			&cache->metadata_updater.syncher;
+	ocf_metadata_updater_t mu = &cache->metadata_updater;
+	struct ocf_metadata_io_syncher *syncher = &mu->syncher;
+	struct metadata_io_request *leader = NULL;
 	struct list_head finished;
 	int ret;
 
 	INIT_LIST_HEAD(&finished);
 
-	env_mutex_lock(&syncher->lock);
+	if (m_req->req.rw == OCF_WRITE)
+		env_atomic64_inc(&mu->stats.write_requests);
+
+	metadata_updater_lock(mu);
 
-	ret = _metadata_updater_iterate_in_progress(cache, &finished, m_req);
+	_metadata_updater_collect_finished(syncher, &finished);
 
-	/* Either add it to in-progress list or pending list for deferred
-	 * execution.
+	ret = _metadata_updater_overlaps(syncher, m_req);
+
+	/* Either add it to in-progress list, merge it with pending write
+	 * of the same pages or add it to pending list for deferred execution.
 	 */
-	if (ret == 0)
-		list_add_tail(&m_req->list, &syncher->in_progress_head);
-	else
-		list_add_tail(&m_req->list, &syncher->pending_head);
+	if (ret == 0) {
+		_metadata_updater_start(mu, m_req);
+	} else {
+		leader = _metadata_updater_find_leader(syncher, m_req);
+		if (leader) {
+			list_add_tail(&m_req->list, &leader->group);
+			env_atomic64_inc(&mu->stats.merged_writes);
+		} else {
+			list_add_tail(&m_req->list, &syncher->pending_head);
+		}
+	}
 
-	env_mutex_unlock(&syncher->lock);
+	metadata_updater_unlock(mu);
 
 	if (ret == 0)
 		ocf_engine_push_req_front(&m_req->req, true);
@@ -122,42 +348,44 @@ uint32_t ocf_metadata_updater_run(ocf_metadata_updater_t mu)
 	struct metadata_io_request *curr, *temp;
 	struct ocf_metadata_io_syncher *syncher;
 	struct list_head finished;
-	ocf_cache_t cache;
 	int ret;
 
 	OCF_CHECK_NULL(mu);
 
 	INIT_LIST_HEAD(&finished);
 
-	cache = ocf_metadata_updater_get_cache(mu);
-	syncher = &cache->metadata_updater.syncher;
+	syncher = &mu->syncher;
 
-	env_mutex_lock(&syncher->lock);
+	metadata_updater_lock(mu);
+	_metadata_updater_collect_finished(syncher, &finished);
 	if (list_empty(&syncher->pending_head)) {
 		/*
-		 * If pending list is empty, we iterate over in progress
-		 * list to free memory used by finished requests.
+		 * If pending list is empty, only free memory used by
+		 * finished requests.
 		 */
-		_metadata_updater_iterate_in_progress(cache, &finished, NULL);
-		env_mutex_unlock(&syncher->lock);
+		metadata_updater_unlock(mu);
 		metadata_updater_process_finished(&finished);
 		env_cond_resched();
 		return 0;
 	}
 	list_for_each_entry_safe(curr, temp, &syncher->pending_head, list) {
-		ret = _metadata_updater_iterate_in_progress(cache, &finished, curr);
+		ret = _metadata_updater_overlaps(syncher, curr);
 		if (ret == 0) {
 			/* Move to in-progress list and kick the workers */
-			list_move_tail(&curr->list, &syncher->in_progress_head);
+			list_del(&curr->list);
+			_metadata_updater_start(mu, curr);
 		}
-		env_mutex_unlock(&syncher->lock);
+		metadata_updater_unlock(mu);
 		metadata_updater_process_finished(&finished);
+		INIT_LIST_HEAD(&finished);
 		if (ret == 0)
 			ocf_engine_push_req_front(&curr->req, true);
 		env_cond_resched();
-		env_mutex_lock(&syncher->lock);
+		metadata_updater_lock(mu);
+		_metadata_updater_collect_finished(syncher, &finished);
 	}
-	env_mutex_unlock(&syncher->lock);
+	metadata_updater_unlock(mu);
+	metadata_updater_process_finished(&finished);
 
 	return 0;
 }
@@ -9,20 +9,45 @@
 #include "../ocf_def_priv.h"
 #include "metadata_io.h"
 
+/* In-progress requests are hashed by the range of
+ * (1 << METADATA_UPDATER_RANGE_SHIFT) metadata pages they start in */
+#define METADATA_UPDATER_RANGE_SHIFT 5
+#define METADATA_UPDATER_INDEX_SIZE 256
+
 struct ocf_metadata_updater {
 	/* Metadata flush synchronizer context */
 	struct ocf_metadata_io_syncher {
-		struct list_head in_progress_head;
+		struct list_head in_progress[METADATA_UPDATER_INDEX_SIZE];
+		uint32_t bucket_max_count[METADATA_UPDATER_INDEX_SIZE];
+			/* Longest request in progress in each bucket */
+		uint32_t max_count;
+			/* Longest request in progress in any bucket */
 		struct list_head pending_head;
 		env_mutex lock;
+		uint64_t lock_ticks;
+
+		/* Requests whose I/O has completed */
+		struct list_head finished_head;
+		env_spinlock finished_lock;
 	} syncher;
 
+	struct {
+		env_atomic64 flush_requests;
+		env_atomic64 write_requests;
+		env_atomic64 merged_writes;
+		env_atomic64 write_ios;
+		env_atomic64 lock_acquisitions;
+		env_atomic64 lock_held_ticks;
+	} stats;
+
 	void *priv;
 };
 
 
 void metadata_updater_submit(struct metadata_io_request *m_req);
 
+void metadata_updater_finish(struct metadata_io_request *m_req);
+
 int ocf_metadata_updater_init(struct ocf_cache *cache);
 
 void ocf_metadata_updater_kick(struct ocf_cache *cache);
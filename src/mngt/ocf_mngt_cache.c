@@ -306,9 +306,13 @@ static ocf_error_t init_attached_data_structures(ocf_cache_t cache,
 	/* Lock to ensure consistency */
 
 	ocf_metadata_init_hash_table(cache);
-	ocf_metadata_init_collision(cache);
+	/* Collision table and freelist are initialized lazily, if enabled */
+	if (!cache->lazy_init)
+		ocf_metadata_init_collision(cache);
 	__init_partitions_attached(cache);
-	__init_freelist(cache);
+	if (!cache->lazy_init)
+		__init_freelist(cache);
+	ocf_core_index_reset(cache->core_index);
 
 	result = __init_cleaning_policy(cache);
 	if (result) {
@@ -354,6 +358,8 @@ static void _ocf_mngt_close_all_uninitialized_cores(
 
 		env_free(cache->core[i].counters);
 		cache->core[i].counters = NULL;
+		ocf_core_index_remove_core(cache->core_index, &cache->core[i]);
+		ocf_core_io_class_ranges_deinit(&cache->core[i]);
 
 		env_bit_clear(i, cache->conf_meta->valid_core_bitmap);
 	}
@@ -418,6 +424,7 @@ static int _ocf_mngt_init_instance_add_cores(
 		core->added = true;
 		cache->conf_meta->core_count++;
 		core->volume.cache = cache;
+		ocf_core_io_class_ranges_init(core);
 
 		if (ocf_mngt_core_init_front_volume(core))
 			goto err;
@@ -471,6 +478,7 @@ void _ocf_mngt_init_instance_load_complete(void *priv, int error)
 	}
 
 	__init_freelist(cache);
+	ocf_core_index_rebuild(cache->core_index);
 
 	cleaning_policy = cache->conf_meta->cleaning_policy_type;
 	if (!cleaning_policy_ops[cleaning_policy].initialize)
@@ -894,6 +902,14 @@ static void _ocf_mngt_attach_load_properties_end(void *priv, int error,
 	struct ocf_cache_attach_context *context = priv;
 	ocf_cache_t cache = context->cache;
 
+	/* Cache was stopped before lazily initialized metadata was flushed,
+	 * collision segment on cache device can not be trusted */
+	if (!error && properties->lazy_init_pending) {
+		ocf_cache_log(cache, log_warn, "Metadata was not initialized "
+				"on cache device\n");
+		error = -OCF_ERR_NO_METADATA;
+	}
+
 	context->metadata.status = error;
 
 	if (error) {
@@ -928,6 +944,7 @@ static void _ocf_mngt_attach_load_properties_end(void *priv, int error,
 	if (cache->device->init_mode == ocf_init_mode_load) {
 		context->metadata.line_size = properties->line_size;
 		cache->conf_meta->metadata_layout = properties->layout;
+		cache->conf_meta->compact_metadata = properties->compact;
 		cache->conf_meta->cache_mode = properties->cache_mode;
 	}
 
@@ -945,6 +962,8 @@ static void _ocf_mngt_attach_load_properties(ocf_pipeline_t pipeline,
 	context->metadata.shutdown_status = ocf_metadata_clean_shutdown;
 	context->metadata.dirty_flushed = DIRTY_FLUSHED;
 	context->metadata.line_size = context->cfg.cache_line_size;
+	cache->conf_meta->compact_metadata = context->cfg.compact_metadata;
+	cache->conf_meta->lazy_init_pending = false;
 
 	if (context->cfg.force)
 		OCF_PL_NEXT_RET(context->pipeline);
@@ -986,6 +1005,14 @@ static void _ocf_mngt_attach_prepare_metadata(ocf_pipeline_t pipeline,
 		OCF_PL_FINISH_RET(context->pipeline, -OCF_ERR_START_CACHE_FAIL);
 	context->flags.freelist_inited = true;
 
+	if (context->cfg.core_line_index) {
+		cache->core_index = ocf_core_index_init(cache);
+		if (!cache->core_index) {
+			OCF_PL_FINISH_RET(context->pipeline,
+					-OCF_ERR_START_CACHE_FAIL);
+		}
+	}
+
 	ret = ocf_concurrency_init(cache);
 	if (ret)
 		OCF_PL_FINISH_RET(context->pipeline, ret);
@@ -1001,6 +1028,7 @@ static void _ocf_mngt_attach_prepare_metadata(ocf_pipeline_t pipeline,
 static void _ocf_mngt_init_instance_init(struct ocf_cache_attach_context *context)
 {
 	ocf_cache_t cache = context->cache;
+	ocf_eviction_t eviction_policy;
 	ocf_error_t result;
 
 	if (!context->metadata.status && !context->cfg.force &&
@@ -1023,7 +1051,24 @@ static void _ocf_mngt_init_instance_init(struct ocf_cache_attach_context *contex
 		}
 	}
 
-	result = init_attached_data_structures(cache, cache->eviction_policy_init);
+	if (context->cfg.lazy_init) {
+		cache->lazy_init = ocf_lazy_init_init(cache);
+		if (!cache->lazy_init)
+			OCF_PL_FINISH_RET(context->pipeline, -OCF_ERR_NO_MEM);
+		cache->conf_meta->lazy_init_pending = true;
+	}
+
+	eviction_policy = cache->eviction_policy_init;
+	if (cache->conf_meta->compact_metadata &&
+			eviction_policy != ocf_eviction_clock) {
+		/* Compact metadata has no room for LRU list pointers */
+		ocf_cache_log(cache, log_info, "Using %s eviction policy "
+				"with compact metadata\n",
+				evict_policy_ops[ocf_eviction_clock].name);
+		eviction_policy = ocf_eviction_clock;
+	}
+
+	result = init_attached_data_structures(cache, eviction_policy);
 	if (result)
 		OCF_PL_FINISH_RET(context->pipeline, result);
 
@@ -1036,7 +1081,8 @@ static void _ocf_mngt_init_instance_init(struct ocf_cache_attach_context *contex
 }
 
 uint64_t _ocf_mngt_calculate_ram_needed(ocf_cache_t cache,
-		ocf_volume_t cache_volume)
+		ocf_volume_t cache_volume, bool core_line_index,
+		bool compact_metadata)
 {
 	ocf_cache_line_size_t line_size = ocf_line_size(cache);
 	uint64_t volume_size = ocf_volume_get_length(cache_volume);
@@ -1052,8 +1098,18 @@ uint64_t _ocf_mngt_calculate_ram_needed(ocf_cache_t cache,
 	cache_line_no = volume_size / line_size;
 	data_per_line = (68 + (2 * (line_size / KiB / 4)));
 
+	/* Narrower core info holding CLOCK reference bit instead of LRU list */
+	if (compact_metadata) {
+		data_per_line -= sizeof(struct ocf_metadata_map) -
+				sizeof(struct ocf_metadata_map_compact);
+		data_per_line -= sizeof(union eviction_policy_meta);
+	}
+
 	min_free_ram = const_data_size + cache_line_no * data_per_line;
 
+	if (core_line_index)
+		min_free_ram += ocf_core_index_size(cache_line_no);
+
 	/* 110% of calculated value */
 	min_free_ram = (11 * min_free_ram) / 10;
 
@@ -1086,7 +1142,8 @@ int ocf_mngt_get_ram_needed(ocf_cache_t cache,
 		return result;
 	}
 
-	*ram_needed = _ocf_mngt_calculate_ram_needed(cache, volume);
+	*ram_needed = _ocf_mngt_calculate_ram_needed(cache, volume,
+			cfg->core_line_index, cfg->compact_metadata);
 
 	ocf_volume_close(volume);
 	ocf_volume_destroy(volume);
@@ -1150,6 +1207,12 @@ static void _ocf_mngt_attach_handle_error(
 	if (context->flags.freelist_inited)
 		ocf_freelist_deinit(cache->freelist);
 
+	ocf_core_index_deinit(cache->core_index);
+	cache->core_index = NULL;
+
+	ocf_lazy_init_deinit(cache->lazy_init);
+	cache->lazy_init = NULL;
+
 	if (context->flags.volume_inited)
 		ocf_volume_deinit(&cache->device->volume);
 
@@ -1283,7 +1346,8 @@ static void _ocf_mngt_attach_check_ram(ocf_pipeline_t pipeline,
 	uint64_t free_ram;
 
 	min_free_ram = _ocf_mngt_calculate_ram_needed(cache,
-			&cache->device->volume);
+			&cache->device->volume, context->cfg.core_line_index,
+			context->cfg.compact_metadata);
 
 	free_ram = env_get_free_memory();
 
@@ -1394,6 +1458,16 @@ static void _ocf_mngt_attach_flush_metadata(ocf_pipeline_t pipeline,
 	struct ocf_cache_attach_context *context = priv;
 	ocf_cache_t cache = context->cache;
 
+	/* Lazily initialized metadata is flushed once it is initialized,
+	 * until then superblock marks it as not initialized */
+	if (cache->lazy_init) {
+		ocf_metadata_set_shutdown_status(cache,
+				ocf_metadata_dirty_shutdown,
+				_ocf_mngt_attach_flush_metadata_complete,
+				context);
+		return;
+	}
+
 	ocf_metadata_flush_all(cache,
 			_ocf_mngt_attach_flush_metadata_complete, context);
 }
@@ -1503,6 +1577,8 @@ static void _ocf_mngt_attach_post_init(ocf_pipeline_t pipeline,
 	ocf_cleaner_refcnt_unfreeze(cache);
 	ocf_refcnt_unfreeze(&cache->refcnt.metadata);
 
+	ocf_lazy_init_start(cache->lazy_init);
+
 	ocf_cache_log(cache, log_debug, "Cache attached\n");
 
 	ocf_pipeline_next(context->pipeline);
@@ -1962,6 +2038,10 @@ static void _ocf_mngt_cache_unplug_complete(void *priv, int error)
 	ocf_metadata_deinit_variable_size(cache);
 	ocf_concurrency_deinit(cache);
 	ocf_freelist_deinit(cache->freelist);
+	ocf_core_index_deinit(cache->core_index);
+	cache->core_index = NULL;
+	ocf_lazy_init_deinit(cache->lazy_init);
+	cache->lazy_init = NULL;
 
 	ocf_volume_deinit(&cache->device->volume);
 
@@ -117,6 +117,8 @@ void cache_mngt_core_remove_from_cache(ocf_core_t core)
 
 	env_free(core->counters);
 	core->counters = NULL;
+	ocf_core_index_remove_core(cache->core_index, core);
+	ocf_core_io_class_ranges_deinit(core);
 	core->added = false;
 	env_bit_clear(core_id, cache->conf_meta->valid_core_bitmap);
 
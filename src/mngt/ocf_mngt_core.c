@@ -9,6 +9,7 @@
 #include "../ocf_priv.h"
 #include "../metadata/metadata.h"
 #include "../engine/cache_engine.h"
+#include "../utils/utils_cache_line.h"
 #include "../utils/utils_pipeline.h"
 #include "../ocf_stats_priv.h"
 #include "../ocf_def_priv.h"
@@ -121,6 +122,8 @@ static void _ocf_mngt_cache_add_core_handle_error(
 
 		env_free(core->counters);
 		core->counters = NULL;
+		ocf_core_index_remove_core(cache->core_index, core);
+		ocf_core_io_class_ranges_deinit(core);
 	}
 
 	if (context->flags.clean_pol_added) {
@@ -395,6 +398,15 @@ static void ocf_mngt_cache_add_core_insert(ocf_pipeline_t pipeline,
 	if (!length)
 		OCF_PL_FINISH_RET(pipeline, -OCF_ERR_CORE_NOT_AVAIL);
 
+	if (ocf_cache_is_device_attached(cache) &&
+			cache->conf_meta->compact_metadata &&
+			ocf_bytes_2_lines_round_up(cache, length) >=
+			OCF_METADATA_COMPACT_CORE_LINE_INVALID) {
+		ocf_cache_log(cache, log_err, "Core exceeds maximum size "
+				"supported by compact metadata\n");
+		OCF_PL_FINISH_RET(pipeline, -OCF_ERR_CORE_SIZE_UNSUPPORTED);
+	}
+
 	core->conf_meta->length = length;
 
 	clean_type = cache->conf_meta->cleaning_policy_type;
@@ -418,11 +430,14 @@ static void ocf_mngt_cache_add_core_insert(ocf_pipeline_t pipeline,
 
 	context->flags.counters_allocated = true;
 
+	ocf_core_io_class_ranges_init(core);
+
 	/* When adding new core to cache, reset all core/cache statistics */
 	ocf_core_stats_initialize(core);
 	env_atomic_set(&core->runtime_meta->cached_clines, 0);
 	env_atomic_set(&core->runtime_meta->dirty_clines, 0);
 	env_atomic64_set(&core->runtime_meta->dirty_since, 0);
+	ocf_core_index_add_core(cache->core_index, core);
 
 	/* In metadata mark data this core was added into cache */
 	env_bit_set(core_id, cache->conf_meta->valid_core_bitmap);
@@ -35,6 +35,16 @@ struct flush_containers_context
 	env_atomic interrupt_seen;
 	/* completion to be called after all containers are flushed */
 	ocf_flush_complete_t complete;
+	/* protects fields below */
+	env_spinlock lock;
+	/* containers waiting for portions in flight or rate budget */
+	struct list_head waiting;
+	/* number of lines in flight in all containers */
+	uint32_t inflight;
+	/* flush rate budget in bytes */
+	uint64_t tokens;
+	/* time of last rate budget refill */
+	uint64_t tokens_ticks;
 };
 
 /* common struct for cache/core flush/purge pipeline priv */
@@ -137,6 +147,39 @@ bool ocf_mngt_cache_is_dirty(ocf_cache_t cache)
  * NOTE:
  * Table is not sorted.
  */
+/*
+ * Collect dirty lines of the core from core index. Metadata exclusive access
+ * is kept for the whole walk, so that the list does not change under it.
+ */
+static uint32_t _ocf_mngt_get_sectors_indexed(ocf_cache_t cache,
+		ocf_core_id_t core_id, struct flush_data *tbl,
+		uint32_t dirty_total)
+{
+	ocf_cache_line_t end = cache->device->collision_table_entries;
+	ocf_cache_line_t line;
+	uint64_t core_line;
+	uint32_t dirty_found = 0, step = 0;
+
+	for (line = ocf_core_index_first(cache->core_index, core_id);
+			line != end && dirty_found < dirty_total;
+			line = ocf_core_index_next(cache->core_index, line)) {
+		if (metadata_test_valid_any(cache, line) &&
+				metadata_test_dirty(cache, line)) {
+			ocf_metadata_get_core_info(cache, line, NULL,
+					&core_line);
+
+			tbl[dirty_found].cache_line = line;
+			tbl[dirty_found].core_line = core_line;
+			tbl[dirty_found].core_id = core_id;
+			dirty_found++;
+		}
+
+		OCF_COND_RESCHED(step, 131072);
+	}
+
+	return dirty_found;
+}
+
 static int _ocf_mngt_get_sectors(ocf_cache_t cache, ocf_core_id_t core_id,
 		struct flush_data **tbl, uint32_t *num)
 {
@@ -162,6 +205,14 @@ static int _ocf_mngt_get_sectors(ocf_cache_t cache, ocf_core_id_t core_id,
 		goto unlock;
 	}
 
+	if (ocf_core_index_active(cache->core_index)) {
+		dirty_found = _ocf_mngt_get_sectors_indexed(cache, core_id,
+				*tbl, dirty_total);
+		goto found;
+	}
+
+	ocf_lazy_init_complete(cache->lazy_init);
+
 	for (line = 0, elem = *tbl;
 			line < cache->device->collision_table_entries;
 			line++) {
@@ -192,6 +243,7 @@ static int _ocf_mngt_get_sectors(ocf_cache_t cache, ocf_core_id_t core_id,
 		}
 	}
 
+found:
 	ocf_core_log(core, log_debug,
 			"%u dirty cache lines to clean\n", dirty_found);
 
@@ -231,8 +283,10 @@ static int _ocf_mngt_get_flush_containers(ocf_cache_t cache,
 	}
 
 	core_revmap = env_vzalloc(sizeof(*core_revmap) * OCF_CORE_MAX);
-	if (!core_revmap)
-		return -OCF_ERR_NO_MEM;
+	if (!core_revmap) {
+		ret = -OCF_ERR_NO_MEM;
+		goto unlock;
+	}
 
 	/* TODO: Alloc fcs and data tables in single allocation */
 	fc = env_vzalloc(sizeof(**fctbl) * num);
@@ -267,6 +321,8 @@ static int _ocf_mngt_get_flush_containers(ocf_cache_t cache,
 		goto unlock;
 	}
 
+	ocf_lazy_init_complete(cache->lazy_init);
+
 	for (line = 0; line < cache->device->collision_table_entries; line++) {
 		ocf_metadata_get_core_info(cache, line, &core_id, &core_line);
 
@@ -332,17 +388,17 @@ static void _ocf_mngt_free_flush_containers(struct flush_container *fctbl,
 #define OCF_MNG_FLUSH_MIN (4*MiB / ocf_line_size(cache))
 #define OCF_MNG_FLUSH_MAX (100*MiB / ocf_line_size(cache))
 
-static void _ocf_mngt_flush_portion(struct flush_container *fc)
+/* Adjust flush portion to the amount of lines flushed in one second */
+static void _ocf_mngt_flush_portion_adapt(struct flush_container *fc)
 {
 	ocf_cache_t cache = fc->cache;
 	uint64_t flush_portion_div;
-	uint32_t curr_count;
 
 	flush_portion_div = env_ticks_to_msecs(fc->ticks2 - fc->ticks1);
 	if (unlikely(!flush_portion_div))
 		flush_portion_div = 1;
 
-	fc->flush_portion = fc->flush_portion * 1000 / flush_portion_div;
+	fc->flush_portion = fc->inflight * 1000 / flush_portion_div;
 	fc->flush_portion &= ~0x3ffULL;
 
 	/* regardless those calculations, limit flush portion to be
@@ -350,30 +406,134 @@ static void _ocf_mngt_flush_portion(struct flush_container *fc)
 	 */
 	fc->flush_portion = OCF_MIN(fc->flush_portion, OCF_MNG_FLUSH_MAX);
 	fc->flush_portion = OCF_MAX(fc->flush_portion, OCF_MNG_FLUSH_MIN);
+}
 
-	curr_count = OCF_MIN(fc->count - fc->iter, fc->flush_portion);
+static void _ocf_mngt_flush_portion(struct flush_container *fc,
+		uint32_t count)
+{
+	fc->ticks1 = env_get_tick_count();
 
 	ocf_cleaner_do_flush_data_async(fc->cache,
 			&fc->flush_data[fc->iter],
-			curr_count, &fc->attribs);
+			count, &fc->attribs);
 
-	fc->iter += curr_count;
+	fc->iter += count;
 }
 
-static void _ocf_mngt_flush_portion_end(void *private_data, int error)
+/*
+ * Refill flush rate budget and take up to count lines from it. Returns 0
+ * if budget does not cover a single line.
+ */
+static uint32_t _ocf_mngt_flush_rate_take(struct flush_containers_context *fsc,
+		ocf_cache_t cache, uint64_t max_rate, uint32_t count)
 {
-	struct flush_container *fc = private_data;
-	struct ocf_mngt_cache_flush_context *context = fc->context;
-	struct flush_containers_context *fsc = &context->fcs;
-	ocf_cache_t cache = context->cache;
-	ocf_core_t core = &cache->core[fc->core_id];
-	bool first_interrupt;
+	uint64_t line_size = ocf_line_size(cache);
+	uint64_t burst = OCF_MAX(max_rate / 10, line_size);
+	uint64_t now = env_get_tick_count();
+	uint64_t elapsed_us;
 
-	env_atomic_set(&core->flushed, fc->iter);
+	elapsed_us = env_ticks_to_nsecs(now - fsc->tokens_ticks) / 1000;
+	elapsed_us = OCF_MIN(elapsed_us, 1000000ULL);
+	fsc->tokens_ticks = now;
 
-	fc->ticks2 = env_get_tick_count();
+	fsc->tokens = OCF_MIN(burst,
+			fsc->tokens + max_rate * elapsed_us / 1000000);
 
-	env_atomic_cmpxchg(&fsc->error, 0, error);
+	if (fsc->tokens < line_size)
+		return 0;
+
+	count = OCF_MIN(count, fsc->tokens / line_size);
+	fsc->tokens -= count * line_size;
+
+	return count;
+}
+
+/*
+ * Limit portion of the container to flush limits of the cache. Returns
+ * number of lines to be flushed now, or 0 if the container will be resumed
+ * later - after one of portions in flight completes, or from management
+ * queue if it waits for rate budget with nothing in flight.
+ */
+static uint32_t _ocf_mngt_flush_throttle(struct flush_container *fc,
+		uint32_t count)
+{
+	struct flush_containers_context *fsc = &fc->context->fcs;
+	ocf_cache_t cache = fc->cache;
+	uint32_t max_inflight = env_atomic_read(
+			&cache->flush_limits.max_inflight);
+	uint64_t max_rate = env_atomic64_read(&cache->flush_limits.max_rate);
+
+	env_spinlock_lock(&fsc->lock);
+
+	if (max_inflight) {
+		if (fsc->inflight >= max_inflight) {
+			list_add_tail(&fc->waiting, &fsc->waiting);
+			env_spinlock_unlock(&fsc->lock);
+			return 0;
+		}
+		count = OCF_MIN(count, max_inflight - fsc->inflight);
+	}
+
+	if (max_rate)
+		count = _ocf_mngt_flush_rate_take(fsc, cache, max_rate, count);
+
+	if (!count && fsc->inflight) {
+		list_add_tail(&fc->waiting, &fsc->waiting);
+		env_spinlock_unlock(&fsc->lock);
+		return 0;
+	}
+
+	if (!count) {
+		/* No completion will resume the container, so it is queued
+		 * again to check the budget after other requests */
+		env_spinlock_unlock(&fsc->lock);
+		env_cond_resched();
+		ocf_engine_push_req_back(fc->req, false);
+		return 0;
+	}
+
+	fsc->inflight += count;
+	fc->inflight = count;
+
+	env_spinlock_unlock(&fsc->lock);
+
+	return count;
+}
+
+/* Return inflight budget of completed portion, if any, and resume waiting
+ * containers */
+static void _ocf_mngt_flush_resume(struct flush_containers_context *fsc,
+		uint32_t completed)
+{
+	struct flush_container *waiting, *tmp;
+	struct list_head resume;
+
+	INIT_LIST_HEAD(&resume);
+
+	env_spinlock_lock(&fsc->lock);
+	fsc->inflight -= completed;
+	list_for_each_entry_safe(waiting, tmp, &fsc->waiting, waiting)
+		list_move_tail(&waiting->waiting, &resume);
+	env_spinlock_unlock(&fsc->lock);
+
+	list_for_each_entry_safe(waiting, tmp, &resume, waiting) {
+		list_del(&waiting->waiting);
+		ocf_engine_push_req_back(waiting->req, false);
+	}
+}
+
+static void _ocf_mngt_flush_portion_release(struct flush_container *fc)
+{
+	_ocf_mngt_flush_resume(&fc->context->fcs, fc->inflight);
+	fc->inflight = 0;
+}
+
+/* Returns error which should stop all containers, if any */
+static int _ocf_mngt_flush_error(struct ocf_mngt_cache_flush_context *context)
+{
+	struct flush_containers_context *fsc = &context->fcs;
+	ocf_cache_t cache = context->cache;
+	bool first_interrupt;
 
 	if (cache->flushing_interrupted) {
 		first_interrupt = !env_atomic_cmpxchg(
@@ -386,9 +546,35 @@ static void _ocf_mngt_flush_portion_end(void *private_data, int error)
 		}
 	}
 
-	if (env_atomic_read(&fsc->error) || fc->iter == fc->count) {
-		ocf_req_put(fc->req);
-		fc->end(context);
+	return env_atomic_read(&fsc->error);
+}
+
+static void _ocf_mngt_flush_container_end(struct flush_container *fc)
+{
+	ocf_req_put(fc->req);
+	fc->end(fc->context);
+}
+
+static void _ocf_mngt_flush_portion_end(void *private_data, int error)
+{
+	struct flush_container *fc = private_data;
+	struct ocf_mngt_cache_flush_context *context = fc->context;
+	struct flush_containers_context *fsc = &context->fcs;
+	ocf_cache_t cache = context->cache;
+	ocf_core_t core = &cache->core[fc->core_id];
+
+	env_atomic_set(&core->flushed, fc->iter);
+	env_atomic64_add(fc->inflight, &cache->flush_progress.flushed);
+
+	fc->ticks2 = env_get_tick_count();
+	_ocf_mngt_flush_portion_adapt(fc);
+
+	env_atomic_cmpxchg(&fsc->error, 0, error);
+
+	_ocf_mngt_flush_portion_release(fc);
+
+	if (_ocf_mngt_flush_error(context) || fc->iter == fc->count) {
+		_ocf_mngt_flush_container_end(fc);
 		return;
 	}
 
@@ -400,9 +586,20 @@ static int _ofc_flush_container_step(struct ocf_request *req)
 {
 	struct flush_container *fc = req->priv;
 	ocf_cache_t cache = fc->cache;
+	uint32_t count;
+
+	if (_ocf_mngt_flush_error(fc->context)) {
+		_ocf_mngt_flush_container_end(fc);
+		return 0;
+	}
+
+	count = OCF_MIN(fc->count - fc->iter, fc->flush_portion);
+	count = _ocf_mngt_flush_throttle(fc, count);
+	if (!count)
+		return 0;
 
 	ocf_metadata_start_exclusive_access(&cache->metadata.lock);
-	_ocf_mngt_flush_portion(fc);
+	_ocf_mngt_flush_portion(fc, count);
 	ocf_metadata_end_exclusive_access(&cache->metadata.lock);
 
 	return 0;
@@ -445,7 +642,9 @@ static void _ocf_mngt_flush_container(
 	fc->cache = cache;
 	fc->flush_portion = OCF_MNG_FLUSH_MIN;
 	fc->ticks1 = 0;
-	fc->ticks2 = UINT_MAX;
+	fc->ticks2 = 0;
+	fc->inflight = 0;
+	INIT_LIST_HEAD(&fc->waiting);
 
 	ocf_engine_push_req_back(fc->req, true);
 	return;
@@ -455,6 +654,27 @@ finish:
 	end(context);
 }
 
+static void _ocf_mngt_flush_progress_start(ocf_cache_t cache,
+		struct flush_container *fctbl, uint32_t fcnum)
+{
+	uint64_t total = 0;
+	uint32_t i;
+
+	for (i = 0; i < fcnum; i++)
+		total += fctbl[i].count;
+
+	env_atomic64_set(&cache->flush_progress.total, total);
+	env_atomic64_set(&cache->flush_progress.flushed, 0);
+	env_atomic64_set(&cache->flush_progress.start, env_get_tick_count());
+	env_atomic_set(&cache->flush_progress.active, 1);
+}
+
+static void _ocf_mngt_flush_progress_end(ocf_cache_t cache)
+{
+	env_atomic64_set(&cache->flush_progress.end, env_get_tick_count());
+	env_atomic_set(&cache->flush_progress.active, 0);
+}
+
 void _ocf_flush_container_complete(void *ctx)
 {
 	struct ocf_mngt_cache_flush_context *context = ctx;
@@ -463,6 +683,9 @@ void _ocf_flush_container_complete(void *ctx)
 		return;
 	}
 
+	_ocf_mngt_flush_progress_end(context->cache);
+	env_spinlock_destroy(&context->fcs.lock);
+
 	_ocf_mngt_free_flush_containers(context->fcs.fctbl,
 			context->fcs.fcnum);
 
@@ -475,9 +698,13 @@ static void _ocf_mngt_flush_containers(
 		struct flush_container *fctbl,
 		uint32_t fcnum, ocf_flush_complete_t complete)
 {
+	ocf_cache_t cache = context->cache;
 	int i;
 
+	_ocf_mngt_flush_progress_start(cache, fctbl, fcnum);
+
 	if (fcnum == 0) {
+		_ocf_mngt_flush_progress_end(cache);
 		complete(context, 0);
 		return;
 	}
@@ -485,11 +712,24 @@ static void _ocf_mngt_flush_containers(
 	/* Sort data. Smallest sectors first (0...n). */
 	ocf_cleaner_sort_flush_containers(fctbl, fcnum);
 
+	if (env_spinlock_init(&context->fcs.lock)) {
+		_ocf_mngt_flush_progress_end(cache);
+		_ocf_mngt_free_flush_containers(fctbl, fcnum);
+		complete(context, -OCF_ERR_NO_MEM);
+		return;
+	}
+
 	env_atomic_set(&context->fcs.error, 0);
 	env_atomic_set(&context->fcs.count, 1);
 	context->fcs.complete = complete;
 	context->fcs.fctbl = fctbl;
 	context->fcs.fcnum = fcnum;
+	INIT_LIST_HEAD(&context->fcs.waiting);
+	context->fcs.inflight = 0;
+	context->fcs.tokens = 0;
+	context->fcs.tokens_ticks = env_get_tick_count();
+
+	/* All containers are flushed concurrently, sharing flush limits */
 
 	for (i = 0; i < fcnum; i++) {
 		env_atomic_inc(&context->fcs.count);
@@ -554,7 +794,6 @@ static void _ocf_mngt_flush_all_cores(
 	if (ret) {
 		ocf_cache_log(cache, log_err, "Flushing operation aborted, "
 				"no memory\n");
-		ocf_metadata_end_exclusive_access(&cache->metadata.lock);
 		complete(context, ret);
 		return;
 	}
@@ -900,6 +1139,69 @@ void ocf_mngt_cache_flush_interrupt(ocf_cache_t cache)
 	cache->flushing_interrupted = 1;
 }
 
+int ocf_mngt_cache_set_flush_limits(ocf_cache_t cache,
+		const struct ocf_mngt_flush_limits *limits)
+{
+	OCF_CHECK_NULL(cache);
+	OCF_CHECK_NULL(limits);
+
+	env_atomic_set(&cache->flush_limits.max_inflight,
+			limits->max_inflight);
+	env_atomic64_set(&cache->flush_limits.max_rate, limits->max_rate);
+
+	ocf_cache_log(cache, log_info, "Flush limits: %u lines in flight, "
+			"%" ENV_PRIu64 " bytes per second\n",
+			limits->max_inflight, limits->max_rate);
+
+	return 0;
+}
+
+int ocf_mngt_cache_get_flush_limits(ocf_cache_t cache,
+		struct ocf_mngt_flush_limits *limits)
+{
+	OCF_CHECK_NULL(cache);
+	OCF_CHECK_NULL(limits);
+
+	limits->max_inflight = env_atomic_read(
+			&cache->flush_limits.max_inflight);
+	limits->max_rate = env_atomic64_read(&cache->flush_limits.max_rate);
+
+	return 0;
+}
+
+int ocf_mngt_cache_get_flush_progress(ocf_cache_t cache,
+		struct ocf_mngt_flush_progress *progress)
+{
+	uint64_t line_size, total, flushed, start, end, elapsed_ms;
+
+	OCF_CHECK_NULL(cache);
+	OCF_CHECK_NULL(progress);
+
+	line_size = ocf_line_size(cache);
+
+	progress->in_progress = env_atomic_read(&cache->flush_progress.active);
+	total = env_atomic64_read(&cache->flush_progress.total);
+	flushed = OCF_MIN(env_atomic64_read(&cache->flush_progress.flushed),
+			total);
+	start = env_atomic64_read(&cache->flush_progress.start);
+	end = progress->in_progress ? env_get_tick_count() :
+			env_atomic64_read(&cache->flush_progress.end);
+	elapsed_ms = (start && end > start) ?
+			env_ticks_to_msecs(end - start) : 0;
+
+	progress->total_bytes = total * line_size;
+	progress->flushed_bytes = flushed * line_size;
+	progress->remaining_bytes = (total - flushed) * line_size;
+	progress->elapsed = elapsed_ms / 1000;
+	progress->rate = elapsed_ms ?
+			progress->flushed_bytes * 1000 / elapsed_ms : 0;
+	progress->eta = (progress->in_progress && progress->rate) ?
+			OCF_DIV_ROUND_UP(progress->remaining_bytes,
+					progress->rate) : 0;
+
+	return 0;
+}
+
 int ocf_mngt_cache_cleaning_set_policy(ocf_cache_t cache, ocf_cleaning_t type)
 {
 	ocf_cleaning_t old_type;
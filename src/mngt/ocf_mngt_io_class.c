@@ -297,3 +297,38 @@ out_cpy:
 
 	return result;
 }
+
+int ocf_mngt_core_set_io_class_ranges(ocf_core_t core,
+		const struct ocf_mngt_io_class_range *ranges, uint32_t count)
+{
+	int result;
+
+	OCF_CHECK_NULL(core);
+
+	if (count && !ranges)
+		return -OCF_ERR_INVAL;
+
+	if (count > OCF_IO_CLASS_RANGES_MAX)
+		return -OCF_ERR_INVAL;
+
+	result = ocf_core_io_class_ranges_set(core, ranges, count);
+	if (result) {
+		ocf_core_log(core, log_err, "Failed to set IO class ranges\n");
+		return result;
+	}
+
+	ocf_core_log(core, log_info, "IO class ranges set: %u\n", count);
+
+	return 0;
+}
+
+int ocf_mngt_core_get_io_class_ranges_count(ocf_core_t core,
+		uint32_t *count)
+{
+	OCF_CHECK_NULL(core);
+	OCF_CHECK_NULL(count);
+
+	*count = ocf_core_io_class_ranges_count(core);
+
+	return 0;
+}
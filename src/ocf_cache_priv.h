@@ -23,6 +23,8 @@
 #include "ocf/ocf_trace.h"
 #include "promotion/promotion.h"
 #include "ocf_freelist.h"
+#include "ocf_core_index.h"
+#include "ocf_lazy_init.h"
 
 #define DIRTY_FLUSHED 1
 #define DIRTY_NOT_FLUSHED 0
@@ -112,6 +114,11 @@ struct ocf_cache {
 
 	ocf_freelist_t freelist;
 
+	/* Lines of each core, NULL unless enabled in attach config */
+	ocf_core_index_t core_index;
+
+	ocf_lazy_init_t lazy_init;
+
 	ocf_eviction_t eviction_policy_init;
 
 	struct {
@@ -157,6 +164,21 @@ struct ocf_cache {
 	int flushing_interrupted;
 	env_mutex flush_mutex;
 
+	struct {
+		env_atomic max_inflight;
+		env_atomic64 max_rate;
+	} flush_limits;
+
+	struct {
+		env_atomic active;
+		env_atomic64 total;
+			/* lines to flush */
+		env_atomic64 flushed;
+			/* lines written back */
+		env_atomic64 start;
+		env_atomic64 end;
+	} flush_progress;
+
 	struct {
 		uint32_t max_queue_size;
 		uint32_t queue_unblock_size;
@@ -243,6 +243,7 @@ void ocf_core_volume_submit_io(struct ocf_io *io)
 		return;
 	}
 
+	io->io_class = ocf_core_io_class_classify(core, io->addr, io->io_class);
 	req->part_id = ocf_part_class2id(cache, io->io_class);
 	req->core = core;
 	req->complete = ocf_req_complete;
@@ -305,6 +306,7 @@ int ocf_core_submit_io_fast(struct ocf_io *io)
 
 	req->core = core;
 	req->complete = ocf_req_complete;
+	io->io_class = ocf_core_io_class_classify(core, io->addr, io->io_class);
 	req->part_id = ocf_part_class2id(cache, io->io_class);
 
 	ocf_resolve_effective_cache_mode(cache, core, req);
@@ -0,0 +1,389 @@
+/*
+ * Copyright(c) 2020 Intel Corporation
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include "ocf/ocf.h"
+#include "metadata/metadata.h"
+#include "ocf_core_index.h"
+#include "ocf_priv.h"
+#include "utils/utils_cache_line.h"
+
+struct ocf_core_index_entry {
+	ocf_cache_line_t next;
+	ocf_cache_line_t prev;
+};
+
+struct ocf_core_index_list {
+	ocf_cache_line_t head;
+	ocf_cache_line_t count;
+};
+
+struct ocf_core_index_regions {
+	/* number of mapped lines in each region */
+	env_atomic *count;
+	uint64_t regions;
+
+	/* core lines per region = 1 << shift */
+	uint32_t shift;
+};
+
+struct ocf_core_index {
+	/* parent cache */
+	struct ocf_cache *cache;
+
+	/* list links of each cache line */
+	struct ocf_core_index_entry *entries;
+
+	/* number of cache lines, also end of list marker */
+	ocf_cache_line_t line_entries;
+
+	/* list of lines of each core */
+	struct ocf_core_index_list list[OCF_CORE_MAX];
+
+	/* list lock array */
+	env_spinlock lock[OCF_CORE_MAX];
+
+	/* mapped lines counters of each core */
+	struct ocf_core_index_regions regions[OCF_CORE_MAX];
+
+	/* index follows mapping changes */
+	bool active;
+};
+
+static void _ocf_core_index_link(ocf_core_index_t index,
+		ocf_cache_line_t line, ocf_core_id_t core_id)
+{
+	struct ocf_core_index_list *list = &index->list[core_id];
+	struct ocf_core_index_entry *entry = &index->entries[line];
+
+	entry->prev = index->line_entries;
+	entry->next = list->head;
+
+	if (list->head != index->line_entries)
+		index->entries[list->head].prev = line;
+
+	list->head = line;
+	list->count++;
+}
+
+static void _ocf_core_index_unlink(ocf_core_index_t index,
+		ocf_cache_line_t line, ocf_core_id_t core_id)
+{
+	struct ocf_core_index_list *list = &index->list[core_id];
+	struct ocf_core_index_entry *entry = &index->entries[line];
+
+	ENV_BUG_ON(!list->count);
+
+	if (entry->prev != index->line_entries)
+		index->entries[entry->prev].next = entry->next;
+	else
+		list->head = entry->next;
+
+	if (entry->next != index->line_entries)
+		index->entries[entry->next].prev = entry->prev;
+
+	entry->next = index->line_entries;
+	entry->prev = index->line_entries;
+	list->count--;
+}
+
+static inline void _ocf_core_index_count(ocf_core_index_t index,
+		ocf_core_id_t core_id, uint64_t core_line, int delta)
+{
+	struct ocf_core_index_regions *regions = &index->regions[core_id];
+	uint64_t region = core_line >> regions->shift;
+
+	if (regions->count && region < regions->regions)
+		env_atomic_add(delta, &regions->count[region]);
+}
+
+static void _ocf_core_index_regions_free(ocf_core_index_t index,
+		ocf_core_id_t core_id)
+{
+	struct ocf_core_index_regions *regions = &index->regions[core_id];
+
+	env_vfree(regions->count);
+	regions->count = NULL;
+	regions->regions = 0;
+	regions->shift = 0;
+}
+
+static int _ocf_core_index_regions_alloc(ocf_core_index_t index,
+		ocf_core_t core)
+{
+	struct ocf_cache *cache = index->cache;
+	struct ocf_core_index_regions *regions =
+			&index->regions[ocf_core_get_id(core)];
+	uint64_t core_lines;
+	uint32_t shift = 0;
+
+	/* Region is at least a maximal discard step */
+	while ((ocf_line_size(cache) << shift) < MAX_TRIM_RQ_SIZE)
+		shift++;
+
+	core_lines = OCF_DIV_ROUND_UP(core->conf_meta->length,
+			ocf_line_size(cache));
+	while (OCF_DIV_ROUND_UP(core_lines, 1ULL << shift) >
+			OCF_CORE_INDEX_MAX_REGIONS) {
+		shift++;
+	}
+
+	regions->regions = OCF_DIV_ROUND_UP(core_lines, 1ULL << shift);
+	if (!regions->regions)
+		return 0;
+
+	regions->count = env_vzalloc(sizeof(*regions->count) *
+			regions->regions);
+	if (!regions->count) {
+		regions->regions = 0;
+		return -OCF_ERR_NO_MEM;
+	}
+	regions->shift = shift;
+
+	return 0;
+}
+
+void ocf_core_index_add_core(ocf_core_index_t index, ocf_core_t core)
+{
+	if (!index)
+		return;
+
+	_ocf_core_index_regions_free(index, ocf_core_get_id(core));
+	if (_ocf_core_index_regions_alloc(index, core)) {
+		ocf_core_log(core, log_warn, "Cannot allocate mapped lines "
+				"counters, discard will look up every line\n");
+	}
+}
+
+void ocf_core_index_remove_core(ocf_core_index_t index, ocf_core_t core)
+{
+	if (!index)
+		return;
+
+	_ocf_core_index_regions_free(index, ocf_core_get_id(core));
+}
+
+ocf_core_index_t ocf_core_index_init(struct ocf_cache *cache)
+{
+	ocf_core_index_t index;
+	ocf_cache_line_t line_entries = ocf_metadata_collision_table_entries(
+			cache);
+	int i;
+
+	index = env_vzalloc(sizeof(*index));
+	if (!index)
+		return NULL;
+
+	index->cache = cache;
+	index->line_entries = line_entries;
+	index->entries = env_vmalloc(sizeof(index->entries[0]) *
+			(uint64_t)line_entries);
+	if (!index->entries)
+		goto free_index;
+
+	for (i = 0; i < OCF_CORE_MAX; i++) {
+		if (env_spinlock_init(&index->lock[i]))
+			goto spinlock_err;
+
+		index->list[i].head = line_entries;
+		index->list[i].count = 0;
+	}
+
+	return index;
+
+spinlock_err:
+	while (i--)
+		env_spinlock_destroy(&index->lock[i]);
+	env_vfree(index->entries);
+free_index:
+	env_vfree(index);
+	return NULL;
+}
+
+void ocf_core_index_deinit(ocf_core_index_t index)
+{
+	int i;
+
+	if (!index)
+		return;
+
+	for (i = 0; i < OCF_CORE_MAX; i++) {
+		env_spinlock_destroy(&index->lock[i]);
+		_ocf_core_index_regions_free(index, i);
+	}
+	env_vfree(index->entries);
+	env_vfree(index);
+}
+
+void ocf_core_index_reset(ocf_core_index_t index)
+{
+	ocf_core_id_t core_id;
+	ocf_core_t core;
+	int i;
+
+	if (!index)
+		return;
+
+	for (i = 0; i < OCF_CORE_MAX; i++) {
+		index->list[i].head = index->line_entries;
+		index->list[i].count = 0;
+	}
+
+	for_each_core_metadata(index->cache, core, core_id)
+		ocf_core_index_add_core(index, core);
+
+	index->active = true;
+}
+
+void ocf_core_index_rebuild(ocf_core_index_t index)
+{
+	ocf_core_id_t core_id;
+	ocf_cache_line_t line;
+	uint64_t core_line;
+	uint32_t step = 0;
+
+	if (!index)
+		return;
+
+	ocf_core_index_reset(index);
+
+	/* Link in reverse order, so that lists follow collision table order */
+	for (line = index->line_entries; line-- > 0; ) {
+		ocf_metadata_get_core_info(index->cache, line, &core_id,
+				&core_line);
+		if (core_id < OCF_CORE_MAX) {
+			_ocf_core_index_count(index, core_id, core_line, 1);
+			_ocf_core_index_link(index, line, core_id);
+		}
+
+		OCF_COND_RESCHED_DEFAULT(step);
+	}
+}
+
+bool ocf_core_index_active(ocf_core_index_t index)
+{
+	return index && index->active;
+}
+
+void ocf_core_index_move(ocf_core_index_t index, ocf_cache_line_t line,
+		ocf_core_id_t old_core_id, uint64_t old_core_line,
+		ocf_core_id_t new_core_id, uint64_t new_core_line)
+{
+	if (!index->active)
+		return;
+
+	/* Counters are atomic, so they do not need list lock */
+	if (old_core_id < OCF_CORE_MAX)
+		_ocf_core_index_count(index, old_core_id, old_core_line, -1);
+	if (new_core_id < OCF_CORE_MAX)
+		_ocf_core_index_count(index, new_core_id, new_core_line, 1);
+
+	if (old_core_id == new_core_id)
+		return;
+
+	ENV_BUG_ON(line >= index->line_entries);
+
+	if (old_core_id < OCF_CORE_MAX) {
+		env_spinlock_lock(&index->lock[old_core_id]);
+		_ocf_core_index_unlink(index, line, old_core_id);
+		env_spinlock_unlock(&index->lock[old_core_id]);
+	}
+
+	if (new_core_id < OCF_CORE_MAX) {
+		env_spinlock_lock(&index->lock[new_core_id]);
+		_ocf_core_index_link(index, line, new_core_id);
+		env_spinlock_unlock(&index->lock[new_core_id]);
+	}
+}
+
+ocf_cache_line_t ocf_core_index_first(ocf_core_index_t index,
+		ocf_core_id_t core_id)
+{
+	ENV_BUG_ON(core_id >= OCF_CORE_MAX);
+
+	return index->list[core_id].head;
+}
+
+ocf_cache_line_t ocf_core_index_next(ocf_core_index_t index,
+		ocf_cache_line_t line)
+{
+	return index->entries[line].next;
+}
+
+uint64_t ocf_core_index_collect(ocf_core_index_t index,
+		ocf_core_id_t core_id, uint64_t core_line_first,
+		uint64_t core_line_last, uint64_t *core_lines, uint64_t max)
+{
+	ocf_cache_line_t line;
+	ocf_core_id_t line_core_id;
+	uint64_t core_line;
+	uint64_t found = 0;
+
+	ENV_BUG_ON(core_id >= OCF_CORE_MAX);
+
+	env_spinlock_lock(&index->lock[core_id]);
+	for (line = index->list[core_id].head; line != index->line_entries;
+			line = index->entries[line].next) {
+		/* Line is linked before its core info is set */
+		ocf_metadata_get_core_info(index->cache, line, &line_core_id,
+				&core_line);
+		if (line_core_id != core_id || core_line < core_line_first ||
+				core_line > core_line_last) {
+			continue;
+		}
+
+		if (found < max)
+			core_lines[found] = core_line;
+		found++;
+	}
+	env_spinlock_unlock(&index->lock[core_id]);
+
+	return found;
+}
+
+ocf_cache_line_t ocf_core_index_count(ocf_core_index_t index,
+		ocf_core_id_t core_id)
+{
+	ENV_BUG_ON(core_id >= OCF_CORE_MAX);
+
+	return index->list[core_id].count;
+}
+
+uint64_t ocf_core_index_next_mapped(ocf_core_index_t index,
+		ocf_core_id_t core_id, uint64_t core_line_first,
+		uint64_t core_line_last)
+{
+	struct ocf_core_index_regions *regions;
+	uint64_t region, region_last;
+
+	if (!index || !index->active)
+		return core_line_first;
+
+	ENV_BUG_ON(core_id >= OCF_CORE_MAX);
+
+	regions = &index->regions[core_id];
+	if (!regions->count)
+		return core_line_first;
+
+	region = core_line_first >> regions->shift;
+	region_last = core_line_last >> regions->shift;
+
+	for (; region <= region_last; region++) {
+		if (region >= regions->regions ||
+				env_atomic_read(&regions->count[region])) {
+			break;
+		}
+	}
+
+	if (region > region_last)
+		return core_line_last + 1;
+
+	return OCF_MAX(core_line_first, region << regions->shift);
+}
+
+uint64_t ocf_core_index_size(uint64_t cache_lines)
+{
+	return sizeof(struct ocf_core_index) +
+			cache_lines * sizeof(struct ocf_core_index_entry);
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright(c) 2020 Intel Corporation
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef __OCF_CORE_INDEX_H__
+#define __OCF_CORE_INDEX_H__
+
+#include "ocf_cache_priv.h"
+
+/*
+ * Reverse index of cache lines: for every core a list of the cache lines
+ * whose core id is set to that core, so that core-scoped operations visit
+ * only the lines of the core instead of the whole collision table. It is
+ * optional, as it takes two line indexes per cache line and a list lock on
+ * every mapping change; without it the cache has no index at all.
+ *
+ * For every core the index also counts mapped lines in each region of core
+ * lines, so that ranges with nothing cached can be skipped (e.g. by discard)
+ * without looking up every core line. Regions not covered by the counters
+ * (or all of them, if they could not be allocated) are treated as occupied.
+ *
+ * The index follows core id changes of cache lines while it is active.
+ * It becomes active once it has been reset (all lines unmapped) or rebuilt
+ * from the collision table, and is not consulted before.
+ */
+struct ocf_core_index;
+
+typedef struct ocf_core_index *ocf_core_index_t;
+
+/* Init / deinit index runtime structures */
+ocf_core_index_t ocf_core_index_init(struct ocf_cache *cache);
+void ocf_core_index_deinit(ocf_core_index_t index);
+
+/* Activate empty index, when no cache line is mapped */
+void ocf_core_index_reset(ocf_core_index_t index);
+
+/* Activate index with lines currently mapped in collision table */
+void ocf_core_index_rebuild(ocf_core_index_t index);
+
+/* Returns true if index exists and lists can be used for iteration */
+bool ocf_core_index_active(ocf_core_index_t index);
+
+/* Upper limit of counted regions per core, coarser regions are used above */
+#define OCF_CORE_INDEX_MAX_REGIONS (1 << 18)
+
+/* Allocate / free region counters of the core */
+void ocf_core_index_add_core(ocf_core_index_t index, ocf_core_t core);
+void ocf_core_index_remove_core(ocf_core_index_t index, ocf_core_t core);
+
+/*
+ * Move cache line from list of old_core_id to list of new_core_id.
+ *
+ * Called from set_core_info on every map and unmap of a cache line, if the
+ * cache has an index. It takes list lock of the old core and then of the
+ * new one (never both at once), so all concurrent mapping changes of one
+ * core are serialized on its list lock. Lines of a core are spread over all
+ * hash buckets, so the hash bucket lock held by the caller does not protect
+ * the list and the updates can not be batched under it.
+ */
+void ocf_core_index_move(ocf_core_index_t index, ocf_cache_line_t line,
+		ocf_core_id_t old_core_id, uint64_t old_core_line,
+		ocf_core_id_t new_core_id, uint64_t new_core_line);
+
+/*
+ * Returns first core line from given range that lies in a region with
+ * mapped lines, or core_line_last + 1 if there is none. Returns
+ * core_line_first if there is no index or it is not active.
+ */
+uint64_t ocf_core_index_next_mapped(ocf_core_index_t index,
+		ocf_core_id_t core_id, uint64_t core_line_first,
+		uint64_t core_line_last);
+
+/*
+ * Iterate over lines of the core. End of the list is denoted by
+ * collision table entries count. Lines must not be moved to another core
+ * during iteration, except the current one.
+ */
+ocf_cache_line_t ocf_core_index_first(ocf_core_index_t index,
+		ocf_core_id_t core_id);
+ocf_cache_line_t ocf_core_index_next(ocf_core_index_t index,
+		ocf_cache_line_t line);
+
+/*
+ * Store core lines of the core within given range in core_lines, at most
+ * max of them. List of the core is walked under its lock, so that lines
+ * can be moved meanwhile. Returns number of lines of the core in the range,
+ * more than max if not all of them could be stored.
+ */
+uint64_t ocf_core_index_collect(ocf_core_index_t index,
+		ocf_core_id_t core_id, uint64_t core_line_first,
+		uint64_t core_line_last, uint64_t *core_lines, uint64_t max);
+
+/* Return number of cache lines of the core */
+ocf_cache_line_t ocf_core_index_count(ocf_core_index_t index,
+		ocf_core_id_t core_id);
+
+/* Memory needed by index lists of given number of cache lines */
+uint64_t ocf_core_index_size(uint64_t cache_lines);
+
+#endif /* __OCF_CORE_INDEX_H__ */
@@ -11,6 +11,7 @@
 #include "ocf_ctx_priv.h"
 #include "ocf_volume_priv.h"
 #include "ocf_seq_cutoff.h"
+#include "ocf_io_class_ranges.h"
 
 #define ocf_core_log_prefix(core, lvl, prefix, fmt, ...) \
 	ocf_cache_log_prefix(ocf_core_get_cache(core), lvl, ".%s" prefix, \
@@ -79,6 +80,8 @@ struct ocf_core {
 
 	struct ocf_seq_cutoff seq_cutoff;
 
+	struct ocf_io_class_ranges io_class_ranges;
+
 	env_atomic flushed;
 
 	/* This bit means that object is open */
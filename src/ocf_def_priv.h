@@ -36,8 +36,13 @@
 		__x < __y ? __x : __y;		\
 	})
 
-#define METADATA_VERSION() ((OCF_VERSION_MAIN << 16) + \
-		(OCF_VERSION_MAJOR << 8) + OCF_VERSION_MINOR)
+/* Revision of metadata layout within OCF version, bumped on each change of
+ * on-disk structures, so that metadata of other layout is not loaded */
+#define METADATA_LAYOUT_REVISION 5
+
+#define METADATA_VERSION() ((METADATA_LAYOUT_REVISION << 24) + \
+		(OCF_VERSION_MAIN << 16) + (OCF_VERSION_MAJOR << 8) + \
+		OCF_VERSION_MINOR)
 
 /* call conditional reschedule every 'iterations' calls */
 #define OCF_COND_RESCHED(cnt, iterations) \
@@ -27,11 +27,12 @@ struct ocf_freelist {
 
 	/* next slowpath victim idx */
 	env_atomic slowpath_victim_idx;
-
-	/* total number of free lines */
-	env_atomic64 total_free;
 };
 
+/* Minimal number of lines moved at once from another context's list
+ * when a bulk get finds its own list empty */
+#define OCF_FREELIST_REFILL_BATCH 32
+
 static void ocf_freelist_lock(ocf_freelist_t freelist, uint32_t ctx)
 {
 	env_spinlock_lock(&freelist->lock[ctx]);
@@ -112,7 +113,6 @@ static void _ocf_freelist_remove_cache_line(ocf_freelist_t freelist,
 	}
 
 	env_atomic64_dec(&freelist_part->curr_size);
-	env_atomic64_dec(&freelist->total_free);
 }
 
 static ocf_cache_line_t next_phys_invalid(ocf_cache_t cache,
@@ -209,8 +209,6 @@ void ocf_freelist_populate(ocf_freelist_t freelist,
 	/* we should have reached the last invalid cache line */
 	phys = next_phys_invalid(cache, phys);
 	ENV_BUG_ON(phys != collision_table_entries);
-
-	env_atomic64_set(&freelist->total_free, num_free_clines);
 }
 
 static void ocf_freelist_add_cache_line(ocf_freelist_t freelist,
@@ -244,7 +242,6 @@ static void ocf_freelist_add_cache_line(ocf_freelist_t freelist,
 	}
 
 	env_atomic64_inc(&freelist_part->curr_size);
-	env_atomic64_inc(&freelist->total_free);
 }
 
 typedef enum {
@@ -345,9 +342,6 @@ static bool ocf_freelist_get_cache_line_fast(ocf_freelist_t freelist,
 bool ocf_freelist_get_cache_line(ocf_freelist_t freelist,
 		ocf_cache_line_t *cline)
 {
-	if (env_atomic64_read(&freelist->total_free) == 0)
-		return false;
-
 	if (!ocf_freelist_get_cache_line_fast(freelist, cline))
 		return ocf_freelist_get_cache_line_slow(freelist, cline);
 
@@ -365,6 +359,250 @@ void ocf_freelist_put_cache_line(ocf_freelist_t freelist,
 	env_put_execution_context(ctx);
 }
 
+/* Take up to count lines from the head of context list, called under
+ * the context lock */
+static uint32_t _ocf_freelist_take_cache_lines(ocf_freelist_t freelist,
+		uint32_t ctx, ocf_cache_line_t *clines, uint32_t count)
+{
+	uint32_t taken = 0;
+
+	while (taken < count &&
+			env_atomic64_read(&freelist->part[ctx].curr_size)) {
+		clines[taken] = freelist->part[ctx].head;
+		_ocf_freelist_remove_cache_line(freelist, ctx, clines[taken]);
+		taken++;
+	}
+
+	return taken;
+}
+
+/* Unlink up to count lines from the head of context list as a chain,
+ * called under the context lock */
+static uint32_t _ocf_freelist_detach_chain(ocf_freelist_t freelist,
+		uint32_t ctx, uint32_t count, ocf_cache_line_t *head,
+		ocf_cache_line_t *tail)
+{
+	struct ocf_cache *cache = freelist->cache;
+	struct ocf_part *freelist_part = &freelist->part[ctx];
+	ocf_cache_line_t line_entries = ocf_metadata_collision_table_entries(
+			freelist->cache);
+	ocf_cache_line_t next;
+	uint32_t size = env_atomic64_read(&freelist_part->curr_size);
+	uint32_t i;
+
+	if (count >= size)
+		count = size;
+	if (!count)
+		return 0;
+
+	*head = freelist_part->head;
+	*tail = *head;
+	for (i = 1; i < count; i++) {
+		ocf_metadata_get_partition_info(cache, *tail, NULL, &next,
+				NULL);
+		*tail = next;
+	}
+
+	if (count == size) {
+		freelist_part->head = line_entries;
+		freelist_part->tail = line_entries;
+	} else {
+		ocf_metadata_get_partition_info(cache, *tail, NULL, &next,
+				NULL);
+		freelist_part->head = next;
+		ocf_metadata_set_partition_prev(cache, next, line_entries);
+		ocf_metadata_set_partition_next(cache, *tail, line_entries);
+	}
+
+	env_atomic64_sub(count, &freelist_part->curr_size);
+
+	return count;
+}
+
+/* Append chain of count lines to context list, called under the context
+ * lock */
+static void _ocf_freelist_append_chain(ocf_freelist_t freelist,
+		uint32_t ctx, uint32_t count, ocf_cache_line_t head,
+		ocf_cache_line_t tail)
+{
+	struct ocf_cache *cache = freelist->cache;
+	struct ocf_part *freelist_part = &freelist->part[ctx];
+	ocf_cache_line_t line_entries = ocf_metadata_collision_table_entries(
+			freelist->cache);
+
+	if (env_atomic64_read(&freelist_part->curr_size) == 0) {
+		freelist_part->head = head;
+		ocf_metadata_set_partition_prev(cache, head, line_entries);
+	} else {
+		ocf_metadata_set_partition_next(cache, freelist_part->tail,
+				head);
+		ocf_metadata_set_partition_prev(cache, head,
+				freelist_part->tail);
+	}
+	freelist_part->tail = tail;
+
+	env_atomic64_add(count, &freelist_part->curr_size);
+}
+
+void ocf_freelist_populate_range(ocf_freelist_t freelist,
+		ocf_cache_line_t phys, ocf_cache_line_t count)
+{
+	struct ocf_cache *cache = freelist->cache;
+	ocf_cache_line_t collision_table_entries =
+			ocf_metadata_collision_table_entries(cache);
+	ocf_cache_line_t head, prev, next, idx, size, i;
+	uint32_t freelist_idx;
+
+	ENV_BUG_ON(phys + count > collision_table_entries);
+
+	for (freelist_idx = 0; freelist_idx < freelist->count;
+			freelist_idx++) {
+		/* contiguous part of the range for each freelist */
+		size = count / freelist->count;
+		if (freelist_idx < (count % freelist->count))
+			++size;
+		if (!size)
+			continue;
+
+		/* link lines outside of the lock, they are not visible yet */
+		head = ocf_metadata_map_phy2lg(cache, phys);
+		prev = collision_table_entries;
+		idx = head;
+		for (i = 1; i < size; i++) {
+			next = ocf_metadata_map_phy2lg(cache, phys + i);
+			ocf_metadata_set_partition_info(cache, idx,
+					PARTITION_INVALID, next, prev);
+			prev = idx;
+			idx = next;
+		}
+		ocf_metadata_set_partition_info(cache, idx, PARTITION_INVALID,
+				collision_table_entries, prev);
+		phys += size;
+
+		ocf_freelist_lock(freelist, freelist_idx);
+		_ocf_freelist_append_chain(freelist, freelist_idx, size, head,
+				idx);
+		ocf_freelist_unlock(freelist, freelist_idx);
+	}
+}
+
+/*
+ * Take lines from victim context list. The ones exceeding count, up to
+ * OCF_FREELIST_REFILL_BATCH in total, are moved to own context list, so
+ * that following gets are served locally. Own list is only try-locked
+ * under the victim lock, so that two contexts refilling from each other
+ * do not deadlock, and lines are never off both lists while moved.
+ */
+static ocf_freelist_get_err_t ocf_freelist_refill_ctx(
+		ocf_freelist_t freelist, uint32_t ctx, uint32_t victim,
+		bool can_wait, ocf_cache_line_t *clines, uint32_t count,
+		uint32_t *taken)
+{
+	ocf_cache_line_t head, tail;
+	uint32_t moved;
+
+	*taken = 0;
+
+	if (env_atomic64_read(&freelist->part[victim].curr_size) == 0)
+		return -OCF_FREELIST_ERR_LIST_EMPTY;
+
+	if (!can_wait && ocf_freelist_trylock(freelist, victim))
+		return -OCF_FREELIST_ERR_NOLOCK;
+
+	if (can_wait)
+		ocf_freelist_lock(freelist, victim);
+
+	*taken = _ocf_freelist_take_cache_lines(freelist, victim, clines,
+			count);
+	if (*taken == count && count < OCF_FREELIST_REFILL_BATCH &&
+			!ocf_freelist_trylock(freelist, ctx)) {
+		moved = _ocf_freelist_detach_chain(freelist, victim,
+				OCF_FREELIST_REFILL_BATCH - count,
+				&head, &tail);
+		if (moved) {
+			_ocf_freelist_append_chain(freelist, ctx, moved,
+					head, tail);
+		}
+		ocf_freelist_unlock(freelist, ctx);
+	}
+
+	ocf_freelist_unlock(freelist, victim);
+
+	return *taken ? 0 : -OCF_FREELIST_ERR_LIST_EMPTY;
+}
+
+static uint32_t ocf_freelist_get_cache_lines_slow(ocf_freelist_t freelist,
+		uint32_t ctx, ocf_cache_line_t *clines, uint32_t count)
+{
+	uint32_t got = 0, taken;
+	bool lock_err = false;
+	uint32_t victim;
+	int i, err;
+
+	/* try slowpath without waiting on lock */
+	for (i = 0; i < freelist->count && got < count; i++) {
+		victim = get_next_victim_freelist(freelist);
+		if (victim == ctx)
+			continue;
+		err = ocf_freelist_refill_ctx(freelist, ctx, victim, false,
+				clines + got, count - got, &taken);
+		got += taken;
+		if (err == -OCF_FREELIST_ERR_NOLOCK)
+			lock_err = true;
+	}
+
+	if (got == count || !lock_err)
+		return got;
+
+	/* slow path with waiting on lock */
+	for (i = 0; i < freelist->count && got < count; i++) {
+		victim = get_next_victim_freelist(freelist);
+		if (victim == ctx)
+			continue;
+		ocf_freelist_refill_ctx(freelist, ctx, victim, true,
+				clines + got, count - got, &taken);
+		got += taken;
+	}
+
+	return got;
+}
+
+uint32_t ocf_freelist_get_cache_lines(ocf_freelist_t freelist,
+		ocf_cache_line_t *clines, uint32_t count)
+{
+	uint32_t ctx = env_get_execution_context();
+	uint32_t got = 0;
+
+	if (env_atomic64_read(&freelist->part[ctx].curr_size)) {
+		ocf_freelist_lock(freelist, ctx);
+		got = _ocf_freelist_take_cache_lines(freelist, ctx, clines,
+				count);
+		ocf_freelist_unlock(freelist, ctx);
+	}
+
+	if (got < count) {
+		got += ocf_freelist_get_cache_lines_slow(freelist, ctx,
+				clines + got, count - got);
+	}
+
+	env_put_execution_context(ctx);
+
+	return got;
+}
+
+void ocf_freelist_put_cache_lines(ocf_freelist_t freelist,
+		const ocf_cache_line_t *clines, uint32_t count)
+{
+	uint32_t ctx = env_get_execution_context();
+	uint32_t i;
+
+	ocf_freelist_lock(freelist, ctx);
+	for (i = 0; i < count; i++)
+		ocf_freelist_add_cache_line(freelist, ctx, clines[i]);
+	ocf_freelist_unlock(freelist, ctx);
+	env_put_execution_context(ctx);
+}
+
 ocf_freelist_t ocf_freelist_init(struct ocf_cache *cache)
 {
 	uint32_t num;
@@ -381,7 +619,6 @@ ocf_freelist_t ocf_freelist_init(struct ocf_cache *cache)
 
 	freelist->cache = cache;
 	freelist->count = num;
-	env_atomic64_set(&freelist->total_free, 0);
 	freelist->lock = env_vzalloc(sizeof(freelist->lock[0]) * num);
 	freelist->part = env_vzalloc(sizeof(freelist->part[0]) * num);
 
@@ -422,6 +659,14 @@ void ocf_freelist_deinit(ocf_freelist_t freelist)
 
 ocf_cache_line_t ocf_freelist_num_free(ocf_freelist_t freelist)
 {
-	return env_atomic64_read(&freelist->total_free);
+	ocf_cache_line_t free = 0;
+	uint32_t i;
+
+	/* free lines are only counted per context, so that gets and puts
+	 * do not contend on a shared counter */
+	for (i = 0; i < freelist->count; i++)
+		free += env_atomic64_read(&freelist->part[i].curr_size);
+
+	return free;
 }
 
@@ -20,14 +20,26 @@ void ocf_freelist_deinit(ocf_freelist_t freelist);
 void ocf_freelist_populate(ocf_freelist_t freelist,
 		ocf_cache_line_t num_free_clines);
 
+/* Assign range of initialized, unused physical cachelines to freelist */
+void ocf_freelist_populate_range(ocf_freelist_t freelist,
+		ocf_cache_line_t phys, ocf_cache_line_t count);
+
 /* Get cacheline from freelist */
 bool ocf_freelist_get_cache_line(ocf_freelist_t freelist,
 		ocf_cache_line_t *cline);
 
+/* Get up to count cachelines from freelist, returns number of lines got */
+uint32_t ocf_freelist_get_cache_lines(ocf_freelist_t freelist,
+		ocf_cache_line_t *clines, uint32_t count);
+
 /* Put cacheline back to freelist */
 void ocf_freelist_put_cache_line(ocf_freelist_t freelist,
 		ocf_cache_line_t cline);
 
+/* Put count cachelines back to freelist */
+void ocf_freelist_put_cache_lines(ocf_freelist_t freelist,
+		const ocf_cache_line_t *clines, uint32_t count);
+
 /* Return total number of free cachelines */
 ocf_cache_line_t ocf_freelist_num_free(ocf_freelist_t freelist);
 
@@ -0,0 +1,131 @@
+/*
+ * Copyright(c) 2020 Intel Corporation
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include "ocf_io_class_ranges.h"
+#include "ocf_core_priv.h"
+
+static int _ocf_io_class_range_cmp(const void *item1, const void *item2)
+{
+	const struct ocf_mngt_io_class_range *range1 = item1;
+	const struct ocf_mngt_io_class_range *range2 = item2;
+
+	if (range1->start > range2->start)
+		return 1;
+
+	if (range1->start < range2->start)
+		return -1;
+
+	return 0;
+}
+
+void ocf_core_io_class_ranges_init(ocf_core_t core)
+{
+	env_rwlock_init(&core->io_class_ranges.lock);
+	core->io_class_ranges.table = NULL;
+	env_atomic_set(&core->io_class_ranges.active, 0);
+}
+
+void ocf_core_io_class_ranges_deinit(ocf_core_t core)
+{
+	env_vfree(core->io_class_ranges.table);
+	core->io_class_ranges.table = NULL;
+	env_atomic_set(&core->io_class_ranges.active, 0);
+	env_rwlock_destroy(&core->io_class_ranges.lock);
+}
+
+int ocf_core_io_class_ranges_set(ocf_core_t core,
+		const struct ocf_mngt_io_class_range *ranges, uint32_t count)
+{
+	struct ocf_io_class_range_table *table = NULL, *old;
+	uint32_t i;
+
+	if (count) {
+		table = env_vmalloc(sizeof(*table) +
+				sizeof(table->ranges[0]) * count);
+		if (!table)
+			return -OCF_ERR_NO_MEM;
+
+		table->count = count;
+		for (i = 0; i < count; i++)
+			table->ranges[i] = ranges[i];
+
+		env_sort(table->ranges, count, sizeof(table->ranges[0]),
+				_ocf_io_class_range_cmp, NULL);
+
+		for (i = 0; i < count; i++) {
+			if (table->ranges[i].start >= table->ranges[i].end)
+				goto err;
+			if (table->ranges[i].class_id >= OCF_IO_CLASS_MAX)
+				goto err;
+			if (i && table->ranges[i - 1].end >
+					table->ranges[i].start) {
+				goto err;
+			}
+		}
+	}
+
+	/* I/O in flight uses either old or new table, never a mix */
+	env_rwlock_write_lock(&core->io_class_ranges.lock);
+	old = core->io_class_ranges.table;
+	core->io_class_ranges.table = table;
+	env_atomic_set(&core->io_class_ranges.active, !!table);
+	env_rwlock_write_unlock(&core->io_class_ranges.lock);
+
+	env_vfree(old);
+
+	return 0;
+
+err:
+	env_vfree(table);
+	return -OCF_ERR_INVAL;
+}
+
+uint32_t ocf_core_io_class_ranges_count(ocf_core_t core)
+{
+	uint32_t count = 0;
+
+	env_rwlock_read_lock(&core->io_class_ranges.lock);
+	if (core->io_class_ranges.table)
+		count = core->io_class_ranges.table->count;
+	env_rwlock_read_unlock(&core->io_class_ranges.lock);
+
+	return count;
+}
+
+uint32_t ocf_core_io_class_classify(ocf_core_t core, uint64_t addr,
+		uint32_t io_class)
+{
+	struct ocf_io_class_range_table *table;
+	uint32_t left, right, middle;
+
+	/* Skip locking when no ranges are configured */
+	if (!env_atomic_read(&core->io_class_ranges.active))
+		return io_class;
+
+	env_rwlock_read_lock(&core->io_class_ranges.lock);
+
+	table = core->io_class_ranges.table;
+	if (!table)
+		goto out;
+
+	/* Find last range starting at or below address */
+	left = 0;
+	right = table->count;
+	while (left < right) {
+		middle = left + (right - left) / 2;
+		if (table->ranges[middle].start <= addr)
+			left = middle + 1;
+		else
+			right = middle;
+	}
+
+	if (left && addr < table->ranges[left - 1].end)
+		io_class = table->ranges[left - 1].class_id;
+
+out:
+	env_rwlock_read_unlock(&core->io_class_ranges.lock);
+
+	return io_class;
+}
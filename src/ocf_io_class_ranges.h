@@ -0,0 +1,43 @@
+/*
+ * Copyright(c) 2020 Intel Corporation
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef __OCF_IO_CLASS_RANGES_H__
+#define __OCF_IO_CLASS_RANGES_H__
+
+#include "ocf/ocf.h"
+#include "ocf_env.h"
+
+/*
+ * Classification of core I/O by its start address. Ranges are kept sorted
+ * by start address in one array, so that range containing given address is
+ * found by binary search. Table is immutable once published, new set of
+ * ranges replaces whole table under write lock.
+ */
+struct ocf_io_class_range_table {
+	uint32_t count;
+	struct ocf_mngt_io_class_range ranges[];
+};
+
+struct ocf_io_class_ranges {
+	env_rwlock lock;
+	struct ocf_io_class_range_table *table;
+
+	/* Set while table is published, read without lock on submit path */
+	env_atomic active;
+};
+
+void ocf_core_io_class_ranges_init(ocf_core_t core);
+
+void ocf_core_io_class_ranges_deinit(ocf_core_t core);
+
+int ocf_core_io_class_ranges_set(ocf_core_t core,
+		const struct ocf_mngt_io_class_range *ranges, uint32_t count);
+
+uint32_t ocf_core_io_class_ranges_count(ocf_core_t core);
+
+uint32_t ocf_core_io_class_classify(ocf_core_t core, uint64_t addr,
+		uint32_t io_class);
+
+#endif /* __OCF_IO_CLASS_RANGES_H__ */
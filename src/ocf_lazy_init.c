@@ -0,0 +1,362 @@
+/*
+ * Copyright(c) 2020 Intel Corporation
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include "ocf/ocf.h"
+#include "metadata/metadata.h"
+#include "ocf_lazy_init.h"
+#include "ocf_request.h"
+#include "ocf_queue_priv.h"
+#include "engine/cache_engine.h"
+#include "engine/engine_common.h"
+#include "utils/utils_refcnt.h"
+
+/* Number of cache lines initialized at once */
+#define OCF_LAZY_INIT_CHUNK 8192
+
+/* Maximal number of background workers */
+#define OCF_LAZY_INIT_MAX_WORKERS 4
+
+typedef void (*ocf_lazy_init_end_t)(void *priv);
+
+struct ocf_lazy_init_waiter {
+	struct list_head list;
+	ocf_lazy_init_end_t end;
+	void *priv;
+};
+
+struct ocf_lazy_init {
+	/* parent cache */
+	struct ocf_cache *cache;
+
+	/* number of cache lines */
+	ocf_cache_line_t line_entries;
+
+	/* first physical line of next chunk */
+	env_atomic64 next;
+
+	/* lines not added to freelist yet */
+	env_atomic64 pending;
+
+	/* background workers, starter and pending lines, metadata is flushed
+	 * when last one is put */
+	env_atomic refs;
+
+	/* waiting for chunks initialized by others */
+	env_spinlock waiters_lock;
+	struct list_head waiters;
+
+	/* flushes metadata on management queue */
+	struct ocf_request *finish_req;
+
+	/* reference to cache metadata is held until flush is done */
+	bool metadata_ref;
+
+	/* initialization start time */
+	uint64_t start;
+};
+
+static void _ocf_lazy_init_put(ocf_lazy_init_t lazy_init)
+{
+	if (env_atomic_dec_return(&lazy_init->refs))
+		return;
+
+	/* Without metadata reference cache is being stopped, which flushes
+	 * metadata on its own */
+	if (lazy_init->metadata_ref)
+		ocf_engine_push_req_back(lazy_init->finish_req, true);
+}
+
+static void _ocf_lazy_init_initialized(ocf_lazy_init_t lazy_init)
+{
+	struct ocf_lazy_init_waiter *waiter;
+
+	env_spinlock_lock(&lazy_init->waiters_lock);
+	while (!list_empty(&lazy_init->waiters)) {
+		waiter = list_first_entry(&lazy_init->waiters,
+				struct ocf_lazy_init_waiter, list);
+		list_del(&waiter->list);
+		env_spinlock_unlock(&lazy_init->waiters_lock);
+
+		waiter->end(waiter->priv);
+
+		env_spinlock_lock(&lazy_init->waiters_lock);
+	}
+	env_spinlock_unlock(&lazy_init->waiters_lock);
+
+	_ocf_lazy_init_put(lazy_init);
+}
+
+/* Call end once all lines are added to freelist */
+static void _ocf_lazy_init_wait(ocf_lazy_init_t lazy_init,
+		struct ocf_lazy_init_waiter *waiter,
+		ocf_lazy_init_end_t end, void *priv)
+{
+	waiter->end = end;
+	waiter->priv = priv;
+
+	/* Pending lines drop to zero before waiters are woken up */
+	env_spinlock_lock(&lazy_init->waiters_lock);
+	if (!env_atomic64_read(&lazy_init->pending)) {
+		env_spinlock_unlock(&lazy_init->waiters_lock);
+		end(priv);
+		return;
+	}
+	list_add_tail(&waiter->list, &lazy_init->waiters);
+	env_spinlock_unlock(&lazy_init->waiters_lock);
+}
+
+static bool _ocf_lazy_init_claim(ocf_lazy_init_t lazy_init,
+		ocf_cache_line_t *phys, ocf_cache_line_t *count)
+{
+	long next;
+
+	do {
+		next = env_atomic64_read(&lazy_init->next);
+		if (next >= lazy_init->line_entries)
+			return false;
+
+		*phys = next;
+		*count = OCF_MIN(lazy_init->line_entries - *phys,
+				OCF_LAZY_INIT_CHUNK);
+	} while (env_atomic64_cmpxchg(&lazy_init->next, next,
+			next + *count) != next);
+
+	return true;
+}
+
+static ocf_cache_line_t _ocf_lazy_init_chunk(ocf_lazy_init_t lazy_init)
+{
+	struct ocf_cache *cache = lazy_init->cache;
+	ocf_cache_line_t phys, count;
+
+	if (!_ocf_lazy_init_claim(lazy_init, &phys, &count))
+		return 0;
+
+	ocf_metadata_init_collision_range(cache, phys, count);
+	ocf_freelist_populate_range(cache->freelist, phys, count);
+
+	if (!env_atomic64_sub_return(count, &lazy_init->pending))
+		_ocf_lazy_init_initialized(lazy_init);
+
+	return count;
+}
+
+static void _ocf_lazy_init_finish_complete(void *priv, int error)
+{
+	ocf_lazy_init_t lazy_init = priv;
+	struct ocf_cache *cache = lazy_init->cache;
+
+	if (error) {
+		ocf_cache_log(cache, log_err, "Failed to flush metadata "
+				"after lazy initialization\n");
+	}
+
+	ocf_refcnt_dec(&cache->refcnt.metadata);
+}
+
+static int _ocf_lazy_init_finish(struct ocf_request *req)
+{
+	ocf_lazy_init_t lazy_init = req->priv;
+	struct ocf_cache *cache = lazy_init->cache;
+
+	ocf_req_put(req);
+	lazy_init->finish_req = NULL;
+
+	ocf_cache_log(cache, log_info, "Metadata initialized in %llu ms\n",
+			(unsigned long long)env_ticks_to_msecs(
+				env_get_tick_count() - lazy_init->start));
+
+	/* Metadata was not flushed on attach, as it was not initialized.
+	 * Cache is running, so shutdown status stays dirty. */
+	ocf_metadata_flush_initialized(cache, _ocf_lazy_init_finish_complete,
+			lazy_init);
+
+	return 0;
+}
+
+static const struct ocf_io_if _io_if_lazy_init_finish = {
+	.read = _ocf_lazy_init_finish,
+	.write = _ocf_lazy_init_finish,
+};
+
+static int _ocf_lazy_init_step(struct ocf_request *req)
+{
+	ocf_lazy_init_t lazy_init = req->priv;
+
+	/* One chunk at a time, so that I/O on the queue is not held off */
+	if (_ocf_lazy_init_chunk(lazy_init)) {
+		ocf_engine_push_req_back(req, false);
+		return 0;
+	}
+
+	/* Chunks still in progress are finished by the ones who took them */
+	ocf_req_put(req);
+	_ocf_lazy_init_put(lazy_init);
+
+	return 0;
+}
+
+static const struct ocf_io_if _io_if_lazy_init_step = {
+	.read = _ocf_lazy_init_step,
+	.write = _ocf_lazy_init_step,
+};
+
+static bool _ocf_lazy_init_spawn(ocf_lazy_init_t lazy_init,
+		ocf_queue_t queue)
+{
+	struct ocf_request *req;
+
+	req = ocf_req_new(queue, NULL, 0, 0, 0);
+	if (!req)
+		return false;
+
+	req->info.internal = true;
+	req->io_if = &_io_if_lazy_init_step;
+	req->priv = lazy_init;
+
+	env_atomic_inc(&lazy_init->refs);
+	ocf_engine_push_req_back(req, true);
+
+	return true;
+}
+
+ocf_lazy_init_t ocf_lazy_init_init(struct ocf_cache *cache)
+{
+	ocf_lazy_init_t lazy_init;
+
+	lazy_init = env_vzalloc(sizeof(*lazy_init));
+	if (!lazy_init)
+		return NULL;
+
+	lazy_init->finish_req = ocf_req_new(cache->mngt_queue, NULL, 0, 0, 0);
+	if (!lazy_init->finish_req)
+		goto err_req;
+
+	lazy_init->finish_req->info.internal = true;
+	lazy_init->finish_req->io_if = &_io_if_lazy_init_finish;
+	lazy_init->finish_req->priv = lazy_init;
+
+	if (env_spinlock_init(&lazy_init->waiters_lock))
+		goto err_lock;
+
+	INIT_LIST_HEAD(&lazy_init->waiters);
+
+	lazy_init->cache = cache;
+	lazy_init->line_entries = ocf_metadata_collision_table_entries(cache);
+	env_atomic64_set(&lazy_init->next, 0);
+	env_atomic64_set(&lazy_init->pending, lazy_init->line_entries);
+	/* Put once all lines are initialized */
+	env_atomic_set(&lazy_init->refs, 1);
+
+	return lazy_init;
+
+err_lock:
+	ocf_req_put(lazy_init->finish_req);
+err_req:
+	env_vfree(lazy_init);
+	return NULL;
+}
+
+void ocf_lazy_init_deinit(ocf_lazy_init_t lazy_init)
+{
+	if (!lazy_init)
+		return;
+
+	ENV_BUG_ON(lazy_init->metadata_ref &&
+			env_atomic_read(&lazy_init->refs));
+
+	if (lazy_init->finish_req)
+		ocf_req_put(lazy_init->finish_req);
+
+	env_spinlock_destroy(&lazy_init->waiters_lock);
+	env_vfree(lazy_init);
+}
+
+void ocf_lazy_init_start(ocf_lazy_init_t lazy_init)
+{
+	struct ocf_cache *cache;
+	ocf_queue_t queue;
+	unsigned spawned = 0;
+
+	if (!lazy_init)
+		return;
+
+	cache = lazy_init->cache;
+	lazy_init->start = env_get_tick_count();
+
+	/* Reference held until metadata is flushed, so that cache can not
+	 * be stopped or detached before */
+	lazy_init->metadata_ref = ocf_refcnt_inc(&cache->refcnt.metadata);
+	if (!lazy_init->metadata_ref) {
+		ocf_lazy_init_complete(lazy_init);
+		return;
+	}
+
+	/* Hold off finish until all workers are spawned */
+	env_atomic_inc(&lazy_init->refs);
+
+	list_for_each_entry(queue, &cache->io_queues, list) {
+		if (queue == cache->mngt_queue)
+			continue;
+		if (spawned == OCF_LAZY_INIT_MAX_WORKERS)
+			break;
+		if (!_ocf_lazy_init_spawn(lazy_init, queue))
+			break;
+		spawned++;
+	}
+
+	if (!spawned && !_ocf_lazy_init_spawn(lazy_init, cache->mngt_queue))
+		ocf_lazy_init_complete(lazy_init);
+
+	_ocf_lazy_init_put(lazy_init);
+}
+
+ocf_cache_line_t ocf_lazy_init_on_demand(ocf_lazy_init_t lazy_init,
+		ocf_cache_line_t count)
+{
+	ocf_cache_line_t added = 0, chunk;
+
+	if (!lazy_init)
+		return 0;
+
+	while (added < count) {
+		chunk = _ocf_lazy_init_chunk(lazy_init);
+		if (!chunk)
+			break;
+		added += chunk;
+	}
+
+	return added;
+}
+
+static void _ocf_lazy_init_complete_end(void *priv)
+{
+	env_completion_complete(priv);
+}
+
+void ocf_lazy_init_complete(ocf_lazy_init_t lazy_init)
+{
+	struct ocf_lazy_init_waiter waiter;
+	env_completion cmpl;
+
+	if (!lazy_init)
+		return;
+
+	while (_ocf_lazy_init_chunk(lazy_init))
+		env_cond_resched();
+
+	/* Chunks taken by others are in progress, the last one to finish
+	 * wakes up waiters */
+	env_completion_init(&cmpl);
+	_ocf_lazy_init_wait(lazy_init, &waiter, _ocf_lazy_init_complete_end,
+			&cmpl);
+	env_completion_wait(&cmpl);
+	env_completion_destroy(&cmpl);
+}
+
+ocf_cache_line_t ocf_lazy_init_pending(ocf_lazy_init_t lazy_init)
+{
+	return lazy_init ? env_atomic64_read(&lazy_init->pending) : 0;
+}
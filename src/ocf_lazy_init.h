@@ -0,0 +1,47 @@
+/*
+ * Copyright(c) 2020 Intel Corporation
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef __OCF_LAZY_INIT_H__
+#define __OCF_LAZY_INIT_H__
+
+#include "ocf_cache_priv.h"
+
+/*
+ * Lazy initialization of attached metadata. Collision table entries are
+ * initialized in chunks of physical cache lines, each chunk is added to
+ * freelist right after it is initialized. Chunks are initialized in
+ * background by requests running on cache I/O queues, or on demand when
+ * mapping runs out of free cache lines. Cache lines of not yet initialized
+ * chunks are never mapped.
+ *
+ * Operations walking whole collision table have to complete initialization
+ * first. Metadata is flushed to cache device once all chunks are initialized,
+ * until then superblock on cache device marks collision segment as not
+ * initialized, so that cache can not be recovered from it.
+ */
+struct ocf_lazy_init;
+
+typedef struct ocf_lazy_init *ocf_lazy_init_t;
+
+/* Init / deinit lazy initialization runtime structures */
+ocf_lazy_init_t ocf_lazy_init_init(struct ocf_cache *cache);
+void ocf_lazy_init_deinit(ocf_lazy_init_t lazy_init);
+
+/* Start initialization in background */
+void ocf_lazy_init_start(ocf_lazy_init_t lazy_init);
+
+/* Initialize chunks until at least count lines are added to freelist,
+ * returns number of lines added */
+ocf_cache_line_t ocf_lazy_init_on_demand(ocf_lazy_init_t lazy_init,
+		ocf_cache_line_t count);
+
+/* Initialize all remaining chunks and wait for the ones initialized by others
+ * to be done */
+void ocf_lazy_init_complete(ocf_lazy_init_t lazy_init);
+
+/* Return number of lines not added to freelist yet */
+ocf_cache_line_t ocf_lazy_init_pending(ocf_lazy_init_t lazy_init);
+
+#endif /* __OCF_LAZY_INIT_H__ */
@@ -96,8 +96,33 @@ struct ocf_req_discard_info {
 	sector_t nr_sects;
 		/*!< Number of sectors to be discarded */
 
-	sector_t handled;
-		/*!< Number of processed sector during discard operation */
+	struct ocf_request *parent;
+		/*!< Discard request which range this step worker handles */
+
+	env_atomic64 next;
+		/*!< Offset in sectors of next step to be claimed by a worker */
+
+	env_atomic workers;
+		/*!< Number of step workers still running */
+
+	env_atomic error;
+		/*!< First error reported by a step worker */
+
+	env_atomic64 skipped;
+		/*!< Number of sectors skipped as nothing of them is cached */
+
+	env_atomic64 invalidated;
+		/*!< Number of cache lines invalidated */
+
+	uint64_t start_time;
+		/*!< Time at which discard started, in ticks */
+
+	uint64_t *core_lines;
+		/*!< Sorted core lines of the range mapped when discard started,
+		 * NULL if mapped regions are looked up in core index counters */
+
+	uint64_t core_lines_count;
+		/*!< Number of entries in core_lines */
 };
 
 /**
@@ -18,7 +18,8 @@ static inline bool ocf_seq_cutoff_is_on(ocf_cache_t cache,
 	if (!ocf_cache_is_device_attached(cache))
 		return false;
 
-	return (ocf_freelist_num_free(cache->freelist) <=
+	return (ocf_freelist_num_free(cache->freelist) +
+			ocf_lazy_init_pending(cache->lazy_init) <=
 				SEQ_CUTOFF_FULL_MARGIN + req->core_line_count);
 }
 
@@ -57,6 +57,15 @@ static void ocf_stats_error_init(struct ocf_counters_error *stats)
 	env_atomic_set(&stats->write, 0);
 }
 
+static void ocf_stats_discard_init(struct ocf_counters_discard *stats)
+{
+	env_atomic64_set(&stats->requests, 0);
+	env_atomic64_set(&stats->bytes, 0);
+	env_atomic64_set(&stats->skipped_bytes, 0);
+	env_atomic64_set(&stats->invalidated_clines, 0);
+	env_atomic64_set(&stats->time_ns, 0);
+}
+
 static void _ocf_stats_block_update(struct ocf_counters_block *counters, int dir,
 		uint64_t bytes)
 {
@@ -171,6 +180,19 @@ void ocf_core_stats_cache_error_update(ocf_core_t core, uint8_t dir)
 	_ocf_core_stats_error_update(counters, dir);
 }
 
+void ocf_core_stats_discard_update(ocf_core_t core, uint64_t bytes,
+		uint64_t skipped_bytes, uint64_t invalidated_clines,
+		uint64_t time_ns)
+{
+	struct ocf_counters_discard *counters = &core->counters->discard;
+
+	env_atomic64_inc(&counters->requests);
+	env_atomic64_add(bytes, &counters->bytes);
+	env_atomic64_add(skipped_bytes, &counters->skipped_bytes);
+	env_atomic64_add(invalidated_clines, &counters->invalidated_clines);
+	env_atomic64_add(time_ns, &counters->time_ns);
+}
+
 /********************************************************************
  * Function that resets stats, debug and breakdown counters.
  * If reset is set the following stats won't be reset:
@@ -194,6 +216,7 @@ void ocf_core_stats_initialize(ocf_core_t core)
 
 	ocf_stats_error_init(&exp_obj_stats->cache_errors);
 	ocf_stats_error_init(&exp_obj_stats->core_errors);
+	ocf_stats_discard_init(&exp_obj_stats->discard);
 
 	for (i = 0; i != OCF_IO_CLASS_MAX; i++)
 		ocf_stats_part_init(&exp_obj_stats->part_counters[i]);
@@ -254,6 +277,17 @@ static void copy_error_stats(struct ocf_stats_error *dest,
 	dest->write = env_atomic_read(&from->write);
 }
 
+static void copy_discard_stats(struct ocf_stats_discard *dest,
+		const struct ocf_counters_discard *from)
+{
+	dest->requests = env_atomic64_read(&from->requests);
+	dest->bytes = env_atomic64_read(&from->bytes);
+	dest->skipped_bytes = env_atomic64_read(&from->skipped_bytes);
+	dest->invalidated_clines =
+			env_atomic64_read(&from->invalidated_clines);
+	dest->time_ns = env_atomic64_read(&from->time_ns);
+}
+
 #ifdef OCF_DEBUG_STATS
 static void copy_debug_stats(struct ocf_stats_core_debug *dest,
 		const struct ocf_counters_debug *from)
@@ -336,6 +370,7 @@ int ocf_core_get_stats(ocf_core_t core, struct ocf_stats_core *stats)
 			&core_stats->core_errors);
 	copy_error_stats(&stats->cache_errors,
 			&core_stats->cache_errors);
+	copy_discard_stats(&stats->discard, &core_stats->discard);
 
 #ifdef OCF_DEBUG_STATS
 	copy_debug_stats(&stats->debug_stat,
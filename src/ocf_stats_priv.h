@@ -114,6 +114,28 @@ struct ocf_stats_core_debug {
 	uint64_t write_align[IO_ALIGN_NO];
 };
 
+/**
+ * @brief OCF discard statistics
+ *
+ * @note Discard throughput is bytes / time_ns
+ */
+struct ocf_stats_discard {
+	/** Number of completed discard requests */
+	uint64_t requests;
+
+	/** Bytes discarded */
+	uint64_t bytes;
+
+	/** Bytes skipped without lookup, as nothing of them was cached */
+	uint64_t skipped_bytes;
+
+	/** Cache lines invalidated */
+	uint64_t invalidated_clines;
+
+	/** Total time of discard requests in cache */
+	uint64_t time_ns;
+};
+
 /**
  * @brief OCF core statistics
  */
@@ -145,6 +167,9 @@ struct ocf_stats_core {
 	/** Core volume error statistics */
 	struct ocf_stats_error core_errors;
 
+	/** Discard statistics */
+	struct ocf_stats_discard discard;
+
 	/** Debug statistics */
 	struct ocf_stats_core_debug debug_stat;
 };
@@ -172,10 +197,20 @@ struct ocf_counters_debug {
 };
 #endif
 
+struct ocf_counters_discard {
+	env_atomic64 requests;
+	env_atomic64 bytes;
+	env_atomic64 skipped_bytes;
+	env_atomic64 invalidated_clines;
+	env_atomic64 time_ns;
+};
+
 struct ocf_counters_core {
 	struct ocf_counters_error core_errors;
 	struct ocf_counters_error cache_errors;
 
+	struct ocf_counters_discard discard;
+
 	struct ocf_counters_part part_counters[OCF_IO_CLASS_MAX];
 #ifdef OCF_DEBUG_STATS
 	struct ocf_counters_debug debug_stats;
@@ -197,6 +232,10 @@ void ocf_core_stats_request_pt_update(ocf_core_t core, ocf_part_id_t part_id,
 void ocf_core_stats_core_error_update(ocf_core_t core, uint8_t dir);
 void ocf_core_stats_cache_error_update(ocf_core_t core, uint8_t dir);
 
+void ocf_core_stats_discard_update(ocf_core_t core, uint64_t bytes,
+		uint64_t skipped_bytes, uint64_t invalidated_clines,
+		uint64_t time_ns);
+
 /**
  * @brief ocf_core_io_class_get_stats retrieve io class statistics
  *			for given core
@@ -75,6 +75,11 @@ struct flush_container {
 	uint64_t ticks1;
 	uint64_t ticks2;
 
+	/* number of lines in portion being flushed */
+	uint32_t inflight;
+	/* entry on list of containers waiting for inflight budget */
+	struct list_head waiting;
+
 	ocf_flush_containter_coplete_t end;
 	struct ocf_mngt_cache_flush_context *context;
 };
@@ -63,10 +63,41 @@ class CacheDeviceConfig(Structure):
         ("_uuid", Uuid),
         ("_volume_type", c_uint8),
         ("_cache_line_size", c_uint64),
+        ("_open_cores", c_bool),
         ("_force", c_bool),
-        ("_min_free_ram", c_uint64),
         ("_perform_test", c_bool),
         ("_discard_on_start", c_bool),
+        ("_core_line_index", c_bool),
+        ("_lazy_init", c_bool),
+        ("_compact_metadata", c_bool),
+        ("_volume_params", c_void_p),
+    ]
+
+
+class FlushLimits(Structure):
+    _fields_ = [("_max_inflight", c_uint32), ("_max_rate", c_uint64)]
+
+
+class FlushProgress(Structure):
+    _fields_ = [
+        ("in_progress", c_bool),
+        ("total_bytes", c_uint64),
+        ("flushed_bytes", c_uint64),
+        ("remaining_bytes", c_uint64),
+        ("rate", c_uint64),
+        ("elapsed", c_uint64),
+        ("eta", c_uint64),
+    ]
+
+
+class MetadataUpdaterStats(Structure):
+    _fields_ = [
+        ("flush_requests", c_uint64),
+        ("write_requests", c_uint64),
+        ("merged_writes", c_uint64),
+        ("write_ios", c_uint64),
+        ("lock_acquisitions", c_uint64),
+        ("lock_held_ns", c_uint64),
     ]
 
 
@@ -96,6 +127,7 @@ class CacheMode(IntEnum):
 
 class EvictionPolicy(IntEnum):
     LRU = 0
+    CLOCK = 1
     DEFAULT = LRU
 
 
@@ -300,7 +332,14 @@ class Cache:
             raise OcfError("Error setting cache seq cut off policy", status)
 
     def configure_device(
-        self, device, force=False, perform_test=True, cache_line_size=None
+        self,
+        device,
+        force=False,
+        perform_test=True,
+        cache_line_size=None,
+        core_line_index=False,
+        lazy_init=False,
+        compact_metadata=False,
     ):
         self.device = device
         self.device_name = device.uuid
@@ -315,16 +354,30 @@ class Cache:
             _cache_line_size=cache_line_size
             if cache_line_size
             else self.cache_line_size,
+            _open_cores=True,
             _force=force,
-            _min_free_ram=0,
             _perform_test=perform_test,
             _discard_on_start=False,
+            _core_line_index=core_line_index,
+            _lazy_init=lazy_init,
+            _compact_metadata=compact_metadata,
+            _volume_params=None,
         )
 
     def attach_device(
-        self, device, force=False, perform_test=False, cache_line_size=None
+        self,
+        device,
+        force=False,
+        perform_test=False,
+        cache_line_size=None,
+        core_line_index=False,
+        lazy_init=False,
+        compact_metadata=False,
     ):
-        self.configure_device(device, force, perform_test, cache_line_size)
+        self.configure_device(
+            device, force, perform_test, cache_line_size, core_line_index,
+            lazy_init, compact_metadata
+        )
         self.write_lock()
 
         c = OcfCompletion([("cache", c_void_p), ("priv", c_void_p), ("error", c_int)])
@@ -566,6 +619,33 @@ class Cache:
         if c.results["error"]:
             raise OcfError("Couldn't flush cache", c.results["error"])
 
+    def set_flush_limits(self, max_inflight=0, max_rate=0):
+        status = self.owner.lib.ocf_mngt_cache_set_flush_limits(
+            self.cache_handle,
+            byref(FlushLimits(_max_inflight=max_inflight, _max_rate=max_rate)),
+        )
+
+        if status:
+            raise OcfError("Error setting flush limits", status)
+
+    def get_flush_progress(self):
+        progress = FlushProgress()
+
+        status = self.owner.lib.ocf_mngt_cache_get_flush_progress(
+            self.cache_handle, byref(progress)
+        )
+
+        if status:
+            raise OcfError("Error getting flush progress", status)
+
+        return struct_to_dict(progress)
+
+    def get_metadata_updater_stats(self):
+        stats = MetadataUpdaterStats()
+        self.owner.lib.ocf_metadata_updater_get_stats(self.cache_handle, byref(stats))
+
+        return struct_to_dict(stats)
+
     def get_name(self):
         self.read_lock()
 
@@ -605,3 +685,8 @@ lib.ocf_mngt_cache_cleaning_set_param.argtypes = [
     c_uint32,
 ]
 lib.ocf_mngt_cache_cleaning_set_param.restype = c_int
+lib.ocf_mngt_cache_set_flush_limits.argtypes = [c_void_p, c_void_p]
+lib.ocf_mngt_cache_set_flush_limits.restype = c_int
+lib.ocf_mngt_cache_get_flush_progress.argtypes = [c_void_p, c_void_p]
+lib.ocf_mngt_cache_get_flush_progress.restype = c_int
+lib.ocf_metadata_updater_get_stats.argtypes = [c_void_p, c_void_p]
@@ -49,6 +49,10 @@ class CoreConfig(Structure):
     ]
 
 
+class IoClassRange(Structure):
+    _fields_ = [("_start", c_uint64), ("_end", c_uint64), ("_class_id", c_uint32)]
+
+
 class Core:
     DEFAULT_ID = 4096
     DEFAULT_SEQ_CUTOFF_THRESHOLD = 1024 * 1024
@@ -162,9 +166,47 @@ class Core:
 
         self.cache.write_unlock()
 
+    def set_io_class_ranges(self, ranges):
+        cfg = (IoClassRange * max(len(ranges), 1))()
+        for i, (start, end, class_id) in enumerate(ranges):
+            cfg[i] = IoClassRange(_start=start, _end=end, _class_id=class_id)
+
+        self.cache.write_lock()
+
+        status = self.cache.owner.lib.ocf_mngt_core_set_io_class_ranges(
+            self.handle, cfg, len(ranges)
+        )
+        if status:
+            self.cache.write_unlock()
+            raise OcfError("Error setting core IO class ranges", status)
+
+        self.cache.write_unlock()
+
     def reset_stats(self):
         self.cache.owner.lib.ocf_core_stats_initialize(self.handle)
 
+    def flush(self):
+        self.cache.write_lock()
+
+        c = OcfCompletion([("core", c_void_p), ("priv", c_void_p), ("error", c_int)])
+        self.cache.owner.lib.ocf_mngt_core_flush(self.handle, c, None)
+        c.wait()
+        self.cache.write_unlock()
+
+        if c.results["error"]:
+            raise OcfError("Couldn't flush core", c.results["error"])
+
+    def purge(self):
+        self.cache.write_lock()
+
+        c = OcfCompletion([("core", c_void_p), ("priv", c_void_p), ("error", c_int)])
+        self.cache.owner.lib.ocf_mngt_core_purge(self.handle, c, None)
+        c.wait()
+        self.cache.write_unlock()
+
+        if c.results["error"]:
+            raise OcfError("Couldn't purge core", c.results["error"])
+
     def exp_obj_md5(self):
         logging.getLogger("pyocf").warning(
             "Reading whole exported object! This disturbs statistics values"
@@ -211,6 +253,8 @@ lib.ocf_core_get_volume.argtypes = [c_void_p]
 lib.ocf_core_get_volume.restype = c_void_p
 lib.ocf_mngt_core_set_seq_cutoff_policy.argtypes = [c_void_p, c_uint32]
 lib.ocf_mngt_core_set_seq_cutoff_policy.restype = c_int
+lib.ocf_mngt_core_set_io_class_ranges.argtypes = [c_void_p, c_void_p, c_uint32]
+lib.ocf_mngt_core_set_io_class_ranges.restype = c_int
 lib.ocf_stats_collect_core.argtypes = [c_void_p, c_void_p, c_void_p, c_void_p, c_void_p]
 lib.ocf_stats_collect_core.restype = c_int
 lib.ocf_core_get_info.argtypes = [c_void_p, c_void_p]
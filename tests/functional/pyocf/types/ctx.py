@@ -3,7 +3,8 @@
 # SPDX-License-Identifier: BSD-3-Clause-Clear
 #
 
-from ctypes import c_void_p, Structure, c_char_p, cast, pointer, byref, c_int
+from ctypes import c_void_p, Structure, c_char_p, cast, pointer, byref, c_int, c_bool
+from enum import IntEnum
 
 from .logger import LoggerOps, Logger
 from .data import DataOps, Data
@@ -28,6 +29,17 @@ class OcfCtxCfg(Structure):
     _fields_ = [("name", c_char_p), ("ops", OcfCtxOps), ("logger_priv", c_void_p)]
 
 
+class NumaPolicy(IntEnum):
+    DEFAULT = 0
+    PREFERRED = 1
+    BIND = 2
+    INTERLEAVE = 3
+
+
+class EnvMemConfig(Structure):
+    _fields_ = [("_hugepages", c_bool), ("_numa_policy", c_int), ("_numa_node", c_int)]
+
+
 class OcfCtx:
     def __init__(self, lib, name, logger, data, mu, cleaner):
         self.logger = logger
@@ -85,6 +97,22 @@ class OcfCtx:
             if vol_type:
                 self.unregister_volume_type(vol_type)
 
+    def set_mem_config(self, hugepages=False, numa_policy=NumaPolicy.DEFAULT, numa_node=0):
+        cfg = EnvMemConfig(
+            _hugepages=hugepages, _numa_policy=numa_policy, _numa_node=numa_node
+        )
+        self.lib.env_mem_set_config(byref(cfg))
+
+    def get_mem_config(self):
+        cfg = EnvMemConfig()
+        self.lib.env_mem_get_config(byref(cfg))
+
+        return {
+            "hugepages": cfg._hugepages,
+            "numa_policy": NumaPolicy(cfg._numa_policy),
+            "numa_node": cfg._numa_node,
+        }
+
     def stop_caches(self):
         for cache in self.caches[:]:
             cache.stop()
@@ -120,3 +148,5 @@ def get_default_ctx(logger):
 lib = OcfLib.getInstance()
 lib.ocf_mngt_cache_get_by_name.argtypes = [c_void_p, c_void_p, c_void_p]
 lib.ocf_mngt_cache_get_by_name.restype = c_int
+lib.env_mem_set_config.argtypes = [c_void_p]
+lib.env_mem_get_config.argtypes = [c_void_p]
@@ -98,6 +98,9 @@ class Io(Structure):
     def submit(self):
         return OcfLib.getInstance().ocf_core_submit_io_wrapper(byref(self))
 
+    def submit_discard(self):
+        return OcfLib.getInstance().ocf_core_submit_discard_wrapper(byref(self))
+
     def set_data(self, data: Data, offset: int = 0):
         self.data = data
         OcfLib.getInstance().ocf_io_set_data(byref(self), data, offset)
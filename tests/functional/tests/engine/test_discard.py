@@ -0,0 +1,101 @@
+#
+# Copyright(c) 2020 Intel Corporation
+# SPDX-License-Identifier: BSD-3-Clause-Clear
+#
+
+from ctypes import c_int
+from hashlib import md5
+
+import pytest
+
+from pyocf.types.cache import Cache, CacheMode
+from pyocf.types.core import Core
+from pyocf.types.queue import Queue
+from pyocf.types.volume import Volume
+from pyocf.types.data import Data
+from pyocf.types.io import IoDir
+from pyocf.utils import Size
+from pyocf.types.shared import OcfCompletion, SeqCutOffPolicy
+
+
+def _new_io(core, addr, size, direction, data):
+    comp = OcfCompletion([("error", c_int)])
+
+    io = core.new_io(core.cache.get_default_queue(), addr, size, direction, 0, 0)
+    io.set_data(data)
+    io.callback = comp.callback
+
+    return io, comp
+
+
+def _io(core, addr, size, direction, data):
+    io, comp = _new_io(core, addr, size, direction, data)
+    io.submit()
+    comp.wait()
+    assert not comp.results["error"], "No IO should fail"
+
+
+@pytest.mark.parametrize("core_line_index", [False, True])
+def test_discard_sparse_range(pyocf_ctx, core_line_index):
+    """
+    Discard a large range of which only a few parts are cached.
+
+    Every other MiB of one core is written, as is a part of another core, then the first
+    three quarters of the first core are discarded in a single request. Cached lines of the
+    discarded range have to be invalidated and the range zeroed on the core, while lines
+    past the range and lines of the other core have to stay cached. With core line index
+    the core has fewer lines than the range, so they are found from its list; without it
+    every line of the range is looked up. Steps of the discard run on several I/O queues.
+    """
+    cache_size = Size.from_MiB(100)
+    core_size = Size.from_MiB(128)
+    chunk = Size.from_MiB(1)
+    line = Size.from_KiB(4)
+    discarded = core_size.B * 3 // 4
+
+    cache = Cache(owner=pyocf_ctx, cache_mode=CacheMode.WT)
+    cache.start_cache()
+    cache.io_queues += [Queue(cache, "io-{}".format(i)) for i in range(1, 4)]
+    cache.attach_device(Volume(cache_size), force=True, core_line_index=core_line_index)
+    core_device = Volume(core_size)
+    core = Core.using_device(core_device, name="core1")
+    cache.add_core(core)
+    other_device = Volume(Size.from_MiB(16))
+    other = Core.using_device(other_device, name="core2")
+    cache.add_core(other)
+    cache.set_seq_cut_off_policy(SeqCutOffPolicy.NEVER)
+
+    data = Data(chunk.B)
+    data.write(b"\x5a" * chunk.B, chunk.B)
+
+    expected = bytearray(core_size.B)
+    for addr in range(0, core_size.B, 2 * chunk.B):
+        _io(core, addr, chunk.B, IoDir.WRITE, data)
+        if addr >= discarded:
+            expected[addr:addr + chunk.B] = b"\x5a" * chunk.B
+    _io(other, 0, chunk.B, IoDir.WRITE, data)
+
+    written = core_size.B // 2
+    assert core.get_stats()["usage"]["occupancy"]["value"] == written // line.B
+
+    io, comp = _new_io(core, 0, discarded, IoDir.WRITE, Data(line.B))
+    io.submit_discard()
+    comp.wait()
+    assert not comp.results["error"], "Discard should not fail"
+
+    remaining = (core_size.B - discarded) // 2
+    assert core.get_stats()["usage"]["occupancy"]["value"] == remaining // line.B, \
+        "Only lines of discarded range should be invalidated"
+    assert other.get_stats()["usage"]["occupancy"]["value"] == chunk.B // line.B, \
+        "Lines of other core should stay cached"
+
+    assert core_device.md5() == md5(expected).hexdigest(), \
+        "Discarded range should be zeroed, rest of core kept"
+
+    read = Data(chunk.B)
+    _io(core, core_size.B - 2 * chunk.B, chunk.B, IoDir.READ, read)
+    assert read.md5() == data.md5()
+    _io(other, 0, chunk.B, IoDir.READ, read)
+    assert read.md5() == data.md5()
+    assert cache.get_stats()["req"]["rd_hits"]["value"] == 2, \
+        "Lines not discarded should be read from cache"
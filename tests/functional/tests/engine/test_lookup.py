@@ -0,0 +1,137 @@
+#
+# Copyright(c) 2020 Intel Corporation
+# SPDX-License-Identifier: BSD-3-Clause-Clear
+#
+
+import os
+import re
+from ctypes import c_int
+from random import Random
+
+import pytest
+
+from pyocf.types.cache import Cache, CacheMode
+from pyocf.types.core import Core
+from pyocf.types.ctx import NumaPolicy
+from pyocf.types.volume import Volume
+from pyocf.types.data import Data
+from pyocf.types.io import IoDir
+from pyocf.utils import Size
+from pyocf.types.shared import OcfCompletion, SeqCutOffPolicy
+
+HUGEPAGE_SIZE = Size.from_MiB(2)
+
+
+def _io(core, addr, size, direction, data):
+    comp = OcfCompletion([("error", c_int)])
+    io = core.new_io(core.cache.get_default_queue(), addr, size, direction, 0, 0)
+    io.set_data(data)
+    io.callback = comp.callback
+    io.submit()
+
+    return comp
+
+
+def _hugepage_mappings():
+    """Start addresses of mappings backed by explicit or advised transparent hugepages"""
+    mappings = set()
+    start = None
+
+    with open("/proc/self/smaps") as smaps:
+        for line in smaps:
+            header = re.match(r"^([0-9a-f]+)-[0-9a-f]+ ", line)
+            if header:
+                start = int(header.group(1), 16)
+            elif line.startswith("VmFlags:") and {"hg", "ht"} & set(line.split()[1:]):
+                mappings.add(start)
+
+    return mappings
+
+
+def _interleaved_mappings():
+    with open("/proc/self/numa_maps") as numa_maps:
+        return {
+            int(line.split()[0], 16)
+            for line in numa_maps
+            if line.split()[1].startswith("interleave")
+        }
+
+
+@pytest.mark.parametrize("numa_policy", [NumaPolicy.DEFAULT, NumaPolicy.INTERLEAVE])
+@pytest.mark.parametrize("hugepages", [False, True])
+def test_lookup_mem_config(pyocf_ctx, hugepages, numa_policy):
+    """
+    Start a cache with metadata placed according to memory config and serve hits from it.
+
+    Large metadata allocations have to be mapped on their own, 2 MiB aligned and advised
+    for hugepages if hugepages are enabled, and interleaved across NUMA nodes if that policy
+    is set. Random reads of a filled core have to hit and return data written before.
+    """
+    if not os.path.exists("/proc/self/smaps"):
+        pytest.skip("Mappings of process are not exposed")
+    numa = os.path.exists("/proc/self/numa_maps")
+
+    cache_size = Size.from_MiB(1024)
+    core_size = Size.from_MiB(64)
+    chunk = Size.from_MiB(1)
+    block = Size.from_KiB(4)
+    lookups = 1024
+
+    default = pyocf_ctx.get_mem_config()
+    pyocf_ctx.set_mem_config(hugepages=hugepages, numa_policy=numa_policy)
+    assert pyocf_ctx.get_mem_config()["hugepages"] == hugepages
+    assert pyocf_ctx.get_mem_config()["numa_policy"] == numa_policy
+
+    huge_before = _hugepage_mappings()
+    interleaved_before = _interleaved_mappings() if numa else set()
+
+    try:
+        cache = Cache.start_on_device(Volume(cache_size), cache_mode=CacheMode.WT)
+
+        huge = _hugepage_mappings() - huge_before
+        if hugepages:
+            assert huge, "Metadata should be backed by hugepages"
+            assert all(addr % HUGEPAGE_SIZE.B == 0 for addr in huge), \
+                "Hugepage backed metadata should be 2 MiB aligned"
+        else:
+            assert not huge, "Metadata should not be backed by hugepages"
+
+        if numa:
+            interleaved = _interleaved_mappings() - interleaved_before
+            if numa_policy == NumaPolicy.INTERLEAVE:
+                assert interleaved, "Metadata should be interleaved across NUMA nodes"
+            else:
+                assert not interleaved, "Metadata should be placed on first touch"
+
+        core = Core.using_device(Volume(core_size))
+        cache.add_core(core)
+        cache.set_seq_cut_off_policy(SeqCutOffPolicy.NEVER)
+
+        for addr in range(0, core_size.B, chunk.B):
+            data = Data(chunk.B)
+            data.write(bytes([addr // chunk.B]) * chunk.B, chunk.B)
+            comp = _io(core, addr, chunk.B, IoDir.WRITE, data)
+            comp.wait()
+            assert not comp.results["error"], "No IO should fail"
+
+        lines = core_size.B // block.B
+        assert cache.get_stats()["usage"]["occupancy"]["value"] == lines
+
+        rand = Random(lookups)
+        for _ in range(lookups):
+            addr = rand.randrange(lines) * block.B
+            read = Data(block.B)
+            comp = _io(core, addr, block.B, IoDir.READ, read)
+            comp.wait()
+            assert not comp.results["error"], "No IO should fail"
+
+            expected = Data(block.B)
+            expected.write(bytes([addr // chunk.B]) * block.B, block.B)
+            assert read.md5() == expected.md5(), f"Wrong data read at {addr}"
+
+        stats = core.get_stats()
+        assert stats["req"]["rd_full_misses"]["value"] == 0, "All reads should hit"
+        assert stats["req"]["rd_hits"]["value"] == lookups
+    finally:
+        pyocf_ctx.stop_caches()
+        pyocf_ctx.set_mem_config(**default)
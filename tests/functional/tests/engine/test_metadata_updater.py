@@ -0,0 +1,138 @@
+#
+# Copyright(c) 2020 Intel Corporation
+# SPDX-License-Identifier: BSD-3-Clause-Clear
+#
+
+from ctypes import c_int
+from time import sleep
+
+from pyocf.types.cache import Cache, CacheMode
+from pyocf.types.core import Core
+from pyocf.types.volume import Volume, TraceDevice
+from pyocf.types.data import Data
+from pyocf.types.io import IoDir
+from pyocf.utils import Size
+from pyocf.types.shared import OcfCompletion, SeqCutOffPolicy
+
+
+def _submit(core, addr, size, data):
+    comp = OcfCompletion([("error", c_int)])
+    io = core.new_io(core.cache.get_default_queue(), addr, size, IoDir.WRITE, 0, 0)
+    io.set_data(data)
+    io.callback = comp.callback
+    io.submit()
+
+    return comp
+
+
+def _wait_for(condition, message):
+    for _ in range(500):
+        if condition():
+            return
+        sleep(0.01)
+
+    assert condition(), message
+
+
+def _delta(cache, before):
+    stats = cache.get_metadata_updater_stats()
+    return {key: stats[key] - before[key] for key in before}
+
+
+def test_metadata_updater_counters(pyocf_ctx):
+    """
+    Every WB write flushes its metadata through the updater with one write I/O,
+    as nothing else is in progress on its pages when writes are sequential.
+    """
+    cache = Cache.start_on_device(Volume(Size.from_MiB(30)), cache_mode=CacheMode.WB)
+    core = Core.using_device(Volume(Size.from_MiB(16)))
+    cache.add_core(core)
+    cache.set_seq_cut_off_policy(SeqCutOffPolicy.NEVER)
+
+    before = cache.get_metadata_updater_stats()
+    writes = 64
+    data = Data(Size.from_KiB(4).B)
+    for i in range(writes):
+        comp = _submit(core, i * data.size, data.size, data)
+        comp.wait()
+        assert not comp.results["error"], "No IO should fail"
+
+    stats = _delta(cache, before)
+    assert stats["flush_requests"] == writes
+    assert stats["write_requests"] == writes
+    assert stats["write_ios"] == writes
+    assert stats["merged_writes"] == 0
+    assert stats["lock_acquisitions"] >= writes
+    assert stats["lock_held_ns"] > 0
+
+
+def test_metadata_updater_merge(pyocf_ctx):
+    """
+    Merge metadata writes of pages already waiting to be written.
+
+    Metadata write of the first request is held on the cache device. Collision
+    entries of lines mapped one after another share a metadata page, so the write
+    of the second request overlaps it and waits, and the write of the third one
+    is merged into the waiting write instead of being written on its own. All
+    requests complete once the held write does.
+    """
+    held = []
+    hold = False
+    metadata_end = 0
+
+    def trace(vol, io):
+        if hold and io.contents._dir == IoDir.WRITE and io.contents._addr < metadata_end:
+            held.append(io)
+            return False
+        return True
+
+    cache_device = TraceDevice(Size.from_MiB(30), trace_fcn=trace)
+    cache = Cache.start_on_device(cache_device, cache_mode=CacheMode.WB)
+    core_device = Volume(Size.from_MiB(16))
+    core = Core.using_device(core_device)
+    cache.add_core(core)
+    cache.set_seq_cut_off_policy(SeqCutOffPolicy.NEVER)
+
+    # Value is in 4 KiB pages
+    metadata_end = int(cache.get_stats()["conf"]["metadata_end_offset"]) * 4096
+    before = cache.get_metadata_updater_stats()
+    hold = True
+
+    block = Size.from_KiB(4).B
+    data = Data(block)
+    data.write(b"\x5a" * block, block)
+
+    comps = [_submit(core, 0, block, data)]
+    _wait_for(lambda: len(held) == 1, "Metadata write of first request should be held")
+
+    comps.append(_submit(core, block, block, data))
+    _wait_for(lambda: _delta(cache, before)["write_requests"] == 2,
+              "Second request should flush metadata")
+    assert len(held) == 1, "Write of the same metadata page should wait"
+
+    comps.append(_submit(core, 2 * block, block, data))
+    _wait_for(lambda: _delta(cache, before)["write_requests"] == 3,
+              "Third request should flush metadata")
+    stats = _delta(cache, before)
+    assert stats["merged_writes"] == 1, "Third write should be merged into waiting one"
+    assert stats["write_ios"] == 1
+
+    hold = False
+    for io in held:
+        Volume.submit_io(cache_device, io)
+
+    for comp in comps:
+        comp.wait()
+        assert not comp.results["error"], "No IO should fail"
+
+    stats = _delta(cache, before)
+    assert stats["flush_requests"] == 3
+    assert stats["write_requests"] == 3
+    assert stats["merged_writes"] == 1
+    assert stats["write_ios"] == 2, "Merged write should not be written on its own"
+
+    # Metadata of all requests is persistent, so all of them are recovered
+    device_copy = cache_device.get_copy()
+    cache.stop()
+    cache = Cache.load_from_device(device_copy)
+    assert cache.get_stats()["usage"]["dirty"]["value"] == 3
@@ -0,0 +1,142 @@
+#
+# Copyright(c) 2020 Intel Corporation
+# SPDX-License-Identifier: BSD-3-Clause-Clear
+#
+
+import logging
+from ctypes import c_int
+from time import perf_counter
+
+import pytest
+
+from pyocf.types.cache import Cache, CacheMode
+from pyocf.types.core import Core
+from pyocf.types.volume import Volume
+from pyocf.types.data import Data
+from pyocf.types.io import IoDir
+from pyocf.utils import Size
+from pyocf.types.shared import OcfCompletion, SeqCutOffPolicy
+
+logger = logging.getLogger(__name__)
+
+def _io(core, addr, size, direction, data):
+    comp = OcfCompletion([("error", c_int)])
+
+    io = core.new_io(core.cache.get_default_queue(), addr, size, direction, 0, 0)
+    io.set_data(data)
+    io.callback = comp.callback
+    io.submit()
+
+    return comp
+
+
+def _write_all(core, size, io_size, data, queue_depth=32):
+    addr = 0
+    while addr < size:
+        completions = []
+        for _ in range(queue_depth):
+            if addr >= size:
+                break
+            completions.append(_io(core, addr, io_size, IoDir.WRITE, data))
+            addr += io_size
+
+        for c in completions:
+            c.wait()
+            assert not c.results["error"], "No IO should fail"
+
+
+@pytest.mark.parametrize("io_size", [Size.from_KiB(4), Size.from_KiB(64), Size.from_KiB(256)])
+def test_miss_alloc_from_freelist(pyocf_ctx, io_size):
+    """
+    Write core lines that are not mapped yet to a cache large enough to hold them all.
+
+    Each request takes all its cache lines from the freelist without eviction. Lines taken
+    in bulk and not used are returned, so the free line count has to drop by exactly the
+    number of lines mapped.
+    """
+    cache_size = Size.from_MiB(100)
+    written = Size.from_MiB(80)
+
+    cache = Cache.start_on_device(Volume(cache_size), cache_mode=CacheMode.WT)
+    core = Core.using_device(Volume(written))
+    cache.add_core(core)
+    cache.set_seq_cut_off_policy(SeqCutOffPolicy.NEVER)
+
+    cache_lines = int(cache.get_stats()["conf"]["size"])
+
+    _write_all(core, written.B, io_size.B, Data(io_size.B))
+
+    lines = written.B // Size.from_KiB(4).B
+    stats = cache.get_stats()
+    assert stats["usage"]["occupancy"]["value"] == lines, "All written lines should be mapped"
+    assert stats["usage"]["free"]["value"] == cache_lines - lines, \
+        "Lines not mapped should be back on freelist"
+    assert stats["req"]["wr_full_misses"]["value"] == written.B // io_size.B, \
+        "Every write should be a full miss"
+
+
+@pytest.mark.parametrize("io_size", [Size.from_KiB(4), Size.from_KiB(64), Size.from_KiB(256)])
+def test_miss_alloc_benchmark(pyocf_ctx, io_size):
+    """
+    Measure cache line allocation on the miss path.
+
+    Every write is a full miss served from the freelist, as in the test above. Cache lines
+    allocated per second are logged for each I/O size, so that per-line and bulk
+    allocation can be compared across builds; nothing is asserted on timing.
+    """
+    cache_size = Size.from_MiB(100)
+    written = Size.from_MiB(80)
+
+    cache = Cache.start_on_device(Volume(cache_size), cache_mode=CacheMode.WT)
+    core = Core.using_device(Volume(written))
+    cache.add_core(core)
+    cache.set_seq_cut_off_policy(SeqCutOffPolicy.NEVER)
+
+    start = perf_counter()
+    _write_all(core, written.B, io_size.B, Data(io_size.B))
+    elapsed = perf_counter() - start
+
+    lines = written.B // Size.from_KiB(4).B
+    logger.info(
+        f"miss path, {io_size.B // 1024} KiB writes: {lines} cache lines "
+        f"in {elapsed:.3f} s, {lines / elapsed:.0f} lines/s"
+    )
+
+    assert cache.get_stats()["usage"]["occupancy"]["value"] == lines, \
+        "All written lines should be mapped"
+
+
+@pytest.mark.parametrize("io_size", [Size.from_KiB(4), Size.from_KiB(256)])
+def test_miss_alloc_freelist_exhausted(pyocf_ctx, io_size):
+    """
+    Write more core lines than the cache holds.
+
+    Once the freelist runs empty mapping has to fall back to eviction, every write has to
+    complete, no line may be lost or counted twice, and data of the last write has to be
+    read back from cache.
+    """
+    cache_size = Size.from_MiB(30)
+    written = Size.from_MiB(64)
+
+    cache = Cache.start_on_device(Volume(cache_size), cache_mode=CacheMode.WT)
+    core = Core.using_device(Volume(written))
+    cache.add_core(core)
+    cache.set_seq_cut_off_policy(SeqCutOffPolicy.NEVER)
+
+    cache_lines = int(cache.get_stats()["conf"]["size"])
+
+    data = Data(io_size.B)
+    data.write(b"\x5a" * io_size.B, io_size.B)
+    _write_all(core, written.B, io_size.B, data)
+
+    stats = cache.get_stats()
+    occupancy = stats["usage"]["occupancy"]["value"]
+    free = stats["usage"]["free"]["value"]
+    assert occupancy + free == cache_lines, "Every cache line should be mapped or free"
+
+    read = Data(io_size.B)
+    comp = _io(core, written.B - io_size.B, io_size.B, IoDir.READ, read)
+    comp.wait()
+    assert not comp.results["error"], "No IO should fail"
+    assert read.md5() == data.md5()
+    assert cache.get_stats()["req"]["rd_hits"]["value"] == 1, "Last write should be cached"
@@ -0,0 +1,105 @@
+#
+# Copyright(c) 2020 Intel Corporation
+# SPDX-License-Identifier: BSD-3-Clause-Clear
+#
+
+from ctypes import c_int
+
+import pytest
+
+from pyocf.types.cache import Cache, CacheMode, EvictionPolicy
+from pyocf.types.core import Core
+from pyocf.types.volume import Volume
+from pyocf.types.data import Data
+from pyocf.types.io import IoDir
+from pyocf.utils import Size
+from pyocf.types.shared import OcfCompletion, SeqCutOffPolicy
+
+
+def _io(core, addr, size, direction):
+    comp = OcfCompletion([("error", c_int)])
+    io = core.new_io(core.cache.get_default_queue(), addr, size, direction, 0, 0)
+    io.set_data(Data(size))
+    io.callback = comp.callback
+    io.submit()
+    comp.wait()
+    assert not comp.results["error"], "No IO should fail"
+
+
+def _start(pyocf_ctx, cache_device, compact_metadata):
+    cache = Cache(owner=pyocf_ctx, cache_mode=CacheMode.WT)
+    cache.start_cache()
+    cache.attach_device(cache_device, force=True, compact_metadata=compact_metadata)
+
+    return cache
+
+
+def test_compact_metadata_footprint(pyocf_ctx):
+    """
+    Compact metadata takes less memory per cache line and switches eviction to CLOCK,
+    as there is no room for LRU list pointers.
+    """
+    footprint = {}
+
+    for compact_metadata in [False, True]:
+        cache = _start(pyocf_ctx, Volume(Size.from_MiB(200)), compact_metadata)
+        stats = cache.get_stats()
+
+        expected = EvictionPolicy.CLOCK if compact_metadata else EvictionPolicy.LRU
+        assert stats["conf"]["eviction_policy"] == expected
+        footprint[compact_metadata] = stats["conf"]["metadata_footprint"].B
+
+        cache.stop()
+
+    assert footprint[True] < footprint[False], "Compact metadata should be smaller"
+
+
+@pytest.mark.parametrize("compact_metadata", [False, True])
+def test_compact_metadata_eviction(pyocf_ctx, compact_metadata):
+    """
+    Keep referenced lines cached while a core bigger than cache is written.
+
+    A hot range of core is read after every write of cold data, so its lines are always
+    referenced when the clock hand (or LRU tail) reaches them and must never be chosen as
+    victims, while cold lines written first have to be evicted. Mapping has to survive
+    cache stop and load.
+    """
+    cache_device = Volume(Size.from_MiB(200))
+    core_device = Volume(Size.from_MiB(256))
+    chunk = Size.from_KiB(128)
+    hot = Size.from_MiB(1)
+    hot_addr = core_device.size.B - hot.B
+
+    cache = _start(pyocf_ctx, cache_device, compact_metadata)
+    core = Core.using_device(core_device)
+    cache.add_core(core)
+    cache.set_seq_cut_off_policy(SeqCutOffPolicy.NEVER)
+
+    lines = int(cache.get_stats()["conf"]["size"])
+
+    _io(core, hot_addr, hot.B, IoDir.WRITE)
+    for addr in range(0, hot_addr, chunk.B):
+        _io(core, addr, chunk.B, IoDir.WRITE)
+
+        core.reset_stats()
+        _io(core, hot_addr, hot.B, IoDir.READ)
+        assert core.get_stats()["req"]["rd_hits"]["value"] == 1, \
+            f"Referenced lines should not be evicted (cold write at {addr})"
+
+    occupancy = cache.get_stats()["usage"]["occupancy"]["value"]
+    assert occupancy <= lines
+    assert occupancy > lines * 9 // 10, "Evicted lines should be reused"
+
+    core.reset_stats()
+    _io(core, 0, chunk.B, IoDir.READ)
+    assert core.get_stats()["req"]["rd_full_misses"]["value"] == 1, \
+        "Cold lines written first should be evicted"
+
+    occupancy = cache.get_stats()["usage"]["occupancy"]["value"]
+    cache.stop()
+
+    cache = Cache.load_from_device(cache_device)
+    stats = cache.get_stats()
+    assert stats["usage"]["occupancy"]["value"] == occupancy
+    expected = EvictionPolicy.CLOCK if compact_metadata else EvictionPolicy.LRU
+    assert stats["conf"]["eviction_policy"] == expected
@@ -0,0 +1,180 @@
+#
+# Copyright(c) 2020 Intel Corporation
+# SPDX-License-Identifier: BSD-3-Clause-Clear
+#
+
+import logging
+from ctypes import c_int
+from time import perf_counter
+
+import pytest
+
+from pyocf.types.cache import Cache, CacheMode
+from pyocf.types.core import Core
+from pyocf.types.volume import Volume
+from pyocf.types.data import Data
+from pyocf.types.io import IoDir
+from pyocf.utils import Size
+from pyocf.types.shared import OcfCompletion, SeqCutOffPolicy
+
+logger = logging.getLogger(__name__)
+
+CORE_COUNT = 4
+CORE_SIZE = Size.from_MiB(16)
+
+
+def _fill(core, size):
+    chunk = Size.from_KiB(128)
+
+    for addr in range(0, size.B, chunk.B):
+        comp = OcfCompletion([("error", c_int)])
+        io = core.new_io(core.cache.get_default_queue(), addr, chunk.B, IoDir.WRITE, 0, 0)
+        io.set_data(Data(chunk.B))
+        io.callback = comp.callback
+        io.submit()
+        comp.wait()
+        assert not comp.results["error"], "No IO should fail"
+
+
+def _prepare(pyocf_ctx, cache_size, cache_mode, core_line_index):
+    cache = Cache(owner=pyocf_ctx, cache_mode=cache_mode)
+    cache.start_cache()
+    cache.attach_device(Volume(cache_size), force=True, core_line_index=core_line_index)
+    cache.set_seq_cut_off_policy(SeqCutOffPolicy.NEVER)
+
+    devices = []
+    cores = []
+    for _ in range(CORE_COUNT):
+        device = Volume(CORE_SIZE)
+        core = Core.using_device(device)
+        cache.add_core(core)
+        devices.append(device)
+        cores.append(core)
+
+    return cache, cores, devices
+
+
+def _occupancy(core):
+    return core.get_stats()["usage"]["occupancy"]["value"]
+
+
+@pytest.mark.parametrize("core_line_index", [False, True])
+def test_core_index_flush_only_core(pyocf_ctx, core_line_index):
+    """
+    Flush one core of a cache shared by several dirty cores.
+
+    Dirty lines of the flushed core have to be written to its core device only, lines of
+    other cores have to stay dirty and their core devices untouched.
+    """
+    cache, cores, devices = _prepare(pyocf_ctx, Size.from_MiB(100), CacheMode.WB,
+                                     core_line_index)
+    lines = CORE_SIZE.B // Size.from_KiB(4).B
+
+    for core in cores:
+        _fill(core, CORE_SIZE)
+        assert core.get_stats()["usage"]["dirty"]["value"] == lines
+    for device in devices:
+        device.reset_stats()
+
+    cores[0].flush()
+
+    assert cores[0].get_stats()["usage"]["dirty"]["value"] == 0, "Flushed core should be clean"
+    assert _occupancy(cores[0]) == lines, "Flushed lines should stay cached"
+    assert devices[0].get_stats()[IoDir.WRITE] > 0, "Dirty data should reach core device"
+    for core, device in zip(cores[1:], devices[1:]):
+        assert core.get_stats()["usage"]["dirty"]["value"] == lines, \
+            "Other cores should stay dirty"
+        assert device.get_stats()[IoDir.WRITE] == 0, \
+            "Nothing should be written to other core devices"
+
+
+@pytest.mark.parametrize("core_line_index", [False, True])
+def test_core_index_follows_eviction(pyocf_ctx, core_line_index):
+    """
+    Purge and remove cores after cache lines were evicted from one core to another.
+
+    The cache holds less than all cores together, so filling the cores one after another
+    remaps lines of earlier cores to later ones. Purge and removal of a core have to find
+    exactly the lines it owns after these moves, leaving lines of other cores in place.
+    """
+    cache, cores, devices = _prepare(pyocf_ctx, Size.from_MiB(40), CacheMode.WT,
+                                     core_line_index)
+
+    for core in cores:
+        _fill(core, CORE_SIZE)
+
+    occupancy = [_occupancy(core) for core in cores]
+    assert occupancy[0] < CORE_SIZE.B // Size.from_KiB(4).B, \
+        "Lines of first core should have been evicted"
+    assert sum(occupancy) == cache.get_stats()["usage"]["occupancy"]["value"]
+
+    cores[1].purge()
+    assert _occupancy(cores[1]) == 0, "Purged core should have no lines in cache"
+    for core, count in zip(cores[2:], occupancy[2:]):
+        assert _occupancy(core) == count, "Other cores should keep their lines"
+
+    cache.remove_core(cores[2])
+    assert cache.get_stats()["usage"]["occupancy"]["value"] == occupancy[0] + occupancy[3], \
+        "Lines of removed and purged core should be freed"
+
+    for core in (cores[0], cores[3]):
+        core.purge()
+        assert _occupancy(core) == 0
+
+    assert cache.get_stats()["usage"]["occupancy"]["value"] == 0
+
+
+def _timed(op):
+    start = perf_counter()
+    op()
+    return perf_counter() - start
+
+
+@pytest.mark.parametrize("core_line_index", [False, True])
+def test_core_index_benchmark(pyocf_ctx, core_line_index):
+    """
+    Measure flush, purge and removal of a small core on caches of growing size.
+
+    Every cache holds the same number of lines of the small core, so with core line index
+    the operations visit the same lines on each cache and their time should stay flat,
+    while without it the whole collision table is scanned and time grows with cache size.
+    Times are logged for each cache size; nothing is asserted on timing.
+    """
+    small = Size.from_MiB(4)
+    lines = small.B // Size.from_KiB(4).B
+
+    for cache_size in [Size.from_MiB(100), Size.from_MiB(300), Size.from_MiB(900)]:
+        cache = Cache(owner=pyocf_ctx, cache_mode=CacheMode.WB)
+        cache.start_cache()
+        cache.attach_device(Volume(cache_size), force=True, core_line_index=core_line_index)
+        cache.set_seq_cut_off_policy(SeqCutOffPolicy.NEVER)
+
+        core = Core.using_device(Volume(small))
+        cache.add_core(core)
+        other = Core.using_device(Volume(CORE_SIZE))
+        cache.add_core(other)
+        _fill(core, small)
+        _fill(other, CORE_SIZE)
+
+        flush_time = _timed(core.flush)
+        assert core.get_stats()["usage"]["dirty"]["value"] == 0, "Flushed core should be clean"
+        assert _occupancy(core) == lines
+
+        purge_time = _timed(core.purge)
+        assert _occupancy(core) == 0, "Purged core should have no lines in cache"
+
+        _fill(core, small)
+        remove_time = _timed(lambda: cache.remove_core(core))
+        assert cache.get_stats()["usage"]["occupancy"]["value"] == _occupancy(other), \
+            "Lines of removed core should be freed"
+        assert other.get_stats()["usage"]["dirty"]["value"] == _occupancy(other), \
+            "Other core should stay dirty"
+
+        logger.info(
+            f"core line index {'on' if core_line_index else 'off'}, "
+            f"cache {cache_size.B // (1024 * 1024)} MiB, {lines} lines of core: "
+            f"flush {flush_time * 1000:.1f} ms, purge {purge_time * 1000:.1f} ms, "
+            f"remove {remove_time * 1000:.1f} ms"
+        )
+
+        cache.stop()
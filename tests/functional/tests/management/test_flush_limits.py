@@ -0,0 +1,91 @@
+#
+# Copyright(c) 2020 Intel Corporation
+# SPDX-License-Identifier: BSD-3-Clause-Clear
+#
+
+from ctypes import c_int
+
+import pytest
+
+from pyocf.types.cache import Cache, CacheMode, CleaningPolicy
+from pyocf.types.core import Core
+from pyocf.types.volume import Volume, TraceDevice
+from pyocf.types.data import Data
+from pyocf.types.io import IoDir
+from pyocf.utils import Size
+from pyocf.types.shared import OcfCompletion, SeqCutOffPolicy
+
+
+def _fill(core, size):
+    chunk = Size.from_KiB(128)
+
+    for addr in range(0, size.B, chunk.B):
+        comp = OcfCompletion([("error", c_int)])
+        io = core.new_io(core.cache.get_default_queue(), addr, chunk.B, IoDir.WRITE, 0, 0)
+        io.set_data(Data(chunk.B))
+        io.callback = comp.callback
+        io.submit()
+        comp.wait()
+        assert not comp.results["error"], "No IO should fail"
+
+
+@pytest.mark.parametrize("max_inflight", [0, 16])
+@pytest.mark.parametrize("max_rate", [0, Size.from_MiB(16).B])
+def test_flush_limits(pyocf_ctx, max_inflight, max_rate):
+    """
+    Flush dirty data of several cores under flush limits.
+
+    All cores are flushed concurrently. No write back to a core may cover more lines than
+    the in-flight limit allows, the rate reported after flush may exceed the rate limit by
+    no more than the budget used ahead of time, and progress has to account for all dirty
+    data.
+    """
+    core_count = 4
+    core_size = Size.from_MiB(8)
+    line_size = Size.from_KiB(4)
+    writes = {}
+
+    def trace(vol, io):
+        if io.contents._dir == IoDir.WRITE:
+            writes.setdefault(vol.uuid, []).append(io.contents._bytes)
+        return True
+
+    cache = Cache.start_on_device(Volume(Size.from_MiB(100)), cache_mode=CacheMode.WB)
+    cache.set_cleaning_policy(CleaningPolicy.NOP)
+    cache.set_seq_cut_off_policy(SeqCutOffPolicy.NEVER)
+
+    devices = []
+    for _ in range(core_count):
+        device = TraceDevice(core_size, trace_fcn=trace)
+        core = Core.using_device(device)
+        cache.add_core(core)
+        _fill(core, core_size)
+        devices.append(device)
+
+    dirty = core_count * core_size.B
+    assert cache.get_stats()["usage"]["dirty"]["value"] == dirty // line_size.B
+    assert not writes, "Nothing should be written back before flush"
+
+    cache.set_flush_limits(max_inflight=max_inflight, max_rate=max_rate)
+    cache.flush()
+
+    assert cache.get_stats()["usage"]["dirty"]["value"] == 0, "Cache should be clean"
+
+    for device in devices:
+        assert sum(writes[device.uuid]) == core_size.B, \
+            "Every dirty line should be written back once"
+        if max_inflight:
+            assert max(writes[device.uuid]) <= max_inflight * line_size.B, \
+                "Write back should not exceed in-flight limit"
+
+    progress = cache.get_flush_progress()
+    assert not progress["in_progress"]
+    assert progress["total_bytes"] == dirty
+    assert progress["flushed_bytes"] == dirty
+    assert progress["remaining_bytes"] == 0
+
+    if max_rate:
+        # Up to 100 ms worth of rate budget can be used ahead of time
+        assert progress["rate"] <= max_rate * dirty // (dirty - max_rate // 10), \
+            "Flush should respect rate limit"
+        assert progress["elapsed"] >= dirty // max_rate - 1
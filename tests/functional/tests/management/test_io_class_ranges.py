@@ -0,0 +1,135 @@
+#
+# Copyright(c) 2020 Intel Corporation
+# SPDX-License-Identifier: BSD-3-Clause-Clear
+#
+
+from ctypes import c_int
+from random import shuffle
+
+import pytest
+
+from pyocf.types.cache import Cache, CacheMode
+from pyocf.types.core import Core
+from pyocf.types.volume import Volume, TraceDevice
+from pyocf.types.data import Data
+from pyocf.types.io import IoDir
+from pyocf.utils import Size
+from pyocf.types.shared import OcfCompletion, OcfError
+
+
+def _io(core, addr, size, io_class, data):
+    comp = OcfCompletion([("error", c_int)])
+    io = core.new_io(core.cache.get_default_queue(), addr, size, IoDir.READ, io_class, 0)
+    io.set_data(data)
+    io.callback = comp.callback
+    io.submit()
+    comp.wait()
+    assert not comp.results["error"], "No IO should fail"
+
+
+@pytest.mark.parametrize("range_count", [0, 16, 4096])
+def test_io_class_ranges_classify(pyocf_ctx, range_count):
+    """
+    Set LBA ranges on core and check IO class of I/O passed to core volume.
+
+    I/O starting within a range is assigned IO class of the range, other I/O
+    keeps IO class given by submitter.
+    """
+    seen = {}
+
+    def trace(vol, io):
+        seen[io.contents._addr] = io.contents._class
+        return True
+
+    cache_device = Volume(Size.from_MiB(30))
+    core_device = TraceDevice(Size.from_MiB(64), trace_fcn=trace)
+    io_size = Size.from_KiB(4)
+
+    cache = Cache.start_on_device(cache_device, cache_mode=CacheMode.PT)
+    core = Core.using_device(core_device)
+    cache.add_core(core)
+
+    # Every other chunk of core is covered by a range
+    chunk = core_device.size.B // max(range_count, 1) // 2
+    ranges = [
+        (2 * i * chunk, (2 * i + 1) * chunk, 1 + i % 32)
+        for i in range(range_count)
+    ]
+    shuffle(ranges)
+    core.set_io_class_ranges(ranges)
+
+    def expected(addr):
+        i = addr // chunk
+        return 1 + (i // 2) % 32 if range_count and i % 2 == 0 else 0
+
+    addrs = list(range(0, core_device.size.B - io_size.B, Size.from_KiB(68).B))
+    data = Data(io_size.B)
+
+    for addr in addrs:
+        _io(core, addr, io_size.B, 0, data)
+
+    for addr in addrs:
+        assert seen[addr] == expected(addr), f"Wrong IO class at {addr}"
+
+    # Ranges are swapped at once and can be removed
+    core.set_io_class_ranges([])
+    seen.clear()
+    _io(core, 0, io_size.B, 0, data)
+    assert seen[0] == 0
+
+
+def test_io_class_ranges_boundaries(pyocf_ctx):
+    """
+    Range covers its start address and ends before its end address.
+
+    Only start address of I/O is classified, so I/O starting in the last sector
+    of a range takes class of the range even if it spans past its end. I/O
+    classified by no range keeps IO class given by submitter.
+    """
+    seen = {}
+
+    def trace(vol, io):
+        seen[io.contents._addr] = io.contents._class
+        return True
+
+    sector = 512
+    cache = Cache.start_on_device(Volume(Size.from_MiB(30)), cache_mode=CacheMode.PT)
+    core = Core.using_device(TraceDevice(Size.from_MiB(16), trace_fcn=trace))
+    cache.add_core(core)
+
+    # Adjacent ranges and a gap before the last one
+    start, middle, end = 2 * 4096, 6 * 4096, 8 * 4096
+    core.set_io_class_ranges([(middle, end, 2), (start, middle, 1), (end + 4096, 16 * 4096, 3)])
+
+    for addr, io_class in [
+        (start - sector, 5),
+        (start, 1),
+        (middle - sector, 1),
+        (middle, 2),
+        (end - sector, 2),
+        (end, 5),
+        (end + 4096 - sector, 5),
+        (end + 4096, 3),
+    ]:
+        data = Data(4096)
+        _io(core, addr, 4096, 5, data)
+        assert seen[addr] == io_class, f"Wrong IO class at {addr}"
+
+
+def test_io_class_ranges_invalid(pyocf_ctx):
+    """
+    Overlapping, empty and ranges with invalid IO class are rejected.
+    """
+    cache = Cache.start_on_device(Volume(Size.from_MiB(30)), cache_mode=CacheMode.PT)
+    core = Core.using_device(Volume(Size.from_MiB(16)))
+    cache.add_core(core)
+
+    core.set_io_class_ranges([(0, 4096, 1)])
+
+    for ranges in [
+        [(0, 8192, 1), (4096, 12288, 2)],
+        [(4096, 4096, 1)],
+        [(0, 4096, 1000)],
+    ]:
+        with pytest.raises(OcfError):
+            core.set_io_class_ranges(ranges)
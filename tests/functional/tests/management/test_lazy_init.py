@@ -0,0 +1,92 @@
+#
+# Copyright(c) 2020 Intel Corporation
+# SPDX-License-Identifier: BSD-3-Clause-Clear
+#
+
+from ctypes import c_int
+
+import pytest
+
+from pyocf.types.cache import Cache, CacheMode
+from pyocf.types.core import Core
+from pyocf.types.volume import Volume
+from pyocf.types.data import Data
+from pyocf.types.io import IoDir
+from pyocf.utils import Size
+from pyocf.types.shared import OcfCompletion, OcfError, SeqCutOffPolicy
+
+
+def _io(core, addr, size, direction, data):
+    comp = OcfCompletion([("error", c_int)])
+    io = core.new_io(core.cache.get_default_queue(), addr, size, direction, 0, 0)
+    io.set_data(data)
+    io.callback = comp.callback
+    io.submit()
+    comp.wait()
+    assert not comp.results["error"], "No IO should fail"
+
+
+def _initialized(log):
+    return [line for line in log.get_lines() if "Metadata initialized" in line]
+
+
+@pytest.mark.parametrize("lazy_init", [False, True])
+def test_lazy_init_attach(pyocf_ctx_log_buffer, lazy_init):
+    """
+    Serve I/O on a large cache while its metadata is initialized.
+
+    With lazy init metadata is initialized in background, so first IO may be served
+    before whole collision table is initialized. Data written right after attach has to
+    be cached and read back correctly. Cache device state from before initialization was
+    flushed must not be loadable, while whole cache has to be usable and persistent once
+    initialization is finished.
+    """
+    log = pyocf_ctx_log_buffer
+    cache_device = Volume(Size.from_MiB(1024))
+    core_device = Volume(Size.from_MiB(64))
+    chunk = Size.from_KiB(128)
+
+    cache = Cache(owner=cache_device.owner, cache_mode=CacheMode.WB)
+    cache.start_cache()
+    cache.attach_device(cache_device, force=True, lazy_init=lazy_init)
+
+    # Initialized metadata is flushed only after it is logged, so if nothing was logged
+    # yet, the copy is from before the flush
+    snapshot = cache_device.get_copy()
+    snapshot_initialized = bool(_initialized(log))
+
+    core = Core.using_device(core_device)
+    cache.add_core(core)
+    cache.set_seq_cut_off_policy(SeqCutOffPolicy.NEVER)
+
+    data = Data(chunk.B)
+    data.write(b"\xa5" * chunk.B, chunk.B)
+    for addr in range(0, core_device.size.B, chunk.B):
+        _io(core, addr, chunk.B, IoDir.WRITE, data)
+
+    lines = core_device.size.B // Size.from_KiB(4).B
+    stats = cache.get_stats()
+    assert stats["usage"]["occupancy"]["value"] == lines
+    assert stats["usage"]["dirty"]["value"] == lines
+
+    read = Data(chunk.B)
+    _io(core, 0, chunk.B, IoDir.READ, read)
+    assert read.md5() == data.md5(), "Data written after attach should be read back"
+
+    cache.stop()
+
+    # Stop waits for initialization to finish
+    assert len(_initialized(log)) == (1 if lazy_init else 0)
+    assert not any("Failed to flush" in line for line in log.get_lines())
+
+    if lazy_init and not snapshot_initialized:
+        with pytest.raises(OcfError, match="OCF_ERR_NO_METADATA"):
+            Cache.load_from_device(snapshot)
+        assert any("Metadata was not initialized" in line for line in log.get_lines())
+
+    cache = Cache.load_from_device(cache_device)
+    stats = cache.get_stats()
+    assert stats["usage"]["occupancy"]["value"] == lines
+    assert stats["usage"]["dirty"]["value"] == lines
+    assert stats["usage"]["free"]["value"] == int(stats["conf"]["size"]) - lines, \
+        "All lines not mapped should be free after initialization"